@@ -0,0 +1,63 @@
+/**
+ * @file    eeprom_map.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   EEPROM address map of the persisted settings (256 bytes on the
+ * ATmega4809). Each block starts with its own tag byte, and its owner loads
+ * the defaults when the tag or the checksum does not match.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __EEPROM_MAP_H__
+#define __EEPROM_MAP_H__
+
+// Serial number: 'S', three digits and a checksum (5 bytes)
+#define EEPROM_SN_ADDR 0
+
+// SD card logging settings (SDLogConfig)
+#define EEPROM_LOGCFG_ADDR 8
+
+// Log file counter (SDFileIndex), written once per log file
+#define EEPROM_FILEIDX_ADDR 32
+
+// Hall sensor ADC acquisition profile (HallADCProfile)
+#define EEPROM_ADCCFG_ADDR 56
+
+// Hall sensor burst capture settings (HallBurstConfig)
+#define EEPROM_BURSTCFG_ADDR 64
+
+// Hall to gape calibration (HallCalibration, 100 bytes)
+#define EEPROM_CALIB_ADDR 72
+
+// Measured hall sensor settling time (HallSettling)
+#define EEPROM_SETTLE_ADDR 176
+
+// Hall sensor power mode (HallPowerConfig)
+#define EEPROM_HALLPWR_ADDR 184
+
+// Enabled hall channels (HallChannelConfig)
+#define EEPROM_CHANNELS_ADDR 188
+
+// ROM codes of the temperature probes (TempProbeCache, 36 bytes)
+#define EEPROM_PROBES_ADDR 192
+
+// Temperature acquisition period and resolution (TempConfig)
+#define EEPROM_TEMPCFG_ADDR 228
+
+// Sample scheduling mode and period (RTCScheduleConfig, 8 bytes)
+#define EEPROM_SCHED_ADDR 236
+
+#endif  // !__EEPROM_MAP_H__
@@ -0,0 +1,29 @@
+/**
+ * @file    fw_version.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Firmware version, stored in the header of binary log files.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FW_VERSION_H__
+#define __FW_VERSION_H__
+
+#define FW_VERSION_MAJOR 0
+#define FW_VERSION_MINOR 3
+#define FW_VERSION_PATCH 0
+
+#endif  // !__FW_VERSION_H__
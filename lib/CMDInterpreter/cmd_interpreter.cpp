@@ -11,6 +11,8 @@
 #include "cmd_interpreter.h"
 #include <Arduino.h>
 
+#include "log_format.h"
+
 // Forward declarations of functions that execute the commands
 extern bool setSerialNumber(uint16_t);
 extern bool getSerialNumber(uint16_t& sn);
@@ -20,6 +22,48 @@ extern void SDCard_initFileName(const uint16_t year, const uint8_t month,
                                 const uint8_t day, const uint8_t hour,
                                 const uint8_t minute, const uint8_t second,
                                 const uint16_t serial_number);
+extern void SDCard_setFlushPolicy(const uint8_t records,
+                                  const uint16_t seconds);
+extern void SDCard_printStats(void);
+extern void SDCard_setPreallocation(const uint16_t days);
+extern bool SDCard_close(void);
+extern bool SDCard_setFormat(const uint8_t format);
+extern void SDCard_setRollover(const bool daily, const uint16_t megabytes);
+extern void SDCard_printHealth(void);
+extern bool HALL_setADCProfile(const uint8_t samples, const uint16_t prescaler,
+                               const uint8_t sample_length,
+                               const bool sample_cap, const uint8_t shift);
+extern void HALL_getADCConfig(LogADCConfig* adc);
+extern void HALL_printADCProfile(void);
+extern void SDCard_setADCConfig(const LogADCConfig& adc);
+extern bool HALL_setBurst(const uint8_t rate_hz, const uint16_t threshold,
+                          const uint8_t pre);
+extern void HALL_printBurst(void);
+extern bool HALL_setCalPoint(const uint8_t channel, const uint8_t point,
+                             const uint16_t raw, const uint16_t gape_um);
+extern bool HALL_saveCalibration(void);
+extern void HALL_getCalibration(LogCalibration* cal);
+extern void HALL_printCalibration(const uint8_t channel, const bool pending);
+extern void SDCard_setCalibration(const LogCalibration& cal);
+extern bool HALL_measureSettling(void);
+extern void HALL_printSettling(void);
+extern void HALL_setPower(const bool sequenced);
+extern void HALL_printPower(void);
+extern bool HALL_setChannelMask(const uint8_t mask);
+extern void HALL_printChannels(void);
+extern void SDCard_setChannelMask(const uint8_t hall_mask);
+extern void SDCard_setChangeFilter(const uint16_t hall_band,
+                                   const uint16_t temp_band,
+                                   const uint16_t heartbeat_s);
+extern bool SDCard_setStats(const uint16_t window_s, const uint16_t raw_every);
+extern void SDCard_printStatsConfig(void);
+extern void TEMP_printProbes(void);
+extern void TEMP_clearProbes(void);
+extern bool TEMP_setConfig(const uint16_t period_s, const uint8_t resolution,
+                           const bool fill_empty);
+extern void TEMP_printConfig(void);
+extern bool RTC_setSchedule(const uint8_t mode, const uint32_t period_ms);
+extern void RTC_printSchedule(void);
 
 // #define DEBUG
 
@@ -95,6 +139,358 @@ bool _cmd_setDateAndtime(const char* datetime) {
     return false;
 }
 
+/**
+ * @brief Attempts to parse a flush policy in the format "RECORDS SECONDS" and,
+ * if successful, applies it to the SD card logging engine
+ *
+ * @param[in] policy    Records (0-255) and seconds (0-65535) between flushes,
+ *                      0 disables that condition
+ *
+ * @return True if the flush policy was successfully set, false otherwise.
+ */
+bool _cmd_setFlushPolicy(const char* policy) {
+    uint16_t _records, _seconds;
+    if (policy == NULL ||
+        sscanf(policy, "%hu %hu", &_records, &_seconds) != 2 ||
+        _records > 255) {
+#ifdef DEBUG
+        Serial.print(F("Unable to parse flush policy\n"));
+#endif
+        return false;
+    }
+
+    SDCard_setFlushPolicy(_records, _seconds);
+    return true;
+}
+
+/**
+ * @brief Attempts to parse the number of days of records to pre-allocate for
+ * the next log file and, if successful, applies it to the SD card logging
+ * engine
+ *
+ * @param[in] days      Days to pre-allocate (0-3650), 0 disables it
+ *
+ * @return True if the pre-allocation was successfully set, false otherwise.
+ */
+bool _cmd_setPreallocation(const char* days) {
+    uint16_t _days;
+    if (days == NULL || sscanf(days, "%hu", &_days) != 1 || _days > 3650) {
+#ifdef DEBUG
+        Serial.print(F("Unable to parse pre-allocation days\n"));
+#endif
+        return false;
+    }
+
+    SDCard_setPreallocation(_days);
+    return true;
+}
+
+/**
+ * @brief Attempts to parse a log record format name ("CSV", "BIN" or "DELTA")
+ * and, if successful, selects it for the next log file
+ *
+ * @param[in] format    CSV, BIN or DELTA
+ *
+ * @return True if the format was successfully set, false otherwise.
+ */
+bool _cmd_setFormat(const char* format) {
+    if (format == NULL) {
+        return false;
+    }
+    if (strstr(format, "CSV")) {
+        return !SDCard_setFormat(0);  // LOG_FORMAT_CSV
+    }
+    if (strstr(format, "BIN")) {
+        return !SDCard_setFormat(1);  // LOG_FORMAT_PACKED
+    }
+    if (strstr(format, "DELTA")) {
+        return !SDCard_setFormat(2);  // LOG_FORMAT_DELTA
+    }
+#ifdef DEBUG
+    Serial.print(F("Unknown log format\n"));
+#endif
+    return false;
+}
+
+/**
+ * @brief Attempts to parse a hall sensor power mode ("SIM" or "SEQ") and, if
+ * successful, applies it to the next readings
+ *
+ * @param[in] mode      SIM (both groups together) or SEQ (one at a time)
+ *
+ * @return True if the mode was successfully set, false otherwise.
+ */
+bool _cmd_setHallPower(const char* mode) {
+    if (mode != NULL && (strstr(mode, "SIM") || strstr(mode, "SEQ"))) {
+        HALL_setPower(strstr(mode, "SEQ") != NULL);
+        HALL_printPower();
+        return true;
+    }
+#ifdef DEBUG
+    Serial.print(F("Unknown hall power mode\n"));
+#endif
+    return false;
+}
+
+/**
+ * @brief Attempts to parse the enabled hall channels as a list of column
+ * digits (1-6) and, if successful, applies them to the readings and the log
+ *
+ * @param[in] channels  Hall columns, e.g. "1256"
+ *
+ * @return True if the channels were successfully set, false otherwise.
+ */
+bool _cmd_setChannels(const char* channels) {
+    uint8_t _mask = 0;
+    for (const char* _p = channels; _p != NULL && *_p; ++_p) {
+        if (*_p < '1' || *_p > '6') {
+            _mask = 0;
+            break;
+        }
+        _mask |= 1 << (*_p - '1');
+    }
+    if (_mask == 0 || !HALL_setChannelMask(_mask)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set hall channels\n"));
+#endif
+        return false;
+    }
+
+    SDCard_setChannelMask(_mask);
+    HALL_printChannels();
+    return true;
+}
+
+/**
+ * @brief Attempts to parse a rollover policy in the format "DAILY MEGABYTES"
+ * and, if successful, applies it to the SD card logging engine
+ *
+ * @param[in] policy    1 for a new file every day (0 otherwise) and the file
+ *                      size limit in MB (0-4095, 0 disables it)
+ *
+ * @return True if the rollover policy was successfully set, false otherwise.
+ */
+bool _cmd_setRollover(const char* policy) {
+    uint16_t _daily, _mb;
+    if (policy == NULL || sscanf(policy, "%hu %hu", &_daily, &_mb) != 2 ||
+        _daily > 1 || _mb > 4095) {
+#ifdef DEBUG
+        Serial.print(F("Unable to parse rollover policy\n"));
+#endif
+        return false;
+    }
+
+    SDCard_setRollover(_daily, _mb);
+    return true;
+}
+
+/**
+ * @brief Attempts to parse an ADC acquisition profile in the format "SAMPLES
+ * PRESCALER LENGTH CAP SHIFT" and, if successful, applies it to the hall
+ * sensor readings and continues the log in a new file
+ *
+ * @param[in] profile   Accumulated samples (1-64, power of 2), ADC clock
+ *                      prescaler (16-256, power of 2), extra sample cycles
+ *                      (0-31), reduced sample capacitance (0-1) and result
+ *                      right shift (0-6)
+ *
+ * @return True if the profile was successfully set, false otherwise.
+ */
+bool _cmd_setADCProfile(const char* profile) {
+    uint16_t _samples, _presc, _len, _cap, _shift;
+    if (profile == NULL ||
+        sscanf(profile, "%hu %hu %hu %hu %hu", &_samples, &_presc, &_len,
+               &_cap, &_shift) != 5 ||
+        _samples > 64 || _len > 31 || _cap > 1 ||
+        !HALL_setADCProfile(_samples, _presc, _len, _cap, _shift)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set ADC profile\n"));
+#endif
+        return false;
+    }
+
+    LogADCConfig _adc;
+    HALL_getADCConfig(&_adc);
+    SDCard_setADCConfig(_adc);
+    HALL_printADCProfile();
+    return true;
+}
+
+/**
+ * @brief Parses and sets change-driven logging
+ *
+ * @param[in] filter    Hall band in counts (0-4095), temperature band in
+ *                      centi-degrees and heartbeat in seconds (0: off)
+ *
+ * @return True if the settings were successfully set, false otherwise.
+ */
+bool _cmd_setChangeFilter(const char* filter) {
+    uint16_t _hall, _temp, _heartbeat;
+    if (filter == NULL ||
+        sscanf(filter, "%hu %hu %hu", &_hall, &_temp, &_heartbeat) != 3 ||
+        _hall > 4095) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set change-driven logging\n"));
+#endif
+        return false;
+    }
+
+    SDCard_setChangeFilter(_hall, _temp, _heartbeat);
+    return true;
+}
+
+/**
+ * @brief Parses and sets the interval statistics
+ *
+ * @param[in] stats     Window in seconds (0 or 2-3600) and decimation of the
+ *                      samples still logged in seconds (0: none)
+ *
+ * @return True if the settings were successfully set, false otherwise.
+ */
+bool _cmd_setStats(const char* stats) {
+    uint16_t _window, _raw;
+    if (stats == NULL || sscanf(stats, "%hu %hu", &_window, &_raw) != 2 ||
+        _window == 1 || SDCard_setStats(_window, _raw)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set interval statistics\n"));
+#endif
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses and sets the temperature acquisition period, resolution and
+ * the value of the records between readings
+ *
+ * @param[in] temp      Period (1-3600 s), resolution (9-12 bits) and an
+ *                      optional fill (0: last reading, 1: empty)
+ *
+ * @return True if the settings were successfully set, false otherwise.
+ */
+bool _cmd_setTemp(const char* temp) {
+    uint16_t _period, _bits, _empty = 0;
+    if (temp == NULL ||
+        sscanf(temp, "%hu %hu %hu", &_period, &_bits, &_empty) < 2 ||
+        _empty > 1 || _bits > 12 ||
+        TEMP_setConfig(_period, _bits, _empty)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set temperature acquisition\n"));
+#endif
+        return false;
+    }
+    TEMP_printConfig();
+    return true;
+}
+
+/**
+ * @brief Parses and sets the sample scheduling, applied at the next boot
+ *
+ * @param[in] sched     Mode (ALARM, SQW, TIMER or 0-2) and period in
+ *                      milliseconds: whole seconds up to 1 min with ALARM and
+ *                      up to 12 h with SQW, 10 ms to 12 h with TIMER (see
+ *                      RTC_setSchedule())
+ *
+ * @return True if the settings were successfully set, false otherwise.
+ */
+bool _cmd_setSchedule(const char* sched) {
+    uint16_t _mode;
+    unsigned long _period;
+    if (sched != NULL && strstr(sched, "ALARM") == sched) {
+        _mode = 0;  // RTC_SCHED_ALARM
+        sched += 5;
+    } else if (sched != NULL && strstr(sched, "SQW") == sched) {
+        _mode = 1;  // RTC_SCHED_SQW
+        sched += 3;
+    } else if (sched != NULL && strstr(sched, "TIMER") == sched) {
+        _mode = 2;  // RTC_SCHED_TIMER
+        sched += 5;
+    } else if (sched == NULL || sscanf(sched, "%hu", &_mode) != 1) {
+        sched = NULL;
+    } else {
+        sched = strchr(sched, ' ');
+    }
+    if (sched == NULL || sscanf(sched, "%lu", &_period) != 1 || _mode > 255 ||
+        RTC_setSchedule(_mode, _period)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set sample scheduling\n"));
+#endif
+        return false;
+    }
+    RTC_printSchedule();
+    return true;
+}
+
+/**
+ * @brief Parses and sets a breakpoint of the pending gape calibration
+ *
+ * @param[in] point     Channel (1-6), breakpoint (1-4, 0 clears the channel),
+ *                      hall value and gape in micrometres
+ *
+ * @return True if the breakpoint was successfully set, false otherwise.
+ */
+bool _cmd_setCalPoint(const char* point) {
+    uint16_t _channel, _point, _raw = 0, _gape = 0;
+    int _n = point == NULL ? 0
+                           : sscanf(point, "%hu %hu %hu %hu", &_channel,
+                                    &_point, &_raw, &_gape);
+    if ((_n != 4 && !(_n == 2 && _point == 0)) || _channel > 255 ||
+        _point > 255 || !HALL_setCalPoint(_channel, _point, _raw, _gape)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set calibration point\n"));
+#endif
+        return false;
+    }
+
+    HALL_printCalibration(_channel, true);
+    return true;
+}
+
+/**
+ * @brief Applies the pending gape calibration and continues the log in a new
+ * file that records it
+ *
+ * @return True if the calibration was successfully applied, false otherwise.
+ */
+bool _cmd_saveCalibration(void) {
+    if (!HALL_saveCalibration()) {
+#ifdef DEBUG
+        Serial.print(F("Invalid calibration\n"));
+#endif
+        return false;
+    }
+
+    LogCalibration _cal;
+    HALL_getCalibration(&_cal);
+    SDCard_setCalibration(_cal);
+    HALL_printCalibration(0, false);
+    return true;
+}
+
+/**
+ * @brief Parses and sets the burst capture settings
+ *
+ * @param[in] burst     Sample rate in Hz (20-100, 0 turns it off), trigger
+ *                      threshold in counts and pre-trigger samples
+ *
+ * @return True if the settings were successfully set, false otherwise.
+ */
+bool _cmd_setBurst(const char* burst) {
+    uint16_t _rate, _threshold, _pre;
+    if (burst == NULL ||
+        sscanf(burst, "%hu %hu %hu", &_rate, &_threshold, &_pre) != 3 ||
+        _rate > 255 || _pre > 255 ||
+        !HALL_setBurst(_rate, _threshold, _pre)) {
+#ifdef DEBUG
+        Serial.print(F("Unable to set burst capture\n"));
+#endif
+        return false;
+    }
+
+    HALL_printBurst();
+    return true;
+}
+
 void CMD_readCommand(void) {
     static uint8_t _bytesR = 0;   // Buffer position
     while (Serial.available()) {  // Loop while incoming serial data
@@ -120,6 +516,64 @@ void CMD_readCommand(void) {
                 _command = COMMANDS::SetSerialNumber;
             else if (strstr(_cmd, "SETDT"))
                 _command = COMMANDS::SetDateAndTime;
+            else if (strstr(_cmd, "SETFLUSH"))
+                _command = COMMANDS::SetFlushPolicy;
+            else if (strstr(_cmd, "LOGSTAT"))
+                _command = COMMANDS::GetLogStats;
+            else if (strstr(_cmd, "SETPREALLOC"))
+                _command = COMMANDS::SetPreallocation;
+            else if (strstr(_cmd, "LOGSTOP"))
+                _command = COMMANDS::StopLog;
+            else if (strstr(_cmd, "SETFORMAT"))
+                _command = COMMANDS::SetLogFormat;
+            else if (strstr(_cmd, "SETROLL"))
+                _command = COMMANDS::SetRollover;
+            else if (strstr(_cmd, "SDHEALTH"))
+                _command = COMMANDS::GetCardHealth;
+            else if (strstr(_cmd, "SETADC"))
+                _command = COMMANDS::SetADCProfile;
+            else if (strstr(_cmd, "ADCINFO"))
+                _command = COMMANDS::GetADCProfile;
+            else if (strstr(_cmd, "SETBURST"))
+                _command = COMMANDS::SetBurst;
+            else if (strstr(_cmd, "BURSTSTAT"))
+                _command = COMMANDS::GetBurstStats;
+            else if (strstr(_cmd, "SETCHANGE"))
+                _command = COMMANDS::SetChangeFilter;
+            else if (strstr(_cmd, "SETCAL"))
+                _command = COMMANDS::SetCalPoint;
+            else if (strstr(_cmd, "CALSAVE"))
+                _command = COMMANDS::SaveCalibration;
+            else if (strstr(_cmd, "CALINFO"))
+                _command = COMMANDS::GetCalibration;
+            else if (strstr(_cmd, "HALLSETTLE"))
+                _command = COMMANDS::MeasureSettling;
+            else if (strstr(_cmd, "SETTLEINFO"))
+                _command = COMMANDS::GetSettling;
+            else if (strstr(_cmd, "SETHALLPWR"))
+                _command = COMMANDS::SetHallPower;
+            else if (strstr(_cmd, "HALLPWRSTAT"))
+                _command = COMMANDS::GetHallPower;
+            else if (strstr(_cmd, "SETCHANNELS"))
+                _command = COMMANDS::SetChannels;
+            else if (strstr(_cmd, "CHANNELINFO"))
+                _command = COMMANDS::GetChannels;
+            else if (strstr(_cmd, "SETSTATS"))
+                _command = COMMANDS::SetStats;
+            else if (strstr(_cmd, "STATSINFO"))
+                _command = COMMANDS::GetStats;
+            else if (strstr(_cmd, "PROBEINFO"))
+                _command = COMMANDS::GetProbes;
+            else if (strstr(_cmd, "PROBESCAN"))
+                _command = COMMANDS::ScanProbes;
+            else if (strstr(_cmd, "SETTEMP"))
+                _command = COMMANDS::SetTemp;
+            else if (strstr(_cmd, "TEMPINFO"))
+                _command = COMMANDS::GetTemp;
+            else if (strstr(_cmd, "SETSCHED"))
+                _command = COMMANDS::SetSchedule;
+            else if (strstr(_cmd, "SCHEDINFO"))
+                _command = COMMANDS::GetSchedule;
             else
                 _command = COMMANDS::Unknown;  // Otherwise set to not found
 
@@ -131,7 +585,7 @@ void CMD_readCommand(void) {
                 case COMMANDS::SetSerialNumber:
                     // Call set serial number function with the next token
                     // delimited by end of buffer
-                    _cmd_setSerialNumber(strtok(NULL, '\0'));
+                    _cmd_setSerialNumber(strtok(NULL, ""));
                     break;
 
                 /** -------------------------------------------------------
@@ -144,7 +598,7 @@ void CMD_readCommand(void) {
                  * Set the device date and time
                  * ------------------------------------------------------- */
                 case COMMANDS::SetDateAndTime:
-                    _cmd_setDateAndtime(strtok(NULL, '\0'));
+                    _cmd_setDateAndtime(strtok(NULL, ""));
                     break;
 
                 /** -------------------------------------------------------
@@ -153,6 +607,214 @@ void CMD_readCommand(void) {
                 case COMMANDS::GetDateAndTime:
                     break;
 
+                /** -------------------------------------------------------
+                 * Set the log buffer flush policy
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetFlushPolicy:
+                    _cmd_setFlushPolicy(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the logging engine counters
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetLogStats:
+                    SDCard_printStats();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the log file pre-allocation
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetPreallocation:
+                    _cmd_setPreallocation(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Flush, truncate and close the log file (clean stop)
+                 * ------------------------------------------------------- */
+                case COMMANDS::StopLog:
+                    SDCard_close();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the record format of the next log file
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetLogFormat:
+                    _cmd_setFormat(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the log file rollover policy
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetRollover:
+                    _cmd_setRollover(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the SD card health counters
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetCardHealth:
+                    SDCard_printHealth();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the ADC acquisition profile of the hall sensors
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetADCProfile:
+                    _cmd_setADCProfile(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the ADC acquisition profile
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetADCProfile:
+                    HALL_printADCProfile();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the burst capture rate, trigger and window
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetBurst:
+                    _cmd_setBurst(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the burst capture settings and counters
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetBurstStats:
+                    HALL_printBurst();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the change-driven logging bands and heartbeat
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetChangeFilter:
+                    _cmd_setChangeFilter(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Edit a breakpoint of the pending gape calibration
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetCalPoint:
+                    _cmd_setCalPoint(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Apply and store the pending gape calibration
+                 * ------------------------------------------------------- */
+                case COMMANDS::SaveCalibration:
+                    _cmd_saveCalibration();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the gape calibration in use
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetCalibration:
+                    HALL_printCalibration(0, false);
+                    break;
+
+                /** -------------------------------------------------------
+                 * Measure the settling time of the hall sensor groups
+                 * ------------------------------------------------------- */
+                case COMMANDS::MeasureSettling:
+                    if (!HALL_measureSettling()) {
+#ifdef DEBUG
+                        Serial.print(F("Hall sensors did not settle\n"));
+#endif
+                    }
+                    HALL_printSettling();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the settling time of the hall sensor groups
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetSettling:
+                    HALL_printSettling();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the hall sensor power mode
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetHallPower:
+                    _cmd_setHallPower(strtok(NULL, " "));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the hall power mode and reading timing
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetHallPower:
+                    HALL_printPower();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the enabled hall channels
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetChannels:
+                    _cmd_setChannels(strtok(NULL, " "));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the enabled hall channels
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetChannels:
+                    HALL_printChannels();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the interval statistics window and raw decimation
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetStats:
+                    _cmd_setStats(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the interval statistics settings
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetStats:
+                    SDCard_printStatsConfig();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the cached temperature probes
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetProbes:
+                    TEMP_printProbes();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Forget the cached probes, enumerated again at next boot
+                 * ------------------------------------------------------- */
+                case COMMANDS::ScanProbes:
+                    TEMP_clearProbes();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the temperature acquisition period and resolution
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetTemp:
+                    _cmd_setTemp(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the temperature acquisition settings
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetTemp:
+                    TEMP_printConfig();
+                    break;
+
+                /** -------------------------------------------------------
+                 * Set the sample scheduling mode and period
+                 * ------------------------------------------------------- */
+                case COMMANDS::SetSchedule:
+                    _cmd_setSchedule(strtok(NULL, ""));
+                    break;
+
+                /** -------------------------------------------------------
+                 * Print the sample scheduling and software clock counters
+                 * ------------------------------------------------------- */
+                case COMMANDS::GetSchedule:
+                    RTC_printSchedule();
+                    break;
+
                 /** -------------------------------------------------------
                  * Unknown command
                  * ------------------------------------------------------- */
@@ -37,6 +37,130 @@
  *   Sets the current date and time
  *   Example: `SETDT 2024-01-31 01:23:45`
  *
+ * - `SETFLUSH N T`
+ *   Flushes the SD log buffer every <N> records or every <T> seconds,
+ *   whichever comes first (0 disables a condition)
+ *   Example: `SETFLUSH 60 60`
+ *
+ * - `LOGSTAT`
+ *   Prints the logging engine counters (M110)
+ *
+ * - `SETPREALLOC D`
+ *   Pre-allocates <D> days of records as a contiguous extent for the next
+ *   log file (0 disables it)
+ *   Example: `SETPREALLOC 30`
+ *
+ * - `LOGSTOP`
+ *   Flushes, truncates and closes the log file before removing the card
+ *
+ * - `SETFORMAT CSV|BIN|DELTA`
+ *   Selects CSV text, packed binary or delta-encoded records for the next
+ *   log file
+ *   Example: `SETFORMAT DELTA`
+ *
+ * - `SETROLL D M`
+ *   Continues the log in a new file every day (<D> = 1) and/or when the file
+ *   reaches <M> MB (0 disables a condition)
+ *   Example: `SETROLL 1 0`
+ *
+ * - `SDHEALTH`
+ *   Prints the SD card latency histograms, retries and errors (M112)
+ *
+ * - `SETADC N P L C S`
+ *   Sets the hall ADC profile: <N> accumulated samples (1-64), ADC clock
+ *   prescaler <P> (16-256), <L> extra sample cycles (0-31), reduced sample
+ *   capacitance <C> (0-1) and result right shift <S> (0-6). Logging continues
+ *   in a new file.
+ *   Example: `SETADC 64 64 0 0 4`
+ *
+ * - `ADCINFO`
+ *   Prints the hall ADC profile and the time of a reading (M113)
+ *
+ * - `SETCHANGE H T B`
+ *   Writes a record only when a hall value moves more than <H> counts or the
+ *   temperature more than <T> centi-degrees from the last record written, or
+ *   <B> seconds after it (<B> = 0 writes every sample)
+ *   Example: `SETCHANGE 8 10 300`
+ *
+ * - `SETCAL C P R G`
+ *   Sets breakpoint <P> (1-4) of hall channel <C> (1-6) of the pending gape
+ *   calibration to hall value <R> and gape <G> in micrometres; <P> = 0 clears
+ *   the channel. Applied with `CALSAVE`.
+ *   Example: `SETCAL 1 1 800 9000`
+ *
+ * - `CALSAVE`
+ *   Applies and stores the pending gape calibration (M115)
+ *
+ * - `CALINFO`
+ *   Prints the gape calibration in use (M115)
+ *
+ * - `HALLSETTLE`
+ *   Measures and stores the settling time of the hall sensor groups (M116)
+ *
+ * - `SETTLEINFO`
+ *   Prints the settling times and the power-up delay of a reading (M116)
+ *
+ * - `SETHALLPWR SIM|SEQ`
+ *   Powers the two hall sensor groups together (SIM) or one at a time (SEQ)
+ *   Example: `SETHALLPWR SEQ`
+ *
+ * - `HALLPWRSTAT`
+ *   Prints the hall power mode and the timing of the readings (M117)
+ *
+ * - `SETCHANNELS CCC`
+ *   Converts, powers and logs only the hall channels listed as column
+ *   digits (1-6); logging continues in a new file
+ *   Example: `SETCHANNELS 1256`
+ *
+ * - `CHANNELINFO`
+ *   Prints the enabled hall channels (M118)
+ *
+ * - `SETSTATS W R`
+ *   Logs one summary (min, max, mean and variance) of every <W> seconds
+ *   (2-3600, 0 turns it off) and only the samples at multiples of <R>
+ *   seconds (0: none); logging continues in a new file
+ *   Example: `SETSTATS 60 0`
+ *
+ * - `STATSINFO`
+ *   Prints the interval statistics settings (M120)
+ *
+ * - `PROBEINFO`
+ *   Prints the ROM code of each cached temperature probe (M121)
+ *
+ * - `PROBESCAN`
+ *   Forgets the cached temperature probes; the bus is enumerated again at
+ *   the next boot
+ *
+ * - `SETTEMP P R [F]`
+ *   Reads the temperature every <P> seconds (1-3600) at <R> bits (9-12);
+ *   the records between readings carry the last one (<F> 0, default) or
+ *   leave it empty (<F> 1)
+ *   Example: `SETTEMP 30 10 0`
+ *
+ * - `TEMPINFO`
+ *   Prints the temperature acquisition settings (M122)
+ *
+ * - `SETSCHED M P`
+ *   Wakes the device from the DS3231 1 Hz square wave with the time kept
+ *   in software (<M> SQW or 1, default), from an alarm re-armed every
+ *   sample (<M> ALARM or 0) or from the internal RTC counter disciplined by
+ *   the DS3231 (<M> TIMER or 2), and samples every <P> milliseconds: whole
+ *   seconds up to a minute with the alarm or 12 h with the square wave,
+ *   10 ms to 12 h with the timer. Applied at the next boot
+ *   Example: `SETSCHED SQW 5000`, `SETSCHED TIMER 100`
+ *
+ * - `SCHEDINFO`
+ *   Prints the sample scheduling and the software clock counters (M123)
+ *
+ * - `SETBURST R T P`
+ *   Samples the hall sensors at <R> Hz (20-100, 0 turns it off) and saves
+ *   a window around every change larger than <T> counts, <P> samples of it
+ *   before the trigger
+ *   Example: `SETBURST 50 150 16`
+ *
+ * - `BURSTSTAT`
+ *   Prints the burst capture settings, events and overruns (M114)
+ *
  * Notes:
  * - All commands must be sent in plain ASCII via the serial interface.
  * - Responses or acknowledgments may be printed back over serial.
@@ -46,7 +170,36 @@ enum COMMANDS {
     SetSerialNumber,
     GetSerialNumber,
     SetDateAndTime,
-    GetDateAndTime
+    GetDateAndTime,
+    SetFlushPolicy,
+    GetLogStats,
+    SetPreallocation,
+    StopLog,
+    SetLogFormat,
+    SetRollover,
+    GetCardHealth,
+    SetADCProfile,
+    GetADCProfile,
+    SetBurst,
+    GetBurstStats,
+    SetChangeFilter,
+    SetCalPoint,
+    SaveCalibration,
+    GetCalibration,
+    MeasureSettling,
+    GetSettling,
+    SetHallPower,
+    GetHallPower,
+    SetChannels,
+    GetChannels,
+    SetStats,
+    GetStats,
+    GetProbes,
+    ScanProbes,
+    SetTemp,
+    GetTemp,
+    SetSchedule,
+    GetSchedule
 };
 
 /**
@@ -36,6 +36,10 @@
 #define ERROR_SDCARD_INITFAIL_str   "(E020) SD initialization failed"
 #define ERROR_SDCARD_INITFAIL_short "E020"
 
+#define ERROR_SDCARD_WRITEFAIL_code  0x015
+#define ERROR_SDCARD_WRITEFAIL_str   "(E021) SD card write failed"
+#define ERROR_SDCARD_WRITEFAIL_short "E021"
+
 /** --------------------------------------------------------------------------
  * RTC and date/time
  * -------------------------------------------------------------------------- */
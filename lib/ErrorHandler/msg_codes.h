@@ -29,4 +29,63 @@
 #define MSG_SYS_READY_str   "(M100) Ready to send data"
 #define MSG_SYS_READY_short "M100"
 
+/** --------------------------------------------------------------------------
+ * SD card & file system
+ * -------------------------------------------------------------------------- */
+#define MSG_LOG_STATS_code  0x06E
+#define MSG_LOG_STATS_str   "(M110) Log statistics"
+#define MSG_LOG_STATS_short "M110"
+
+#define MSG_LOG_RESUMED_code  0x06F
+#define MSG_LOG_RESUMED_str   "(M111) Log file resumed"
+#define MSG_LOG_RESUMED_short "M111"
+
+#define MSG_CARD_HEALTH_code  0x070
+#define MSG_CARD_HEALTH_str   "(M112) SD card health"
+#define MSG_CARD_HEALTH_short "M112"
+
+#define MSG_ADC_PROFILE_code  0x071
+#define MSG_ADC_PROFILE_str   "(M113) ADC profile"
+#define MSG_ADC_PROFILE_short "M113"
+
+#define MSG_BURST_code  0x072
+#define MSG_BURST_str   "(M114) Burst capture"
+#define MSG_BURST_short "M114"
+
+#define MSG_CALIBRATION_code  0x073
+#define MSG_CALIBRATION_str   "(M115) Gape calibration"
+#define MSG_CALIBRATION_short "M115"
+
+#define MSG_SETTLING_code  0x074
+#define MSG_SETTLING_str   "(M116) Hall settling"
+#define MSG_SETTLING_short "M116"
+
+#define MSG_HALL_POWER_code  0x075
+#define MSG_HALL_POWER_str   "(M117) Hall power"
+#define MSG_HALL_POWER_short "M117"
+
+#define MSG_CHANNELS_code  0x076
+#define MSG_CHANNELS_str   "(M118) Hall channels"
+#define MSG_CHANNELS_short "M118"
+
+#define MSG_STATS_SUMMARY_code  0x077
+#define MSG_STATS_SUMMARY_str   "(M119) Interval statistics"
+#define MSG_STATS_SUMMARY_short "M119"
+
+#define MSG_STATS_CONFIG_code  0x078
+#define MSG_STATS_CONFIG_str   "(M120) Statistics settings"
+#define MSG_STATS_CONFIG_short "M120"
+
+#define MSG_PROBES_code  0x079
+#define MSG_PROBES_str   "(M121) Temperature probes"
+#define MSG_PROBES_short "M121"
+
+#define MSG_TEMP_CONFIG_code  0x07A
+#define MSG_TEMP_CONFIG_str   "(M122) Temperature settings"
+#define MSG_TEMP_CONFIG_short "M122"
+
+#define MSG_SCHEDULE_code  0x07B
+#define MSG_SCHEDULE_str   "(M123) Sample scheduling"
+#define MSG_SCHEDULE_short "M123"
+
 #endif  // !__MSG_CODES_H__
\ No newline at end of file
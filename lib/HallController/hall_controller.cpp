@@ -19,6 +19,10 @@
 
 #include "hall_controller.h"
 
+#include <avr/sleep.h>
+
+#include "msg_codes.h"
+
 // Group 0 hall sensors sleep pin and port
 #define HALL_SLEEP_GROUP0_PORT   PORTA
 #define HALL_SLEEP_GROUP0_PIN    PIN1CTRL
@@ -31,24 +35,215 @@
 
 #define PORTD_BASE_ADDR 0x460
 
-void ADC_init(void) {
+// Hall column of each ADC input AIN[0-5]
+static const uint8_t _order[6] = {3, 2, 1, 0, 4, 5};
+
+// Acquisition profile in use
+static HallADCProfile _profile;
+
+// Sleep control pins of the two sensor groups (set by HALL_initIO)
+static uint8_t _sleepPins[2];
+
+// ADC inputs of each sensor group
+static const uint8_t _groupAin[2][3] = {{3, 2, 1}, {0, 4, 5}};
+
+// Enabled channels, and the ADC inputs of a sweep and of each group they leave
+static HallChannelConfig _channels;
+static uint8_t _sweepAin[6] = {0, 1, 2, 3, 4, 5};
+static uint8_t _sweepN = 6;
+static uint8_t _groupList[2][3] = {{3, 2, 1}, {0, 4, 5}};
+static uint8_t _groupN[2] = {3, 3};
+
+// Sensor power mode and timing of the last readings
+static HallPowerConfig _power;
+static uint16_t _readings;
+static uint32_t _readUs, _sensorUs, _maxReadUs;
+
+// Measured settling time of each group and the power-up delay of a reading
+static HallSettling _settle;
+static uint16_t _wakeUs = HALL_SETTLE_DEFAULT_US;
+
+// AREF supply of the last reading, the hall correction gain (Q12) and the
+// millis() of the last measurement during a burst capture
+#define HALL_SUPPLY_GAIN_BITS 12
+static uint16_t _supplyCenti;
+static uint16_t _supplyGain = 1 << HALL_SUPPLY_GAIN_BITS;
+static uint32_t _supplyMs;
+
+// Interrupt-driven sweep: ADC inputs to convert, index of the current one,
+// results, completion flag and micros() at its start
+static const uint8_t* volatile _sweepList;
+static volatile uint8_t _sweepCount, _sweepIdx;
+static volatile uint16_t _sweep[6];
+static volatile bool _sweepDone = true;
+static volatile uint32_t _sweepUs;
+
+// Burst capture settings and state. The ring holds the last samples; after a
+// trigger it is filled with the post-trigger samples and frozen until the
+// event is saved.
+enum HallEventState : uint8_t {
+    HALL_EVENT_ARMED = 0,  ///< Looking for a trigger
+    HALL_EVENT_POST,       ///< Collecting the post-trigger samples
+    HALL_EVENT_READY       ///< Complete, waiting for HALL_getEvent()
+};
+static HallBurstConfig _burst;
+static bool _burstRunning = false;
+static volatile uint16_t _latest[LOG_HALL_CHANNELS];
+static volatile uint16_t _ring[LOG_EVENT_SAMPLES][LOG_HALL_CHANNELS];
+static volatile uint8_t _ringHead, _ringFilled;
+static volatile uint8_t _eventState, _eventPost, _eventChannels;
+static volatile uint32_t _eventUs;
+static volatile uint16_t _burstEvents, _burstOverruns;
+
+// Gape calibration in use with the conversion span of each channel (the two
+// table nodes around its last value, instead of whole tables in RAM), and the
+// one being edited
+static LogCalibration _cal;
+static LogCalSpan _calSpans[LOG_HALL_CHANNELS];
+static LogCalibration _calEdit;
+
+uint32_t _sweepMicros(const HallADCProfile& profile, const uint8_t count);
+uint16_t _convert(const uint8_t ain);
+void _burstStart(void);
+void _burstStop(void);
+
+/**
+ * @brief Log2 of a power of two, or 0xFF if it is not one
+ */
+uint8_t _log2(uint16_t value) {
+    uint8_t _n = 0;
+    while (value > 1 && !(value & 1)) {
+        value >>= 1;
+        ++_n;
+    }
+    return value == 1 ? _n : 0xFF;
+}
+
+/**
+ * @brief Check that a profile can be applied: DIV16 or slower keeps the ADC
+ * clock under 1.5 MHz at 16 MHz and the shifted result must fit in a record
+ */
+bool _profileValid(const HallADCProfile& profile) {
+    return profile.sampnum <= ADC_SAMPNUM_ACC64_gc &&
+           profile.presc >= ADC_PRESC_DIV16_gc &&
+           profile.presc <= ADC_PRESC_DIV256_gc &&
+           profile.samplen <= ADC_SAMPLEN_gm && profile.sampcap <= 1 &&
+           profile.shift <= 6 &&
+           10 + profile.sampnum <= HALL_VALUE_BITS + profile.shift;
+}
+
+/**
+ * @brief Write the acquisition profile to the ADC registers
+ */
+void _applyProfile(void) {
     // Not RUN in standby
     // Resolution: 10bits
     // One-shot mode
-    ADC0.CTRLA &= ~(ADC_RUNSTBY_bm | ADC_RESSEL_bm | ADC_FREERUN_bm);
+    ADC0.CTRLA &= ~(ADC_RUNSTBY_bm | ADC_RESSEL_bm | ADC_FREERUN_bm |
+                    ADC_ENABLE_bm);
 
-    // Sample Accumulation: 64
-    ADC0.CTRLB = ADC_SAMPNUM_ACC64_gc;
+    // Sample accumulation
+    ADC0.CTRLB = _profile.sampnum;
 
-    // CLK_PER divided by 64 = 125kHz @ 16MHz CPU
+    // ADC clock prescaler
     // External reference: AREF (connected to 3.3V output)
-    // Sample capacitance = 0 (@todo more testing)
-    ADC0.CTRLC = ADC_REFSEL_VREFA_gc | ADC_PRESC_DIV64_gc;
+    // Sample capacitance
+    ADC0.CTRLC = ADC_REFSEL_VREFA_gc | _profile.presc |
+                 (_profile.sampcap ? ADC_SAMPCAP_bm : 0);
+
+    // Sample length
+    ADC0.SAMPCTRL = _profile.samplen;
 
     // Enable ADC
     ADC0.CTRLA |= ADC_ENABLE_bm;
 }
 
+void ADC_init(void) {
+    EEPROM.get(EEPROM_ADCCFG_ADDR, _profile);
+    if (_profile.tag != 'A' ||
+        _profile.crc != LOG_crc16((const uint8_t*)&_profile,
+                                  offsetof(HallADCProfile, crc)) ||
+        !_profileValid(_profile)) {
+        // Never set or corrupted: defaults
+        _profile.sampnum = _log2(HALL_ADC_SAMPLES);
+        _profile.presc = _log2(HALL_ADC_PRESCALER) - 1;
+        _profile.samplen = HALL_ADC_SAMPLEN;
+        _profile.sampcap = HALL_ADC_SAMPCAP;
+        _profile.shift = HALL_ADC_SHIFT;
+    }
+    _applyProfile();
+
+    // Supply measurement reference: 1.1V scaled by the AC0 DAC, turned on
+    // only while it is converted
+    VREF.CTRLA = (VREF.CTRLA & ~VREF_AC0REFSEL_gm) | VREF_AC0REFSEL_1V1_gc;
+    AC0.DACREF = HALL_SUPPLY_DACREF;
+}
+
+bool HALL_setADCProfile(const uint8_t samples, const uint16_t prescaler,
+                        const uint8_t sample_length, const bool sample_cap,
+                        const uint8_t shift) {
+    HallADCProfile _p;
+    _p.tag = 'A';
+    _p.sampnum = _log2(samples);
+    _p.presc = _log2(prescaler) - 1;  // DIV2 is 0
+    _p.samplen = sample_length;
+    _p.sampcap = sample_cap;
+    _p.shift = shift;
+    if (!_profileValid(_p) ||
+        (_burst.rateHz &&
+         _sweepMicros(_p, _sweepN) >= 1000000UL / _burst.rateHz)) {
+        return false;  // Invalid, or too slow for the burst rate
+    }
+    _p.crc = LOG_crc16((const uint8_t*)&_p, offsetof(HallADCProfile, crc));
+    EEPROM.put(EEPROM_ADCCFG_ADDR, _p);
+
+    // Burst sweeps must not run while the ADC is reconfigured
+    bool _burstOn = _burstRunning;
+    if (_burstOn) {
+        _burstStop();
+    }
+    _profile = _p;
+    _applyProfile();
+    if (_burstOn) {
+        _burstStart();
+    }
+    return true;
+}
+
+void HALL_getADCProfile(HallADCProfile *profile) {
+    *profile = _profile;
+}
+
+/**
+ * @brief Conversion time of the enabled hall values with a profile
+ */
+uint32_t _sweepMicros(const HallADCProfile& profile, const uint8_t count) {
+    // Each sample takes 13 ADC clock cycles plus the extra sample length
+    uint32_t _cycles = (uint32_t)count * (13 + profile.samplen)
+                       << (profile.sampnum + profile.presc + 1);
+    return _cycles / (F_CPU / 1000000UL);
+}
+
+uint32_t HALL_getSweepMicros(void) {
+    return _sweepMicros(_profile, _sweepN);
+}
+
+void HALL_printADCProfile(void) {
+    Serial.print(MSG_ADC_PROFILE_short);
+    Serial.print(',');
+    Serial.print(1 << _profile.sampnum);
+    Serial.print(',');
+    Serial.print(2 << _profile.presc);
+    Serial.print(',');
+    Serial.print(_profile.samplen);
+    Serial.print(',');
+    Serial.print(_profile.sampcap);
+    Serial.print(',');
+    Serial.print(_profile.shift);
+    Serial.print(',');
+    Serial.println(HALL_getSweepMicros());
+}
+
 /**
  * @brief Configures pins PD0 to PD5 on the microcontroller as analog input pins
  * by clearing their direction bits, disabling their digital input buffers, and
@@ -69,6 +264,9 @@ void HALL_setupAnalogPins(void) {
 }
 
 void HALL_initIO(const uint8_t group0_sleep, const uint8_t group1_sleep) {
+    _sleepPins[0] = group0_sleep;
+    _sleepPins[1] = group1_sleep;
+
     pinMode(group0_sleep, OUTPUT);
     digitalWrite(group0_sleep, LOW);  // put group 0 hall sensor to sleep
     pinMode(group1_sleep, OUTPUT);
@@ -78,68 +276,233 @@ void HALL_initIO(const uint8_t group0_sleep, const uint8_t group1_sleep) {
 }
 
 /**
- * @brief Reads a group of three analog inputs (AIN[x] to A[x+2]) based on the
- * specified group index, performs ADC conversions for each input, and stores
- * the 12-bit resolution results in the provided hall array. It handles ADC
- * channel configuration, conversion initiation, completion waiting, interrupt
- * flag clearing, and result retrieval for each input.
+ * @brief Start the conversion of the first input of a sweep. The result ready
+ * interrupt runs the rest of it.
  *
- * @param[in] group  The group number (0 or 1) to read from
- * @param[out] hall  Pointer to a uint16_t array where the hall sensor readings
- *                   will be stored
+ * @param[in] ain   ADC inputs to convert
+ * @param[in] count Number of inputs
  */
-void _group_read(uint8_t group, uint16_t* hall) {
-    // Read a group of three analog inputs (AIN[x] to A[x+2])
-    uint8_t _ii = 3 * group, _fin = 3 * (group + 1);
-    for (; _ii < _fin; ++_ii) {
-        // Configure channel
-        ADC0.MUXPOS = (_ii & ADC_MUXPOS_gm);
+void _startSweep(const uint8_t* ain, const uint8_t count) {
+    _sweepList = ain;
+    _sweepCount = count;
+    _sweepIdx = 0;
+    _sweepDone = false;
 
-        // Start ADC conversion
-        ADC0.COMMAND = ADC_STCONV_bm;
+    // Configure the first channel and enable the result ready interrupt
+    ADC0.MUXPOS = (ain[0] & ADC_MUXPOS_gm);
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+    ADC0.INTCTRL |= ADC_RESRDY_bm;
+
+    // Start ADC conversion
+    ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+/**
+ * @brief Store a burst sweep in the ring (called from the result ready
+ * interrupt) and look for a trigger: a change larger than the threshold on
+ * any channel over HALL_BURST_SPAN samples, with the pre-trigger samples
+ * already in the ring
+ */
+void _burstSample(void) {
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        _latest[_c] = _sweep[_c];
+    }
+    if (_eventState == HALL_EVENT_READY) {
+        return;  // Frozen until the event is saved
+    }
+
+    uint8_t _head = _ringHead;
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        _ring[_head][_c] = _sweep[_c];
+    }
+    if (_ringFilled < LOG_EVENT_SAMPLES) {
+        ++_ringFilled;
+    }
+
+    if (_eventState == HALL_EVENT_ARMED && _ringFilled > _burst.pre &&
+        _ringFilled > HALL_BURST_SPAN) {
+        uint8_t _ref = _head >= HALL_BURST_SPAN
+                           ? _head - HALL_BURST_SPAN
+                           : _head + LOG_EVENT_SAMPLES - HALL_BURST_SPAN;
+        uint8_t _mask = 0;
+        for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+            int16_t _d = _ring[_head][_c] - _ring[_ref][_c];
+            if (_d > (int16_t)_burst.threshold ||
+                -_d > (int16_t)_burst.threshold) {
+                _mask |= 1 << _c;
+            }
+        }
+        if (_mask) {
+            _eventChannels = _mask;
+            _eventUs = _sweepUs;
+            _eventPost = LOG_EVENT_SAMPLES - 1 - _burst.pre;
+            _eventState = HALL_EVENT_POST;
+        }
+    } else if (_eventState == HALL_EVENT_POST) {
+        --_eventPost;
+    }
+    if (_eventState == HALL_EVENT_POST && _eventPost == 0) {
+        _eventState = HALL_EVENT_READY;
+        ++_burstEvents;
+    }
+
+    _ringHead = _head + 1 < LOG_EVENT_SAMPLES ? _head + 1 : 0;
+}
+
+/**
+ * @brief Result ready interrupt: stores the result of the current input in its
+ * hall column and starts the conversion of the next one. After the last input
+ * it disables the interrupt and flags the sweep as done.
+ */
+ISR(ADC0_RESRDY_vect) {
+    uint8_t _i = _sweepIdx;
+    const uint8_t* _list = _sweepList;
+    _sweep[_order[_list[_i]]] = (ADC0.RES >> _profile.shift);
 
-        // Wait until ADC conversion done
-        while (!(ADC0.INTFLAGS & ADC_RESRDY_bm)) {
-            ;
+    // Clear the interrupt flag by writing 1
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+
+    if (++_i < _sweepCount) {
+        ADC0.MUXPOS = (_list[_i] & ADC_MUXPOS_gm);
+        ADC0.COMMAND = ADC_STCONV_bm;
+        _sweepIdx = _i;
+    } else {
+        ADC0.INTCTRL &= ~ADC_RESRDY_bm;
+        if (_burstRunning) {
+            _burstSample();
         }
+        _sweepDone = true;
+    }
+}
 
-        // Clear the interrupt flag by writing 1
-        ADC0.INTFLAGS = ADC_RESRDY_bm;
+/**
+ * @brief Burst timer interrupt: starts a sweep every burst period (a sweep
+ * still running means the period is too short for the ADC profile)
+ */
+ISR(TCB2_INT_vect) {
+    TCB2.INTFLAGS = TCB_CAPT_bm;
+    if (!_sweepDone) {
+        ++_burstOverruns;
+        return;
+    }
+    _sweepUs = micros();
+    _startSweep(_sweepAin, _sweepN);
+}
 
-        hall[_ii - (3 * group)] = (ADC0.RES >> 4);  // 12-bit "resolution"
+/**
+ * @brief Sleep until the running sweep is done. Interrupts are enabled by the
+ * instruction before sleep, so a wake-up can not be missed between the check
+ * and it.
+ */
+void _waitSweep(void) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    while (!_sweepDone) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
     }
+    sei();
 }
 
 /**
- * @brief Reads analog-to-digital conversion (ADC) results from six channels,
- * processes them in a specific order defined by `{3, 2, 1, 0, 4, 5}`, and
- * stores the 12-bit resolution values into the hall array. It configures the
- * ADC channel, starts the conversion, waits for completion, clears the
- * interrupt flag, and retrieves the result for each channel.
+ * @brief Reads analog-to-digital conversion (ADC) results from the enabled
+ * channels, processes them in a specific order defined by `{3, 2, 1, 0, 4, 5}`,
+ * and stores the 12-bit resolution values into the hall array (0 for the
+ * disabled ones). The first
+ * conversion is started here and the result ready interrupt runs the rest of
+ * the sequence, while the CPU waits in idle sleep (woken up by each conversion
+ * and by the millis() timer).
  *
  * @param[out] hall Pointer to a uint16_t array where the hall sensor readings
  *                  will be stored
  */
 void _read(uint16_t* hall) {
-    uint8_t _order[6] = {3, 2, 1, 0, 4, 5};
+    _startSweep(_sweepAin, _sweepN);
+    _waitSweep();
 
     for (uint8_t _ii = 0; _ii < 6; ++_ii) {
-        // Configure channel
-        ADC0.MUXPOS = (_ii & ADC_MUXPOS_gm);
+        hall[_ii] = _sweep[_ii];
+    }
+}
 
-        // Start ADC conversion
-        ADC0.COMMAND = ADC_STCONV_bm;
+/**
+ * @brief Reads the enabled analog inputs of a sensor group (at least one) into
+ * their columns of the hall array, like _read()
+ *
+ * @param[in] group  The group number (0 or 1) to read from
+ * @param[out] hall  Pointer to a uint16_t array where the hall sensor readings
+ *                   will be stored
+ */
+void _group_read(uint8_t group, uint16_t* hall) {
+    _startSweep(_groupList[group], _groupN[group]);
+    _waitSweep();
 
-        // Wait until ADC conversion done
-        while (!(ADC0.INTFLAGS & ADC_RESRDY_bm)) {
-            ;
-        }
+    for (uint8_t _ii = 0; _ii < _groupN[group]; ++_ii) {
+        uint8_t _col = _order[_groupList[group][_ii]];
+        hall[_col] = _sweep[_col];
+    }
+}
+
+/**
+ * @brief Measure the AREF supply and update the correction gain: the AC0 DAC
+ * reference is converted against AREF with fewer accumulated samples than
+ * the hall values. It runs while the sensors settle, so it only adds time
+ * when it takes longer than their power-up delay.
+ *
+ * @return Time taken in microseconds
+ */
+uint32_t _measureSupply(void) {
+    uint32_t _start = micros();
+    VREF.CTRLB |= VREF_AC0REFEN_bm;
+    delayMicroseconds(HALL_SUPPLY_START_US);
+
+    uint8_t _s = _profile.sampnum < HALL_SUPPLY_SAMPNUM ? _profile.sampnum
+                                                       : HALL_SUPPLY_SAMPNUM;
+    ADC0.CTRLB = _s;
+    uint16_t _code = _convert(ADC_MUXPOS_DACREF_gc);
+    ADC0.CTRLB = _profile.sampnum;
+    VREF.CTRLB &= ~VREF_AC0REFEN_bm;
 
-        // Clear the interrupt flag by writing 1
-        ADC0.INTFLAGS = ADC_RESRDY_bm;
+    // AREF = Vdacref * 1023 * samples / result, with Vdacref = Vref * DACREF
+    // / 256
+    const uint32_t _scale =
+        (uint32_t)HALL_SUPPLY_REF_MV * HALL_SUPPLY_DACREF * 1023;
+    uint32_t _mv = _code ? (_scale >> (8 - _s)) / _code : 0;
+    if (_mv < HALL_SUPPLY_MIN_MV || _mv > HALL_SUPPLY_MAX_MV) {
+        _supplyCenti = 0;
+        _supplyGain = 1 << HALL_SUPPLY_GAIN_BITS;
+    } else {
+        _supplyCenti = (_mv + 5) / 10;
+#if HALL_SUPPLY_CORRECTION
+        _supplyGain = ((_mv << HALL_SUPPLY_GAIN_BITS) +
+                       HALL_AREF_NOMINAL_MV / 2) /
+                      HALL_AREF_NOMINAL_MV;
+#endif
+    }
+    return micros() - _start;
+}
 
-        hall[_order[_ii]] = (ADC0.RES >> 4);  // 12-bit "resolution"
+/**
+ * @brief Scale the enabled hall values by the supply gain, to what a nominal
+ * AREF would have read (HALL_SUPPLY_CORRECTION)
+ */
+void _correctSupply(uint16_t* hall) {
+#if HALL_SUPPLY_CORRECTION
+    const uint16_t _max = (1 << HALL_VALUE_BITS) - 1;
+    for (uint8_t _ii = 0; _ii < 6; ++_ii) {
+        if (_channels.mask & (1 << _ii)) {
+            uint32_t _v = ((uint32_t)hall[_ii] * _supplyGain +
+                           (1 << (HALL_SUPPLY_GAIN_BITS - 1))) >>
+                          HALL_SUPPLY_GAIN_BITS;
+            hall[_ii] = _v > _max ? _max : _v;
+        }
     }
+#else
+    (void)hall;
+#endif
 }
 
 /**
@@ -161,24 +524,686 @@ void HALL_wakeAndRead(const uint8_t group0_sleep, const uint8_t group1_sleep,
     // Activar las interrupciones del ADC
     // ADC0.INTCTRL = ADC_RESRDY_bm;
 
-    // Turn on group 0 hall sensors
-    pinMode(group0_sleep, OUTPUT);
-    digitalWrite(group0_sleep, HIGH);
-    // Turn on group 1 hall sensors
-    pinMode(group1_sleep, OUTPUT);
-    digitalWrite(group1_sleep, HIGH);
+    const uint8_t _pins[2] = {group0_sleep, group1_sleep};
+    uint32_t _start = micros(), _sensor;
+    if (_power.sequenced) {
+        // One group at a time, each after its own settling time. The supply
+        // is measured while the first one settles.
+        _sensor = 0;
+        bool _supply = false;
+        for (uint8_t _g = 0; _g < 2; ++_g) {
+            if (!_groupN[_g]) {
+                continue;  // No channel enabled: the group stays asleep
+            }
+            uint32_t _on = micros();
+            pinMode(_pins[_g], OUTPUT);
+            digitalWrite(_pins[_g], HIGH);
+            uint32_t _supplyUs = _supply ? 0 : _measureSupply();
+            _supply = true;
+            if (_supplyUs < _settle.us[_g]) {
+                delayMicroseconds(_settle.us[_g] - _supplyUs);
+            }
+            _group_read(_g, hall);
+            digitalWrite(_pins[_g], LOW);
+            _sensor += micros() - _on;
+        }
+    } else {
+        // Turn on the hall sensors of the groups in use
+        uint8_t _on = 0;
+        for (uint8_t _g = 0; _g < 2; ++_g) {
+            if (_groupN[_g]) {
+                pinMode(_pins[_g], OUTPUT);
+                digitalWrite(_pins[_g], HIGH);
+                ++_on;
+            }
+        }
 
-    // Wait for the sensors to stabilize
-    delayMicroseconds(1000);
+        // Measure the supply and wait for the sensors to settle
+        uint32_t _supplyUs = _measureSupply();
+        if (_supplyUs < _wakeUs) {
+            delayMicroseconds(_wakeUs - _supplyUs);
+        }
 
-    // Read all hall sensors
-    _read(hall);
+        // Read the enabled hall sensors
+        _read(hall);
 
-    digitalWrite(group0_sleep, LOW);  // put group 0 hall sensor to sleep
-    digitalWrite(group1_sleep, LOW);  // put group 1 hall sensor to sleep
+        // Put the hall sensors to sleep
+        digitalWrite(group0_sleep, LOW);
+        digitalWrite(group1_sleep, LOW);
+        _sensor = _on * (micros() - _start);
+    }
+    _correctSupply(hall);
+
+    // Timing of the reading: its length and the powered time of the groups
+    _readUs = micros() - _start;
+    _sensorUs = _sensor;
+    if (_readUs > _maxReadUs) {
+        _maxReadUs = _readUs;
+    }
+    if (_readings < UINT16_MAX) {
+        ++_readings;
+    }
 }
 
 void HALL_read(const uint8_t group0_sleep, const uint8_t group1_sleep,
                uint16_t* hall) {
+    if (_burstRunning) {  // Sensors already on, take the last burst sample
+        if (millis() - _supplyMs >= HALL_SUPPLY_BURST_MS) {
+            // The ADC is shared: pause the timer and let a sweep finish
+            TCB2.CTRLA &= ~TCB_ENABLE_bm;
+            _waitSweep();
+            _measureSupply();
+            _supplyMs = millis();
+            TCB2.INTFLAGS = TCB_CAPT_bm;
+            TCB2.CTRLA |= TCB_ENABLE_bm;
+        }
+        cli();
+        for (uint8_t _ii = 0; _ii < 6; ++_ii) {
+            hall[_ii] = _latest[_ii];
+        }
+        sei();
+        _correctSupply(hall);
+        return;
+    }
     HALL_wakeAndRead(group0_sleep, group1_sleep, hall);
-}
\ No newline at end of file
+}
+
+uint16_t HALL_getSupply(void) {
+    return _supplyCenti;
+}
+
+void HALL_getChannelOrder(uint8_t* order) {
+    for (uint8_t _ii = 0; _ii < 6; ++_ii) {
+        order[_order[_ii]] = _ii;
+    }
+}
+
+void HALL_getADCConfig(LogADCConfig* adc) {
+    adc->ctrlb = ADC0.CTRLB;
+    adc->ctrlc = ADC0.CTRLC;
+    adc->ctrld = ADC0.CTRLD;
+    adc->sampctrl = ADC0.SAMPCTRL;
+    adc->resultShift = _profile.shift;
+}
+
+/*******************************************************
+ * Sensor settling
+ *******************************************************/
+
+/**
+ * @brief Convert an ADC input, polling for the result
+ */
+uint16_t _convert(const uint8_t ain) {
+    ADC0.MUXPOS = (ain & ADC_MUXPOS_gm);
+    ADC0.COMMAND = ADC_STCONV_bm;
+    while (!(ADC0.INTFLAGS & ADC_RESRDY_bm)) {
+        ;
+    }
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+    return ADC0.RES;
+}
+
+/**
+ * @brief Power a sensor group up and time how long its inputs take to come
+ * within HALL_SETTLE_BAND of their settled values, the mean of
+ * HALL_SETTLE_STABLE sweeps HALL_SETTLE_MAX_US after a first power-up
+ *
+ * @return Time from power-up to the first of HALL_SETTLE_STABLE sweeps in a
+ * row within the band in microseconds, or UINT16_MAX if there was none within
+ * HALL_SETTLE_MAX_US
+ */
+uint16_t _settleTime(const uint8_t group) {
+    uint16_t _sum[3] = {0, 0, 0};
+    digitalWrite(_sleepPins[group], HIGH);
+    delayMicroseconds(HALL_SETTLE_MAX_US);
+    for (uint8_t _i = 0; _i < HALL_SETTLE_STABLE; ++_i) {
+        for (uint8_t _c = 0; _c < 3; ++_c) {
+            _sum[_c] += _convert(_groupAin[group][_c]);
+        }
+    }
+    digitalWrite(_sleepPins[group], LOW);
+    delay(HALL_SETTLE_REST_MS);  // Let the sensors power down
+
+    uint16_t _settled[3];
+    for (uint8_t _c = 0; _c < 3; ++_c) {
+        _settled[_c] = (_sum[_c] + HALL_SETTLE_STABLE / 2) / HALL_SETTLE_STABLE;
+    }
+
+    uint16_t _settledUs = 0;
+    uint8_t _stable = 0;
+    digitalWrite(_sleepPins[group], HIGH);
+    uint32_t _on = micros(), _us;
+    while (_stable < HALL_SETTLE_STABLE &&
+           (_us = micros() - _on) < HALL_SETTLE_MAX_US) {
+        bool _within = true;
+        for (uint8_t _c = 0; _c < 3; ++_c) {
+            int16_t _d = _convert(_groupAin[group][_c]) - _settled[_c];
+            _within &= _d <= HALL_SETTLE_BAND && -_d <= HALL_SETTLE_BAND;
+        }
+        if (!_within) {
+            _stable = 0;
+        } else if (_stable++ == 0) {
+            _settledUs = _us;
+        }
+    }
+    digitalWrite(_sleepPins[group], LOW);
+    return _stable >= HALL_SETTLE_STABLE ? _settledUs : UINT16_MAX;
+}
+
+/**
+ * @brief Use the longest settling time of the groups in use, which are
+ * powered together
+ */
+void _applySettling(void) {
+    _wakeUs = 0;
+    for (uint8_t _g = 0; _g < 2; ++_g) {
+        if (_groupN[_g] && _settle.us[_g] > _wakeUs) {
+            _wakeUs = _settle.us[_g];
+        }
+    }
+}
+
+void HALL_initSettling(void) {
+    EEPROM.get(EEPROM_SETTLE_ADDR, _settle);
+    if (_settle.tag != 'T' ||
+        _settle.crc != LOG_crc16((const uint8_t*)&_settle,
+                                 offsetof(HallSettling, crc)) ||
+        _settle.us[0] > HALL_SETTLE_MAX_US ||
+        _settle.us[1] > HALL_SETTLE_MAX_US) {
+        // Never measured or corrupted: defaults until it is measured
+        _settle.tag = 0;
+        _settle.us[0] = HALL_SETTLE_DEFAULT_US;
+        _settle.us[1] = HALL_SETTLE_DEFAULT_US;
+        _applySettling();
+        HALL_measureSettling();
+        return;
+    }
+    _applySettling();
+}
+
+bool HALL_measureSettling(void) {
+    // The sensors of a burst capture stay on
+    bool _burstOn = _burstRunning;
+    if (_burstOn) {
+        _burstStop();
+    }
+
+    // Single 10-bit conversions at 1 MHz: about 40 us per sweep of a group
+    ADC0.CTRLB = ADC_SAMPNUM_ACC1_gc;
+    ADC0.CTRLC = (ADC0.CTRLC & ~ADC_PRESC_gm) | ADC_PRESC_DIV16_gc;
+    ADC0.SAMPCTRL = 0;
+
+    HallSettling _s = _settle;
+    _s.tag = 'T';
+    bool _ok = true;
+    for (uint8_t _g = 0; _g < 2 && _ok; ++_g) {
+        if (!_groupN[_g]) {
+            continue;  // Not powered by the readings
+        }
+        uint16_t _max = 0;
+        for (uint8_t _t = 0; _t < HALL_SETTLE_TRIALS; ++_t) {
+            delay(HALL_SETTLE_REST_MS);  // Let the sensors power down
+            uint16_t _us = _settleTime(_g);
+            if (_us > _max) {
+                _max = _us;
+            }
+        }
+        _ok = _max != UINT16_MAX;
+        _max += _max / 4;
+        _s.us[_g] = _max < HALL_SETTLE_MIN_US ? HALL_SETTLE_MIN_US : _max;
+    }
+    _applyProfile();
+
+    if (_ok) {
+        _s.crc = LOG_crc16((const uint8_t*)&_s, offsetof(HallSettling, crc));
+        EEPROM.put(EEPROM_SETTLE_ADDR, _s);
+        _settle = _s;
+        _applySettling();
+    }
+    if (_burstOn) {
+        _burstStart();
+    }
+    return _ok;
+}
+
+uint16_t HALL_getWakeDelay(void) {
+    return _wakeUs;
+}
+
+void HALL_printSettling(void) {
+    Serial.print(MSG_SETTLING_short);
+    Serial.print(',');
+    Serial.print(_settle.us[0]);
+    Serial.print(',');
+    Serial.print(_settle.us[1]);
+    Serial.print(',');
+    Serial.print(_wakeUs);
+    Serial.print(',');
+    Serial.println(_settle.tag == 'T');
+}
+
+void HALL_initPower(void) {
+    EEPROM.get(EEPROM_HALLPWR_ADDR, _power);
+    if (_power.tag != 'P' ||
+        _power.crc != LOG_crc16((const uint8_t*)&_power,
+                                offsetof(HallPowerConfig, crc)) ||
+        _power.sequenced > 1) {
+        _power.sequenced = HALL_POWER_SEQUENCED;  // Never set or corrupted
+    }
+}
+
+void HALL_setPower(const bool sequenced) {
+    _power.tag = 'P';
+    _power.sequenced = sequenced;
+    _power.crc =
+        LOG_crc16((const uint8_t*)&_power, offsetof(HallPowerConfig, crc));
+    EEPROM.put(EEPROM_HALLPWR_ADDR, _power);
+
+    // Timing of the new mode only
+    _readings = 0;
+    _readUs = 0;
+    _sensorUs = 0;
+    _maxReadUs = 0;
+}
+
+void HALL_printPower(void) {
+    Serial.print(MSG_HALL_POWER_short);
+    Serial.print(',');
+    Serial.print(_power.sequenced);
+    Serial.print(',');
+    Serial.print(_readings);
+    Serial.print(',');
+    Serial.print(_readUs);
+    Serial.print(',');
+    Serial.print(_sensorUs);
+    Serial.print(',');
+    Serial.println(_maxReadUs);
+}
+
+/*******************************************************
+ * Channel mask
+ *******************************************************/
+
+/**
+ * @brief Build the ADC input lists of the enabled channels, in input order for
+ * a sweep and in wiring order for each group, and clear the values of the
+ * disabled ones
+ */
+void _applyChannels(void) {
+    _sweepN = 0;
+    for (uint8_t _ain = 0; _ain < 6; ++_ain) {
+        if (_channels.mask & (1 << _order[_ain])) {
+            _sweepAin[_sweepN++] = _ain;
+        } else {
+            _sweep[_order[_ain]] = 0;
+            _latest[_order[_ain]] = 0;
+        }
+    }
+    for (uint8_t _g = 0; _g < 2; ++_g) {
+        _groupN[_g] = 0;
+        for (uint8_t _c = 0; _c < 3; ++_c) {
+            if (_channels.mask & (1 << _order[_groupAin[_g][_c]])) {
+                _groupList[_g][_groupN[_g]++] = _groupAin[_g][_c];
+            }
+        }
+    }
+    _applySettling();
+}
+
+void HALL_initChannels(void) {
+    EEPROM.get(EEPROM_CHANNELS_ADDR, _channels);
+    if (_channels.tag != 'M' ||
+        _channels.crc != LOG_crc16((const uint8_t*)&_channels,
+                                   offsetof(HallChannelConfig, crc)) ||
+        _channels.mask == 0 || _channels.mask > LOG_HALL_MASK_ALL) {
+        _channels.mask = HALL_CHANNEL_MASK;  // Never set or corrupted
+    }
+    _applyChannels();
+}
+
+bool HALL_setChannelMask(const uint8_t mask) {
+    uint8_t _n = 0;
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        _n += (mask >> _c) & 1;
+    }
+    if (mask == 0 || mask > LOG_HALL_MASK_ALL ||
+        (_burst.rateHz &&
+         _sweepMicros(_profile, _n) >= 1000000UL / _burst.rateHz)) {
+        return false;
+    }
+
+    // The burst interrupts use the input lists
+    bool _burstOn = _burstRunning;
+    if (_burstOn) {
+        _burstStop();
+    }
+    _channels.tag = 'M';
+    _channels.mask = mask;
+    _channels.crc =
+        LOG_crc16((const uint8_t*)&_channels, offsetof(HallChannelConfig, crc));
+    EEPROM.put(EEPROM_CHANNELS_ADDR, _channels);
+    _applyChannels();
+    if (_burstOn) {
+        _burstStart();
+    }
+    return true;
+}
+
+uint8_t HALL_getChannelMask(void) {
+    return _channels.mask;
+}
+
+void HALL_printChannels(void) {
+    Serial.print(MSG_CHANNELS_short);
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (_channels.mask & (1 << _c)) {
+            Serial.print(',');
+            Serial.print(_c + 1);
+        }
+    }
+    Serial.println();
+}
+
+/*******************************************************
+ * Burst capture
+ *******************************************************/
+
+/**
+ * @brief Power the sensor groups in use, measure the supply, take a first
+ * sample and start the burst timer
+ */
+void _burstStart(void) {
+    for (uint8_t _g = 0; _g < 2; ++_g) {
+        if (_groupN[_g]) {
+            digitalWrite(_sleepPins[_g], HIGH);
+        }
+    }
+    // Measure the supply and wait for the sensors to settle
+    uint32_t _supplyUs = _measureSupply();
+    _supplyMs = millis();
+    if (_supplyUs < _wakeUs) {
+        delayMicroseconds(_wakeUs - _supplyUs);
+    }
+
+    uint16_t _first[LOG_HALL_CHANNELS];
+    _read(_first);
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        _latest[_c] = _first[_c];
+    }
+    _ringHead = 0;
+    _ringFilled = 0;
+    _eventState = HALL_EVENT_ARMED;
+    _burstRunning = true;
+
+    // Periodic interrupt from the TCA0 clock (CLK_PER/64 in the Arduino core)
+    TCB2.CTRLA = 0;
+    TCB2.CTRLB = TCB_CNTMODE_INT_gc;
+    TCB2.CCMP = HALL_BURST_TIMER_HZ / _burst.rateHz - 1;
+    TCB2.CNT = 0;
+    TCB2.INTFLAGS = TCB_CAPT_bm;
+    TCB2.INTCTRL = TCB_CAPT_bm;
+    TCB2.CTRLA = TCB_CLKSEL_CLKTCA_gc | TCB_ENABLE_bm;
+}
+
+/**
+ * @brief Stop the burst timer, let the last sweep finish and put the sensors
+ * to sleep
+ */
+void _burstStop(void) {
+    TCB2.INTCTRL = 0;
+    TCB2.CTRLA = 0;
+    _waitSweep();
+    _burstRunning = false;
+    digitalWrite(_sleepPins[0], LOW);
+    digitalWrite(_sleepPins[1], LOW);
+}
+
+/**
+ * @brief Check burst settings: the rate range, the sweep time of the ADC
+ * profile within the period and a post-trigger sample at least
+ */
+bool _burstValid(const HallBurstConfig& burst) {
+    return burst.rateHz == 0 ||
+           (burst.rateHz >= HALL_BURST_RATE_MIN &&
+            burst.rateHz <= HALL_BURST_RATE_MAX &&
+            _sweepMicros(_profile, _sweepN) < 1000000UL / burst.rateHz &&
+            burst.pre < LOG_EVENT_SAMPLES - 1 && burst.threshold > 0);
+}
+
+void HALL_initBurst(void) {
+    EEPROM.get(EEPROM_BURSTCFG_ADDR, _burst);
+    if (_burst.tag != 'B' ||
+        _burst.crc != LOG_crc16((const uint8_t*)&_burst,
+                                offsetof(HallBurstConfig, crc)) ||
+        !_burstValid(_burst)) {
+        // Never set, corrupted or too fast for the ADC profile: defaults
+        _burst.rateHz = HALL_BURST_RATE;
+        _burst.threshold = HALL_BURST_THRESHOLD;
+        _burst.pre = HALL_BURST_PRE;
+        if (!_burstValid(_burst)) {
+            _burst.rateHz = 0;
+        }
+    }
+    if (_burst.rateHz) {
+        _burstStart();
+    }
+}
+
+bool HALL_setBurst(const uint8_t rate_hz, const uint16_t threshold,
+                   const uint8_t pre) {
+    HallBurstConfig _b;
+    _b.tag = 'B';
+    _b.rateHz = rate_hz;
+    _b.threshold = threshold;
+    _b.pre = pre;
+    if (!_burstValid(_b)) {
+        return false;
+    }
+    _b.crc = LOG_crc16((const uint8_t*)&_b, offsetof(HallBurstConfig, crc));
+    EEPROM.put(EEPROM_BURSTCFG_ADDR, _b);
+
+    if (_burstRunning) {
+        _burstStop();
+    }
+    _burst = _b;
+    if (_burst.rateHz) {
+        _burstStart();
+    }
+    return true;
+}
+
+/**
+ * @brief Reverse the order of the ring samples from `first` to `last - 1`
+ */
+void _reverseRing(uint8_t first, uint8_t last) {
+    while (first + 1 < last) {
+        --last;
+        for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+            uint16_t _v = _ring[first][_c];
+            _ring[first][_c] = _ring[last][_c];
+            _ring[last][_c] = _v;
+        }
+        ++first;
+    }
+}
+
+const LogHallSample* HALL_getEvent(LogEventHeader* event, const uint32_t time,
+                                   const uint32_t time_us) {
+    if (_eventState != HALL_EVENT_READY) {
+        return nullptr;
+    }
+
+    // Rotate the ring in place so the oldest sample comes first
+    uint8_t _head = _ringHead;
+    _reverseRing(0, _head);
+    _reverseRing(_head, LOG_EVENT_SAMPLES);
+    _reverseRing(0, LOG_EVENT_SAMPLES);
+    _ringHead = 0;
+
+    // Trigger time from the time of a known micros() value (it may be before)
+    int32_t _ms = (int32_t)(_eventUs - time_us) / 1000;
+    int32_t _s = _ms / 1000;
+    _ms -= _s * 1000;
+    if (_ms < 0) {
+        _ms += 1000;
+        --_s;
+    }
+    event->time = time + _s;
+    event->timeMs = _ms;
+    event->periodUs = 1000000UL / _burst.rateHz;
+    event->count = LOG_EVENT_SAMPLES;
+    event->pre = _burst.pre;
+    event->channels = _eventChannels;
+    event->threshold = _burst.threshold;
+
+    // The ring is not written while the event is ready
+    return (const LogHallSample*)_ring;
+}
+
+void HALL_releaseEvent(void) {
+    cli();
+    _ringHead = 0;
+    _ringFilled = 0;
+    _eventState = HALL_EVENT_ARMED;
+    sei();
+}
+
+void HALL_printBurst(void) {
+    Serial.print(MSG_BURST_short);
+    Serial.print(',');
+    Serial.print(_burst.rateHz);
+    Serial.print(',');
+    Serial.print(_burst.threshold);
+    Serial.print(',');
+    Serial.print(_burst.pre);
+    Serial.print(',');
+    Serial.print(_burstEvents);
+    Serial.print(',');
+    Serial.println(_burstOverruns);
+}
+
+/*******************************************************
+ * Gape calibration
+ *******************************************************/
+
+/**
+ * @brief Check whether a channel of a calibration has any breakpoint set
+ */
+bool _calHasPoints(const LogCalibration& cal, const uint8_t channel) {
+    for (uint8_t _p = 0; _p < LOG_CAL_POINTS; ++_p) {
+        if (cal.points[channel][_p].raw || cal.points[channel][_p].gapeUm) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Mark the channels with breakpoints as calibrated
+ *
+ * @return False if one of them has invalid breakpoints
+ */
+bool _calCheck(LogCalibration& cal) {
+    cal.channels = 0;
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (!_calHasPoints(cal, _c)) {
+            continue;
+        }
+        if (!LOG_calValid(cal.points[_c])) {
+            return false;
+        }
+        cal.channels |= 1 << _c;
+    }
+    return true;
+}
+
+/**
+ * @brief Start the conversion of every channel over with the calibration in
+ * use
+ */
+void _calApply(void) {
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        _calSpans[_c].node = LOG_CAL_SPAN_NONE;
+    }
+    _calEdit = _cal;
+}
+
+void HALL_initCalibration(void) {
+    HallCalibration _hc;
+    EEPROM.get(EEPROM_CALIB_ADDR, _hc);
+    if (_hc.tag != 'C' ||
+        _hc.crc != LOG_crc16((const uint8_t*)&_hc,
+                             offsetof(HallCalibration, crc)) ||
+        !_calCheck(_hc.cal)) {
+        memset(&_hc.cal, 0, sizeof(LogCalibration));  // Never set: raw only
+    }
+    _cal = _hc.cal;
+    _calApply();
+}
+
+bool HALL_setCalPoint(const uint8_t channel, const uint8_t point,
+                      const uint16_t raw, const uint16_t gape_um) {
+    if (channel < 1 || channel > LOG_HALL_CHANNELS || point > LOG_CAL_POINTS ||
+        raw > LOG_CAL_RAW_MAX) {
+        return false;
+    }
+    if (point == 0) {
+        memset(_calEdit.points[channel - 1], 0,
+               sizeof(_calEdit.points[channel - 1]));
+    } else {
+        _calEdit.points[channel - 1][point - 1].raw = raw;
+        _calEdit.points[channel - 1][point - 1].gapeUm = gape_um;
+    }
+    return true;
+}
+
+bool HALL_saveCalibration(void) {
+    HallCalibration _hc;
+    _hc.tag = 'C';
+    _hc.cal = _calEdit;
+    if (!_calCheck(_hc.cal)) {
+        return false;
+    }
+    _hc.crc = LOG_crc16((const uint8_t*)&_hc, offsetof(HallCalibration, crc));
+    EEPROM.put(EEPROM_CALIB_ADDR, _hc);
+
+    _cal = _hc.cal;
+    _calApply();
+    return true;
+}
+
+void HALL_getCalibration(LogCalibration* cal) {
+    *cal = _cal;
+}
+
+void HALL_toGape(const uint16_t* hall, LogGape* gape) {
+    gape->channels = _cal.channels;
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        gape->um[_c] = _cal.channels & (1 << _c)
+                           ? LOG_calApplySpan(_cal.points[_c], _calSpans[_c],
+                                              hall[_c])
+                           : 0;
+    }
+}
+
+void HALL_printCalibration(const uint8_t channel, const bool pending) {
+    const LogCalibration& _c = pending ? _calEdit : _cal;
+    for (uint8_t _ch = 1; _ch <= LOG_HALL_CHANNELS; ++_ch) {
+        if (channel && channel != _ch) {
+            continue;
+        }
+        Serial.print(MSG_CALIBRATION_short);
+        Serial.print(',');
+        Serial.print(_ch);
+        if (pending ? _calHasPoints(_c, _ch - 1)
+                    : (_c.channels & (1 << (_ch - 1)))) {
+            for (uint8_t _p = 0; _p < LOG_CAL_POINTS; ++_p) {
+                Serial.print(',');
+                Serial.print(_c.points[_ch - 1][_p].raw);
+                Serial.print(',');
+                Serial.print(_c.points[_ch - 1][_p].gapeUm);
+            }
+        }
+        Serial.println();
+    }
+}
@@ -23,15 +23,281 @@
 #define __HALL_SENSOR_H__
 
 #include <Arduino.h>
+#include <EEPROM.h>
+
+#include "eeprom_map.h"
+#include "log_calib.h"
+#include "log_format.h"
+
+// Default acquisition profile: 64 accumulated samples at 125 kHz (CLK_PER/64)
+// with the result shifted to 12 bits
+#define HALL_ADC_SAMPLES   64
+#define HALL_ADC_PRESCALER 64
+#define HALL_ADC_SAMPLEN   0
+#define HALL_ADC_SAMPCAP   0
+#define HALL_ADC_SHIFT     4
+
+// Largest hall value stored in the log records (12 bits)
+#define HALL_VALUE_BITS 12
+
+// Default burst capture settings: off, trigger on a change of 200 counts
+// with 16 samples kept before the trigger
+#define HALL_BURST_RATE      0
+#define HALL_BURST_THRESHOLD 200
+#define HALL_BURST_PRE       16
+
+// Burst sample rate range in Hz
+#define HALL_BURST_RATE_MIN 20
+#define HALL_BURST_RATE_MAX 100
+
+// Samples between the two values compared by the burst trigger
+#define HALL_BURST_SPAN 4
+
+// Burst timer (TCB2) clock: the TCA0 clock, CLK_PER/64 in the Arduino core
+#define HALL_BURST_TIMER_HZ (F_CPU / 64)
+
+// Default sensor power mode: both groups powered together
+#define HALL_POWER_SEQUENCED 0
+
+// Default enabled hall channels (bit 0: hall1): all six
+#define HALL_CHANNEL_MASK 0x3F
+
+// Sensor power-up delay of a reading until the settling time is measured
+#define HALL_SETTLE_DEFAULT_US 1000
+
+// Settling measurement: time until single 10-bit conversions of a group stay
+// within HALL_SETTLE_BAND counts of their settled values for
+// HALL_SETTLE_STABLE sweeps. The longest of HALL_SETTLE_TRIALS power-ups,
+// HALL_SETTLE_REST_MS apart, plus a quarter is kept.
+#define HALL_SETTLE_BAND    3
+#define HALL_SETTLE_STABLE  8
+#define HALL_SETTLE_TRIALS  4
+#define HALL_SETTLE_REST_MS 10
+#define HALL_SETTLE_MIN_US  50
+#define HALL_SETTLE_MAX_US  5000
+
+// AREF supply measurement: the AC0 DAC reference (HALL_SUPPLY_REF_MV scaled
+// by HALL_SUPPLY_DACREF / 256) converted against AREF with at most
+// HALL_SUPPLY_SAMPNUM accumulation, HALL_SUPPLY_START_US after the reference
+// is turned on. A result outside HALL_SUPPLY_MIN_MV to HALL_SUPPLY_MAX_MV is
+// taken as failed.
+#define HALL_SUPPLY_REF_MV   1100
+#define HALL_SUPPLY_DACREF   0xFF
+#define HALL_SUPPLY_SAMPNUM  ADC_SAMPNUM_ACC8_gc
+#define HALL_SUPPLY_START_US 25
+#define HALL_SUPPLY_MIN_MV   2000
+#define HALL_SUPPLY_MAX_MV   4500
+
+// While a burst capture keeps the sensors on, the supply is measured when it
+// starts and then at most every HALL_SUPPLY_BURST_MS, with the burst timer
+// paused
+#define HALL_SUPPLY_BURST_MS 1000
+
+// Nominal AREF rail. The hall sensors are ratiometric: they run off the AREF
+// rail and their outputs follow it, so by default the supply is only logged.
+// For sensors with a fixed reference output, HALL_SUPPLY_CORRECTION 1 scales
+// the hall values to what a nominal AREF would have read.
+#define HALL_AREF_NOMINAL_MV 3300
+#ifndef HALL_SUPPLY_CORRECTION
+#define HALL_SUPPLY_CORRECTION 0
+#endif
+
+/**
+ * @brief ADC acquisition profile persisted in EEPROM at EEPROM_ADCCFG_ADDR
+ */
+struct HallADCProfile {
+    char tag;         ///< 'A' when the block has been written
+    uint8_t sampnum;  ///< Accumulated samples as ADC_SAMPNUM_gc (log2, 0-6)
+    uint8_t presc;    ///< ADC clock prescaler as ADC_PRESC_gc (DIV16-DIV256)
+    uint8_t samplen;  ///< Extra ADC clock cycles of sampling (0-31)
+    uint8_t sampcap;  ///< Reduced sample capacitance (for VREF above 1 V)
+    uint8_t shift;    ///< Right shift of the accumulated result
+    uint16_t crc;     ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Burst capture settings persisted in EEPROM at EEPROM_BURSTCFG_ADDR
+ */
+struct HallBurstConfig {
+    char tag;            ///< 'B' when the block has been written
+    uint8_t rateHz;      ///< Sample rate, 0 when burst capture is off
+    uint16_t threshold;  ///< Trigger change in counts over HALL_BURST_SPAN
+    uint8_t pre;         ///< Samples kept before the trigger
+    uint16_t crc;        ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Hall to gape calibration persisted in EEPROM at EEPROM_CALIB_ADDR
+ */
+struct HallCalibration {
+    char tag;            ///< 'C' when the block has been written
+    LogCalibration cal;  ///< Breakpoints and calibrated channels
+    uint16_t crc;        ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Measured settling time of the sensor groups persisted in EEPROM at
+ * EEPROM_SETTLE_ADDR
+ */
+struct HallSettling {
+    char tag;          ///< 'T' when the block has been written
+    uint16_t us[2];    ///< Settling time of group 0 and group 1
+    uint16_t crc;      ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Sensor power mode persisted in EEPROM at EEPROM_HALLPWR_ADDR
+ */
+struct HallPowerConfig {
+    char tag;           ///< 'P' when the block has been written
+    uint8_t sequenced;  ///< 1: one group powered at a time, 0: both together
+    uint16_t crc;       ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Enabled hall channels persisted in EEPROM at EEPROM_CHANNELS_ADDR
+ */
+struct HallChannelConfig {
+    char tag;      ///< 'M' when the block has been written
+    uint8_t mask;  ///< Enabled hall columns (bit 0: hall1)
+    uint16_t crc;  ///< CRC-16 of the previous fields
+};
 
 /**
  * @brief Initializes the ADC by configuring its control registers for 10-bit
- * resolution, one-shot mode, 64-sample accumulation, a clock prescaler of 64,
- * and an external reference voltage (AREF). It also disables standby mode,
- * free-running mode, and sample capacitance, and enables the ADC for operation.
+ * resolution, one-shot mode and an external reference voltage (AREF), with the
+ * sample accumulation, clock prescaler, sample length and sample capacitance
+ * of the acquisition profile stored in EEPROM (the HALL_ADC_* defaults if it
+ * was never set). It also disables standby and free-running modes, and enables
+ * the ADC for operation.
  */
 void ADC_init(void);
 
+/**
+ * @brief Sets, applies and stores in EEPROM the ADC acquisition profile. The
+ * accumulated result (10 bits plus log2 of the samples) shifted right must
+ * fit in HALL_VALUE_BITS.
+ *
+ * @param[in] samples       Accumulated samples per value (1, 2, 4 ... 64)
+ * @param[in] prescaler     CLK_PER division of the ADC clock (16 ... 256)
+ * @param[in] sample_length Extra ADC clock cycles of sampling (0-31)
+ * @param[in] sample_cap    Reduced sample capacitance
+ * @param[in] shift         Right shift of the accumulated result (0-6)
+ *
+ * @return True if the profile is valid and was applied, false otherwise (also
+ * when a sweep would not fit in the burst capture period)
+ */
+bool HALL_setADCProfile(const uint8_t samples, const uint16_t prescaler,
+                        const uint8_t sample_length, const bool sample_cap,
+                        const uint8_t shift);
+
+/**
+ * @brief Returns the current ADC acquisition profile
+ *
+ * @param[out] profile  Acquisition profile
+ */
+void HALL_getADCProfile(HallADCProfile *profile);
+
+/**
+ * @brief Returns the time of the conversions of a hall reading (the enabled
+ * channels) with the current acquisition profile
+ *
+ * @return Conversion time in microseconds
+ */
+uint32_t HALL_getSweepMicros(void);
+
+/**
+ * @brief Prints the acquisition profile as `M113,samples,prescaler,sample
+ * length,sample capacitance,shift,sweep us`
+ */
+void HALL_printADCProfile(void);
+
+/**
+ * @brief Loads the settling time of the sensor groups from EEPROM. If it was
+ * never measured, measures it (see HALL_measureSettling()). Call it after
+ * HALL_initIO().
+ */
+void HALL_initSettling(void);
+
+/**
+ * @brief Measures the settling time of each sensor group in use after power-up
+ * with fast single conversions, and stores it in EEPROM. Readings then wait
+ * the longest of them instead of HALL_SETTLE_DEFAULT_US. Takes about 0.2 s.
+ *
+ * @return True if the groups settled within HALL_SETTLE_MAX_US, false
+ * otherwise (the previous settling times are kept)
+ */
+bool HALL_measureSettling(void);
+
+/**
+ * @brief Returns the sensor power-up delay of a reading
+ *
+ * @return Delay in microseconds
+ */
+uint16_t HALL_getWakeDelay(void);
+
+/**
+ * @brief Prints the settling times as `M116,group 0 us,group 1 us,delay us,
+ * measured`
+ */
+void HALL_printSettling(void);
+
+/**
+ * @brief Loads the sensor power mode from EEPROM (HALL_POWER_SEQUENCED if it
+ * was never set)
+ */
+void HALL_initPower(void);
+
+/**
+ * @brief Sets and stores in EEPROM the sensor power mode of the readings, and
+ * clears their timing. Sequenced readings power and convert one group while
+ * the other sleeps, after the settling time of that group: half the peak
+ * sensor current, in a longer reading. Burst capture keeps both groups on.
+ *
+ * @param[in] sequenced True for one group at a time, false for both together
+ */
+void HALL_setPower(const bool sequenced);
+
+/**
+ * @brief Prints the power mode and the timing of the readings since power-on
+ * or the last mode change as `M117,sequenced,readings,read us,sensor us,max
+ * read us`. The read time is the last power-up to power-down time, the sensor
+ * time the powered time of the last reading summed over both groups.
+ */
+void HALL_printPower(void);
+
+/**
+ * @brief Loads the enabled hall channels from EEPROM (HALL_CHANNEL_MASK if
+ * they were never set). Called before HALL_initSettling(), which only
+ * measures the groups in use.
+ */
+void HALL_initChannels(void);
+
+/**
+ * @brief Sets, applies and stores in EEPROM the enabled hall channels. Only
+ * their inputs are converted, a group without any is not powered, and their
+ * values are 0 in the hall array.
+ *
+ * @param[in] mask  Enabled hall columns (bit 0: hall1), 1 to 0x3F
+ *
+ * @return True if the mask is valid and was applied, false otherwise (also
+ * when a sweep would not fit in the burst capture period)
+ */
+bool HALL_setChannelMask(const uint8_t mask);
+
+/**
+ * @brief Returns the enabled hall channels
+ *
+ * @return Enabled hall columns (bit 0: hall1)
+ */
+uint8_t HALL_getChannelMask(void);
+
+/**
+ * @brief Prints the enabled hall channels as `M118,hall,...` (column numbers
+ * from 1)
+ */
+void HALL_printChannels(void);
+
 /**
  * @brief Initializes the I/O pins for controlling hall sensors by setting the
  * specified pins as outputs and driving them low to put the respective sensor
@@ -47,6 +313,13 @@ void HALL_initIO(const uint8_t group0_sleep, const uint8_t group1_sleep);
  * @brief Reads hall sensor data by waking up the specified sensor groups. It
  * takes the two control pin to change the sleep state of sensor and reads the
  * analog values from the hall sensors, storing them in the provided array.
+ * The conversions of the enabled channels run from the ADC result ready
+ * interrupt while the CPU waits in idle sleep; interrupts are enabled on
+ * return. The groups in use are powered together or one after the other (see
+ * HALL_setPower()). The AREF supply is measured while the (first) group
+ * settles, and the values are corrected for it with HALL_SUPPLY_CORRECTION; a
+ * running burst capture returns its last sample and measures the supply
+ * again every HALL_SUPPLY_BURST_MS.
  *
  * @param[in] group0_sleep  Pin number for group 0 hall sensors sleep control
  * @param[in] group1_sleep  Pin number for group 1 hall sensors sleep control
@@ -56,4 +329,129 @@ void HALL_initIO(const uint8_t group0_sleep, const uint8_t group1_sleep);
 void HALL_read(const uint8_t group0_sleep, const uint8_t group1_sleep,
                uint16_t *hall);
 
+/**
+ * @brief Returns the AREF supply measured by the last reading
+ *
+ * @return Supply in centivolts, 0 if the measurement failed or there was no
+ * reading yet
+ */
+uint16_t HALL_getSupply(void);
+
+/**
+ * @brief Returns the ADC input (AIN[x]) read into each column of the hall
+ * array, as stored in the log file header
+ *
+ * @param[out] order    Array of six ADC input numbers
+ */
+void HALL_getChannelOrder(uint8_t *order);
+
+/**
+ * @brief Returns the current ADC configuration, as stored in the log file
+ * header. Call it after ADC_init().
+ *
+ * @param[out] adc      ADC registers and result shift
+ */
+void HALL_getADCConfig(LogADCConfig *adc);
+
+/**
+ * @brief Loads the burst capture settings from EEPROM and, if enabled, powers
+ * the sensors and starts the burst timer. Call it after ADC_init() and
+ * HALL_initIO().
+ */
+void HALL_initBurst(void);
+
+/**
+ * @brief Sets, applies and stores in EEPROM the burst capture settings. While
+ * burst capture is on the sensors stay powered, a sweep runs every period from
+ * the TCB2 interrupt and HALL_read() returns the last sweep. A change larger
+ * than the threshold on any channel freezes a window of LOG_EVENT_SAMPLES
+ * sweeps around it until HALL_getEvent() and HALL_releaseEvent().
+ *
+ * @param[in] rate_hz   Sample rate (HALL_BURST_RATE_MIN-MAX), 0 to turn off
+ * @param[in] threshold Trigger change in counts over HALL_BURST_SPAN samples
+ * @param[in] pre       Samples kept before the trigger
+ *
+ * @return True if the settings are valid and were applied, false otherwise
+ */
+bool HALL_setBurst(const uint8_t rate_hz, const uint16_t threshold,
+                   const uint8_t pre);
+
+/**
+ * @brief Returns a completed burst capture, oldest sample first. The window
+ * stays valid until HALL_releaseEvent().
+ *
+ * @param[out] event    Event header, the trigger time from `time` and
+ *                      `time_us`
+ * @param[in] time      A POSIX time
+ * @param[in] time_us   micros() at that time
+ *
+ * @return LOG_EVENT_SAMPLES hall samples, nullptr if no event is ready
+ */
+const LogHallSample *HALL_getEvent(LogEventHeader *event, const uint32_t time,
+                                   const uint32_t time_us);
+
+/**
+ * @brief Releases the window of the last event and re-arms the trigger
+ */
+void HALL_releaseEvent(void);
+
+/**
+ * @brief Prints the burst capture state as `M114,rate,threshold,pre,events,
+ * overruns`
+ */
+void HALL_printBurst(void);
+
+/**
+ * @brief Loads the gape calibration from EEPROM for the conversion of the
+ * calibrated channels
+ */
+void HALL_initCalibration(void);
+
+/**
+ * @brief Edits a breakpoint of the pending calibration, applied with
+ * HALL_saveCalibration()
+ *
+ * @param[in] channel   Hall channel (1-6)
+ * @param[in] point     Breakpoint (1-LOG_CAL_POINTS), 0 clears the channel
+ * @param[in] raw       Hall value in counts (0-4095)
+ * @param[in] gape_um   Valve gape in micrometres
+ *
+ * @return True if the arguments are in range, false otherwise
+ */
+bool HALL_setCalPoint(const uint8_t channel, const uint8_t point,
+                      const uint16_t raw, const uint16_t gape_um);
+
+/**
+ * @brief Applies and stores in EEPROM the pending calibration. A channel with
+ * any breakpoint set is calibrated and needs ascending hall values.
+ *
+ * @return True if the calibration is valid and was applied, false otherwise
+ */
+bool HALL_saveCalibration(void);
+
+/**
+ * @brief Returns the calibration in use, as stored in the log file header
+ *
+ * @param[out] cal      Breakpoints and calibrated channels
+ */
+void HALL_getCalibration(LogCalibration *cal);
+
+/**
+ * @brief Converts the hall values of the calibrated channels to gape with
+ * their fixed-point tables
+ *
+ * @param[in]  hall     Six hall values
+ * @param[out] gape     Gapes and calibrated channels (none if uncalibrated)
+ */
+void HALL_toGape(const uint16_t *hall, LogGape *gape);
+
+/**
+ * @brief Prints the breakpoints of a channel as `M115,channel,raw1,gape1,...`
+ * (`M115,channel` when it has none)
+ *
+ * @param[in] channel   Hall channel (1-6), 0 for all of them
+ * @param[in] pending   Print the pending calibration instead of the one in use
+ */
+void HALL_printCalibration(const uint8_t channel, const bool pending);
+
 #endif  // !__HALL_SENSOR_H__
\ No newline at end of file
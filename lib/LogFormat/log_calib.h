@@ -0,0 +1,162 @@
+/**
+ * @file    log_calib.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Hall to valve gape conversion, shared by the firmware and the host
+ * tools. A channel calibration (LogCalibration) is piecewise linear between
+ * LOG_CAL_POINTS breakpoints and clamped outside them. It is expanded once into
+ * a fixed-point table with one gape value every 2^LOG_CAL_LUT_SHIFT counts, so
+ * a conversion is a table lookup and one interpolation by shifts: no floating
+ * point and no division. The table builder is constexpr, which lets the
+ * conversion be checked at compile time.
+ *
+ * The table nodes sample the breakpoint curve, so a breakpoint that is not on
+ * a node is rounded off within its table segment.
+ *
+ * This file only depends on the C standard library so it can be built for the
+ * host.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOG_CALIB_H__
+#define __LOG_CALIB_H__
+
+#include "log_format.h"
+
+// Table step of 128 counts: 33 nodes cover the 12-bit hall values
+#define LOG_CAL_LUT_SHIFT 7
+#define LOG_CAL_LUT_SIZE  ((4096 >> LOG_CAL_LUT_SHIFT) + 1)
+
+// Largest hall value
+#define LOG_CAL_RAW_MAX 4095
+
+/**
+ * @brief Gape of one channel at each table node, in micrometres
+ */
+struct LogCalTable {
+    uint16_t um[LOG_CAL_LUT_SIZE];
+};
+
+/**
+ * @brief Gape converted from the six hall values of a record
+ */
+struct LogGape {
+    uint8_t channels;                  ///< Bit k set when gape k+1 is valid
+    uint16_t um[LOG_HALL_CHANNELS];    ///< Gape in micrometres
+};
+
+/**
+ * @brief Check the breakpoints of a channel: hall values strictly ascending
+ * and within 12 bits
+ */
+constexpr bool LOG_calValid(const LogCalPoint *points) {
+    for (uint8_t _i = 1; _i < LOG_CAL_POINTS; ++_i) {
+        if (points[_i].raw <= points[_i - 1].raw) {
+            return false;
+        }
+    }
+    return points[LOG_CAL_POINTS - 1].raw <= LOG_CAL_RAW_MAX;
+}
+
+/**
+ * @brief Gape at a hall value from the breakpoints (rounded to the nearest
+ * micrometre, clamped outside the breakpoints)
+ */
+constexpr uint16_t LOG_calInterpolate(const LogCalPoint *points,
+                                      const uint16_t raw) {
+    if (raw <= points[0].raw) {
+        return points[0].gapeUm;
+    }
+    for (uint8_t _i = 1; _i < LOG_CAL_POINTS; ++_i) {
+        if (raw <= points[_i].raw) {
+            int32_t _dr = points[_i].raw - points[_i - 1].raw;
+            int32_t _n = ((int32_t)points[_i].gapeUm - points[_i - 1].gapeUm) *
+                         (raw - points[_i - 1].raw);
+            return points[_i - 1].gapeUm +
+                   (_n + (_n >= 0 ? _dr / 2 : -_dr / 2)) / _dr;
+        }
+    }
+    return points[LOG_CAL_POINTS - 1].gapeUm;
+}
+
+/**
+ * @brief Build the conversion table of a channel from its breakpoints
+ */
+constexpr LogCalTable LOG_calTable(const LogCalPoint *points) {
+    LogCalTable _t{};
+    for (uint8_t _i = 0; _i < LOG_CAL_LUT_SIZE; ++_i) {
+        _t.um[_i] = LOG_calInterpolate(points, _i << LOG_CAL_LUT_SHIFT);
+    }
+    return _t;
+}
+
+/**
+ * @brief Convert a hall value to gape with a channel table
+ *
+ * @param[in] table     Conversion table of the channel
+ * @param[in] raw       Hall value (above 12 bits is clamped)
+ *
+ * @return Gape in micrometres
+ */
+constexpr uint16_t LOG_calApply(const LogCalTable &table, uint16_t raw) {
+    if (raw > LOG_CAL_RAW_MAX) {
+        raw = LOG_CAL_RAW_MAX;
+    }
+    uint8_t _i = raw >> LOG_CAL_LUT_SHIFT;
+    uint8_t _f = raw & ((1 << LOG_CAL_LUT_SHIFT) - 1);
+    int32_t _d = (int32_t)table.um[_i + 1] - table.um[_i];
+    return table.um[_i] + ((_d * _f) >> LOG_CAL_LUT_SHIFT);
+}
+
+/**
+ * @brief The two table nodes around the last hall value converted on a
+ * channel, so a LogCalTable need not be kept in RAM
+ */
+struct LogCalSpan {
+    uint8_t node;   ///< Lower node index (LOG_CAL_SPAN_NONE: none yet)
+    uint16_t um[2]; ///< Gape at that node and the next one
+};
+
+#define LOG_CAL_SPAN_NONE 0xFF
+
+/**
+ * @brief Convert a hall value to gape from the breakpoints, with the same
+ * result as LOG_calApply() on the channel table. The two nodes around the
+ * value are only recomputed when it leaves the span of the previous one.
+ *
+ * @param[in]     points    Breakpoints of the channel
+ * @param[in,out] span      Nodes of the last conversion on the channel
+ * @param[in]     raw       Hall value (above 12 bits is clamped)
+ *
+ * @return Gape in micrometres
+ */
+constexpr uint16_t LOG_calApplySpan(const LogCalPoint *points,
+                                    LogCalSpan &span, uint16_t raw) {
+    if (raw > LOG_CAL_RAW_MAX) {
+        raw = LOG_CAL_RAW_MAX;
+    }
+    uint8_t _i = raw >> LOG_CAL_LUT_SHIFT;
+    uint8_t _f = raw & ((1 << LOG_CAL_LUT_SHIFT) - 1);
+    if (span.node != _i) {
+        span.node = _i;
+        span.um[0] = LOG_calInterpolate(points, _i << LOG_CAL_LUT_SHIFT);
+        span.um[1] = LOG_calInterpolate(points, (_i + 1) << LOG_CAL_LUT_SHIFT);
+    }
+    int32_t _d = (int32_t)span.um[1] - span.um[0];
+    return span.um[0] + ((_d * _f) >> LOG_CAL_LUT_SHIFT);
+}
+
+#endif  // !__LOG_CALIB_H__
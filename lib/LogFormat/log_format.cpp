@@ -0,0 +1,706 @@
+/**
+ * @file    log_format.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "log_format.h"
+
+#include <string.h>
+
+#include "log_calib.h"
+
+static_assert(sizeof(LogFileHeader) <= LOG_HEADER_SIZE - 2,
+              "Header does not fit in its sector");
+static_assert(sizeof(LogBlockHeader) == LOG_BLOCK_HEADER_SIZE,
+              "Block header size mismatch");
+static_assert(LOG_BLOCK_HEADER_SIZE + sizeof(LogEventHeader) +
+                      LOG_EVENT_SAMPLES * LOG_HALL_PACKED_SIZE <=
+                  LOG_BLOCK_SIZE,
+              "Event does not fit in a block");
+static_assert(LOG_BLOCK_HEADER_SIZE + sizeof(LogCardHealth) <= LOG_BLOCK_SIZE,
+              "Health record does not fit in a block");
+
+// The gape conversion is evaluated at compile time on a sample calibration
+// whose breakpoints sit on table nodes, where it must be exact
+constexpr LogCalPoint _calCheck[LOG_CAL_POINTS] = {
+    {256, 9000}, {1024, 6000}, {2048, 2500}, {3840, 0}};
+constexpr LogCalTable _calCheckTable = LOG_calTable(_calCheck);
+static_assert(LOG_calValid(_calCheck) &&
+                  LOG_calApply(_calCheckTable, 0) == 9000 &&
+                  LOG_calApply(_calCheckTable, 1024) == 6000 &&
+                  LOG_calApply(_calCheckTable, 1536) == 4250 &&
+                  LOG_calApply(_calCheckTable, 4095) == 0,
+              "Gape conversion table mismatch");
+
+/// Spans give the table's result, off the breakpoints as well
+constexpr bool _calSpanMatches(void) {
+    LogCalSpan _span{LOG_CAL_SPAN_NONE, {0, 0}};
+    for (uint16_t _raw = 0; _raw <= LOG_CAL_RAW_MAX; _raw += 7) {
+        if (LOG_calApplySpan(_calCheck, _span, _raw) !=
+            LOG_calApply(_calCheckTable, _raw)) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(_calSpanMatches(), "Gape conversion span mismatch");
+
+// Delta record flags
+#define LOG_DELTA_TEMP_bm 0x40
+#define LOG_DELTA_TIME_bm 0x80
+
+// CRC-16/CCITT lookup table, one nibble at a time (32 bytes of flash/RAM
+// instead of 512)
+static const uint16_t _crcNibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+uint16_t LOG_crc16(const uint8_t *data, size_t len, uint16_t crc) {
+    while (len--) {
+        uint8_t _b = *data++;
+        crc = (crc << 4) ^ _crcNibble[(crc >> 12) ^ (_b >> 4)];
+        crc = (crc << 4) ^ _crcNibble[(crc >> 12) ^ (_b & 0x0F)];
+    }
+    return crc;
+}
+
+void LOG_initHeader(LogFileHeader *header, const uint8_t record_format) {
+    memset(header, 0, sizeof(LogFileHeader));
+    memcpy(header->magic, LOG_MAGIC, sizeof(header->magic));
+    header->version = LOG_FORMAT_VERSION;
+    header->recordFormat = record_format;
+    header->headerSize = LOG_HEADER_SIZE;
+    header->recordSize =
+        record_format == LOG_FORMAT_PACKED ? LOG_PACKED_RECORD_SIZE : 0;
+    header->channels = LOG_HALL_CHANNELS;
+    header->hallMask = LOG_HALL_MASK_ALL;
+    header->tempProbes = 1;
+}
+
+uint16_t LOG_writeHeader(const LogFileHeader *header, uint8_t *sector) {
+    memset(sector, 0, LOG_HEADER_SIZE);
+    memcpy(sector, header, sizeof(LogFileHeader));
+    uint16_t _crc = LOG_crc16(sector, LOG_HEADER_SIZE - 2);
+    sector[LOG_HEADER_SIZE - 2] = _crc & 0xFF;
+    sector[LOG_HEADER_SIZE - 1] = _crc >> 8;
+    return _crc;
+}
+
+uint16_t LOG_fileId(const uint8_t *sector) {
+    return sector[LOG_HEADER_SIZE - 2] |
+           (uint16_t)sector[LOG_HEADER_SIZE - 1] << 8;
+}
+
+bool LOG_readHeader(const uint8_t *sector, LogFileHeader *header) {
+    if (memcmp(sector, LOG_MAGIC, 4) != 0) {
+        return false;
+    }
+    if (LOG_crc16(sector, LOG_HEADER_SIZE - 2) != LOG_fileId(sector)) {
+        return false;
+    }
+    memcpy(header, sector, sizeof(LogFileHeader));
+    if (header->hallMask == 0) {
+        header->hallMask = LOG_HALL_MASK_ALL;
+    }
+    if (header->tempProbes == 0) {
+        header->tempProbes = 1;
+    }
+    return header->version >= 1 && header->headerSize >= sizeof(LogFileHeader);
+}
+
+/**
+ * @brief Pack the 12-bit hall values of the channels in a mask, two values in
+ * three bytes: aaaaaaaa bbbbaaaa bbbbbbbb (an odd last value takes two)
+ *
+ * @return Bytes written
+ */
+static uint8_t _packHall(uint8_t *dst, const uint16_t *hall,
+                         const uint8_t mask) {
+    uint16_t _v[LOG_HALL_CHANNELS + 1];
+    uint8_t _n = 0;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (mask & (1 << _i)) {
+            _v[_n++] = hall[_i] & 0x0FFF;
+        }
+    }
+    _v[_n] = 0;
+
+    uint8_t *_p = dst;
+    for (uint8_t _i = 0; _i < _n; _i += 2) {
+        uint16_t _a = _v[_i], _b = _v[_i + 1];
+        *_p++ = _a;
+        *_p++ = (_a >> 8) | (_b << 4);
+        if (_i + 1 < _n) {
+            *_p++ = _b >> 4;
+        }
+    }
+    return _p - dst;
+}
+
+/**
+ * @brief Unpack the hall values of the channels in a mask, 0 in the others
+ *
+ * @return Bytes read
+ */
+static uint8_t _unpackHall(const uint8_t *src, uint16_t *hall,
+                           const uint8_t mask) {
+    const uint8_t *_p = src;
+    bool _second = false;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (!(mask & (1 << _i))) {
+            hall[_i] = 0;
+        } else if (!_second) {
+            hall[_i] = _p[0] | (uint16_t)(_p[1] & 0x0F) << 8;
+            _p += 2;
+            _second = true;
+        } else {
+            hall[_i] = (_p[-1] >> 4) | (uint16_t)_p[0] << 4;
+            _p += 1;
+            _second = false;
+        }
+    }
+    return _p - src;
+}
+
+uint8_t LOG_packedSize(const uint8_t mask, const uint8_t probes) {
+    uint8_t _n = 0;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        _n += (mask >> _i) & 1;
+    }
+    return 4 + (3 * _n + 1) / 2 + 2 * probes + (mask & LOG_SUPPLY_bm ? 2 : 0) +
+           (mask & LOG_MILLIS_bm ? 2 : 0);
+}
+
+void LOG_packRecord(uint8_t *dst, const LogRecord *record,
+                    const uint8_t mask, const uint8_t probes) {
+    dst[0] = record->time;
+    dst[1] = record->time >> 8;
+    dst[2] = record->time >> 16;
+    dst[3] = record->time >> 24;
+
+    dst += 4 + _packHall(&dst[4], record->hall, mask);
+
+    for (uint8_t _i = 0; _i < probes; ++_i) {
+        *dst++ = record->tempCenti[_i];
+        *dst++ = (uint16_t)record->tempCenti[_i] >> 8;
+    }
+    if (mask & LOG_SUPPLY_bm) {
+        *dst++ = record->supplyCenti;
+        *dst++ = record->supplyCenti >> 8;
+    }
+    if (mask & LOG_MILLIS_bm) {
+        dst[0] = record->timeMs;
+        dst[1] = record->timeMs >> 8;
+    }
+}
+
+void LOG_unpackRecord(const uint8_t *src, LogRecord *record,
+                      const uint8_t mask, const uint8_t probes) {
+    record->time = (uint32_t)src[0] | (uint32_t)src[1] << 8 |
+                   (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+
+    src += 4 + _unpackHall(&src[4], record->hall, mask);
+
+    for (uint8_t _i = 0; _i < LOG_TEMP_PROBES; ++_i) {
+        record->tempCenti[_i] = LOG_TEMP_INVALID;
+    }
+    for (uint8_t _i = 0; _i < probes; ++_i, src += 2) {
+        record->tempCenti[_i] = (int16_t)(src[0] | (uint16_t)src[1] << 8);
+    }
+    record->supplyCenti = 0;
+    if (mask & LOG_SUPPLY_bm) {
+        record->supplyCenti = src[0] | (uint16_t)src[1] << 8;
+        src += 2;
+    }
+    record->timeMs = mask & LOG_MILLIS_bm ? src[0] | (uint16_t)src[1] << 8 : 0;
+}
+
+/*******************************************************
+ * Blocks
+ *******************************************************/
+/**
+ * @brief Write an unsigned LEB128 varint
+ *
+ * @return Bytes written (1 to 5)
+ */
+static uint8_t _putVarint(uint8_t *dst, uint32_t value) {
+    uint8_t _n = 0;
+    while (value >= 0x80) {
+        dst[_n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    dst[_n++] = value;
+    return _n;
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint without going past `end`
+ *
+ * @return Bytes read, 0 if the varint is truncated or too long
+ */
+static uint8_t _getVarint(const uint8_t *src, const uint8_t *end,
+                          uint32_t *value) {
+    uint32_t _v = 0;
+    for (uint8_t _n = 0; _n < 5 && src + _n < end; ++_n) {
+        _v |= (uint32_t)(src[_n] & 0x7F) << (7 * _n);
+        if (!(src[_n] & 0x80)) {
+            *value = _v;
+            return _n + 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t _zigzag(const int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t _unzigzag(const uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline uint16_t _get16(const uint8_t *p) {
+    return p[0] | (uint16_t)p[1] << 8;
+}
+
+static inline void _put16(uint8_t *p, const uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline uint32_t _get32(const uint8_t *p) {
+    return _get16(p) | (uint32_t)_get16(&p[2]) << 16;
+}
+
+static inline void _put32(uint8_t *p, const uint32_t v) {
+    _put16(p, v);
+    _put16(&p[2], v >> 16);
+}
+
+// Offsets of the LogBlockHeader fields
+#define LOG_BLOCK_COUNT_OFS 2
+#define LOG_BLOCK_USED_OFS  4
+#define LOG_BLOCK_FILE_OFS  6
+#define LOG_BLOCK_SEQ_OFS   8
+#define LOG_BLOCK_CRC_OFS   12
+
+static void _putBlockHeader(uint8_t *block, const uint8_t type,
+                            const uint16_t count, const uint16_t used) {
+    block[0] = LOG_BLOCK_MARKER;
+    block[1] = type;
+    _put16(&block[LOG_BLOCK_COUNT_OFS], count);
+    _put16(&block[LOG_BLOCK_USED_OFS], used);
+}
+
+/**
+ * @brief CRC of the used bytes of a block, except the CRC field
+ */
+static uint16_t _blockCrc(const uint8_t *block, const uint16_t used) {
+    uint16_t _crc = LOG_crc16(block, LOG_BLOCK_CRC_OFS);
+    return LOG_crc16(block + LOG_BLOCK_HEADER_SIZE,
+                     used - LOG_BLOCK_HEADER_SIZE, _crc);
+}
+
+uint8_t LOG_summarySize(const uint8_t mask) {
+    uint8_t _n = 0;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        _n += (mask >> _i) & 1;
+    }
+    return 6 + 9 * _n + 6;
+}
+
+/**
+ * @brief Unpack a LOG_summarySize() bytes window summary
+ */
+static void _unpackSummary(const uint8_t *src, LogSummary *summary,
+                           const uint8_t mask) {
+    memset(summary, 0, sizeof(LogSummary));
+    summary->time = _get32(src);
+    summary->count = _get16(&src[4]);
+    src += 6;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (mask & (1 << _i)) {
+            summary->min[_i] = src[0] | (uint16_t)(src[1] & 0x0F) << 8;
+            summary->max[_i] = (src[1] >> 4) | (uint16_t)src[2] << 4;
+            summary->mean[_i] = _get16(&src[3]);
+            summary->var[_i] = _get32(&src[5]);
+            src += 9;
+        }
+    }
+    summary->tempMin = (int16_t)_get16(src);
+    summary->tempMax = (int16_t)_get16(&src[2]);
+    summary->tempMean = (int16_t)_get16(&src[4]);
+}
+
+uint16_t LOG_blockStart(LogBlockState *state, uint8_t *block,
+                        const uint8_t type, const uint8_t mask,
+                        const uint8_t probes) {
+    state->block = block;
+    state->type = type;
+    state->mask = mask;
+    state->probes = probes;
+    state->timeStep = 0;
+    state->count = 0;
+    state->used = LOG_BLOCK_HEADER_SIZE;
+    memset(block, 0, LOG_BLOCK_HEADER_SIZE);
+    _putBlockHeader(block, type, 0, state->used);
+    return state->used;
+}
+
+uint16_t LOG_blockAppend(LogBlockState *state, const LogRecord *record) {
+    uint8_t *_dst = &state->block[state->used];
+    uint16_t _n;
+
+    if (state->type == LOG_BLOCK_STATS) {  // Kind byte and packed record
+        _n = 1 + LOG_packedSize(state->mask, state->probes);
+        if (state->used + _n > LOG_BLOCK_SIZE) {
+            return 0;
+        }
+        _dst[0] = LOG_ENTRY_RECORD;
+        LOG_packRecord(&_dst[1], record, state->mask, state->probes);
+    } else if (state->count == 0 ||
+               state->type == LOG_BLOCK_PACKED) {  // Keyframe
+        _n = LOG_packedSize(state->mask, state->probes);
+        if (state->used + _n > LOG_BLOCK_SIZE) {
+            return 0;
+        }
+        LOG_packRecord(_dst, record, state->mask, state->probes);
+    } else {
+        uint8_t _rec[LOG_DELTA_MAX_SIZE];
+        uint8_t _flags = 0;
+        _n = 1;
+
+        uint32_t _step = record->time - state->prev.time;
+        if (state->mask & LOG_MILLIS_bm) {
+            // Past the range of a step in milliseconds: next block
+            if ((int32_t)_step > LOG_DELTA_MS_MAX_S ||
+                (int32_t)_step < -LOG_DELTA_MS_MAX_S) {
+                return 0;
+            }
+            _step = (int32_t)_step * 1000L + record->timeMs -
+                    state->prev.timeMs;
+        }
+        if (_step != state->timeStep) {
+            _flags |= LOG_DELTA_TIME_bm;
+            _n += _putVarint(&_rec[_n], _step);
+        }
+        for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+            int16_t _d = (int16_t)(record->hall[_i] - state->prev.hall[_i]);
+            if (_d && (state->mask & (1 << _i))) {
+                _flags |= 1 << _i;
+                _n += _putVarint(&_rec[_n], _zigzag(_d));
+            }
+        }
+        // The temperatures and the supply share a flag: they move slowly
+        int32_t _d[LOG_TEMP_PROBES + 1];
+        uint8_t _nd = 0;
+        bool _changed = false;
+        for (; _nd < state->probes; ++_nd) {
+            _d[_nd] = (int32_t)record->tempCenti[_nd] -
+                      state->prev.tempCenti[_nd];
+            _changed |= _d[_nd] != 0;
+        }
+        if (state->mask & LOG_SUPPLY_bm) {
+            _d[_nd] = (int32_t)record->supplyCenti - state->prev.supplyCenti;
+            _changed |= _d[_nd++] != 0;
+        }
+        if (_changed) {
+            _flags |= LOG_DELTA_TEMP_bm;
+            for (uint8_t _i = 0; _i < _nd; ++_i) {
+                _n += _putVarint(&_rec[_n], _zigzag(_d[_i]));
+            }
+        }
+        _rec[0] = _flags;
+
+        if (state->used + _n > LOG_BLOCK_SIZE) {
+            return 0;
+        }
+        memcpy(_dst, _rec, _n);
+        state->timeStep = _step;
+    }
+
+    state->prev = *record;
+    ++state->count;
+    state->used += _n;
+    _putBlockHeader(state->block, state->type, state->count, state->used);
+    return _n;
+}
+
+uint16_t LOG_blockAppendSummary(LogBlockState *state,
+                                const LogSummary *summary) {
+    uint8_t *_dst = &state->block[state->used];
+    uint16_t _n = 1 + LOG_summarySize(state->mask);
+    if (state->used + _n > LOG_BLOCK_SIZE) {
+        return 0;
+    }
+
+    *_dst++ = LOG_ENTRY_SUMMARY;
+    _put32(_dst, summary->time);
+    _put16(&_dst[4], summary->count);
+    _dst += 6;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (state->mask & (1 << _i)) {
+            uint16_t _min = summary->min[_i] & 0x0FFF;
+            uint16_t _max = summary->max[_i] & 0x0FFF;
+            _dst[0] = _min;
+            _dst[1] = (_min >> 8) | (_max << 4);
+            _dst[2] = _max >> 4;
+            _put16(&_dst[3], summary->mean[_i]);
+            _put32(&_dst[5], summary->var[_i]);
+            _dst += 9;
+        }
+    }
+    _put16(_dst, summary->tempMin);
+    _put16(&_dst[2], summary->tempMax);
+    _put16(&_dst[4], summary->tempMean);
+
+    ++state->count;
+    state->used += _n;
+    _putBlockHeader(state->block, state->type, state->count, state->used);
+    return _n;
+}
+
+bool LOG_blockResume(LogBlockState *state, uint8_t *block,
+                     const uint8_t mask, const uint8_t probes) {
+    LogRecord _r;
+    if (!LOG_blockBegin(state, block, mask, probes)) {
+        return false;
+    }
+    while (LOG_blockNext(state, block, &_r)) {
+    }
+    if (state->count != 0) {  // Records left that do not decode
+        return false;
+    }
+    // Back to encoder use: `count` and `used` of the whole block
+    state->block = block;
+    state->count = _get16(&block[LOG_BLOCK_COUNT_OFS]);
+    state->used = _get16(&block[LOG_BLOCK_USED_OFS]);
+    return true;
+}
+
+void LOG_blockSeal(uint8_t *block, const uint16_t file, const uint32_t seq) {
+    _put16(&block[LOG_BLOCK_FILE_OFS], file);
+    _put16(&block[LOG_BLOCK_SEQ_OFS], seq);
+    _put16(&block[LOG_BLOCK_SEQ_OFS + 2], seq >> 16);
+    _put16(&block[LOG_BLOCK_CRC_OFS],
+           _blockCrc(block, _get16(&block[LOG_BLOCK_USED_OFS])));
+}
+
+bool LOG_blockCheck(const uint8_t *block, const uint16_t file,
+                    const uint32_t seq) {
+    uint16_t _used = _get16(&block[LOG_BLOCK_USED_OFS]);
+    uint32_t _seq = _get16(&block[LOG_BLOCK_SEQ_OFS]) |
+                    (uint32_t)_get16(&block[LOG_BLOCK_SEQ_OFS + 2]) << 16;
+    return block[0] == LOG_BLOCK_MARKER &&
+           _get16(&block[LOG_BLOCK_FILE_OFS]) == file && _seq == seq &&
+           _used >= LOG_BLOCK_HEADER_SIZE && _used <= LOG_BLOCK_SIZE &&
+           _get16(&block[LOG_BLOCK_CRC_OFS]) == _blockCrc(block, _used);
+}
+
+void LOG_healthBlock(uint8_t *block, const LogCardHealth *health) {
+    memset(block, 0, LOG_BLOCK_SIZE);
+    _putBlockHeader(block, LOG_BLOCK_HEALTH, 0, LOG_BLOCK_SIZE);
+    memcpy(&block[LOG_BLOCK_HEADER_SIZE], health, sizeof(LogCardHealth));
+}
+
+bool LOG_readHealth(const uint8_t *block, LogCardHealth *health) {
+    if (block[0] != LOG_BLOCK_MARKER || block[1] != LOG_BLOCK_HEALTH) {
+        return false;
+    }
+    memcpy(health, &block[LOG_BLOCK_HEADER_SIZE], sizeof(LogCardHealth));
+    return true;
+}
+
+void LOG_eventBlock(uint8_t *block, const LogEventHeader *event,
+                    const LogHallSample *hall) {
+    memset(block, 0, LOG_BLOCK_SIZE);
+    uint8_t _n = event->count < LOG_EVENT_SAMPLES ? event->count
+                                                  : LOG_EVENT_SAMPLES;
+    uint16_t _used = LOG_BLOCK_HEADER_SIZE + sizeof(LogEventHeader) +
+                     _n * LOG_HALL_PACKED_SIZE;
+    _putBlockHeader(block, LOG_BLOCK_EVENT, 0, _used);
+    uint8_t *_p = &block[LOG_BLOCK_HEADER_SIZE];
+    memcpy(_p, event, sizeof(LogEventHeader));
+    _p[offsetof(LogEventHeader, count)] = _n;
+    _p += sizeof(LogEventHeader);
+    for (uint8_t _i = 0; _i < _n; ++_i) {
+        _packHall(_p, hall[_i], LOG_HALL_MASK_ALL);
+        _p += LOG_HALL_PACKED_SIZE;
+    }
+}
+
+bool LOG_readEvent(const uint8_t *block, LogEventHeader *event,
+                   LogHallSample *hall) {
+    if (block[0] != LOG_BLOCK_MARKER || block[1] != LOG_BLOCK_EVENT) {
+        return false;
+    }
+    const uint8_t *_p = &block[LOG_BLOCK_HEADER_SIZE];
+    memcpy(event, _p, sizeof(LogEventHeader));
+    if (event->count > LOG_EVENT_SAMPLES) {
+        return false;
+    }
+    _p += sizeof(LogEventHeader);
+    for (uint8_t _i = 0; hall && _i < event->count; ++_i) {
+        _unpackHall(_p, hall[_i], LOG_HALL_MASK_ALL);
+        _p += LOG_HALL_PACKED_SIZE;
+    }
+    return true;
+}
+
+bool LOG_blockBegin(LogBlockState *state, const uint8_t *block,
+                    const uint8_t mask, const uint8_t probes) {
+    state->block = nullptr;
+    state->type = block[1];
+    state->mask = mask;
+    state->probes = probes;
+    state->timeStep = 0;
+    state->prev.time = 0;  // No record yet
+    state->count = _get16(&block[LOG_BLOCK_COUNT_OFS]);
+    state->used = _get16(&block[LOG_BLOCK_USED_OFS]);
+    if (block[0] != LOG_BLOCK_MARKER ||
+        (state->type != LOG_BLOCK_DELTA && state->type != LOG_BLOCK_PACKED &&
+         state->type != LOG_BLOCK_HEALTH && state->type != LOG_BLOCK_EVENT &&
+         state->type != LOG_BLOCK_STATS) ||
+        ((state->type == LOG_BLOCK_HEALTH || state->type == LOG_BLOCK_EVENT) &&
+         state->count != 0) ||
+        state->used < LOG_BLOCK_HEADER_SIZE || state->used > LOG_BLOCK_SIZE) {
+        return false;
+    }
+    // From here on `used` is the read position and `count` the records left
+    state->used = LOG_BLOCK_HEADER_SIZE;
+    return true;
+}
+
+bool LOG_blockNext(LogBlockState *state, const uint8_t *block,
+                   LogRecord *record) {
+    if (state->type == LOG_BLOCK_STATS) {  // Skip the summaries
+        LogSummary _s;
+        uint8_t _kind;
+        while ((_kind = LOG_blockNextEntry(state, block, record, &_s)) ==
+               LOG_ENTRY_SUMMARY) {
+        }
+        return _kind == LOG_ENTRY_RECORD;
+    }
+    if (state->count == 0) {
+        return false;
+    }
+    const uint8_t *_p = block + state->used;
+    const uint8_t *_end = block + _get16(&block[LOG_BLOCK_USED_OFS]);
+
+    if (state->used == LOG_BLOCK_HEADER_SIZE ||
+        state->type == LOG_BLOCK_PACKED) {  // Keyframe
+        uint8_t _size = LOG_packedSize(state->mask, state->probes);
+        if (_p + _size > _end) {
+            return false;
+        }
+        LOG_unpackRecord(_p, &state->prev, state->mask, state->probes);
+        _p += _size;
+    } else {
+        if (_p >= _end) {
+            return false;
+        }
+        uint8_t _flags = *_p++, _n;
+        uint32_t _v;
+
+        if (_flags & LOG_DELTA_TIME_bm) {
+            if (!(_n = _getVarint(_p, _end, &_v))) {
+                return false;
+            }
+            state->timeStep = _v;
+            _p += _n;
+        }
+        if (state->mask & LOG_MILLIS_bm) {
+            int32_t _ms = (int32_t)state->timeStep + state->prev.timeMs;
+            int32_t _s = _ms / 1000;
+            _ms -= _s * 1000;
+            if (_ms < 0) {
+                _ms += 1000;
+                --_s;
+            }
+            state->prev.time += _s;
+            state->prev.timeMs = _ms;
+        } else {
+            state->prev.time += state->timeStep;
+        }
+        for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+            if (_flags & (1 << _i)) {
+                if (!(_n = _getVarint(_p, _end, &_v))) {
+                    return false;
+                }
+                state->prev.hall[_i] += _unzigzag(_v);
+                _p += _n;
+            }
+        }
+        if (_flags & LOG_DELTA_TEMP_bm) {
+            for (uint8_t _i = 0; _i < state->probes; ++_i) {
+                if (!(_n = _getVarint(_p, _end, &_v))) {
+                    return false;
+                }
+                state->prev.tempCenti[_i] += _unzigzag(_v);
+                _p += _n;
+            }
+            if (state->mask & LOG_SUPPLY_bm) {
+                if (!(_n = _getVarint(_p, _end, &_v))) {
+                    return false;
+                }
+                state->prev.supplyCenti += _unzigzag(_v);
+                _p += _n;
+            }
+        }
+    }
+
+    state->used = _p - block;
+    --state->count;
+    *record = state->prev;
+    return true;
+}
+
+uint8_t LOG_blockNextEntry(LogBlockState *state, const uint8_t *block,
+                           LogRecord *record, LogSummary *summary) {
+    if (state->type != LOG_BLOCK_STATS) {
+        return LOG_blockNext(state, block, record) ? LOG_ENTRY_RECORD
+                                                   : LOG_ENTRY_NONE;
+    }
+    if (state->count == 0) {
+        return LOG_ENTRY_NONE;
+    }
+    const uint8_t *_p = block + state->used;
+    const uint8_t *_end = block + _get16(&block[LOG_BLOCK_USED_OFS]);
+    if (_p >= _end) {
+        return LOG_ENTRY_NONE;
+    }
+
+    uint8_t _kind = *_p++, _size = 0;
+    if (_kind == LOG_ENTRY_RECORD) {
+        _size = LOG_packedSize(state->mask, state->probes);
+    } else if (_kind == LOG_ENTRY_SUMMARY) {
+        _size = LOG_summarySize(state->mask);
+    }
+    if (_size == 0 || _p + _size > _end) {
+        return LOG_ENTRY_NONE;
+    }
+    if (_kind == LOG_ENTRY_RECORD) {
+        LOG_unpackRecord(_p, &state->prev, state->mask, state->probes);
+        *record = state->prev;
+    } else {
+        _unpackSummary(_p, summary, state->mask);
+    }
+
+    state->used = _p + _size - block;
+    --state->count;
+    return _kind;
+}
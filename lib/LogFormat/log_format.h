@@ -0,0 +1,626 @@
+/**
+ * @file    log_format.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Binary log file format, shared by the firmware and the host tools.
+ *
+ * A binary log file starts with a 512-byte header sector (LogFileHeader, zero
+ * padded, with a CRC-16 in its last two bytes) followed by 512-byte blocks,
+ * one per card sector. Each block starts with a LogBlockHeader that carries
+ * the file id (the header CRC), its sequence number (the sector index in the
+ * file) and a CRC-16 of the used bytes, so a torn, stale or never written
+ * sector is told apart from a valid one after a power failure.
+ *
+ * Packed blocks (LOG_FORMAT_PACKED) hold fixed-size packed records, up to
+ * LOG_PACKED_PER_BLOCK with all six hall channels:
+ *
+ * | Offset | Size | Field                                              |
+ * | ------ | ---- | -------------------------------------------------- |
+ * | 0      | 4    | POSIX time (uint32)                                |
+ * | 4      | h    | 12-bit values of the logged hall channels (header  |
+ * |        |      | hallMask), two per three bytes: h = (3n + 1) / 2   |
+ * | 4 + h  | 2p   | Temperature of each probe (header tempProbes) in   |
+ * |        |      | centi-degrees Celsius (int16)                      |
+ * | 4+h+2p | 2    | AREF supply in centivolts (uint16), only with      |
+ * |        |      | LOG_SUPPLY_bm in hallMask                          |
+ * | last 2 | 2    | Milliseconds of the time (uint16), only with       |
+ * |        |      | LOG_MILLIS_bm in hallMask                          |
+ *
+ * Delta blocks (LOG_FORMAT_DELTA) hold a keyframe (a packed record) followed
+ * by delta records:
+ *
+ * - flags: bits 0-5 hall channel changed, bit 6 a temperature (or the
+ *   supply) changed, bit 7 time step differs from the previous one
+ * - time step in seconds (varint), if bit 7. With LOG_MILLIS_bm it is in
+ *   milliseconds, as a two's complement uint32, and a record more than
+ *   LOG_DELTA_MS_MAX_S away from the previous one starts a new block
+ * - one zig-zag varint per changed hall channel, then, if bit 6, one per
+ *   probe temperature and, with LOG_SUPPLY_bm, the supply
+ *
+ * The time step starts at 0 in every block, so blocks decode on their own.
+ * The unused tail of a block is zero.
+ *
+ * Health blocks (LOG_BLOCK_HEALTH) hold no records but one LogCardHealth, the
+ * SD card counters at that time, and take the whole block.
+ *
+ * Event blocks (LOG_BLOCK_EVENT) hold no records but one burst capture: a
+ * LogEventHeader followed by its hall samples, six 12-bit values in 9 bytes
+ * each as in packed records.
+ *
+ * Statistics blocks (LOG_BLOCK_STATS) replace the record blocks of a file with
+ * interval statistics (header stats.windowS not 0). Each entry starts with a
+ * LogEntryKind byte: a packed record (the decimated samples) or a packed
+ * LogSummary of a window:
+ *
+ * | Offset | Size | Field                                              |
+ * | ------ | ---- | -------------------------------------------------- |
+ * | 0      | 4    | POSIX time of the window start (uint32)            |
+ * | 4      | 2    | Samples in the window (uint16)                     |
+ * | 6      | 9n   | Per logged hall channel: min and max (two 12-bit   |
+ * |        |      | values in 3 bytes), mean (uint16) and sample       |
+ * |        |      | variance (uint32), both in 1/16 counts             |
+ * | 6 + 9n | 6    | Temperature min, max and mean of the first probe   |
+ * |        |      | (int16 centi-degrees)                              |
+ *
+ * All multi-byte values are little-endian. This file only depends on the C
+ * standard library so it can be built for the host.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOG_FORMAT_H__
+#define __LOG_FORMAT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// File magic and version of the binary format
+#define LOG_MAGIC          "BHDL"
+#define LOG_FORMAT_VERSION 2
+
+// The header takes a whole sector so records start sector-aligned
+#define LOG_HEADER_SIZE 512
+
+// Values per record
+#define LOG_HALL_CHANNELS 6
+
+// Hall channel mask with all of them logged
+#define LOG_HALL_MASK_ALL 0x3F
+
+// hallMask bit set when the records also carry the AREF supply voltage
+#define LOG_SUPPLY_bm 0x40
+
+// hallMask bit set when the records also carry the milliseconds of their time
+// (sample periods below a second)
+#define LOG_MILLIS_bm 0x80
+
+// Longest time step of a delta record in milliseconds, in seconds
+#define LOG_DELTA_MS_MAX_S 2000000L
+
+// Size of a packed record with all six hall channels in bytes
+#define LOG_PACKED_RECORD_SIZE 15
+
+// Size of a block (one card sector) and first byte of its header
+#define LOG_BLOCK_SIZE   512
+#define LOG_BLOCK_MARKER 0xB5
+
+// Size of a block header and packed records per block
+#define LOG_BLOCK_HEADER_SIZE 14
+#define LOG_PACKED_PER_BLOCK \
+    ((LOG_BLOCK_SIZE - LOG_BLOCK_HEADER_SIZE) / LOG_PACKED_RECORD_SIZE)
+
+// Temperature probes per record, at most
+#define LOG_TEMP_PROBES 4
+
+// Largest delta record: flags, 5-byte time step, 6 x 2-byte hall and 3-byte
+// temperature and supply varints
+#define LOG_DELTA_MAX_SIZE (18 + 3 * LOG_TEMP_PROBES + 3)
+
+// Hall samples of a burst event (one event block)
+#define LOG_EVENT_SAMPLES    48
+#define LOG_HALL_PACKED_SIZE 9
+
+// Calibration breakpoints per hall channel (see log_calib.h)
+#define LOG_CAL_POINTS 4
+
+// Temperature value of a failed or missing reading (centi-degrees)
+#define LOG_TEMP_INVALID INT16_MIN
+
+// Fractional bits of the hall means and variances of a summary
+#define LOG_STATS_FRAC 4
+
+// Card latency histogram: bin 0 counts operations under 2^8 us, bin k from
+// 2^(k+7) to 2^(k+8) us and the last bin all the slower ones (from 262 ms)
+#define LOG_LATENCY_BINS      12
+#define LOG_LATENCY_BIN0_LOG2 8
+
+/**
+ * @brief Record formats of a log file
+ */
+enum LogRecordFormat : uint8_t {
+    LOG_FORMAT_CSV = 0,     ///< ASCII text, one line per record
+    LOG_FORMAT_PACKED = 1,  ///< Fixed-size binary records in blocks
+    LOG_FORMAT_DELTA = 2,   ///< Delta records in self-contained blocks
+};
+
+/**
+ * @brief Block types
+ */
+enum LogBlockType : uint8_t {
+    LOG_BLOCK_DELTA = 1,   ///< Keyframe and delta records
+    LOG_BLOCK_PACKED = 2,  ///< Packed records
+    LOG_BLOCK_HEALTH = 3,  ///< SD card health counters, no records
+    LOG_BLOCK_EVENT = 4,   ///< Burst capture around a trigger, no records
+    LOG_BLOCK_STATS = 5,   ///< Window summaries and decimated records
+};
+
+/**
+ * @brief Entries of a statistics block (first byte of each one)
+ */
+enum LogEntryKind : uint8_t {
+    LOG_ENTRY_NONE = 0,     ///< End of the block (never stored)
+    LOG_ENTRY_RECORD = 1,   ///< Packed record
+    LOG_ENTRY_SUMMARY = 2,  ///< Packed window summary
+};
+
+/**
+ * @brief SD card operations timed by the health counters
+ */
+enum LogCardOp : uint8_t {
+    LOG_CARD_OPEN = 0,  ///< File create or open
+    LOG_CARD_WRITE,     ///< Sector or file write
+    LOG_CARD_SYNC,      ///< Card or file sync
+    LOG_CARD_OPS
+};
+
+/**
+ * @brief ADC configuration used to acquire the hall values
+ */
+struct __attribute__((packed)) LogADCConfig {
+    uint8_t ctrlb;        ///< ADC0.CTRLB (sample accumulation)
+    uint8_t ctrlc;        ///< ADC0.CTRLC (reference, prescaler, SAMPCAP)
+    uint8_t ctrld;        ///< ADC0.CTRLD (init delay, sample delay)
+    uint8_t sampctrl;     ///< ADC0.SAMPCTRL (sample length)
+    uint8_t resultShift;  ///< Right shift applied to the accumulated result
+};
+
+/**
+ * @brief Change-driven logging settings: a record is only written when a value
+ * leaves the band around the last record written, or when the heartbeat is
+ * due. All zero when every sample is written.
+ */
+struct __attribute__((packed)) LogChangeFilter {
+    uint16_t hallBand;    ///< Hall change in counts that writes a record
+    uint16_t tempBand;    ///< Temperature change in centi-degrees
+    uint16_t heartbeatS;  ///< Longest time between records (0: filter off)
+};
+
+/**
+ * @brief Interval statistics settings: one summary per window and the samples
+ * still logged. All zero when every sample is written.
+ */
+struct __attribute__((packed)) LogStatsConfig {
+    uint16_t windowS;   ///< Window length in seconds (0: statistics off)
+    uint16_t rawEvery;  ///< Log the samples at multiples of this many seconds
+                        ///< (0: none)
+};
+
+/**
+ * @brief A calibration breakpoint: the valve gape at a hall value
+ */
+struct __attribute__((packed)) LogCalPoint {
+    uint16_t raw;     ///< Hall value in counts
+    uint16_t gapeUm;  ///< Valve gape in micrometres
+};
+
+/**
+ * @brief Per-channel hall to gape calibration, piecewise linear between
+ * LOG_CAL_POINTS breakpoints with ascending hall values
+ */
+struct __attribute__((packed)) LogCalibration {
+    uint8_t channels;  ///< Bit k set when hall channel k+1 is calibrated
+    LogCalPoint points[LOG_HALL_CHANNELS][LOG_CAL_POINTS];  ///< Breakpoints
+};
+
+/**
+ * @brief Binary log file header, stored at the start of the first sector
+ */
+struct __attribute__((packed)) LogFileHeader {
+    char magic[4];             ///< LOG_MAGIC, not null-terminated
+    uint8_t version;           ///< LOG_FORMAT_VERSION
+    uint8_t recordFormat;      ///< LogRecordFormat of the records
+    uint16_t headerSize;       ///< Offset of the first record
+    uint8_t recordSize;        ///< Bytes per record
+    uint8_t channels;          ///< Hall values per record
+    uint16_t serialNumber;     ///< Device serial number (0 if not set)
+    uint8_t fwVersion[3];      ///< Firmware major, minor and patch
+    uint32_t startTime;        ///< POSIX time of the file creation
+    uint32_t samplePeriodMs;   ///< Nominal time between records
+    uint8_t channelOrder[LOG_HALL_CHANNELS];  ///< ADC input of each column
+    LogADCConfig adc;          ///< ADC configuration
+    LogChangeFilter filter;    ///< Change-driven logging settings
+    LogCalibration cal;        ///< Hall to gape calibration
+    uint8_t hallMask;          ///< Hall channels logged (bit 0: hall1),
+                               ///< LOG_SUPPLY_bm and LOG_MILLIS_bm
+    LogStatsConfig stats;      ///< Interval statistics settings
+    uint8_t tempProbes;        ///< Temperatures per record (0: one)
+};
+
+/**
+ * @brief Header at the start of every block
+ */
+struct __attribute__((packed)) LogBlockHeader {
+    uint8_t marker;  ///< LOG_BLOCK_MARKER
+    uint8_t type;    ///< LogBlockType
+    uint16_t count;  ///< Records in the block
+    uint16_t used;   ///< Bytes used, including this header
+    uint16_t file;   ///< File id: CRC of the file header
+    uint32_t seq;    ///< Sector index of the block in the file
+    uint16_t crc;    ///< CRC-16 of the used bytes except this field
+};
+
+/**
+ * @brief Counters of one kind of card operation
+ */
+struct __attribute__((packed)) LogCardOpStats {
+    uint32_t count;    ///< Operations (each one with its retries)
+    uint16_t retries;  ///< Attempts repeated after a failure
+    uint16_t errors;   ///< Operations that failed after the retries
+    uint32_t maxUs;    ///< Slowest operation
+    uint16_t latency[LOG_LATENCY_BINS];  ///< Latency histogram (saturates)
+};
+
+/**
+ * @brief SD card health counters since power-on
+ */
+struct __attribute__((packed)) LogCardHealth {
+    uint32_t time;        ///< POSIX time of the report
+    uint8_t errorCode;    ///< sdErrorCode() of the last failure (0: none)
+    uint32_t errorData;   ///< sdErrorData() of the last failure
+    uint32_t errorTime;   ///< POSIX time of the last failure
+    LogCardOpStats op[LOG_CARD_OPS];  ///< Counters by LogCardOp
+};
+
+/**
+ * @brief Six hall values sampled together
+ */
+typedef uint16_t LogHallSample[LOG_HALL_CHANNELS];
+
+/**
+ * @brief Burst capture around a fast change of the hall values
+ */
+struct __attribute__((packed)) LogEventHeader {
+    uint32_t time;       ///< POSIX time of the trigger sample
+    uint16_t timeMs;     ///< Milliseconds of the trigger within that second
+    uint16_t periodUs;   ///< Time between samples
+    uint8_t count;       ///< Samples in the event (up to LOG_EVENT_SAMPLES)
+    uint8_t pre;         ///< Samples before the trigger sample
+    uint8_t channels;    ///< Hall columns that triggered (bit 0: hall1)
+    uint16_t threshold;  ///< Change that triggered the capture
+};
+
+/**
+ * @brief Decoded record
+ */
+struct LogRecord {
+    uint32_t time;                     ///< POSIX time
+    uint16_t timeMs;                   ///< Milliseconds within that second
+                                       ///< (0 if not logged)
+    uint16_t hall[LOG_HALL_CHANNELS];  ///< Hall values (12 bits)
+    int16_t tempCenti[LOG_TEMP_PROBES];  ///< Temperature of each probe in
+                                         ///< centi-degrees
+    uint16_t supplyCenti;              ///< AREF supply in centivolts (0 if
+                                       ///< not logged)
+};
+
+/**
+ * @brief Statistics of the samples of a window. Channels without samples (or
+ * not logged) are 0, the temperature (of the first probe) LOG_TEMP_INVALID.
+ */
+struct LogSummary {
+    uint32_t time;                     ///< POSIX time of the window start
+    uint16_t count;                    ///< Samples in the window
+    uint16_t min[LOG_HALL_CHANNELS];   ///< Lowest hall value
+    uint16_t max[LOG_HALL_CHANNELS];   ///< Highest hall value
+    uint16_t mean[LOG_HALL_CHANNELS];  ///< Mean in 1/16 counts
+    uint32_t var[LOG_HALL_CHANNELS];   ///< Sample variance in 1/16 counts^2
+    int16_t tempMin;                   ///< Temperatures in centi-degrees
+    int16_t tempMax;
+    int16_t tempMean;
+};
+
+/**
+ * @brief Block coder state: the block being filled or read and the previous
+ * record in it
+ */
+struct LogBlockState {
+    uint8_t *block;      ///< Block being filled (encoder only)
+    LogRecord prev;      ///< Last record of the block
+    uint32_t timeStep;   ///< Last time step of the block (in milliseconds
+                         ///< with LOG_MILLIS_bm)
+    uint16_t count;      ///< Records in the block
+    uint16_t used;       ///< Bytes used in the block
+    uint8_t type;        ///< LogBlockType
+    uint8_t mask;        ///< Hall channels stored (bit 0: hall1)
+    uint8_t probes;      ///< Temperatures stored
+};
+
+/**
+ * @brief Update a CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) with a
+ * block of bytes
+ *
+ * @param[in] data      Bytes to add
+ * @param[in] len       Number of bytes
+ * @param[in] crc       CRC of the previous bytes (0xFFFF to start)
+ *
+ * @return Updated CRC
+ */
+uint16_t LOG_crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief Fill the constant fields of a header (magic, version, sizes) and
+ * clear the rest
+ *
+ * @param[out] header           Header to initialize
+ * @param[in]  record_format    LogRecordFormat of the records
+ */
+void LOG_initHeader(LogFileHeader *header, const uint8_t record_format);
+
+/**
+ * @brief Serialize a header into a LOG_HEADER_SIZE sector: copy it, zero pad
+ * it and store the CRC-16 of the first 510 bytes in the last two
+ *
+ * @param[in]  header   Header to serialize
+ * @param[out] sector   LOG_HEADER_SIZE bytes
+ *
+ * @return Header CRC, the file id of the blocks
+ */
+uint16_t LOG_writeHeader(const LogFileHeader *header, uint8_t *sector);
+
+/**
+ * @brief File id of a header sector (its CRC)
+ *
+ * @param[in] sector    LOG_HEADER_SIZE bytes
+ *
+ * @return File id
+ */
+uint16_t LOG_fileId(const uint8_t *sector);
+
+/**
+ * @brief Check the magic, version and CRC of a header sector and copy it out.
+ * A zero hallMask or tempProbes (files written before they existed) reads as
+ * all six channels or one probe.
+ *
+ * @param[in]  sector   LOG_HEADER_SIZE bytes from the start of a file
+ * @param[out] header   Decoded header
+ *
+ * @return True if the header is valid
+ */
+bool LOG_readHeader(const uint8_t *sector, LogFileHeader *header);
+
+/**
+ * @brief Size of a packed record
+ *
+ * @param[in] mask      Hall channels stored (bit 0: hall1), LOG_SUPPLY_bm and
+ *                      LOG_MILLIS_bm
+ * @param[in] probes    Temperatures stored
+ *
+ * @return Bytes per record, LOG_PACKED_RECORD_SIZE with all six channels,
+ * one probe, no supply and no milliseconds
+ */
+uint8_t LOG_packedSize(const uint8_t mask, const uint8_t probes = 1);
+
+/**
+ * @brief Pack a record into LOG_packedSize() bytes
+ *
+ * @param[out] dst      LOG_packedSize(mask) bytes
+ * @param[in]  record   Record to pack (only the low 12 bits of the hall
+ *                      values are kept)
+ * @param[in]  mask     Hall channels stored (bit 0: hall1), LOG_SUPPLY_bm and
+ *                      LOG_MILLIS_bm
+ * @param[in]  probes   Temperatures stored
+ */
+void LOG_packRecord(uint8_t *dst, const LogRecord *record,
+                    const uint8_t mask = LOG_HALL_MASK_ALL,
+                    const uint8_t probes = 1);
+
+/**
+ * @brief Unpack a LOG_packedSize() bytes record
+ *
+ * @param[in]  src      Packed record
+ * @param[out] record   Decoded record, 0 in the channels (supply and
+ *                      milliseconds) not stored, LOG_TEMP_INVALID in the
+ *                      probes not stored
+ * @param[in]  mask     Hall channels stored (bit 0: hall1), LOG_SUPPLY_bm and
+ *                      LOG_MILLIS_bm
+ * @param[in]  probes   Temperatures stored
+ */
+void LOG_unpackRecord(const uint8_t *src, LogRecord *record,
+                      const uint8_t mask = LOG_HALL_MASK_ALL,
+                      const uint8_t probes = 1);
+
+/**
+ * @brief Size of a packed window summary
+ *
+ * @param[in] mask      Hall channels stored (bit 0: hall1)
+ *
+ * @return Bytes per summary, without the entry kind byte
+ */
+uint8_t LOG_summarySize(const uint8_t mask);
+
+/**
+ * @brief Start filling an empty block: write its header with no records
+ *
+ * @param[out] state    Encoder state
+ * @param[out] block    LOG_BLOCK_SIZE bytes, kept by the state
+ * @param[in]  type     LogBlockType of the records
+ * @param[in]  mask     Hall channels stored (header hallMask)
+ * @param[in]  probes   Temperatures stored (header tempProbes)
+ *
+ * @return Bytes written to the block (the block header)
+ */
+uint16_t LOG_blockStart(LogBlockState *state, uint8_t *block,
+                        const uint8_t type,
+                        const uint8_t mask = LOG_HALL_MASK_ALL,
+                        const uint8_t probes = 1);
+
+/**
+ * @brief Append a record to the block being filled and update the block
+ * header. Packed and statistics blocks store every record packed; delta
+ * blocks store a keyframe if the block is empty or a delta record otherwise.
+ *
+ * @param[in,out] state     Encoder state
+ * @param[in]     record    Record to append
+ *
+ * @return Bytes appended, 0 if the record does not fit in the block
+ */
+uint16_t LOG_blockAppend(LogBlockState *state, const LogRecord *record);
+
+/**
+ * @brief Append a window summary to the statistics block being filled and
+ * update the block header
+ *
+ * @param[in,out] state     Encoder state of a LOG_BLOCK_STATS block
+ * @param[in]     summary   Summary to append
+ *
+ * @return Bytes appended, 0 if the summary does not fit in the block
+ */
+uint16_t LOG_blockAppendSummary(LogBlockState *state,
+                                const LogSummary *summary);
+
+/**
+ * @brief Continue filling a block read back from the card: decode its records
+ * to restore the encoder state
+ *
+ * @param[out] state    Encoder state
+ * @param[in]  block    LOG_BLOCK_SIZE bytes, kept by the state
+ * @param[in]  mask     Hall channels stored (header hallMask)
+ * @param[in]  probes   Temperatures stored (header tempProbes)
+ *
+ * @return True if the block decodes completely
+ */
+bool LOG_blockResume(LogBlockState *state, uint8_t *block,
+                     const uint8_t mask = LOG_HALL_MASK_ALL,
+                     const uint8_t probes = 1);
+
+/**
+ * @brief Store the file id, the sequence number and the CRC in the header of
+ * a block, right before it is written to the card
+ *
+ * @param[in,out] block     LOG_BLOCK_SIZE bytes
+ * @param[in]     file      File id (LOG_fileId() of the file header)
+ * @param[in]     seq       Sector index of the block in the file
+ */
+void LOG_blockSeal(uint8_t *block, const uint16_t file, const uint32_t seq);
+
+/**
+ * @brief Check that a block was written for this file and position and that
+ * its CRC matches
+ *
+ * @param[in] block     LOG_BLOCK_SIZE bytes
+ * @param[in] file      File id (LOG_fileId() of the file header)
+ * @param[in] seq       Sector index of the block in the file
+ *
+ * @return True if the block is valid
+ */
+bool LOG_blockCheck(const uint8_t *block, const uint16_t file,
+                    const uint32_t seq);
+
+/**
+ * @brief Fill a health block: a block header with no records, the counters and
+ * a zero tail (the whole block counts as used)
+ *
+ * @param[out] block    LOG_BLOCK_SIZE bytes
+ * @param[in]  health   Card health counters
+ */
+void LOG_healthBlock(uint8_t *block, const LogCardHealth *health);
+
+/**
+ * @brief Read the counters of a valid health block
+ *
+ * @param[in]  block    LOG_BLOCK_SIZE bytes
+ * @param[out] health   Card health counters
+ *
+ * @return True if the block is a health block
+ */
+bool LOG_readHealth(const uint8_t *block, LogCardHealth *health);
+
+/**
+ * @brief Fill an event block: a block header with no records, the event header
+ * and its packed samples, and a zero tail
+ *
+ * @param[out] block    LOG_BLOCK_SIZE bytes
+ * @param[in]  event    Event header (`count` samples)
+ * @param[in]  hall     Samples, oldest first
+ */
+void LOG_eventBlock(uint8_t *block, const LogEventHeader *event,
+                    const LogHallSample *hall);
+
+/**
+ * @brief Read a valid event block
+ *
+ * @param[in]  block    LOG_BLOCK_SIZE bytes
+ * @param[out] event    Event header
+ * @param[out] hall     LOG_EVENT_SAMPLES samples (may be null)
+ *
+ * @return True if the block is an event block
+ */
+bool LOG_readEvent(const uint8_t *block, LogEventHeader *event,
+                   LogHallSample *hall);
+
+/**
+ * @brief Check the header of a block and start reading its records (health
+ * and event blocks have none)
+ *
+ * @param[out] state    Decoder state
+ * @param[in]  block    LOG_BLOCK_SIZE bytes
+ * @param[in]  mask     Hall channels stored (header hallMask)
+ * @param[in]  probes   Temperatures stored (header tempProbes)
+ *
+ * @return True if the block header is valid
+ */
+bool LOG_blockBegin(LogBlockState *state, const uint8_t *block,
+                    const uint8_t mask = LOG_HALL_MASK_ALL,
+                    const uint8_t probes = 1);
+
+/**
+ * @brief Decode the next record of a block
+ *
+ * @param[in,out] state     Decoder state
+ * @param[in]     block     Block passed to LOG_blockBegin()
+ * @param[out]    record    Decoded record
+ *
+ * @return True if a record was decoded, false at the end of the block or if
+ * the block is corrupted
+ */
+bool LOG_blockNext(LogBlockState *state, const uint8_t *block,
+                   LogRecord *record);
+
+/**
+ * @brief Decode the next entry of a block: a record, or a window summary in
+ * statistics blocks (LOG_blockNext() skips those)
+ *
+ * @param[in,out] state     Decoder state
+ * @param[in]     block     Block passed to LOG_blockBegin()
+ * @param[out]    record    Decoded record
+ * @param[out]    summary   Decoded summary
+ *
+ * @return LogEntryKind of the entry, LOG_ENTRY_NONE at the end of the block or
+ * if the block is corrupted
+ */
+uint8_t LOG_blockNextEntry(LogBlockState *state, const uint8_t *block,
+                           LogRecord *record, LogSummary *summary);
+
+#endif  // !__LOG_FORMAT_H__
@@ -0,0 +1,114 @@
+/**
+ * @file    log_stats.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Streaming window statistics (see log_stats.h)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "log_stats.h"
+
+#include <string.h>
+
+/**
+ * @brief Add a value to an accumulator
+ */
+static void _accAdd(LogStatsAcc *acc, const int16_t value) {
+    if (acc->n == 0) {
+        acc->first = value;
+        acc->min = value;
+        acc->max = value;
+    } else if (value < acc->min) {
+        acc->min = value;
+    } else if (value > acc->max) {
+        acc->max = value;
+    }
+    int32_t _d = (int32_t)value - acc->first;
+    uint32_t _a = _d < 0 ? -_d : _d;  // Up to 65535, the square fits
+    acc->sum += _d;
+    acc->sumSq += _a * _a;
+    ++acc->n;
+}
+
+/**
+ * @brief Division rounded half away from zero by a positive divisor
+ */
+static int64_t _divRound(const int64_t value, const int64_t divisor) {
+    return value >= 0 ? (value + divisor / 2) / divisor
+                      : -((-value + divisor / 2) / divisor);
+}
+
+/**
+ * @brief Mean of an accumulator with `frac` fractional bits
+ */
+static int32_t _accMean(const LogStatsAcc *acc, const uint8_t frac) {
+    return ((int32_t)acc->first << frac) +
+           _divRound((int64_t)acc->sum << frac, acc->n);
+}
+
+/**
+ * @brief Sample variance of an accumulator with LOG_STATS_FRAC fractional
+ * bits: (n sumSq - sum^2) / (n (n - 1)), 0 below two samples
+ */
+static uint32_t _accVar(const LogStatsAcc *acc) {
+    if (acc->n < 2) {
+        return 0;
+    }
+    uint64_t _n = acc->n;
+    uint64_t _s2 = (uint64_t)((int64_t)acc->sum * acc->sum);
+    uint64_t _v = ((_n * acc->sumSq - _s2) << LOG_STATS_FRAC) /
+                  (_n * (_n - 1));
+    return _v > UINT32_MAX ? UINT32_MAX : (uint32_t)_v;
+}
+
+void LOG_windowReset(LogStatsWindow *window, const uint32_t time) {
+    memset(window, 0, sizeof(LogStatsWindow));
+    window->time = time;
+}
+
+void LOG_windowAdd(LogStatsWindow *window, const LogRecord *record) {
+    if (window->hall[0].n == UINT16_MAX) {  // Full (sub-second samples)
+        return;
+    }
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        _accAdd(&window->hall[_i], record->hall[_i]);
+    }
+    if (record->tempCenti[0] != LOG_TEMP_INVALID) {
+        _accAdd(&window->temp, record->tempCenti[0]);
+    }
+}
+
+void LOG_windowSummary(const LogStatsWindow *window, LogSummary *summary) {
+    memset(summary, 0, sizeof(LogSummary));
+    summary->time = window->time;
+    summary->count = window->hall[0].n;
+    for (uint8_t _i = 0; summary->count && _i < LOG_HALL_CHANNELS; ++_i) {
+        const LogStatsAcc &_a = window->hall[_i];
+        summary->min[_i] = _a.min;
+        summary->max[_i] = _a.max;
+        summary->mean[_i] = _accMean(&_a, LOG_STATS_FRAC);
+        summary->var[_i] = _accVar(&_a);
+    }
+    if (window->temp.n) {
+        summary->tempMin = window->temp.min;
+        summary->tempMax = window->temp.max;
+        summary->tempMean = _accMean(&window->temp, 0);
+    } else {
+        summary->tempMin = LOG_TEMP_INVALID;
+        summary->tempMax = LOG_TEMP_INVALID;
+        summary->tempMean = LOG_TEMP_INVALID;
+    }
+}
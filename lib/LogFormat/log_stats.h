@@ -0,0 +1,89 @@
+/**
+ * @file    log_stats.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Streaming statistics of the samples of a window (min, max, mean and
+ * sample variance per value) for interval summaries, shared by the firmware
+ * and the host tools.
+ *
+ * The accumulators are the integer form of Welford's update: each value is
+ * taken relative to the first sample of the window, and the sum and the sum of
+ * squares of those differences are kept exactly in integers. There is no
+ * rounding while accumulating and no cancellation between two large sums (the
+ * differences stay small for a steady signal), so the mean and the variance
+ * are only rounded once, when the window is summarized.
+ *
+ * This file only depends on the C standard library so it can be built for the
+ * host.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOG_STATS_H__
+#define __LOG_STATS_H__
+
+#include "log_format.h"
+
+// Longest window: keeps the sums of a window within 64 bits
+#define LOG_STATS_WINDOW_MAX 3600
+
+/**
+ * @brief Accumulator of one value
+ */
+struct LogStatsAcc {
+    uint16_t n;      ///< Samples
+    int16_t first;   ///< First sample, the reference of the sums
+    int16_t min;
+    int16_t max;
+    int32_t sum;     ///< Sum of the differences from `first`
+    uint64_t sumSq;  ///< Sum of their squares
+};
+
+/**
+ * @brief Accumulators of the samples of a window
+ */
+struct LogStatsWindow {
+    uint32_t time;                        ///< Window start (POSIX time)
+    LogStatsAcc hall[LOG_HALL_CHANNELS];  ///< Hall values
+    LogStatsAcc temp;                     ///< Valid temperatures (probe 1)
+};
+
+/**
+ * @brief Start a window with no samples
+ *
+ * @param[out] window   Accumulators
+ * @param[in]  time     Window start
+ */
+void LOG_windowReset(LogStatsWindow *window, const uint32_t time);
+
+/**
+ * @brief Add a sample to a window (LOG_TEMP_INVALID temperatures are left
+ * out). A window keeps its first 65535 samples.
+ *
+ * @param[in,out] window    Accumulators
+ * @param[in]     record    Sample
+ */
+void LOG_windowAdd(LogStatsWindow *window, const LogRecord *record);
+
+/**
+ * @brief Summarize a window: means and variances rounded to LOG_STATS_FRAC
+ * fractional bits, the temperature mean to centi-degrees
+ *
+ * @param[in]  window   Accumulators
+ * @param[out] summary  Statistics of the window
+ */
+void LOG_windowSummary(const LogStatsWindow *window, LogSummary *summary);
+
+#endif  // !__LOG_STATS_H__
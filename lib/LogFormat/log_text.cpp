@@ -0,0 +1,257 @@
+/**
+ * @file    log_text.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "log_text.h"
+
+#include <string.h>
+
+// Powers of ten of the POSIX time digits
+static const uint32_t _pow10[LOG_TEXT_POSIX_LEN] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL,      1000UL,      100UL,      10UL,      1UL};
+
+// Quotients by multiplying with a fixed-point reciprocal, exact for every
+// uint16 (x/10), up to 43698 (x/100) and up to 178 (8-bit x/10)
+#define _DIV10(x)   ((uint16_t)(((uint32_t)(x) * 0xCCCDu) >> 19))
+#define _DIV100(x)  ((uint16_t)(((uint32_t)(x) * 5243u) >> 19))
+#define _DIV10_8(x) ((uint8_t)(((uint16_t)(x) * 103u) >> 10))
+
+/**
+ * @brief Write a value from 0 to 99 as two digits
+ */
+static void _put2(char *dst, const uint8_t value) {
+    uint8_t _tens = _DIV10_8(value);
+    dst[0] = '0' + _tens;
+    dst[1] = '0' + (value - _tens * 10);
+}
+
+/**
+ * @brief Write milliseconds (0 to 999) as a point and three digits
+ */
+static char *_putMs(char *dst, const uint16_t ms) {
+    uint8_t _hundreds = _DIV100(ms);
+    dst[0] = '.';
+    dst[1] = '0' + _hundreds;
+    _put2(&dst[2], ms - _hundreds * 100);
+    return dst + 4;
+}
+
+/**
+ * @brief Add a small value to a string of decimal digits, ending at last
+ */
+static void _addDecimal(char *last, uint8_t value) {
+    while (value) {
+        uint8_t _d = *last - '0' + value;
+        value = 0;
+        while (_d >= 10) {
+            _d -= 10;
+            ++value;  // Carry to the next digit
+        }
+        *last-- = '0' + _d;
+    }
+}
+
+/**
+ * @brief Render the whole time text
+ */
+static void _renderTime(LogTimeText *text, const uint32_t time) {
+    // Zero-padded POSIX time
+    uint32_t _v = time;
+    text->posixStart = LOG_TEXT_POSIX_LEN - 1;
+    for (uint8_t _i = 0; _i < LOG_TEXT_POSIX_LEN; ++_i) {
+        char _d = '0';
+        while (_v >= _pow10[_i]) {
+            _v -= _pow10[_i];
+            ++_d;
+        }
+        text->posix[_i] = _d;
+        if (_d != '0' && _i < text->posixStart) {
+            text->posixStart = _i;
+        }
+    }
+    text->posix[LOG_TEXT_POSIX_LEN] = '\0';
+
+    // Civil date from days since 1970-01-01 (H. Hinnant's algorithm)
+    uint32_t _days = time / 86400UL;
+    uint32_t _sec = time - _days * 86400UL;
+    uint32_t _z = _days + 719468UL;
+    uint32_t _era = _z / 146097UL;
+    uint32_t _doe = _z - _era * 146097UL;
+    uint32_t _yoe = (_doe - _doe / 1460 + _doe / 36524 - _doe / 146096) / 365;
+    uint32_t _doy = _doe - (365 * _yoe + _yoe / 4 - _yoe / 100);
+    uint32_t _mp = (5 * _doy + 2) / 153;
+    uint8_t _d = _doy - (153 * _mp + 2) / 5 + 1;
+    uint8_t _m = _mp < 10 ? _mp + 3 : _mp - 9;
+    uint16_t _y = _yoe + _era * 400 + (_m <= 2);
+
+    text->dayStart = time - _sec;
+    text->hour = _sec / 3600;
+    uint16_t _rem = _sec - text->hour * 3600UL;
+    text->minute = _rem / 60;
+    text->second = _rem - text->minute * 60;
+
+    char *_dt = text->datetime;
+    _put2(&_dt[0], _y / 100);
+    _put2(&_dt[2], _y % 100);
+    _dt[4] = '-';
+    _put2(&_dt[5], _m);
+    _dt[7] = '-';
+    _put2(&_dt[8], _d);
+    _dt[10] = ' ';
+    _put2(&_dt[11], text->hour);
+    _dt[13] = ':';
+    _put2(&_dt[14], text->minute);
+    _dt[16] = ':';
+    _put2(&_dt[17], text->second);
+    _dt[LOG_TEXT_DATETIME_LEN] = '\0';
+
+    text->time = time;
+}
+
+void LOG_timeTextReset(LogTimeText *text) {
+    memset(text, 0, sizeof(LogTimeText));
+}
+
+void LOG_timeTextUpdate(LogTimeText *text, const uint32_t time) {
+    uint32_t _step = time - text->time;
+    if (_step == 0 && text->time != 0) {
+        return;
+    }
+    // Jumps, steps back and day changes render everything again
+    if (text->time == 0 || time < text->time || _step >= 60 ||
+        time - text->dayStart >= 86400UL) {
+        _renderTime(text, time);
+        return;
+    }
+
+    _addDecimal(&text->posix[LOG_TEXT_POSIX_LEN - 1], _step);
+    while (text->posixStart && text->posix[text->posixStart - 1] != '0') {
+        --text->posixStart;
+    }
+
+    // Same day, so the hour can not wrap
+    char *_dt = text->datetime;
+    text->second += _step;
+    if (text->second >= 60) {
+        text->second -= 60;
+        if (++text->minute == 60) {
+            text->minute = 0;
+            _put2(&_dt[11], ++text->hour);
+        }
+        _put2(&_dt[14], text->minute);
+    }
+    _put2(&_dt[17], text->second);
+
+    text->time = time;
+}
+
+char *LOG_putUint16(char *dst, uint16_t value) {
+    char _tmp[5];
+    uint8_t _n = 0;
+    do {  // Digits from the last one
+        uint16_t _q = _DIV10(value);
+        _tmp[_n++] = '0' + (value - _q * 10);
+        value = _q;
+    } while (value);
+    while (_n) {
+        *dst++ = _tmp[--_n];
+    }
+    return dst;
+}
+
+char *LOG_putCenti(char *dst, const int16_t temp_centi) {
+    if (temp_centi == LOG_TEMP_INVALID) {
+        return dst;
+    }
+    uint16_t _v = temp_centi;
+    if (temp_centi < 0) {
+        *dst++ = '-';
+        _v = -temp_centi;
+    }
+    uint16_t _deg = _DIV100(_v);
+    dst = LOG_putUint16(dst, _deg);
+    *dst++ = '.';
+    _put2(dst, _v - _deg * 100);
+    return dst + 2;
+}
+
+char *LOG_putMilli(char *dst, const uint16_t value) {
+    uint16_t _units = _DIV10(_DIV10(_DIV10(value)));
+    uint16_t _rem = value - _units * 1000;
+    uint8_t _hundreds = _DIV100(_rem);
+    dst = LOG_putUint16(dst, _units);
+    *dst++ = '.';
+    *dst++ = '0' + _hundreds;
+    _put2(dst, _rem - _hundreds * 100);
+    return dst + 2;
+}
+
+uint8_t LOG_formatRecord(char *dst, const LogRecord *record,
+                         const LogTimeText *text, const bool datetime,
+                         const uint8_t mask, const LogGape *gape,
+                         const uint8_t probes) {
+    char *_p = dst;
+    uint8_t _n = LOG_TEXT_POSIX_LEN - text->posixStart;
+    memcpy(_p, &text->posix[text->posixStart], _n);
+    _p += _n;
+    if (mask & LOG_MILLIS_bm) {
+        _p = _putMs(_p, record->timeMs);
+    }
+    *_p++ = ',';
+    if (datetime) {
+        memcpy(_p, text->datetime, LOG_TEXT_DATETIME_LEN);
+        _p += LOG_TEXT_DATETIME_LEN;
+        if (mask & LOG_MILLIS_bm) {
+            _p = _putMs(_p, record->timeMs);
+        }
+        *_p++ = ',';
+    }
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (mask & (1 << _i)) {
+            _p = LOG_putUint16(_p, record->hall[_i]);
+            *_p++ = ',';
+        }
+    }
+    _p = LOG_putCenti(_p, record->tempCenti[0]);
+    for (uint8_t _i = 1; _i < probes; ++_i) {
+        *_p++ = ',';
+        _p = LOG_putCenti(_p, record->tempCenti[_i]);
+    }
+    if (mask & LOG_SUPPLY_bm) {
+        *_p++ = ',';
+        if (record->supplyCenti) {
+            _p = LOG_putCenti(_p, record->supplyCenti);
+        }
+    }
+    if (gape && (gape->channels & mask)) {
+        for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+            if (!(mask & (1 << _i))) {
+                continue;
+            }
+            *_p++ = ',';
+            if (gape->channels & (1 << _i)) {
+                _p = LOG_putMilli(_p, gape->um[_i]);
+            }
+        }
+    }
+    *_p++ = '\r';
+    *_p++ = '\n';
+    *_p = '\0';
+    return _p - dst;
+}
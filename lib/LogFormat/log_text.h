@@ -0,0 +1,146 @@
+/**
+ * @file    log_text.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Text rendering of log records (CSV lines and the serial output)
+ * without Print, floats or heap use. A record is rendered into one caller
+ * buffer in one pass:
+ *
+ * `POSIX,YYYY-MM-DD hh:mm:ss,hall1,...,hall6,TT.tt\r\n`
+ *
+ * Only the logged hall channels (the channel mask) are printed. With a hall
+ * calibration, their gapes follow the temperature in millimetres with three
+ * decimals (empty for channels without calibration).
+ *
+ * Digits come from 16-bit multiplications by a fixed-point reciprocal of ten
+ * (no division, which is a library call on an 8-bit MCU) and the temperature is
+ * printed from integer centi-degrees.
+ * The POSIX and date-time strings are kept in a LogTimeText between records
+ * and only the digits that changed are rewritten each tick; the date is only
+ * computed again when the day changes or the time jumps.
+ *
+ * This file only depends on the C standard library so it can be built for the
+ * host.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOG_TEXT_H__
+#define __LOG_TEXT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_calib.h"
+#include "log_format.h"
+
+// Length of "YYYY-MM-DD hh:mm:ss" and of the longest POSIX time
+#define LOG_TEXT_DATETIME_LEN 19
+#define LOG_TEXT_POSIX_LEN    10
+
+// Longest rendered record (times with milliseconds, 5-digit hall values, a
+// "-327.68" temperature per probe, a "327.67" supply, six "65.535" gapes),
+// with the line end and a null terminator
+#define LOG_TEXT_MAX_SIZE (128 + 8 * LOG_TEMP_PROBES)
+
+/**
+ * @brief Text of the last rendered time, updated in place
+ */
+struct LogTimeText {
+    char posix[LOG_TEXT_POSIX_LEN + 1];        ///< POSIX time (right aligned)
+    char datetime[LOG_TEXT_DATETIME_LEN + 1];  ///< "YYYY-MM-DD hh:mm:ss"
+    uint8_t posixStart;  ///< Index of the first POSIX digit
+    uint32_t time;       ///< POSIX time of the text (0: not rendered yet)
+    uint32_t dayStart;   ///< POSIX time of 00:00:00 of that day
+    uint8_t hour;        ///< Hour of the text
+    uint8_t minute;      ///< Minute of the text
+    uint8_t second;      ///< Second of the text
+};
+
+/**
+ * @brief Forget the rendered time, the next update renders it in full
+ *
+ * @param[out] text     Time text to reset
+ */
+void LOG_timeTextReset(LogTimeText *text);
+
+/**
+ * @brief Update the time text. A step forward of less than a minute within
+ * the same day only rewrites the changed digits; other changes render the
+ * whole text again.
+ *
+ * @param[in,out] text  Time text
+ * @param[in]     time  POSIX time
+ */
+void LOG_timeTextUpdate(LogTimeText *text, const uint32_t time);
+
+/**
+ * @brief Write an unsigned integer in decimal, without leading zeros
+ *
+ * @param[out] dst      Output, up to 5 characters (not null-terminated)
+ * @param[in]  value    Value to write
+ *
+ * @return Pointer past the last character written
+ */
+char *LOG_putUint16(char *dst, uint16_t value);
+
+/**
+ * @brief Write a temperature in centi-degrees as degrees with two decimals
+ * ("-3.05", "21.50"). LOG_TEMP_INVALID writes nothing.
+ *
+ * @param[out] dst          Output, up to 7 characters (not null-terminated)
+ * @param[in]  temp_centi   Temperature in centi-degrees Celsius
+ *
+ * @return Pointer past the last character written
+ */
+char *LOG_putCenti(char *dst, const int16_t temp_centi);
+
+/**
+ * @brief Write a value in thousandths as units with three decimals
+ * ("12.345", "0.080")
+ *
+ * @param[out] dst      Output, up to 6 characters (not null-terminated)
+ * @param[in]  value    Value in thousandths (micrometres for millimetres)
+ *
+ * @return Pointer past the last character written
+ */
+char *LOG_putMilli(char *dst, const uint16_t value);
+
+/**
+ * @brief Render a record as a text line: POSIX time, the date and time (if
+ * given), both with the milliseconds (".mmm") if LOG_MILLIS_bm is in the
+ * mask, the hall values of the channels in the mask, the temperature of
+ * each probe, the supply (if LOG_SUPPLY_bm is in the mask, empty when not
+ * measured) and their gapes (if any of them is calibrated), comma separated
+ * and ended by "\r\n"
+ *
+ * @param[out] dst      Output, LOG_TEXT_MAX_SIZE bytes (null-terminated)
+ * @param[in]  record   Record to render
+ * @param[in]  text     Time text of the record time, updated with
+ *                      LOG_timeTextUpdate()
+ * @param[in]  datetime Include the date and time column
+ * @param[in]  mask     Hall channels to print (bit 0: hall1), LOG_SUPPLY_bm
+ *                      and LOG_MILLIS_bm
+ * @param[in]  gape     Gapes of the record, nullptr or no channel for none
+ * @param[in]  probes   Temperatures to print
+ *
+ * @return Length of the line
+ */
+uint8_t LOG_formatRecord(char *dst, const LogRecord *record,
+                         const LogTimeText *text, const bool datetime,
+                         const uint8_t mask, const LogGape *gape,
+                         const uint8_t probes = 1);
+
+#endif  // !__LOG_TEXT_H__
@@ -19,12 +19,57 @@
 
 #include "rtc_controller.h"
 
+#include "log_format.h"
+#include "msg_codes.h"
+
 RTC_DS3231 DS3231;
 
 bool _clockErrorFlag = true;
 bool _dateTimeValid = false;
 bool _alarmSetFlag = false;
 
+// Scheduling settings in use
+RTCScheduleConfig _schedule = {'Q', RTC_SCHED_MODE, RTC_SAMPLE_PERIOD_MS, 0};
+// Falling edges of the INT/SQW pin not taken by RTC_tick() yet
+volatile uint8_t _edges = 0;
+// Software clock: time of the last edge (of the last sample with the timer)
+// and of the last DS3231 read, which is due at the next edge when _resync
+// is set
+uint32_t _softTime = 0;
+uint16_t _softMs = 0;
+uint32_t _syncTime = 0;
+bool _resync = true;
+// DS3231 reads, the ones that corrected the software clock and the offset
+// found by the last one (positive: the clock was ahead)
+uint16_t _resyncs = 0;
+uint16_t _corrections = 0;
+int32_t _offsetMs = 0;
+
+// Internal timer (RTC_SCHED_TIMER): RTC.CNT extended to 32 bits by the
+// overflows, the tick of the next sample with its fraction in 1/65536 of a
+// tick, and the periods elapsed that RTC_tick() has not taken yet
+void (*_onTimer)(void) = nullptr;
+volatile uint16_t _overflows = 0;
+volatile uint32_t _deadline = 0;
+volatile uint16_t _deadlineFrac = 0;
+volatile uint8_t _periods = 0;
+// Tick of the last square wave edge
+volatile uint32_t _edgeTicks = 0;
+// Sample period in ticks, from the oscillator frequency measured against the
+// DS3231 in 1/256 Hz
+uint32_t _periodTicks = 0;
+uint16_t _periodFrac = 0;
+uint32_t _tpsQ8 = 32768UL << 8;
+// Time of the next sample
+uint32_t _nextTime = 0;
+uint16_t _nextMs = 0;
+// Discipline: 0 idle, 1 waiting for an edge to align, 2 counting the edges
+// since the one at _discTicks (DS3231 second _discTime)
+uint8_t _discipline = 0;
+uint8_t _discEdges = 0;
+uint32_t _discTicks = 0;
+uint32_t _discTime = 0;
+
 uint8_t RTC_initExternal(void) {
     if (!DS3231.begin()) {  // Initialize RTC communications
         // Unable to find DS3231
@@ -83,13 +128,353 @@ bool RTC_1secondAlarm(void) {
     // Clear older alarm
     DS3231.clearAlarm(1);
 
-    // Set alarm from now + 1 seconds in the future
+    // Set alarm at the next multiple of the sample period
     /// @todo TheCavePearl project has a better way without TimeSpan class
-    _alarmSetFlag =
-        DS3231.setAlarm1(DS3231.now() + TimeSpan(1), DS3231_A1_Second);
+    DateTime _now = DS3231.now();
+    const uint16_t _period = _schedule.periodMs / 1000;
+    _alarmSetFlag = DS3231.setAlarm1(
+        _now + TimeSpan(_period - _now.unixtime() % _period),
+        DS3231_A1_Second);
     return _alarmSetFlag;
 }
 
+/**
+ * @brief Whether a period is valid for a scheduling mode
+ */
+bool _scheduleValid(const uint8_t mode, const uint32_t period_ms) {
+    if (mode == RTC_SCHED_TIMER) {
+        return period_ms >= RTC_PERIOD_MIN_MS && period_ms <= RTC_PERIOD_MAX_MS;
+    }
+    return mode <= RTC_SCHED_SQW && period_ms >= 1000 &&
+           period_ms % 1000 == 0 &&
+           period_ms <= (mode == RTC_SCHED_ALARM ? RTC_ALARM_PERIOD_MAX_MS
+                                                 : RTC_PERIOD_MAX_MS);
+}
+
+void RTC_initSchedule(void) {
+    EEPROM.get(EEPROM_SCHED_ADDR, _schedule);
+    if (_schedule.tag != 'Q' ||
+        _schedule.crc != LOG_crc16((const uint8_t *)&_schedule,
+                                   offsetof(RTCScheduleConfig, crc)) ||
+        !_scheduleValid(_schedule.mode, _schedule.periodMs)) {
+        _schedule.mode = RTC_SCHED_MODE;  // Never set or corrupted
+        _schedule.periodMs = RTC_SAMPLE_PERIOD_MS;
+    }
+}
+
+/**
+ * @brief Add milliseconds to a time
+ */
+void _addMs(uint32_t *time, uint16_t *ms, const uint32_t add) {
+    uint16_t _ms = *ms + add % 1000;
+    *time += add / 1000 + _ms / 1000;
+    *ms = _ms % 1000;
+}
+
+/**
+ * @brief Ticks of the internal timer since it started. Call it with
+ * interrupts off.
+ */
+uint32_t _ticks(void) {
+    uint16_t _high = _overflows;
+    uint16_t _count = RTC.CNT;
+    if (RTC.INTFLAGS & RTC_OVF_bm) {  // Wrapped, interrupt not served yet
+        _count = RTC.CNT;
+        ++_high;
+    }
+    return (uint32_t)_high << 16 | _count;
+}
+
+/**
+ * @brief Take the sample periods elapsed (or due within the compare
+ * synchronisation delay) and set the compare on the next deadline. The
+ * compare only matches the low 16 bits, so it also fires once per overflow
+ * before the deadline; those matches find nothing due. Call it with
+ * interrupts off.
+ */
+void _armCompare(void) {
+    bool _fired = false;
+    while ((int32_t)(_ticks() + 3 - _deadline) >= 0) {
+        uint32_t _frac = (uint32_t)_deadlineFrac + _periodFrac;
+        _deadline += _periodTicks + (_frac >> 16);
+        _deadlineFrac = _frac;
+        if (_periods < UINT8_MAX) {
+            ++_periods;
+        }
+        _fired = true;
+    }
+    while (RTC.STATUS & RTC_CMPBUSY_bm) {
+    }
+    RTC.CMP = (uint16_t)_deadline;
+    if (_fired && _onTimer) {
+        _onTimer();
+    }
+}
+
+ISR(RTC_CNT_vect) {
+    if (RTC.INTFLAGS & RTC_OVF_bm) {
+        RTC.INTFLAGS = RTC_OVF_bm;
+        ++_overflows;
+    }
+    if (RTC.INTFLAGS & RTC_CMP_bm) {
+        RTC.INTFLAGS = RTC_CMP_bm;
+        _armCompare();
+    }
+}
+
+/**
+ * @brief Sample period in ticks of the measured oscillator frequency
+ */
+void _setPeriodTicks(void) {
+    uint64_t _q = ((uint64_t)_schedule.periodMs * _tpsQ8 << 8) / 1000;
+    noInterrupts();
+    _periodTicks = _q >> 16;
+    _periodFrac = _q;
+    interrupts();
+}
+
+/**
+ * @brief Schedule the next sample at the first multiple of the period after
+ * the DS3231 second that started at tick `ticks`, and after the last sample
+ */
+void _align(const uint32_t time, const uint32_t ticks) {
+    uint32_t _phase = (uint64_t)time * 1000 % _schedule.periodMs;
+    uint32_t _wait = _phase ? _schedule.periodMs - _phase : 0;
+    uint32_t _next = time;
+    uint16_t _ms = 0;
+    _addMs(&_next, &_ms, _wait);
+    while (_next < _softTime || (_next == _softTime && _ms <= _softMs)) {
+        _addMs(&_next, &_ms, _schedule.periodMs);
+        _wait += _schedule.periodMs;
+    }
+    _nextTime = _next;
+    _nextMs = _ms;
+
+    uint64_t _q = ((uint64_t)_wait * _tpsQ8 << 8) / 1000;
+    noInterrupts();
+    _deadline = ticks + (uint32_t)(_q >> 16);
+    _deadlineFrac = _q;
+    _periods = 0;
+    RTC.INTFLAGS = RTC_CMP_bm;
+    RTC.INTCTRL = RTC_OVF_bm | RTC_CMP_bm;
+    _armCompare();
+    interrupts();
+}
+
+/**
+ * @brief Offset of the timer schedule at the square wave edge at tick `ticks`
+ * that the DS3231 reads as second `time`, in milliseconds
+ */
+int32_t _timerOffset(const uint32_t time, const uint32_t ticks) {
+    // Ticks to the deadline, which is past the periods not taken yet
+    noInterrupts();
+    int32_t _ahead = _deadline - ticks;
+    uint8_t _pending = _periods;
+    interrupts();
+    int64_t _sched = ((int64_t)_ahead * 256000) / (int32_t)_tpsQ8;
+    return (int32_t)(_nextTime - time) * 1000L + _nextMs +
+           (int32_t)_pending * _schedule.periodMs - _sched;
+}
+
+/**
+ * @brief Discipline the internal timer with the square wave edges: realign
+ * the samples at the first one and measure the oscillator frequency until
+ * RTC_DISCIPLINE_S later
+ *
+ * @param[in] edges  Edges since the last call
+ * @param[in] ticks  Tick of the last of them
+ */
+void _disciplineTimer(const uint8_t edges, const uint32_t ticks) {
+    if (_discipline == 0 &&
+        (_resync || (int32_t)(_nextTime - _syncTime) >= RTC_RESYNC_S)) {
+        DS3231.writeSqwPinMode(DS3231_SquareWave1Hz);
+        _discipline = 1;
+        return;
+    }
+    if (edges == 0) {
+        return;
+    }
+    if (_discipline == 1 || (_discipline == 2 && _resync)) {
+        // Read right after an edge, so the DS3231 second is the new one
+        uint32_t _rtc = DS3231.now().unixtime();
+        if (!_resync) {
+            _offsetMs = _timerOffset(_rtc, ticks);
+            if (_offsetMs > 1 || _offsetMs < -1) {
+                ++_corrections;
+            }
+        }
+        _align(_rtc, ticks);
+        _syncTime = _discTime = _rtc;
+        _discTicks = ticks;
+        _discEdges = 0;
+        _discipline = 2;
+        _resync = false;
+        ++_resyncs;
+    } else if (_discipline == 2) {
+        _discEdges += edges;
+        if (_discEdges < RTC_DISCIPLINE_S) {
+            return;
+        }
+        // Keep the measurement if within 1/16 of the nominal frequency
+        uint32_t _tps = ((uint64_t)(ticks - _discTicks) << 8) / _discEdges;
+        if (_tps > (32768UL << 8) - (32768UL << 4) &&
+            _tps < (32768UL << 8) + (32768UL << 4)) {
+            _tpsQ8 = _tps;
+            _setPeriodTicks();
+        }
+        _align(_discTime + _discEdges, ticks);
+        DS3231.writeSqwPinMode(DS3231_OFF);
+        _discipline = 0;
+    }
+}
+
+bool RTC_startSchedule(void (*on_timer)(void)) {
+    if (_schedule.mode == RTC_SCHED_ALARM) {
+        return RTC_1secondAlarm();
+    }
+
+    // No alarm: the square wave falls on every seconds update
+    DS3231.disableAlarm(1);
+    DS3231.clearAlarm(1);
+    DS3231.writeSqwPinMode(DS3231_SquareWave1Hz);
+    _resync = true;
+
+    if (_schedule.mode == RTC_SCHED_TIMER) {
+#if RTC_TIMER_XOSC32K
+        _PROTECTED_WRITE(CLKCTRL.XOSC32KCTRLA,
+                         CLKCTRL_ENABLE_bm | CLKCTRL_RUNSTDBY_bm);
+#endif
+        // Free running counter, the overflows extend it to 32 bits; the
+        // compare is enabled once aligned at the first edge
+        _onTimer = on_timer;
+        _setPeriodTicks();
+        while (RTC.STATUS > 0) {  // Wait for all registers to synchronise
+        }
+        RTC.CLKSEL = RTC_TIMER_XOSC32K ? RTC_CLKSEL_TOSC32K_gc
+                                       : RTC_CLKSEL_INT32K_gc;
+        RTC.PER = 0xFFFF;
+        RTC.CNT = 0;
+        RTC.INTFLAGS = RTC_OVF_bm | RTC_CMP_bm;
+        RTC.INTCTRL = RTC_OVF_bm;
+        RTC.CTRLA = RTC_PRESCALER_DIV1_gc | RTC_RUNSTDBY_bm | RTC_RTCEN_bm;
+        _discipline = 1;
+    }
+    return DS3231.readSqwPinMode() == DS3231_SquareWave1Hz;
+}
+
+bool RTC_onInterrupt(void) {
+    if (_edges < UINT8_MAX) {
+        ++_edges;
+    }
+    if (_schedule.mode != RTC_SCHED_TIMER) {
+        return true;
+    }
+    _edgeTicks = _ticks();
+    return false;
+}
+
+/**
+ * @brief RTC_tick() with the internal timer
+ */
+bool _tickTimer(const uint8_t edges, const uint32_t ticks, uint32_t *time,
+                uint16_t *time_ms) {
+    // Realign first: a sample on the DS3231 second is due right away
+    _disciplineTimer(edges, ticks);
+
+    noInterrupts();
+    uint8_t _p = _periods;
+    _periods = 0;
+    interrupts();
+
+    // The last period elapsed is sampled, the ones before are missed
+    if (_p > 0) {
+        _addMs(&_nextTime, &_nextMs, (_p - 1) * _schedule.periodMs);
+        _softTime = _nextTime;
+        _softMs = _nextMs;
+        _addMs(&_nextTime, &_nextMs, _schedule.periodMs);
+    }
+    *time = _softTime;
+    *time_ms = _softMs;
+    return _p > 0;
+}
+
+bool RTC_tick(uint32_t *time, uint16_t *time_ms) {
+    noInterrupts();
+    uint8_t _n = _edges;
+    _edges = 0;
+    uint32_t _at = _edgeTicks;
+    interrupts();
+
+    if (_schedule.mode == RTC_SCHED_TIMER) {
+        return _tickTimer(_n, _at, time, time_ms);
+    }
+
+    const uint32_t _prev = _softTime;
+    if (_schedule.mode == RTC_SCHED_ALARM) {
+        _softTime = DS3231.now().unixtime();
+        RTC_1secondAlarm();
+    } else {
+        _softTime += _n;
+        // Read right after an edge, so the DS3231 second is the new one
+        if (_resync || _softTime - _syncTime >= RTC_RESYNC_S) {
+            uint32_t _rtc = DS3231.now().unixtime();
+            if (!_resync && _rtc != _softTime) {
+                _offsetMs = (int32_t)(_softTime - _rtc) * 1000L;
+                ++_corrections;
+            }
+            _softTime = _syncTime = _rtc;
+            _resync = false;
+            ++_resyncs;
+        }
+    }
+    // A sample per period, also when edges were merged or the time set
+    const uint32_t _period = _schedule.periodMs / 1000;
+    *time = _softTime;
+    *time_ms = 0;
+    return _n && _softTime / _period != _prev / _period;
+}
+
+uint32_t RTC_getPeriodMs(void) {
+    return _schedule.periodMs;
+}
+
+uint32_t RTC_getNextTime(void) {
+    if (_schedule.mode == RTC_SCHED_TIMER) {
+        return _nextTime;
+    }
+    const uint32_t _period = _schedule.periodMs / 1000;
+    return (_softTime / _period + 1) * _period;
+}
+
+bool RTC_setSchedule(const uint8_t mode, const uint32_t period_ms) {
+    if (!_scheduleValid(mode, period_ms)) {
+        return true;
+    }
+    RTCScheduleConfig _s = {'Q', mode, period_ms, 0};
+    _s.crc = LOG_crc16((const uint8_t *)&_s, offsetof(RTCScheduleConfig, crc));
+    EEPROM.put(EEPROM_SCHED_ADDR, _s);
+    return false;
+}
+
+void RTC_printSchedule(void) {
+    // Oscillator error from the measured frequency, 0 if never measured
+    int32_t _ppm = ((int64_t)_tpsQ8 - (32768L << 8)) * 1000000 /
+                   (32768L << 8);
+    Serial.print(MSG_SCHEDULE_short);
+    Serial.print(',');
+    Serial.print(_schedule.mode);
+    Serial.print(',');
+    Serial.print(_schedule.periodMs);
+    Serial.print(',');
+    Serial.print(_resyncs);
+    Serial.print(',');
+    Serial.print(_corrections);
+    Serial.print(',');
+    Serial.print(_ppm);
+    Serial.print(',');
+    Serial.println(_offsetMs);
+}
+
 bool setDateAndTime(const uint16_t &year, const uint16_t &month,
                     const uint16_t &day, const uint16_t &hour,
                     const uint16_t &minute, const uint16_t &second) {
@@ -102,6 +487,7 @@ bool setDateAndTime(const uint16_t &year, const uint16_t &month,
     if (_alarmSetFlag) {  // If alarm was set before, reset it
         _alarmSetFlag = RTC_1secondAlarm();
     }
+    _resync = true;  // The software clock reads the new time at next edge
 
     if (!DS3231.lostPower()) {  // If the RTC didn't lose power, we can set the
                                 // date time valid
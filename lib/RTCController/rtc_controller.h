@@ -23,9 +23,64 @@
 #ifndef __RTC_CONTROLLER_H__
 #define __RTC_CONTROLLER_H__
 
+#include <EEPROM.h>
 #include <SPI.h>
 
 #include "RTClib.h"
+#include "eeprom_map.h"
+
+/**
+ * @brief What wakes the device for a sample
+ */
+enum RTCScheduleMode : uint8_t {
+    RTC_SCHED_ALARM = 0,  ///< Alarm 1 re-armed and time read every sample
+    RTC_SCHED_SQW = 1,    ///< 1 Hz square wave programmed once, time counted
+    RTC_SCHED_TIMER = 2   ///< Internal RTC counter disciplined by the DS3231
+};
+
+// Default scheduling mode
+#ifndef RTC_SCHED_MODE
+#define RTC_SCHED_MODE RTC_SCHED_SQW
+#endif
+
+// Default time between samples in milliseconds
+#ifndef RTC_SAMPLE_PERIOD_MS
+#define RTC_SAMPLE_PERIOD_MS 1000
+#endif
+
+// Sample period limits in milliseconds. The DS3231 modes take whole seconds,
+// the alarm up to a minute; the internal timer goes down to RTC_PERIOD_MIN_MS
+#define RTC_PERIOD_MIN_MS 10
+#define RTC_PERIOD_MAX_MS 43200000UL
+#define RTC_ALARM_PERIOD_MAX_MS 60000UL
+
+// Seconds between reads of the DS3231 time in RTC_SCHED_SQW and
+// RTC_SCHED_TIMER modes
+#ifndef RTC_RESYNC_S
+#define RTC_RESYNC_S 3600
+#endif
+
+// Seconds of DS3231 square wave the internal oscillator is measured over at
+// each resync in RTC_SCHED_TIMER mode
+#ifndef RTC_DISCIPLINE_S
+#define RTC_DISCIPLINE_S 32
+#endif
+
+// Clock the internal timer from a 32.768 kHz crystal on TOSC1/TOSC2 instead
+// of the internal ULP oscillator (not fitted on the Nano Every)
+#ifndef RTC_TIMER_XOSC32K
+#define RTC_TIMER_XOSC32K 0
+#endif
+
+/**
+ * @brief Sample scheduling settings persisted in EEPROM at EEPROM_SCHED_ADDR
+ */
+struct RTCScheduleConfig {
+    char tag;           ///< 'Q' when the block has been written
+    uint8_t mode;       ///< RTCScheduleMode
+    uint32_t periodMs;  ///< Milliseconds between samples
+    uint16_t crc;       ///< CRC-16 of the previous fields
+};
 
 /**
  * @brief Initializes communication with a DS3231 real-time clock (RTC) module,
@@ -57,12 +112,94 @@ DateTime RTC_getNow(void);
 /**
  * @brief Configures a 1-second alarm on the RTC module disabling the square
  * wave output, clearing any existing alarms, and setting a new alarm to trigger
- * 1 seconds from the current time
+ * at the next multiple of the sample period
  *
  * @return True if the alarm was successfully set
  */
 bool RTC_1secondAlarm(void);
 
+/**
+ * @brief Load the scheduling settings from EEPROM (the defaults if never set)
+ */
+void RTC_initSchedule(void);
+
+/**
+ * @brief Program the DS3231 to wake the device: the 1 Hz square wave, set
+ * once, in RTC_SCHED_SQW mode, or the first alarm in RTC_SCHED_ALARM mode.
+ * In RTC_SCHED_TIMER mode start the ATmega4809 RTC counter from its 32.768
+ * kHz clock; the square wave is only on while the counter is disciplined.
+ * Attach RTC_onInterrupt() to the falling edge of RTC_ALARM_PIN.
+ *
+ * @param[in] on_timer  Called from the counter interrupt when a sample is due
+ *                      in RTC_SCHED_TIMER mode, where no pin edge wakes it
+ *
+ * @return True if the DS3231 was programmed
+ */
+bool RTC_startSchedule(void (*on_timer)(void) = nullptr);
+
+/**
+ * @brief Count a falling edge of RTC_ALARM_PIN. Call it from the interrupt.
+ *
+ * @return True if the edge is a sample wake-up, false if it only times the
+ * internal oscillator (RTC_SCHED_TIMER mode)
+ */
+bool RTC_onInterrupt(void);
+
+/**
+ * @brief Take the edges and timer periods since the last call and give the
+ * time of the sample due, if any. In RTC_SCHED_SQW mode the time is a
+ * software counter advanced by one second per edge, read from the DS3231 at
+ * the first edge and then every RTC_RESYNC_S, so a sample costs no I2C
+ * transfer. In RTC_SCHED_ALARM mode the DS3231 time is read and the alarm
+ * re-armed. In RTC_SCHED_TIMER mode samples fall on multiples of the period
+ * counted by the internal timer; every RTC_RESYNC_S the DS3231 square wave
+ * realigns them and measures the oscillator over RTC_DISCIPLINE_S seconds,
+ * so the drift between reads is that of the DS3231 plus the oscillator's
+ * change since the last measurement.
+ *
+ * @param[out] time     POSIX time of the sample (or the last edge)
+ * @param[out] time_ms  Milliseconds of that time (0 but in RTC_SCHED_TIMER)
+ *
+ * @return True if a sample is due: the time reached another multiple of the
+ * sample period (or it is the first edge)
+ */
+bool RTC_tick(uint32_t *time, uint16_t *time_ms);
+
+/**
+ * @brief Time between samples
+ *
+ * @return Milliseconds
+ */
+uint32_t RTC_getPeriodMs(void);
+
+/**
+ * @brief POSIX second in which the next sample falls
+ */
+uint32_t RTC_getNextTime(void);
+
+/**
+ * @brief Set the scheduling mode and the sample period and persist them.
+ * They take effect at the next boot.
+ *
+ * @param[in] mode       RTCScheduleMode
+ * @param[in] period_ms  Milliseconds between samples: whole seconds up to
+ *                       RTC_ALARM_PERIOD_MAX_MS in RTC_SCHED_ALARM mode and
+ *                       up to RTC_PERIOD_MAX_MS in RTC_SCHED_SQW mode, from
+ *                       RTC_PERIOD_MIN_MS to RTC_PERIOD_MAX_MS with the timer
+ *
+ * @return True if a setting is out of range
+ */
+bool RTC_setSchedule(const uint8_t mode, const uint32_t period_ms);
+
+/**
+ * @brief Print the scheduling settings in use and the software clock
+ * counters as `M123,mode,period,resyncs,corrections,ppm,offset`: the period
+ * in milliseconds, the reads of the DS3231 time since boot, how many found
+ * the clock off, and with the internal timer its oscillator error in parts
+ * per million and the clock's offset at the last read in milliseconds
+ */
+void RTC_printSchedule(void);
+
 /**
  * @brief Set the date and time on the RTC module using the provided year,
  * month, day, hour, minute, and second values. It disables the first
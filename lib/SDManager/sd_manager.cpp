@@ -19,6 +19,10 @@
 
 #include "sd_manager.h"
 
+#include "RTClib.h"
+#include "fw_version.h"
+#include "msg_codes.h"
+
 // #define DEBUG
 
 /*******************************************************
@@ -29,8 +33,391 @@ const byte SDCard_SS = 10;  // define the Chip Select pin for SD card
 #define SD_CONFIG SdSpiConfig(SDCard_SS, DEDICATED_SPI, SPI_HALF_SPEED)
 SdFat sd;  // sd card object
 bool SDfailFlag = false;
-SdFile logfile;  // for sd card, this is the file object to be written to
+// Two file objects: the log file being written and the next one, created
+// ahead of a rollover so the switch needs no directory or FAT work
+SdFile _files[2];
+SdFile *logfile = &_files[0];  // this is the file object to be written to
+SdFile *_nextfile = &_files[1];
 char filename[] = "YYYYMMDD_HHMM_00_SN000.csv";
+char _nextName[] = "YYYYMMDD_HHMM_00_SN000.csv";
+
+// Binary log file header template and record format of the open file
+LogFileHeader _header;
+uint8_t _format = SD_LOG_FORMAT;
+uint8_t _fileFormat = SD_LOG_FORMAT;
+
+// Encoder state of the block at the end of the buffer, and id of the open
+// binary file (header CRC) stored in every block
+LogBlockState _block;
+uint16_t _fileId = 0;
+
+// The acquisition changed: continue in a new file at the next record. A
+// resumed file is checked against the settings it was recorded with: the
+// channels, probes and period of the file index and, for binary files, the
+// settings of its header.
+bool _rollPending = false;
+bool _checkADC = false;
+
+// Change-driven logging settings and the last record written in the open
+// file, the reference of the bands
+LogChangeFilter _filter = {SD_CHANGE_HALL_BAND, SD_CHANGE_TEMP_BAND,
+                           SD_CHANGE_HEARTBEAT};
+LogRecord _lastRecord;
+bool _lastRecordValid = false;
+
+// Interval statistics settings, the window in progress and the summary of the
+// last window closed (until it is printed)
+LogStatsConfig _statsConfig = {SD_STATS_WINDOW, SD_STATS_RAW_EVERY};
+LogStatsWindow _window;
+LogSummary _summary;
+bool _summaryReady = false;
+
+/*******************************************************
+ * Logging engine
+ *******************************************************/
+#define SD_BUFFER_SIZE (SD_LOG_BUFFER_SECTORS * SD_SECTOR_SIZE)
+
+/**
+ * @brief RAM image of the sectors at the end of the log file. Records are
+ * printed into it and it is written to the card as whole sectors when full.
+ * `_pos` is the file offset of the first sector, always a multiple of 512.
+ */
+class SectorBuffer : public Print {
+   public:
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    void commit(const uint16_t size);
+
+    uint8_t _data[SD_BUFFER_SIZE];
+    uint16_t _len = 0;
+    uint32_t _pos = 0;
+};
+
+SectorBuffer _sector;
+SDLogStats _stats;
+
+uint8_t _flushRecords = SD_FLUSH_RECORDS;
+uint16_t _flushSeconds = SD_FLUSH_SECONDS;
+uint8_t _recordsSinceFlush = 0;
+uint32_t _lastFlushTime = 0;
+
+// Pre-allocated contiguous log file. While `_rawSectors` is not zero the
+// buffer is written straight to the card sectors of the file, bypassing FAT,
+// and its directory entry is committed every flush period (`_dirSyncTime`)
+uint16_t _preallocDays = SD_PREALLOC_DAYS;
+bool _preallocated = false;
+uint32_t _rawFirstSector = 0;
+uint32_t _rawSectors = 0;
+uint32_t _dirSyncTime = 0;
+
+// File naming and rollover. `_fileSeq` is the running counter of the last
+// created file (persisted), its two last digits go in the file name
+uint16_t _fileSeq = 0;
+uint16_t _nextSeq = 0;
+bool _nextPreallocated = false;
+// Open and pre-created files, persisted for the recovery after a reset
+uint16_t _openSeq = 0;
+uint32_t _openStart = 0;
+uint8_t _openFlags = 0;
+uint8_t _openMask = 0;
+uint8_t _openProbes = 0;
+uint32_t _openPeriod = 0;
+uint32_t _nextStart = 0;
+uint8_t _nextFormat = 0;
+bool _nextTried = false;  // Pre-creation attempted for this file
+uint16_t _serialNumber = 0;
+bool _rollDaily = SD_ROLL_DAILY;
+uint16_t _rollMB = SD_ROLL_MB;
+uint32_t _fileDay = 0;   // Day number (POSIX time / 86400) of the file start
+uint32_t _lastTime = 0;  // Time of the last record (0: none yet)
+
+// Card health counters since power-on. A health record is written to the log
+// at the next block boundary (or CSV line) after `_healthDue`
+LogCardHealth _health;
+uint32_t _healthDue = 0;
+bool _healthPending = false;
+
+/**
+ * @brief Update the latency counters with a card operation started at `start`
+ *
+ * @param[in] start     micros() value when the operation started
+ * @param[in] ok        Whether the operation succeeded
+ */
+void _recordLatency(const uint32_t start, const bool ok) {
+    uint32_t _us = micros() - start;
+    _stats.lastWriteUs = _us;
+    _stats.totalWriteUs += _us;
+    if (_us > _stats.maxWriteUs) {
+        _stats.maxWriteUs = _us;
+    }
+    if (!ok) {
+        ++_stats.errors;
+    }
+}
+
+/**
+ * @brief Update the health counters with a card operation started at `start`
+ * (micros(), counted by a hardware timer). On a failure keep the card error
+ * code and data.
+ *
+ * @param[in] op        LogCardOp
+ * @param[in] start     micros() value when the operation started
+ * @param[in] retries   Attempts repeated after a failure
+ * @param[in] ok        Whether the operation finally succeeded
+ */
+void _cardOp(const uint8_t op, const uint32_t start, const uint8_t retries,
+             const bool ok) {
+    uint32_t _us = micros() - start;
+    LogCardOpStats &_op = _health.op[op];
+    ++_op.count;
+    _op.retries += retries;
+    if (_us > _op.maxUs) {
+        _op.maxUs = _us;
+    }
+    uint8_t _bin = 0;
+    for (uint32_t _v = _us >> LOG_LATENCY_BIN0_LOG2;
+         _v && _bin < LOG_LATENCY_BINS - 1; _v >>= 1) {
+        ++_bin;
+    }
+    if (_op.latency[_bin] != UINT16_MAX) {
+        ++_op.latency[_bin];
+    }
+    if (!ok) {
+        ++_op.errors;
+        _health.errorCode = sd.sdErrorCode();
+        _health.errorData = sd.sdErrorData();
+        _health.errorTime = _lastTime;
+    }
+}
+
+/**
+ * @brief Write the first `len` bytes of the buffer at its file offset.
+ * Rewriting the same sector on every partial flush keeps all card writes
+ * sector-aligned, so full sectors are written straight from RAM.
+ *
+ * In raw mode the sectors (the last one zero padded) go to the card with a
+ * single multi-block write and no FAT or directory traffic. If the buffer runs
+ * past the pre-allocated extent, the file falls back to growing through FAT.
+ * A failed write is repeated up to SD_WRITE_RETRIES times.
+ *
+ * @param[in] len   Number of valid bytes in the buffer
+ *
+ * @return True if the write succeeded
+ */
+bool _writeBuffer(const uint16_t len) {
+    if (!logfile->isOpen() || len == 0) {
+        return logfile->isOpen();
+    }
+
+    uint8_t _ns = (len + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE;
+    uint32_t _first = _sector._pos / SD_SECTOR_SIZE;
+    if (_fileFormat != LOG_FORMAT_CSV) {
+        // Stamp every block (not the header sector) with its position and CRC
+        for (uint8_t _i = _first ? 0 : 1; _i < _ns; ++_i) {
+            LOG_blockSeal(&_sector._data[_i * SD_SECTOR_SIZE], _fileId,
+                          _first + _i);
+        }
+    }
+    uint32_t _start = micros();
+    uint8_t _retries = 0;
+    bool _ok;
+    if (_rawSectors && _first + _ns <= _rawSectors) {
+        memset(&_sector._data[len], 0, _ns * SD_SECTOR_SIZE - len);
+        _stats.cardBytes += _ns * SD_SECTOR_SIZE;
+        while (!(_ok = sd.card()->writeSectors(_rawFirstSector + _first,
+                                               _sector._data, _ns)) &&
+               _retries < SD_WRITE_RETRIES) {
+            ++_retries;
+        }
+    } else {
+        _rawSectors = 0;  // Extent exhausted (or not contiguous)
+        _stats.cardBytes += len;
+        while (!(_ok = logfile->seekSet(_sector._pos) &&
+                       logfile->write(_sector._data, len) == len) &&
+               _retries < SD_WRITE_RETRIES) {
+            ++_retries;
+        }
+    }
+    _cardOp(LOG_CARD_WRITE, _start, _retries, _ok);
+    return _ok;
+}
+
+/**
+ * @brief Account for `size` bytes placed at the end of the buffer, and send
+ * the buffer to the card if it is full
+ *
+ * @param[in] size  Bytes added, no more than the free space in the buffer
+ */
+void SectorBuffer::commit(const uint16_t size) {
+    _len += size;
+    _stats.payloadBytes += size;
+
+    if (_len == SD_BUFFER_SIZE) {  // Buffer full, send it to the card
+        uint32_t _start = micros();
+        bool _ok = _writeBuffer(SD_BUFFER_SIZE);
+        _recordLatency(_start, _ok);
+        _stats.sectorWrites += SD_LOG_BUFFER_SECTORS;
+        _pos += SD_BUFFER_SIZE;
+        _len = 0;
+    }
+}
+
+size_t SectorBuffer::write(const uint8_t *buffer, size_t size) {
+    size_t _n = size;
+    while (size) {
+        uint16_t _chunk = SD_BUFFER_SIZE - _len;
+        if (_chunk > size) {
+            _chunk = size;
+        }
+        memcpy(&_data[_len], buffer, _chunk);
+        buffer += _chunk;
+        size -= _chunk;
+        commit(_chunk);
+    }
+    return _n;
+}
+
+/**
+ * @brief Size limit of a log file in bytes (0: no limit)
+ */
+uint32_t _rollBytes(void) {
+    return (uint32_t)_rollMB << 20;
+}
+
+/**
+ * @brief Size of the contiguous extent to pre-allocate for `_preallocDays` of
+ * records, limited to the FAT32 maximum file size
+ *
+ * @return Length in bytes, a multiple of the sector size (0 if disabled)
+ */
+uint32_t _preallocLength(void) {
+    // Binary records only hold the enabled hall channels
+    const uint16_t _record =
+        _format == LOG_FORMAT_CSV
+            ? SD_CSV_RECORD_BYTES + 8 * (_header.tempProbes - 1) +
+                  (_header.hallMask & LOG_MILLIS_bm ? 8 : 0)
+            : SD_BIN_RECORD_BYTES - LOG_PACKED_RECORD_SIZE +
+                  LOG_packedSize(_header.hallMask, _header.tempProbes);
+    // One record per sample period
+    uint32_t _samples = 86400UL;
+    if (_header.samplePeriodMs) {
+        _samples = 86400000UL / _header.samplePeriodMs;
+    }
+    uint32_t _perDay = _samples * _record;
+    if (_statsConfig.windowS) {  // A summary per window and the raw samples
+        const uint16_t _summary =
+            _format == LOG_FORMAT_CSV
+                ? SD_CSV_SUMMARY_BYTES
+                : SD_BIN_RECORD_BYTES + LOG_summarySize(_header.hallMask);
+        _perDay = 86400UL / _statsConfig.windowS * _summary;
+        if (_statsConfig.rawEvery) {
+            uint32_t _raw = 86400UL / _statsConfig.rawEvery;
+            _perDay += (_raw < _samples ? _raw : _samples) * (_record + 1);
+        }
+    }
+    uint32_t _days = _preallocDays;
+    if (_rollDaily && _days > 1) {  // A file never holds more than a day
+        _days = 1;
+    }
+    if (_days > 0xFFFFFFFFUL / _perDay) {
+        _days = 0xFFFFFFFFUL / _perDay;
+    }
+    uint32_t _length = _days * _perDay;
+    // Nor more than the size limit and the buffer that crosses it
+    if (_rollMB && _length > _rollBytes() + SD_BUFFER_SIZE) {
+        _length = _rollBytes() + SD_BUFFER_SIZE;
+    }
+    return _length & ~(uint32_t)(SD_SECTOR_SIZE - 1);
+}
+
+/**
+ * @brief Write the logging settings to EEPROM (only the changed bytes)
+ */
+void _saveConfig(void) {
+    SDLogConfig _cfg;
+    _cfg.tag = 'L';
+    _cfg.format = _format;
+    _cfg.flushRecords = _flushRecords;
+    _cfg.flushSeconds = _flushSeconds;
+    _cfg.preallocDays = _preallocDays;
+    _cfg.rollDaily = _rollDaily;
+    _cfg.rollMB = _rollMB;
+    _cfg.filter = _filter;
+    _cfg.stats = _statsConfig;
+    _cfg.crc = LOG_crc16((const uint8_t *)&_cfg, offsetof(SDLogConfig, crc));
+    EEPROM.put(EEPROM_LOGCFG_ADDR, _cfg);
+}
+
+/**
+ * @brief Load the logging settings from EEPROM, keeping the defaults if they
+ * were never written or are corrupted
+ */
+void _loadConfig(void) {
+    SDLogConfig _cfg;
+    EEPROM.get(EEPROM_LOGCFG_ADDR, _cfg);
+    if (_cfg.tag != 'L' ||
+        _cfg.crc != LOG_crc16((const uint8_t *)&_cfg,
+                              offsetof(SDLogConfig, crc)) ||
+        _cfg.format > LOG_FORMAT_DELTA ||
+        _cfg.stats.windowS > LOG_STATS_WINDOW_MAX) {
+#ifdef DEBUG
+        Serial.println("Using default log settings");
+#endif
+        return;
+    }
+    _format = _cfg.format;
+    _flushRecords = _cfg.flushRecords;
+    _flushSeconds = _cfg.flushSeconds;
+    _preallocDays = _cfg.preallocDays;
+    _rollDaily = _cfg.rollDaily;
+    _rollMB = _cfg.rollMB;
+    _filter = _cfg.filter;
+    _statsConfig = _cfg.stats;
+}
+
+/**
+ * @brief Load the file counter and the open files from EEPROM (none if never
+ * written)
+ */
+void _loadIndex(void) {
+    SDFileIndex _idx;
+    EEPROM.get(EEPROM_FILEIDX_ADDR, _idx);
+    if (_idx.tag == 'N' &&
+        _idx.crc == LOG_crc16((const uint8_t *)&_idx,
+                              offsetof(SDFileIndex, crc))) {
+        _fileSeq = _idx.seq;
+        _openSeq = _idx.openSeq;
+        _openStart = _idx.openStart;
+        _openFlags = _idx.openFlags;
+        _openMask = _idx.openMask;
+        _openProbes = _idx.openProbes;
+        _openPeriod = _idx.openPeriodMs;
+        _nextStart = _idx.nextStart;
+        _nextFormat = _idx.nextFormat;
+    }
+}
+
+/**
+ * @brief Write the file counter and the open files to EEPROM (a few times
+ * per log file, only the changed bytes)
+ */
+void _saveIndex(void) {
+    SDFileIndex _idx;
+    _idx.tag = 'N';
+    _idx.seq = _fileSeq;
+    _idx.openSeq = _openSeq;
+    _idx.openStart = _openStart;
+    _idx.openFlags = _openFlags;
+    _idx.openMask = _openMask;
+    _idx.openProbes = _openProbes;
+    _idx.openPeriodMs = _openPeriod;
+    _idx.nextStart = _nextStart;
+    _idx.nextFormat = _nextFormat;
+    _idx.crc = LOG_crc16((const uint8_t *)&_idx, offsetof(SDFileIndex, crc));
+    EEPROM.put(EEPROM_FILEIDX_ADDR, _idx);
+}
 
 /**
  * @brief Print the error code and data from the SD card
@@ -49,6 +436,9 @@ void errorPrint() {
 }
 
 bool SDCard_init(void) {
+    _loadConfig();
+    _loadIndex();
+
     if (!sd.begin(SD_CONFIG)) {
 #ifdef DEBUG
         Serial.print(
@@ -85,107 +475,210 @@ bool SDCard_init(void) {
     return true;
 }
 
-void SDCard_initFileName(const uint16_t year, const uint8_t month,
-                         const uint8_t day, const uint8_t hour,
-                         const uint8_t minute, const uint8_t second,
-                         const uint16_t serial_number) {
-    char buf[5];
-    // integer to ascii function itoa(), supplied with numeric year value,
-    // a buffer to hold output, and the base for the conversion (base 10 here)
-    itoa(year, buf, 10);
-    // copy the ascii year into the filename array
-    for (byte i = 0; i < 4; i++) {
-        filename[i] = buf[i];
-    }
-    // Insert the month value
-    if (month < 10) {
-        filename[4] = '0';
-        filename[5] = month + '0';
-    } else if (month >= 10) {
-        filename[4] = (month / 10) + '0';
-        filename[5] = (month % 10) + '0';
-    }
-    // Insert the day value
-    if (day < 10) {
-        filename[6] = '0';
-        filename[7] = day + '0';
-    } else if (day >= 10) {
-        filename[6] = (day / 10) + '0';
-        filename[7] = (day % 10) + '0';
-    }
-    // Insert an underscore between date and time
-    filename[8] = '_';
-    // Insert the hour
-    if (hour < 10) {
-        filename[9] = '0';
-        filename[10] = hour + '0';
-    } else if (hour >= 10) {
-        filename[9] = (hour / 10) + '0';
-        filename[10] = (hour % 10) + '0';
-    }
-    // Insert minutes
-    if (minute < 10) {
-        filename[11] = '0';
-        filename[12] = minute + '0';
-    } else if (minute >= 10) {
-        filename[11] = (minute / 10) + '0';
-        filename[12] = (minute % 10) + '0';
-    }
-    // Insert another underscore after time
-    filename[13] = '_';
-    // If there is a valid serialnumber SNxxx, insert it into
-    // the file name in positions 17-21.
-    filename[19] = '0' + (serial_number / 100) % 10;
-    filename[20] = '0' + (serial_number / 10) % 10;
-    filename[21] = '0' + serial_number % 10;
-    // Next change the counter on the end of the filename
-    // (digits 14+15) to increment count for files generated on
-    // the same day. This shouldn't come into play
-    // during a normal data run, but can be useful when
-    // troubleshooting.
-    for (uint8_t i = 0; i < 100; i++) {
-        filename[14] = i / 10 + '0';
-        filename[15] = i % 10 + '0';
-
-        if (!sd.exists(filename)) {
-            // when sd.exists() returns false, this block
-            // of code will be executed to open the file
-
-            if (!logfile.open(filename, O_APPEND | O_CREAT | O_WRONLY)) {
-                // If there is an error opening the file, notify the
-                // user. Otherwise, the file is open and ready for writing
+/**
+ * @brief Write a two-digit number
+ */
+static void _put2(char *dst, const uint8_t value) {
+    dst[0] = value / 10 + '0';
+    dst[1] = value % 10 + '0';
+}
+
+/**
+ * @brief Build a log file name `YYYYMMDD_HHMM_NN_SNxxx.ext` for the given
+ * start time, file counter and record format
+ *
+ * @param[out] name     Name buffer, same layout as `filename`
+ * @param[in]  start    Time of the first record
+ * @param[in]  seq      File counter, the last two digits are used
+ * @param[in]  format   LogRecordFormat, sets the extension
+ */
+void _makeName(char *name, const DateTime &start, const uint16_t seq,
+               const uint8_t format) {
+    _put2(&name[0], start.year() / 100);
+    _put2(&name[2], start.year() % 100);
+    _put2(&name[4], start.month());
+    _put2(&name[6], start.day());
+    _put2(&name[9], start.hour());
+    _put2(&name[11], start.minute());
+    _put2(&name[14], seq % 100);
+    // Serial number SNxxx in positions 17-21
+    name[19] = '0' + (_serialNumber / 100) % 10;
+    name[20] = '0' + (_serialNumber / 10) % 10;
+    name[21] = '0' + _serialNumber % 10;
+    // The extension tells the record format
+    memcpy(&name[23], format == LOG_FORMAT_CSV ? "csv" : "bhd", 3);
+}
+
+/**
+ * @brief Create a new log file named after `start` and the next value of the
+ * file counter, and pre-allocate it. The counter comes from EEPROM, so this is
+ * normally a single create; if a file with that name is already on the card
+ * (e.g. the counter was reset) the following values are tried.
+ *
+ * @param[in]  file         File object to open
+ * @param[out] name         Name of the created file
+ * @param[in]  start        Time of the first record
+ * @param[out] seq          File counter used in the name
+ * @param[out] preallocated Whether the contiguous extent was reserved
+ *
+ * @return True if the file was created
+ */
+bool _createFile(SdFile *file, char *name, const DateTime &start,
+                 uint16_t *seq, bool *preallocated) {
+    *preallocated = false;
+    uint32_t _start = micros();
+    for (uint8_t _i = 0; _i < 100; ++_i) {
+        _makeName(name, start, ++_fileSeq, _format);
+        if (file->open(name, O_RDWR | O_CREAT | O_EXCL)) {
+            break;
+        }
+    }
+    _cardOp(LOG_CARD_OPEN, _start, 0, file->isOpen());
+    _saveIndex();
+    *seq = _fileSeq;
+    if (!file->isOpen()) {
 #ifdef DEBUG
-                Serial.println("<<< CANT CREATE OR OPEN LOG FILE >>>");
-                Serial.flush();
+        Serial.println("<<< CANT CREATE OR OPEN LOG FILE >>>");
+        Serial.flush();
 #endif
-            } else {
+        return false;
+    }
 #ifdef DEBUG
-                Serial.println("File created");
+    Serial.print("Name: ");
+    Serial.println(name);
 #endif
-            }
+
+    // Reserve a contiguous extent for the whole file and log to its sectors
+    // directly. If the card is too fragmented, grow through FAT.
+    uint32_t _length = _preallocLength();
+    *preallocated = _length && file->preAllocate(_length);
+    return true;
+}
+
+/**
+ * @brief Print the breakpoints of the calibrated channels as
+ * `#C,channel,raw1,gape1,...` lines
+ */
+void _printCalibration(Print &out) {
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (!(_header.cal.channels & (1 << _c))) {
+            continue;
+        }
+        out.print(F("#C,"));
+        out.print(_c + 1);
+        for (uint8_t _p = 0; _p < LOG_CAL_POINTS; ++_p) {
+            out.print(',');
+            out.print(_header.cal.points[_c][_p].raw);
+            out.print(',');
+            out.print(_header.cal.points[_c][_p].gapeUm);
+        }
+        out.println();
+    }
+}
+
+/**
+ * @brief Start the logging engine at the beginning of the open log file:
+ * write the header line or sector, set the timestamps and sync the file.
+ * The file is recorded in EEPROM as the one to resume after a reset.
+ *
+ * @param[in] start     Time of the first record
+ * @param[in] seq       File counter of the file name
+ */
+void _startFile(const DateTime &start, const uint16_t seq) {
+    memset(&_stats, 0, sizeof(_stats));
+    _sector._len = 0;
+    _sector._pos = 0;
+    _recordsSinceFlush = 0;
+    _lastFlushTime = 0;
+    _dirSyncTime = 0;
+    _fileFormat = _format;
+    _fileDay = start.unixtime() / 86400UL;
+    _lastTime = 0;
+    _lastRecordValid = false;
+    _nextTried = false;
+    if (_header.version == 0) {  // SDCard_setLogInfo() was not called
+        LOG_initHeader(&_header, _fileFormat);
+    }
+
+    _openSeq = seq;
+    _openStart = start.unixtime();
+    _openFlags = _fileFormat | (_preallocated ? SD_INDEX_PREALLOC_bm : 0);
+    _openMask = _header.hallMask;
+    _openProbes = _header.tempProbes;
+    _openPeriod = _header.samplePeriodMs;
+    _nextStart = _nextfile->isOpen() ? _nextStart : 0;
+    _saveIndex();
+
+    _rawSectors = 0;
+    if (_preallocated) {
+        uint32_t _last;
+        if (logfile->contiguousRange(&_rawFirstSector, &_last)) {
+            _rawSectors = _last - _rawFirstSector + 1;
+        }
 #ifdef DEBUG
-            Serial.print("Name: ");
-            Serial.println(filename);
+        Serial.print("Pre-allocated sectors: ");
+        Serial.println(_rawSectors);
 #endif
-            break;  // Break out of the for loop when the statement
-                    // if(!logfile.exists()) is finally false (i.e. you found a
-                    // new file name to use).
-        }  // end of if(!sd.exists())
-    }  // end of file-naming for loop
-
-    //------------------------------------------------------------
-    // Write 1st header line
-    // Header will be: POSIX Time, Date & Time, Hall[0-5] value, Temperature
-    logfile.print(
-        F("POSIXt,DateTime,hall1,hall2,hall3,hall4,hall5,hall6,Temp.C"));
-    logfile.println();
+    }
+
+    if (_fileFormat == LOG_FORMAT_CSV) {
+        //------------------------------------------------------------
+        // Write 1st header line
+        // Header will be: POSIX Time, Date & Time, enabled Hall[0-5] values,
+        // Temperature of each probe and supply followed by their gapes and
+        // the calibration with calibrated channels
+        _sector.print(F("POSIXt,DateTime"));
+        for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+            if (_header.hallMask & (1 << _c)) {
+                _sector.print(F(",hall"));
+                _sector.print(_c + 1);
+            }
+        }
+        if (_header.tempProbes == 1) {
+            _sector.print(F(",Temp.C"));
+        } else {  // One column per probe
+            for (uint8_t _i = 0; _i < _header.tempProbes; ++_i) {
+                _sector.print(F(",Temp"));
+                _sector.print(_i + 1);
+                _sector.print(F(".C"));
+            }
+        }
+        if (_header.hallMask & LOG_SUPPLY_bm) {
+            _sector.print(F(",Supply.V"));
+        }
+        if (_header.cal.channels & _header.hallMask) {
+            for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+                if (_header.hallMask & (1 << _c)) {
+                    _sector.print(F(",gape"));
+                    _sector.print(_c + 1);
+                }
+            }
+        }
+        _sector.println();
+        _printCalibration(_sector);
+    } else {
+        // Binary header sector, written in place in the empty buffer
+        _header.recordFormat = _fileFormat;
+        _header.recordSize = _fileFormat == LOG_FORMAT_PACKED
+                                 ? LOG_packedSize(_header.hallMask,
+                                                  _header.tempProbes)
+                                 : 0;
+        _header.serialNumber = _serialNumber;
+        _header.startTime = start.unixtime();
+        _fileId = LOG_writeHeader(&_header, _sector._data);
+        _sector.commit(LOG_HEADER_SIZE);
+    }
+    _stats.payloadBytes = 0;  // Count only record bytes per sample
     // Update the file's creation date, modify date, and access date.
-    logfile.timestamp(T_CREATE, year, month, day, hour, minute, second);
-    logfile.timestamp(T_WRITE, year, month, day, hour, minute, second);
-    logfile.timestamp(T_ACCESS, year, month, day, hour, minute, second);
+    logfile->timestamp(T_CREATE, start.year(), start.month(), start.day(),
+                       start.hour(), start.minute(), start.second());
+    logfile->timestamp(T_WRITE, start.year(), start.month(), start.day(),
+                       start.hour(), start.minute(), start.second());
+    logfile->timestamp(T_ACCESS, start.year(), start.month(), start.day(),
+                       start.hour(), start.minute(), start.second());
 
-    // force the data to be written to the file by closing it
-    if (logfile.close()) {
+    // force the header and directory entry to be written to the card
+    if (!SDCard_flush()) {
 #ifdef DEBUG
         Serial.print("File writed: ");
         Serial.println(filename);
@@ -197,45 +690,883 @@ void SDCard_initFileName(const uint16_t year, const uint8_t month,
     }
 }
 
-bool SDCard_writeFile(const uint32_t unix_time, const char *timestamp,
-                      const uint16_t hall[6], const float tempC) {
-    // Reopen logfile. If opening fails, notify the user
-    if (!logfile.isOpen()) {
-        if (!logfile.open(filename, O_RDWR | O_CREAT | O_AT_END)) {
-            return true;
+/**
+ * @brief Flush, truncate and close the current log file, keeping the
+ * pre-created next one
+ *
+ * @return True if the operation fails or false if successful
+ */
+bool _closeFile(void) {
+    if (!logfile->isOpen()) {
+        return false;
+    }
+
+    bool _fail = SDCard_flush();
+    if (_preallocated) {
+        // Give back the unused part of the extent
+        _fail |= !logfile->truncate(_sector._pos + _sector._len);
+        _preallocated = false;
+        _rawSectors = 0;
+    }
+    return !logfile->close() || _fail;
+}
+
+/**
+ * @brief Close the current log file and continue in a new one starting at
+ * `start`. A pre-created file is swapped in (and renamed if its provisional
+ * name does not match the start time); otherwise a file is created now. A
+ * pre-created file of another format than the current one (SETFORMAT since
+ * it was created) is removed instead.
+ *
+ * @param[in] start     Time of the first record of the new file
+ */
+void _rollover(const DateTime &start) {
+    _closeFile();
+
+    if (_nextfile->isOpen() && _nextFormat != _format) {
+        _nextfile->remove();
+        _nextStart = 0;
+    }
+    if (_nextfile->isOpen()) {
+        SdFile *_f = logfile;
+        logfile = _nextfile;
+        _nextfile = _f;
+        _preallocated = _nextPreallocated;
+        _makeName(filename, start, _nextSeq, _format);
+        if (strcmp(filename, _nextName) != 0 && !logfile->rename(filename)) {
+            strcpy(filename, _nextName);  // Keep the provisional name
         }
+        _startFile(start, _nextSeq);
+    } else {
+        uint16_t _seq;
+        _createFile(logfile, filename, start, &_seq, &_preallocated);
+        _startFile(start, _seq);
     }
+}
+
+void SDCard_initFileName(const uint16_t year, const uint8_t month,
+                         const uint8_t day, const uint8_t hour,
+                         const uint8_t minute, const uint8_t second,
+                         const uint16_t serial_number) {
+    // Finish the previous log file (and drop a pre-created one, its name
+    // may not match the new date) before starting a new one
+    SDCard_close();
 
+    _serialNumber = serial_number;
+    DateTime _start(year, month, day, hour, minute, second);
+    uint16_t _seq;
+    _createFile(logfile, filename, _start, &_seq, &_preallocated);
+    _startFile(_start, _seq);
+}
+
+/**
+ * @brief Print the card health counters as `M112` lines
+ *
+ * @param[out] out      Serial port or sector buffer
+ * @param[in]  tag      Line prefix
+ */
+void _printHealth(Print &out, const char *tag) {
+    static const char _ops[LOG_CARD_OPS] = {'O', 'W', 'S'};
+    for (uint8_t _i = 0; _i < LOG_CARD_OPS; ++_i) {
+        const LogCardOpStats &_op = _health.op[_i];
+        out.print(tag);
+        out.print(',');
+        out.print(_ops[_i]);
+        out.print(',');
+        out.print(_op.count);
+        out.print(',');
+        out.print(_op.retries);
+        out.print(',');
+        out.print(_op.errors);
+        out.print(',');
+        out.print(_op.maxUs);
+        for (uint8_t _b = 0; _b < LOG_LATENCY_BINS; ++_b) {
+            out.print(',');
+            out.print(_op.latency[_b]);
+        }
+        out.println();
+    }
+    out.print(tag);
+    out.print(F(",E,"));
+    out.print(_health.errorCode);
+    out.print(',');
+    out.print(_health.errorData);
+    out.print(',');
+    out.print(_health.errorTime);
+    out.println();
+}
+
+/**
+ * @brief Write a due card health record to the log: a health block in binary
+ * files (the buffer must be at a block boundary) or `#M112` comment lines in
+ * CSV files
+ */
+void _writeHealth(void) {
+    if (!_healthPending) {
+        return;
+    }
+    _healthPending = false;
+    _health.time = _lastTime;
+    if (_fileFormat == LOG_FORMAT_CSV) {
+        _printHealth(_sector, "#" MSG_CARD_HEALTH_short);
+    } else {
+        LOG_healthBlock(&_sector._data[_sector._len], &_health);
+        _sector.commit(SD_SECTOR_SIZE);
+    }
+}
+
+/**
+ * @brief Render a CSV record into the sector buffer
+ *
+ * @param[in] record        Record to write
+ * @param[in] text          Text of the record time
+ * @param[in] gape          Gapes of the record
+ */
+void _writeCSV(const LogRecord &record, const LogTimeText &text,
+               const LogGape &gape) {
+    _writeHealth();
+    char _line[LOG_TEXT_MAX_SIZE];
+    uint8_t _n = LOG_formatRecord(_line, &record, &text, true,
+                                  _header.hallMask, &gape,
+                                  _header.tempProbes);
+    _sector.write((const uint8_t *)_line, _n);
 #ifdef DEBUG
     Serial.print("Writing to file: ");
+    Serial.print(_line);
 #endif
-    // Write the unixtime
-    logfile.print(unix_time, DEC);
-    logfile.print(F(","));  // POSIX time value
-#ifdef DEBUG
-    Serial.print(unix_time, DEC);
-    Serial.print(",");
-#endif
-    logfile.print(timestamp);
-    logfile.print(F(","));  // human-readable time stamp
-#ifdef DEBUG
-    Serial.print(timestamp);
-    Serial.print(",");
-#endif
-    for (uint8_t _i = 0; _i < 6; ++_i) {
-        logfile.print(hall[_i], DEC);
-        logfile.print(F(","));  // Hall sensor value
+}
+
+/**
+ * @brief Append a record or a summary to the block at the end of the sector
+ * buffer. Every sector of the buffer holds one block; when an entry does not
+ * fit, the block tail is zeroed and the entry starts the next block. A due
+ * health block goes in before a new block is started. Files with interval
+ * statistics use stats blocks for both.
+ *
+ * @param[in] record    Record to append (nullptr for a summary)
+ * @param[in] summary   Summary to append
+ */
+void _writeBlock(const LogRecord *record, const LogSummary *summary = nullptr) {
+    const uint8_t _type = _header.stats.windowS         ? LOG_BLOCK_STATS
+                          : _fileFormat == LOG_FORMAT_PACKED ? LOG_BLOCK_PACKED
+                                                             : LOG_BLOCK_DELTA;
+    uint16_t _off = _sector._len % SD_SECTOR_SIZE, _n = 0;
+    if (_off == 0) {  // Sector boundary, start a new block
+        _writeHealth();
+        _n = LOG_blockStart(&_block, &_sector._data[_sector._len], _type,
+                            _header.hallMask, _header.tempProbes);
+    } else {  // The block may have moved to the buffer front on a flush
+        _block.block = &_sector._data[_sector._len - _off];
+    }
+
+    uint16_t _r = record ? LOG_blockAppend(&_block, record)
+                         : LOG_blockAppendSummary(&_block, summary);
+    if (_r == 0) {  // Block full
+        memset(&_sector._data[_sector._len], 0, SD_SECTOR_SIZE - _off);
+        _sector.commit(SD_SECTOR_SIZE - _off);
+        _writeHealth();
+        _n = LOG_blockStart(&_block, &_sector._data[_sector._len], _type,
+                            _header.hallMask, _header.tempProbes);
+        _r = record ? LOG_blockAppend(&_block, record)
+                    : LOG_blockAppendSummary(&_block, summary);
+    }
+    _sector.commit(_n + _r);
+}
+
+/**
+ * @brief Print a value in 1/16 units with two decimals
+ */
+void _printQ4(Print &out, const uint32_t value) {
+    out.print(value >> LOG_STATS_FRAC);
+    out.print('.');
+    uint8_t _h = ((value & 15) * 100 + 8) >> LOG_STATS_FRAC;
+    if (_h < 10) {
+        out.print('0');
+    }
+    out.print(_h);
+}
+
+/**
+ * @brief Print a window summary as a `M119` line
+ *
+ * @param[out] out      Serial port or sector buffer
+ * @param[in]  tag      Line prefix
+ * @param[in]  summary  Summary to print
+ */
+void _printSummary(Print &out, const char *tag, const LogSummary &summary) {
+    out.print(tag);
+    out.print(',');
+    out.print(summary.time);
+    out.print(',');
+    out.print(summary.count);
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (!(_header.hallMask & (1 << _i))) {
+            continue;
+        }
+        out.print(',');
+        out.print(summary.min[_i]);
+        out.print(',');
+        out.print(summary.max[_i]);
+        out.print(',');
+        _printQ4(out, summary.mean[_i]);
+        out.print(',');
+        _printQ4(out, summary.var[_i]);
+    }
+    const int16_t _temps[3] = {summary.tempMin, summary.tempMax,
+                               summary.tempMean};
+    for (uint8_t _i = 0; _i < 3; ++_i) {
+        char _text[8];
+        out.print(',');
+        out.write((const uint8_t *)_text, LOG_putCenti(_text, _temps[_i]) -
+                                              _text);
+    }
+    out.println();
+}
+
+/**
+ * @brief Add a sample to the statistics window. A sample past the end of the
+ * window closes it into `_summary`.
+ *
+ * @param[in] record    Sample
+ *
+ * @return True if a window was closed
+ */
+bool _addToWindow(const LogRecord &record) {
+    _summaryReady = false;
+    if (!_statsConfig.windowS) {
+        return false;
+    }
+    const uint32_t _start = record.time - record.time % _statsConfig.windowS;
+    if (_start != _window.time) {
+        if (_window.hall[0].n) {
+            LOG_windowSummary(&_window, &_summary);
+            _summaryReady = true;
+        }
+        LOG_windowReset(&_window, _start);
+    }
+    LOG_windowAdd(&_window, &record);
+    return _summaryReady;
+}
+
+/**
+ * @brief Append the closed window summary to the log: in the stats block of
+ * binary files or as a `#M119` comment line in CSV files
+ */
+void _writeSummary(void) {
+    if (_fileFormat == LOG_FORMAT_CSV) {
+        _writeHealth();
+        _printSummary(_sector, "#" MSG_STATS_SUMMARY_short, _summary);
+    } else {
+        _writeBlock(nullptr, &_summary);
+    }
+    ++_stats.summaries;
+}
+
+/**
+ * @brief Print a burst event as a `#E` line with its header and one `#S` line
+ * per hall sample
+ */
+void _printEvent(Print &out, const LogEventHeader &event,
+                 const LogHallSample *hall) {
+    out.print(F("#E,"));
+    out.print(event.time);
+    out.print(',');
+    out.print(event.timeMs);
+    out.print(',');
+    out.print(event.periodUs);
+    out.print(',');
+    out.print(event.count);
+    out.print(',');
+    out.print(event.pre);
+    out.print(',');
+    out.print(event.channels);
+    out.print(',');
+    out.print(event.threshold);
+    out.println();
+    for (uint8_t _i = 0; _i < event.count; ++_i) {
+        out.print(F("#S"));
+        for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+            out.print(',');
+            out.print(hall[_i][_c]);
+        }
+        out.println();
+    }
+}
+
+bool SDCard_writeEvent(const LogEventHeader &event,
+                       const LogHallSample *hall) {
+    if (!logfile->isOpen()) {
+        return true;
+    }
+    uint16_t _errors = _stats.errors;
+
+    if (_fileFormat == LOG_FORMAT_CSV) {
+        _printEvent(_sector, event, hall);
+    } else {
+        // Close the record block early, the event takes a block of its own
+        uint16_t _off = _sector._len % SD_SECTOR_SIZE;
+        if (_off) {
+            memset(&_sector._data[_sector._len], 0, SD_SECTOR_SIZE - _off);
+            _sector.commit(SD_SECTOR_SIZE - _off);
+        }
+        LOG_eventBlock(&_sector._data[_sector._len], &event, hall);
+        _sector.commit(SD_SECTOR_SIZE);
+    }
+    return _stats.errors != _errors;
+}
+
+/**
+ * @brief Check a record against the change-driven logging bands around the
+ * last record written
+ *
+ * @param[in] record    Record to check
+ *
+ * @return True if no value left its band and the heartbeat is not due
+ */
+bool _withinBands(const LogRecord &record) {
+    if (!_filter.heartbeatS || !_lastRecordValid ||
+        record.time - _lastRecord.time >= _filter.heartbeatS) {
+        return false;
+    }
+    const int16_t _band = _filter.hallBand;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        int16_t _d = record.hall[_i] - _lastRecord.hall[_i];
+        if (_d > _band || -_d > _band) {
+            return false;
+        }
+    }
+    for (uint8_t _i = 0; _i < _header.tempProbes; ++_i) {
+        if (record.tempCenti[_i] == LOG_TEMP_INVALID) {
+            continue;  // Not read in this sample
+        }
+        if (_lastRecord.tempCenti[_i] == LOG_TEMP_INVALID) {
+            return false;  // First reading since the last record
+        }
+        int32_t _t = (int32_t)record.tempCenti[_i] - _lastRecord.tempCenti[_i];
+        if (_t > _filter.tempBand || -_t > _filter.tempBand) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SDCard_writeFile(const LogRecord &record, const LogTimeText &text,
+                      const LogGape &gape) {
+    const uint32_t unix_time = record.time;
+
+    // Interval statistics: the sample may close the window of the previous
+    // ones (the summary is kept for Serial even without a log file)
+    const bool _summary = _addToWindow(record);
+
+    // The log file stays open between samples. If it was never opened or
+    // was closed, notify the user
+    if (!logfile->isOpen()) {
+        return true;
+    }
+
+    // Interval statistics only keep the decimated samples, and change-driven
+    // logging does not write a quiet sample
+    const bool _raw = SDCard_rawDue(unix_time, record.timeMs) &&
+                      (_rollPending || !_withinBands(record));
+    if (!_raw) {
+        ++_stats.skipped;
+        if (!_summary) {
+            return false;
+        }
+    }
+
+    // The summary goes in the file of its window, unless the settings changed
+    uint16_t _errors = _stats.errors;
+    const bool _early = _summary && !_rollPending;
+    if (_early) {
+        _writeSummary();
+    }
+
+    // Continue in a new file at the day boundary, the size limit or a change
+    // of the acquisition settings
+    if (_lastTime &&
+        ((_rollDaily && unix_time / 86400UL != _fileDay) ||
+         (_rollMB && _sector._pos + _sector._len >= _rollBytes()) ||
+         _rollPending)) {
+        _rollover(DateTime(unix_time));
+    }
+    _rollPending = false;
+    _lastTime = unix_time;
+
+    // Card health record in the log every SD_HEALTH_PERIOD seconds
+    if (SD_HEALTH_PERIOD && unix_time >= _healthDue) {
+        _healthPending = _healthDue != 0;
+        _healthDue = unix_time + SD_HEALTH_PERIOD;
+    }
+
+    if (_summary && !_early) {
+        _writeSummary();
+    }
+    if (_raw) {
+        if (_fileFormat != LOG_FORMAT_CSV) {
+            _writeBlock(&record);
+        } else {
+            _writeCSV(record, text, gape);
+        }
+        ++_stats.records;
+        _lastRecord = record;
+        _lastRecordValid = true;
+    }
+
+    // Apply the flush policy
+    if (_lastFlushTime == 0) {
+        _lastFlushTime = unix_time;
+    }
+    ++_recordsSinceFlush;
+    if ((_flushRecords && _recordsSinceFlush >= _flushRecords) ||
+        (_flushSeconds && unix_time - _lastFlushTime >= _flushSeconds)) {
+        _lastFlushTime = unix_time;
+        SDCard_flush();
+    }
+
+    return _stats.errors != _errors;
+}
+
+void SDCard_setFlushPolicy(const uint8_t records, const uint16_t seconds) {
+    _flushRecords = records;
+    _flushSeconds = seconds;
+    _saveConfig();
+}
+
+bool SDCard_flush(void) {
+    if (!logfile->isOpen()) {
+        return true;
+    }
+
+    uint32_t _start = micros();
+    bool _ok = _writeBuffer(_sector._len);
+    // Raw sectors only need the card to finish programming, FAT writes also
+    // need the cache and directory entry committed
+    uint32_t _syncStart = micros();
+    uint8_t _retries = 0;
+    bool _synced;
+    while (!(_synced = _rawSectors ? sd.card()->syncDevice()
+                                   : logfile->sync()) &&
+           _retries < SD_WRITE_RETRIES) {
+        ++_retries;
+    }
+    _cardOp(LOG_CARD_SYNC, _syncStart, _retries, _synced);
+    // Raw sector writes do not touch the file: commit its directory entry
+    // (size and modify time) too, at least every flush period
+    if (_rawSectors && _synced && _lastTime &&
+        (!_flushSeconds || _lastTime - _dirSyncTime >= _flushSeconds)) {
+        DateTime _t(_lastTime);
+        _dirSyncTime = _lastTime;
+        _syncStart = micros();
+        _synced = logfile->timestamp(T_WRITE, _t.year(), _t.month(), _t.day(),
+                                     _t.hour(), _t.minute(), _t.second()) &&
+                  logfile->sync();
+        _cardOp(LOG_CARD_SYNC, _syncStart, 0, _synced);
+    }
+    _ok &= _synced;
+    _recordLatency(_start, _ok);
+    ++_stats.flushes;
+    _recordsSinceFlush = 0;
+
+    // Keep only the partial sector in the buffer
+    uint16_t _full = _sector._len & ~(uint16_t)(SD_SECTOR_SIZE - 1);
+    if (_full) {
+        _sector._len -= _full;
+        _sector._pos += _full;
+        memmove(_sector._data, &_sector._data[_full], _sector._len);
+    }
+
+    return !_ok;
+}
+
+/**
+ * @brief Read a sector of the log file into the sector buffer, zero padded
+ * past the end of the file
+ *
+ * @param[in] sector    Sector index in the file
+ *
+ * @return True if the read succeeded
+ */
+bool _readSector(const uint32_t sector) {
+    memset(_sector._data, 0, SD_SECTOR_SIZE);
+    return logfile->seekSet(sector * SD_SECTOR_SIZE) &&
+           logfile->read(_sector._data, SD_SECTOR_SIZE) >= 0;
+}
+
+/**
+ * @brief Whether a sector of the log file holds a valid block of this file
+ */
+bool _blockValid(const uint32_t sector) {
+    return _readSector(sector) &&
+           LOG_blockCheck(_sector._data, _fileId, sector);
+}
+
+/**
+ * @brief Find the last valid block of a binary log file and load it into the
+ * sector buffer to continue appending to it.
+ *
+ * Blocks are written in order, so the valid ones are a prefix of the file and
+ * the end is found with a binary search. A probe also accepts the following
+ * block, so a single damaged block inside the file does not cut it short.
+ *
+ * @return True if the file can be resumed
+ */
+bool _resumeBlocks(void) {
+    LogFileHeader _hdr;
+    if (!_readSector(0) || !LOG_readHeader(_sector._data, &_hdr) ||
+        _hdr.recordFormat != _fileFormat) {
+        return false;
+    }
+    _fileId = LOG_fileId(_sector._data);
+    _checkADC = true;
+
+    uint32_t _n = (logfile->fileSize() + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE;
+    uint32_t _lo = 0, _hi = _n;  // Sector 0 is the header
+    while (_hi - _lo > 1) {
+        uint32_t _mid = _lo + (_hi - _lo) / 2;
+        if (_blockValid(_mid) || (_mid + 1 < _n && _blockValid(_mid + 1))) {
+            _lo = _mid;
+        } else {
+            _hi = _mid;
+        }
+    }
+    if (_lo + 1 < _n && _blockValid(_lo + 1)) {
+        ++_lo;
+    }
+
+    _lastTime = _hdr.startTime;
+    LogCardHealth _h;
+    LogEventHeader _e;
+    bool _health = false;
+    if (_lo == 0 || !_blockValid(_lo)) {
+        // No blocks yet, or a damaged last block that is rewritten
+        _sector._pos = SD_SECTOR_SIZE * (_lo ? _lo : 1);
+        _sector._len = 0;
+        return true;
+    }
+    if ((_health = LOG_readHealth(_sector._data, &_h)) ||
+        LOG_readEvent(_sector._data, &_e, nullptr)) {
+        // Health and event blocks are always whole, continue after them
+        _lastTime = _health ? _h.time : _e.time;
+        _sector._pos = (_lo + 1) * SD_SECTOR_SIZE;
+        _sector._len = 0;
+        return true;
+    }
+    if (!LOG_blockResume(&_block, _sector._data, _hdr.hallMask,
+                         _hdr.tempProbes)) {
+        // A valid block whose records can not be continued is kept whole
+        _sector._pos = (_lo + 1) * SD_SECTOR_SIZE;
+        _sector._len = 0;
+        return true;
+    }
+    if (_block.prev.time) {  // Stats blocks may only hold summaries
+        _lastTime = _block.prev.time;
+    }
+    _sector._pos = _lo * SD_SECTOR_SIZE;
+    _sector._len = _block.used;
+    if (_sector._len == SD_SECTOR_SIZE) {  // Exactly full, next block
+        _sector._pos += SD_SECTOR_SIZE;
+        _sector._len = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Continue a CSV log file after its last complete line. A
+ * pre-allocated file cannot be resumed: its length is the whole extent.
+ *
+ * @return True if the file can be resumed
+ */
+bool _resumeCSV(void) {
+    if (_preallocated) {
+        return false;
+    }
+    uint32_t _size = logfile->fileSize();
+    _sector._pos = _size & ~(uint32_t)(SD_SECTOR_SIZE - 1);
+    _sector._len = _size - _sector._pos;
+    if (_sector._len == 0 && _sector._pos) {  // Look into the last sector
+        _sector._pos -= SD_SECTOR_SIZE;
+        _sector._len = SD_SECTOR_SIZE;
+    }
+    if (!_readSector(_sector._pos / SD_SECTOR_SIZE)) {
+        return false;
+    }
+    // Drop a line cut by the reset
+    while (_sector._len && _sector._data[_sector._len - 1] != '\n') {
+        --_sector._len;
+    }
+    if (_sector._len == SD_SECTOR_SIZE) {
+        _sector._pos += SD_SECTOR_SIZE;
+        _sector._len = 0;
+    }
+    _lastTime = _openStart;
+    _checkADC = true;
+    return logfile->truncate(_sector._pos + _sector._len);
+}
+
+bool SDCard_recover(const uint16_t serial_number) {
+    _serialNumber = serial_number;
+
+    if (_nextStart) {  // Created ahead of a rollover that never came
+        _makeName(_nextName, DateTime(_nextStart), _fileSeq, _nextFormat);
+        sd.remove(_nextName);
+        _nextStart = 0;
+    }
+    if (!_openStart) {  // Last file was closed cleanly
+        _saveIndex();
+        return true;
+    }
+
+    _fileFormat = _openFlags & SD_INDEX_FORMAT_gm;
+    _preallocated = _openFlags & SD_INDEX_PREALLOC_bm;
+    _makeName(filename, DateTime(_openStart), _openSeq, _fileFormat);
+    memset(&_stats, 0, sizeof(_stats));
+    uint32_t _start = micros();
+    bool _ok = logfile->open(filename, O_RDWR);
+    _cardOp(LOG_CARD_OPEN, _start, 0, _ok);
+    _ok = _ok && (_fileFormat == LOG_FORMAT_CSV ? _resumeCSV()
+                                                : _resumeBlocks());
+    if (!_ok) {
 #ifdef DEBUG
-        Serial.print(hall[_i], DEC);
-        Serial.print(",");
+        Serial.println("<<< CANT RESUME LOG FILE >>>");
 #endif
+        logfile->close();
+        _preallocated = false;
+        _openStart = 0;
+        _saveIndex();
+        return true;
+    }
+
+    _recordsSinceFlush = 0;
+    _lastFlushTime = 0;
+    _dirSyncTime = 0;
+    _fileDay = _openStart / 86400UL;
+    _nextTried = false;
+    _rawSectors = 0;
+    if (_preallocated) {
+        uint32_t _last;
+        if (logfile->contiguousRange(&_rawFirstSector, &_last)) {
+            _rawSectors = _last - _rawFirstSector + 1;
+        }
     }
-    logfile.print(tempC, 2);  // Temperature sensor value
-    logfile.println();
+    _saveIndex();
 #ifdef DEBUG
-    Serial.print(tempC, 2);
-    Serial.println();
+    Serial.print("Resumed: ");
+    Serial.println(filename);
 #endif
+    return false;
+}
+
+bool SDCard_close(void) {
+    if (_nextfile->isOpen()) {  // Unused pre-created file
+        _nextfile->remove();
+    }
+    bool _fail = _closeFile();
+    // Nothing to resume after a reset
+    _openStart = 0;
+    _nextStart = 0;
+    _saveIndex();
+    return _fail;
+}
+
+bool SDCard_prepareNextFile(void) {
+    if (!logfile->isOpen() || _nextfile->isOpen() || _nextTried ||
+        !_lastTime) {
+        return false;
+    }
 
-    return !logfile.close();
-}
\ No newline at end of file
+    // Expected start of the next file
+    uint32_t _start = 0;
+    if (_rollDaily &&
+        86400UL - _lastTime % 86400UL <= SD_PRECREATE_SECONDS) {
+        _start = (_lastTime / 86400UL + 1) * 86400UL;
+    } else if (_rollMB && _sector._pos + _sector._len >=
+                              _rollBytes() - (_rollBytes() >> 4)) {
+        _start = _lastTime;
+    } else {
+        return false;
+    }
+
+    _nextTried = true;
+    if (!_createFile(_nextfile, _nextName, DateTime(_start), &_nextSeq,
+                     &_nextPreallocated)) {
+        return true;
+    }
+    // Removed by the recovery if a reset comes before the rollover
+    _nextStart = _start;
+    _nextFormat = _format;
+    _saveIndex();
+    return false;
+}
+
+void SDCard_setRollover(const bool daily, const uint16_t megabytes) {
+    _rollDaily = daily;
+    _rollMB = megabytes;
+    _saveConfig();
+}
+
+void SDCard_setPreallocation(const uint16_t days) {
+    _preallocDays = days;
+    _saveConfig();
+}
+
+void SDCard_setLogInfo(const uint32_t sample_period_ms,
+                       const uint8_t *channel_order, const LogADCConfig &adc,
+                       const LogCalibration &cal, const uint8_t hall_mask,
+                       const uint8_t temp_probes) {
+    LOG_initHeader(&_header, LOG_FORMAT_PACKED);
+    _header.fwVersion[0] = FW_VERSION_MAJOR;
+    _header.fwVersion[1] = FW_VERSION_MINOR;
+    _header.fwVersion[2] = FW_VERSION_PATCH;
+    _header.samplePeriodMs = sample_period_ms;
+    memcpy(_header.channelOrder, channel_order, LOG_HALL_CHANNELS);
+    _header.adc = adc;
+    _header.filter = _filter;
+    _header.cal = cal;
+    _header.hallMask = hall_mask | LOG_SUPPLY_bm;  // Supply always logged
+    if (sample_period_ms % 1000) {  // Sub-second times
+        _header.hallMask |= LOG_MILLIS_bm;
+    }
+    _header.stats = _statsConfig;
+    _header.tempProbes = temp_probes;
+
+    // A resumed file recorded with other channel, probe settings or sample
+    // period is not continued, nor a binary file with other ADC, change-driven
+    // logging, calibration or statistics settings (CSV files do not record
+    // them). The binary header is read back from the card (checked by the
+    // resume) rather than kept in RAM since then.
+    if (_checkADC) {
+        bool _other = _openMask != _header.hallMask ||
+                      _openProbes != _header.tempProbes ||
+                      _openPeriod != _header.samplePeriodMs;
+        if (_fileFormat != LOG_FORMAT_CSV && !_other) {
+            LogFileHeader _hdr;
+            _other =
+                !logfile->seekSet(0) ||
+                logfile->read(&_hdr, sizeof(LogFileHeader)) !=
+                    sizeof(LogFileHeader) ||
+                memcmp(&_hdr.adc, &adc, sizeof(LogADCConfig)) != 0 ||
+                memcmp(&_hdr.filter, &_filter, sizeof(LogChangeFilter)) != 0 ||
+                memcmp(&_hdr.cal, &cal, sizeof(LogCalibration)) != 0 ||
+                memcmp(&_hdr.stats, &_statsConfig, sizeof(LogStatsConfig)) != 0;
+        }
+        _rollPending |= _other;
+    }
+    _checkADC = false;
+}
+
+void SDCard_setADCConfig(const LogADCConfig &adc) {
+    _header.adc = adc;
+    _rollPending = logfile->isOpen();
+}
+
+void SDCard_setCalibration(const LogCalibration &cal) {
+    _header.cal = cal;
+    _rollPending = logfile->isOpen();
+}
+
+void SDCard_setChannelMask(const uint8_t hall_mask) {
+    _header.hallMask =
+        hall_mask | LOG_SUPPLY_bm | (_header.hallMask & LOG_MILLIS_bm);
+    _rollPending = logfile->isOpen();
+}
+
+void SDCard_setChangeFilter(const uint16_t hall_band, const uint16_t temp_band,
+                            const uint16_t heartbeat_s) {
+    _filter.hallBand = hall_band;
+    _filter.tempBand = temp_band;
+    _filter.heartbeatS = heartbeat_s;
+    _saveConfig();
+
+    // Binary files record the settings in their header
+    _header.filter = _filter;
+    if (logfile->isOpen() && _fileFormat != LOG_FORMAT_CSV) {
+        _rollPending = true;
+    }
+}
+
+bool SDCard_setStats(const uint16_t window_s, const uint16_t raw_every) {
+    if (window_s > LOG_STATS_WINDOW_MAX) {
+        return true;
+    }
+    _statsConfig.windowS = window_s;
+    _statsConfig.rawEvery = window_s ? raw_every : 0;
+    _saveConfig();
+
+    // Start over with a window of the new length, in a new file
+    LOG_windowReset(&_window, 0);
+    _summaryReady = false;
+    _header.stats = _statsConfig;
+    _rollPending = logfile->isOpen();
+    return false;
+}
+
+bool SDCard_rawDue(const uint32_t time, const uint16_t time_ms) {
+    // The first sample of the second, the only one with sub-second periods
+    return !_statsConfig.windowS ||
+           (_statsConfig.rawEvery && time % _statsConfig.rawEvery == 0 &&
+            (time_ms == 0 || time_ms < _header.samplePeriodMs));
+}
+
+void SDCard_printSummary(void) {
+    if (_summaryReady) {
+        _printSummary(Serial, MSG_STATS_SUMMARY_short, _summary);
+    }
+}
+
+void SDCard_printStatsConfig(void) {
+    Serial.print(MSG_STATS_CONFIG_short);
+    Serial.print(',');
+    Serial.print(_statsConfig.windowS);
+    Serial.print(',');
+    Serial.println(_statsConfig.rawEvery);
+}
+
+bool SDCard_setFormat(const uint8_t format) {
+    if (format > LOG_FORMAT_DELTA) {
+        return true;
+    }
+    _format = format;
+    _saveConfig();
+    return false;
+}
+
+uint8_t SDCard_getFormat(void) {
+    return _fileFormat;
+}
+
+const SDLogStats &SDCard_getStats(void) {
+    return _stats;
+}
+
+void SDCard_printStats(void) {
+    uint32_t _writes = _stats.sectorWrites + _stats.flushes;
+    uint32_t _samples = _stats.records + _stats.skipped;
+    Serial.print(MSG_LOG_STATS_short);
+    Serial.print(',');
+    Serial.print(_stats.records);
+    Serial.print(',');
+    Serial.print(_stats.cardBytes);
+    Serial.print(',');
+    // Card bytes per sample with two implicit decimals
+    Serial.print(_samples ? (100UL * _stats.cardBytes) / _samples : 0UL);
+    Serial.print(',');
+    Serial.print(_stats.lastWriteUs);
+    Serial.print(',');
+    Serial.print(_stats.maxWriteUs);
+    Serial.print(',');
+    Serial.print(_writes ? _stats.totalWriteUs / _writes : 0UL);
+    Serial.print(',');
+    Serial.print(_stats.skipped);
+    Serial.print(',');
+    Serial.println(_stats.summaries);
+}
+
+const LogCardHealth &SDCard_getHealth(void) {
+    return _health;
+}
+
+void SDCard_printHealth(void) {
+    _health.time = _lastTime;
+    _printHealth(Serial, MSG_CARD_HEALTH_short);
+}
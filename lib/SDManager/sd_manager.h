@@ -7,6 +7,35 @@
  * library. Functions to initialize the SD card, create a log file with a unique
  * name, and write data to the log file.
  *
+ * Records are not written to the card one by one: they are gathered in a
+ * 512-byte RAM sector buffer that is written as a whole sector when it fills
+ * up, and flushed (partial sector + directory entry sync) according to a flush
+ * policy of every N records or every T seconds, whichever comes first. The log
+ * file stays open between samples.
+ *
+ * Optionally, the log file is pre-allocated as one contiguous extent sized for
+ * the whole deployment and the buffer is written to its sectors directly with
+ * multi-block writes, so a sample never causes FAT or directory updates. Its
+ * directory entry is only committed once per flush period (T seconds, or
+ * every flush without one). The file is truncated to its real length when it
+ * is closed.
+ *
+ * Records are written as CSV text, as fixed-size packed binary records or as
+ * delta-encoded blocks after a header sector (see log_format.h). The format, flush policy,
+ * pre-allocation, rollover, change-driven logging and interval statistics
+ * are persisted in EEPROM. Log files are named with a file counter kept in
+ * EEPROM and roll over at the day boundary or at a size limit into a file
+ * created ahead of time.
+ *
+ * Binary blocks carry the file id, their sector index and a CRC, and the open
+ * file is recorded in EEPROM, so after a reset SDCard_recover() continues the
+ * same file from its last valid block instead of starting a new one.
+ *
+ * Every card open, write and sync is timed into a log-scale latency histogram,
+ * failed writes and syncs are retried, and the card error code and data of the
+ * last failure are kept. These card health counters are reported with
+ * SDCard_printHealth() and written to the log every SD_HEALTH_PERIOD seconds.
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
@@ -25,13 +54,157 @@
 #define __SD_MANAGER_H__
 
 // Configuración recomendada para minimizar el uso de flash
-#define USE_FAT_FILE_FLAG_CONTIGUOUS 0
+#define USE_FAT_FILE_FLAG_CONTIGUOUS 1
 // #define ENABLE_DEDICATED_SPI 0
 // #define USE_LONG_FILE_NAMES 0
 #define SDFAT_FILE_TYPE 1
 // #define CHECK_FLASH_PROGRAMMING 0  // May cause SD to sleep at high current.
 
+#include <EEPROM.h>
+
 #include "SdFat.h"
+#include "eeprom_map.h"
+#include "log_format.h"
+#include "log_stats.h"
+#include "log_text.h"
+
+// Size of a card sector
+#define SD_SECTOR_SIZE 512
+
+// Sectors in the RAM buffer (each one costs 512 bytes of RAM). With more than
+// one, full buffers are sent with a single multi-block write
+#ifndef SD_LOG_BUFFER_SECTORS
+#define SD_LOG_BUFFER_SECTORS 1
+#endif
+
+// Days of records to pre-allocate for each log file (0: grow through FAT)
+#ifndef SD_PREALLOC_DAYS
+#define SD_PREALLOC_DAYS 0
+#endif
+
+// Worst-case CSV record and summary lengths used to size the pre-allocated
+// extent, and packed record with its share of the block header
+#define SD_CSV_RECORD_BYTES 71
+#define SD_CSV_SUMMARY_BYTES 240
+#define SD_BIN_RECORD_BYTES 16
+
+// Default record format of new log files
+#ifndef SD_LOG_FORMAT
+#define SD_LOG_FORMAT LOG_FORMAT_DELTA
+#endif
+
+// Default flush policy: flush every N records or every T seconds
+#ifndef SD_FLUSH_RECORDS
+#define SD_FLUSH_RECORDS 60
+#endif
+#ifndef SD_FLUSH_SECONDS
+#define SD_FLUSH_SECONDS 60
+#endif
+
+// Default rollover: a new file every day and/or every N MB (0: no limit)
+#ifndef SD_ROLL_DAILY
+#define SD_ROLL_DAILY 1
+#endif
+#ifndef SD_ROLL_MB
+#define SD_ROLL_MB 0
+#endif
+
+// Change-driven logging: a sample is only written when a hall value moves
+// more than SD_CHANGE_HALL_BAND counts or the temperature more than
+// SD_CHANGE_TEMP_BAND centi-degrees from the last record written, or
+// SD_CHANGE_HEARTBEAT seconds after it (0: every sample is written)
+#ifndef SD_CHANGE_HALL_BAND
+#define SD_CHANGE_HALL_BAND 8
+#endif
+#ifndef SD_CHANGE_TEMP_BAND
+#define SD_CHANGE_TEMP_BAND 10
+#endif
+#ifndef SD_CHANGE_HEARTBEAT
+#define SD_CHANGE_HEARTBEAT 0
+#endif
+
+// Interval statistics: the samples of every SD_STATS_WINDOW seconds are
+// summarized (min, max, mean and variance) in one summary record, and only
+// the samples at multiples of SD_STATS_RAW_EVERY seconds are still logged
+// (window 0: statistics off, every sample is logged; raw 0: no samples)
+#ifndef SD_STATS_WINDOW
+#define SD_STATS_WINDOW 0
+#endif
+#ifndef SD_STATS_RAW_EVERY
+#define SD_STATS_RAW_EVERY 0
+#endif
+
+// Attempts repeated after a failed card write or sync
+#ifndef SD_WRITE_RETRIES
+#define SD_WRITE_RETRIES 2
+#endif
+
+// Seconds between card health records in the log (0: none)
+#ifndef SD_HEALTH_PERIOD
+#define SD_HEALTH_PERIOD 3600
+#endif
+
+// The next log file is created when the daily rollover is this close
+#ifndef SD_PRECREATE_SECONDS
+#define SD_PRECREATE_SECONDS 300
+#endif
+
+/**
+ * @brief Logging settings persisted in EEPROM at EEPROM_LOGCFG_ADDR
+ */
+struct SDLogConfig {
+    char tag;               ///< 'L' when the block has been written
+    uint8_t format;         ///< LogRecordFormat of new log files
+    uint8_t flushRecords;   ///< Flush every N records (0: disabled)
+    uint16_t flushSeconds;  ///< Flush every T seconds (0: disabled)
+    uint16_t preallocDays;  ///< Days of records to pre-allocate (0: off)
+    uint8_t rollDaily;      ///< New log file at the day boundary
+    uint16_t rollMB;        ///< New log file at this size (0: no limit)
+    LogChangeFilter filter; ///< Change-driven logging (heartbeat 0: off)
+    LogStatsConfig stats;   ///< Interval statistics (window 0: off)
+    uint16_t crc;           ///< CRC-16 of the previous fields
+};
+
+// SDFileIndex::openFlags: record format and pre-allocated extent
+#define SD_INDEX_FORMAT_gm   0x0F
+#define SD_INDEX_PREALLOC_bm 0x80
+
+/**
+ * @brief File counter and open files persisted in EEPROM at
+ * EEPROM_FILEIDX_ADDR, so a reset resumes the same log file
+ */
+struct SDFileIndex {
+    uint32_t openStart;     ///< Start time of the log file being written
+                            ///< (0: closed cleanly)
+    uint32_t openPeriodMs;  ///< Its sample period
+    uint32_t nextStart;     ///< Start of the pre-created file (0: none)
+    uint16_t seq;           ///< Counter of the last created log file
+    uint16_t openSeq;       ///< Counter of the log file being written
+    char tag;               ///< 'N' when the block has been written
+    uint8_t openFlags;      ///< Its format and SD_INDEX_PREALLOC_bm
+    uint8_t openMask;       ///< Its hall mask (LogFileHeader::hallMask)
+    uint8_t openProbes;     ///< Its temperature columns
+    uint8_t nextFormat;     ///< Format of the pre-created file
+    uint16_t crc;           ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Logging engine counters since the current log file was opened
+ */
+struct SDLogStats {
+    uint32_t records;       ///< Records appended to the log
+    uint32_t skipped;       ///< Samples not written by change-driven logging
+                            ///< or interval statistics
+    uint32_t summaries;     ///< Interval summaries appended to the log
+    uint32_t payloadBytes;  ///< Bytes of log data produced
+    uint32_t cardBytes;     ///< Bytes sent to the card (with partial rewrites)
+    uint16_t sectorWrites;  ///< Full sectors written (buffer full)
+    uint16_t flushes;       ///< Partial flushes (sector rewrite + sync)
+    uint16_t errors;        ///< Failed writes or syncs
+    uint32_t lastWriteUs;   ///< Latency of the last card write or flush
+    uint32_t maxWriteUs;    ///< Worst card write or flush latency
+    uint32_t totalWriteUs;  ///< Accumulated card write and flush latency
+};
 
 /**
  * @brief Initialize and sets up an SD card and FAT filesystem. It verifies the
@@ -42,11 +215,92 @@
  */
 bool SDCard_init(void);
 
+/**
+ * @brief Resume the log file that was being written when the device lost
+ * power or was reset. Binary files are scanned for their last valid block
+ * (by sequence number and CRC), which is loaded back into the sector buffer,
+ * so at most the records since the last flush are lost and no new file or
+ * header is created. CSV files resume at their last synced length (not
+ * possible when pre-allocated). An unused pre-created next file is removed.
+ *
+ * @param[in] serial_number     Serial number in format (0-999)
+ *
+ * @return True if there is no file to resume (closed cleanly, missing or
+ * damaged); create a new one with SDCard_initFileName()
+ */
+bool SDCard_recover(const uint16_t serial_number);
+
+/**
+ * @brief Set the acquisition details stored in the header of binary log
+ * files. Call it before the log file is created.
+ *
+ * @param[in] sample_period_ms  Nominal time between records, the records
+ *                              carry milliseconds (LOG_MILLIS_bm) if it is
+ *                              not a whole number of seconds
+ * @param[in] channel_order     ADC input of each hall column (6 values)
+ * @param[in] adc               ADC configuration
+ * @param[in] cal               Hall to gape calibration
+ * @param[in] hall_mask         Hall channels logged (bit 0: hall1), the
+ *                              supply (LOG_SUPPLY_bm) is always added
+ * @param[in] temp_probes       Temperature columns (1 to LOG_TEMP_PROBES)
+ */
+void SDCard_setLogInfo(const uint32_t sample_period_ms,
+                       const uint8_t *channel_order, const LogADCConfig &adc,
+                       const LogCalibration &cal, const uint8_t hall_mask,
+                       const uint8_t temp_probes = 1);
+
+/**
+ * @brief Change the ADC configuration stored in the header of the log files.
+ * Logging continues in a new file from the next record, so each file holds
+ * values of one acquisition profile.
+ *
+ * @param[in] adc       ADC configuration
+ */
+void SDCard_setADCConfig(const LogADCConfig &adc);
+
+/**
+ * @brief Change the gape calibration stored with the log files (header of
+ * binary files, `#C` lines and gape columns of CSV files). Logging continues
+ * in a new file from the next record.
+ *
+ * @param[in] cal       Hall to gape calibration
+ */
+void SDCard_setCalibration(const LogCalibration &cal);
+
+/**
+ * @brief Change the hall channels stored in the log files (header of binary
+ * files, columns of CSV files). Logging continues in a new file from the next
+ * record.
+ *
+ * @param[in] hall_mask Hall channels logged (bit 0: hall1), the supply
+ *                      (LOG_SUPPLY_bm) is always added
+ */
+void SDCard_setChannelMask(const uint8_t hall_mask);
+
+/**
+ * @brief Set the record format of the next log file and persist it
+ *
+ * @param[in] format    LogRecordFormat (CSV, packed or delta)
+ *
+ * @return True if the format is not supported
+ */
+bool SDCard_setFormat(const uint8_t format);
+
+/**
+ * @brief Returns the record format of the current log file
+ *
+ * @return LogRecordFormat of the open log file
+ */
+uint8_t SDCard_getFormat(void);
+
 /**
  * @brief Initialize a filename for an SD card log file based on the provided
- * date, time, and serial number (append a counter if necessary for uniqueness).
- * It creates the file, writes a header line, sets timestamps, and closes the
- * file to finalize its creation.
+ * date, time, serial number and the file counter stored in EEPROM
+ * (`YYYYMMDD_HHMM_NN_SNxxx`, NN: last two digits of the counter), so the file
+ * is created without searching the directory for a free name.
+ * It closes the previous log file, creates the new one (.csv or .bhd for the
+ * binary format), writes a header line or sector and sets timestamps. The
+ * file is left open for logging.
  *
  * @note  Based on similar function in
  * https://github.com/millerlp/BivalveBit_lib
@@ -65,18 +319,178 @@ void SDCard_initFileName(const uint16_t year, const uint8_t month,
                          const uint16_t serial_number);
 
 /**
- * @brief Function that writes data to the log file with: POSIX timestamp, a
- * human-readable timestamp, all of six hall sensor values, and the temperature
- * value in Celsius
+ * @brief Function that appends a record to the log file with: POSIX
+ * timestamp, a human-readable timestamp, all of six hall sensor values, and the
+ * temperature value in Celsius. The record goes to the sector buffer; the card
+ * is only written when the sector fills up or the flush policy is due.
+ * When the record crosses the day boundary or the file reached its size limit,
+ * the file is closed and the record starts the next one.
+ * Binary records do not use the time text.
+ *
+ * With interval statistics on, every sample is first added to the window
+ * statistics. The sample that starts a new window closes the previous one,
+ * whose summary is appended to the log (see SDCard_printSummary()), and the
+ * sample itself is only logged when SDCard_rawDue().
+ *
+ * @param[in] record            POSIX time, hall values and temperature in
+ *                              centi-degrees
+ * @param[in] text              Text of the record time (CSV only), updated
+ *                              with LOG_timeTextUpdate()
+ * @param[in] gape              Gapes of the record (CSV only, binary files
+ *                              carry the calibration in their header)
+ *
+ * @return True if the operation fails or false if successful
+ */
+bool SDCard_writeFile(const LogRecord &record, const LogTimeText &text,
+                      const LogGape &gape);
+
+/**
+ * @brief Appends a burst capture to the log file: an event block in binary
+ * files (the current record block is closed early) or a `#E` line followed by
+ * one `#S` line per sample in CSV files. Like the records, it reaches the card
+ * with the next flush.
+ *
+ * @param[in] event     Event header
+ * @param[in] hall      `event.count` hall samples, oldest first
+ *
+ * @return True if the operation fails or false if successful
+ */
+bool SDCard_writeEvent(const LogEventHeader &event, const LogHallSample *hall);
+
+/**
+ * @brief Set and persist the flush policy of the log buffer. A flush writes the
+ * partially filled sector and syncs the directory entry, so it bounds the data
+ * lost on a reset. A value of 0 disables that condition.
  *
- * @param[in] unix_time         The POSIX timestamp
- * @param[in] timestamp         A human-readable timestamp in the format
- * @param[in] hall              An array of six hall sensor values
- * @param[in] tempC             The temperature value in Celsius
+ * @param[in] records   Flush after this many records (0 to 255)
+ * @param[in] seconds   Flush when this many seconds of POSIX time have passed
+ *                      since the last flush
+ */
+void SDCard_setFlushPolicy(const uint8_t records, const uint16_t seconds);
+
+/**
+ * @brief Write the buffered records to the card and sync the log file
  *
  * @return True if the operation fails or false if successful
  */
-bool SDCard_writeFile(const uint32_t unix_time, const char *timestamp,
-                      const uint16_t hall[6], const float tempC);
+bool SDCard_flush(void);
+
+/**
+ * @brief Create the next log file ahead of a rollover (name, directory entry
+ * and pre-allocated extent) when the day boundary or the size limit is near,
+ * so the rollover itself only swaps files. Call it from the main loop after
+ * the sample is logged; it does nothing most of the time.
+ *
+ * @return True if the next file could not be created
+ */
+bool SDCard_prepareNextFile(void);
+
+/**
+ * @brief Set (and persist) when the log continues in a new file
+ *
+ * @param[in] daily     New file at the day boundary
+ * @param[in] megabytes New file when the current one reaches this size
+ *                      (0 to 4095, 0 disables it)
+ */
+void SDCard_setRollover(const bool daily, const uint16_t megabytes);
+
+/**
+ * @brief Set (and persist) change-driven logging: samples that stay within
+ * the bands around the last record written are not logged until the
+ * heartbeat is due. The settings go in the binary file header, so logging
+ * continues in a new binary file from the next record.
+ *
+ * @param[in] hall_band     Hall change in counts that writes a record
+ * @param[in] temp_band     Temperature change in centi-degrees that writes a
+ *                          record
+ * @param[in] heartbeat_s   Longest time between records in seconds, 0 writes
+ *                          every sample
+ */
+void SDCard_setChangeFilter(const uint16_t hall_band, const uint16_t temp_band,
+                            const uint16_t heartbeat_s);
+
+/**
+ * @brief Set (and persist) the interval statistics. The window in progress is
+ * dropped and logging continues in a new file from the next record.
+ *
+ * @param[in] window_s      Window length in seconds, 0 turns the statistics
+ *                          off (every sample is logged)
+ * @param[in] raw_every     Samples at multiples of this many seconds are
+ *                          still logged, 0 logs none
+ *
+ * @return True if the window is longer than LOG_STATS_WINDOW_MAX
+ */
+bool SDCard_setStats(const uint16_t window_s, const uint16_t raw_every);
+
+/**
+ * @brief Check if a sample is logged (and printed) as a record
+ *
+ * @param[in] time      POSIX time of the sample
+ * @param[in] time_ms   Milliseconds of the sample within that second
+ *
+ * @return True if statistics are off or the sample is on the raw decimation
+ * (the first sample of the second with sub-second sample periods)
+ */
+bool SDCard_rawDue(const uint32_t time, const uint16_t time_ms = 0);
+
+/**
+ * @brief Print the summary of the window closed by the last sample written to
+ * Serial, if any:
+ * `M119,window start,samples,min,max,mean,variance (per logged hall channel),
+ * temperature min,max,mean`
+ */
+void SDCard_printSummary(void);
+
+/**
+ * @brief Print the interval statistics settings to Serial:
+ * `M120,window s,raw every s`
+ */
+void SDCard_printStatsConfig(void);
+
+/**
+ * @brief Flush and close the log file (clean stop). A pre-allocated file is
+ * truncated to the length actually logged, and an unused pre-created next
+ * file is removed.
+ *
+ * @return True if the operation fails or false if successful
+ */
+bool SDCard_close(void);
+
+/**
+ * @brief Set (and persist) how many days of 1 Hz records are pre-allocated as
+ * a contiguous extent when the next log file is created
+ *
+ * @param[in] days      Days to pre-allocate, 0 to grow the file through FAT
+ */
+void SDCard_setPreallocation(const uint16_t days);
+
+/**
+ * @brief Returns the logging engine counters of the current log file
+ *
+ * @return Reference to the counters
+ */
+const SDLogStats &SDCard_getStats(void);
+
+/**
+ * @brief Print the logging engine counters to Serial as a single line:
+ * `M110,records,card bytes,card bytes per sample x100,last us,max us,mean us,
+ * skipped samples,summaries`
+ */
+void SDCard_printStats(void);
+
+/**
+ * @brief Returns the SD card health counters since power-on
+ *
+ * @return Reference to the counters
+ */
+const LogCardHealth &SDCard_getHealth(void);
+
+/**
+ * @brief Print the SD card health counters to Serial, one line per operation
+ * (O: open, W: write, S: sync) and one with the last failure:
+ * `M112,op,count,retries,errors,max us,histogram bin 0,...,bin 11`
+ * `M112,E,error code,error data,POSIX time of the failure`
+ */
+void SDCard_printHealth(void);
 
 #endif  // !__SD_MANAGER_H__
\ No newline at end of file
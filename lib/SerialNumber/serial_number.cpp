@@ -38,7 +38,7 @@ bool _SNValid = false;
 bool getSerialNumber(uint16_t &sn) {
     _SNValid = false;
 
-    EEPROM.get(0, _serialNumber);
+    EEPROM.get(EEPROM_SN_ADDR, _serialNumber);
     if (_serialNumber[0] == 'S') {
 #ifdef DEBUG
         Serial.println("Reading serial number");
@@ -76,7 +76,7 @@ bool setSerialNumber(const uint16_t sn) {
     Serial.print("Numero serie: ");
     Serial.println(sn);
 #endif
-    if (sn == 0 || sn > 999) return;
+    if (sn == 0 || sn > 999) return false;
 
     _serialNumber[0] = 'S';
 
@@ -85,7 +85,7 @@ bool setSerialNumber(const uint16_t sn) {
     _serialNumber[3] = sn % 10;
     _serialNumber[4] =
         ((_serialNumber[1] + _serialNumber[2] + _serialNumber[3]) % 10);
-    EEPROM.put(0, _serialNumber);
+    EEPROM.put(EEPROM_SN_ADDR, _serialNumber);
 #ifdef DEBUG
     Serial.print("Digitos: ");
     Serial.print(_serialNumber[1], DEC);
@@ -28,6 +28,8 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 
+#include "eeprom_map.h"
+
 /**
  * @brief Retrieves a serial number from EEPROM, validates it using a checksum
  * and stores it in the provided reference parameter `sn`
@@ -22,28 +22,223 @@
 #include <DallasTemperature.h>
 #include <OneWire.h>
 
+#include "msg_codes.h"
+
 // Setup a oneWire instance to communicate with any OneWire devices
 /// @todo One-Wire data pin is hardcoded
 OneWire oneWire(9);
 // Pass our oneWire reference to Dallas Temperature.
 DallasTemperature ds18b20(&oneWire);
+// ROM codes of the probes, so a reading does not search the bus
+TempProbeCache _probes;
+// Probes found by the boot search (bit k: probe k)
+uint8_t _found = 0;
+// Acquisition period, resolution and the value of the records between
+// readings
+TempConfig _config;
+// Conversion in progress and the time of the sample that reads it
+bool _pending = false;
+uint32_t _pendingFor;
+// Last reading and the time of its sample
+int16_t _reading[LOG_TEMP_PROBES];
+uint32_t _readingTime;
+bool _readingValid = false;
+
+/**
+ * @brief Whether a sample takes a reading: the first one of an acquisition
+ * period (or of all)
+ */
+bool _due(const uint32_t time) {
+    return !_readingValid ||
+           time / _config.periodS != _readingTime / _config.periodS;
+}
+
+/**
+ * @brief Set the configured resolution on every probe found at boot
+ */
+void _applyResolution(void) {
+    for (uint8_t _i = 0; _i < _probes.count; ++_i) {
+        if (_found & (1 << _i)) {
+            ds18b20.setResolution(_probes.rom[_i], _config.resolution, true);
+        }
+    }
+}
 
 bool TEMP_init(void) {
     // Start up the library
     ds18b20.begin();
 
-    if (ds18b20.getDS18Count() == 1) {
-        // Set resolution to 12 bits
-        ds18b20.setResolution(12);
+    EEPROM.get(EEPROM_TEMPCFG_ADDR, _config);
+    if (_config.tag != 'D' ||
+        _config.crc != LOG_crc16((const uint8_t*)&_config,
+                                 offsetof(TempConfig, crc)) ||
+        _config.periodS == 0 || _config.periodS > TEMP_PERIOD_MAX ||
+        _config.resolution < 9 || _config.resolution > 12) {
+        _config.periodS = TEMP_PERIOD_S;  // Never set or corrupted
+        _config.resolution = TEMP_RESOLUTION;
+        _config.fillEmpty = TEMP_FILL_EMPTY;
+    }
+
+    EEPROM.get(EEPROM_PROBES_ADDR, _probes);
+    if (_probes.tag != 'R' ||
+        _probes.crc != LOG_crc16((const uint8_t*)&_probes,
+                                 offsetof(TempProbeCache, crc)) ||
+        _probes.count > LOG_TEMP_PROBES) {
+        _probes.count = 0;  // Never set, cleared or corrupted
+    }
+
+    // Search the bus once: keep the column of the cached probes and append
+    // the new ones
+    bool _changed = _probes.tag != 'R';
+    DeviceAddress _rom;
+    _found = 0;
+    oneWire.reset_search();
+    while (oneWire.search(_rom)) {
+        if (OneWire::crc8(_rom, 7) != _rom[7] ||
+            !ds18b20.validFamily(_rom)) {
+            continue;
+        }
+        uint8_t _i = 0;
+        while (_i < _probes.count && memcmp(_probes.rom[_i], _rom, 8)) {
+            ++_i;
+        }
+        if (_i == _probes.count) {
+            if (_i == LOG_TEMP_PROBES) {
+                continue;  // No column left
+            }
+            memcpy(_probes.rom[_probes.count++], _rom, 8);
+            _changed = true;
+        }
+        _found |= 1 << _i;
+    }
+    _applyResolution();
 
-        return 0;
+    if (_changed) {
+        _probes.tag = 'R';
+        _probes.crc = LOG_crc16((const uint8_t*)&_probes,
+                                offsetof(TempProbeCache, crc));
+        EEPROM.put(EEPROM_PROBES_ADDR, _probes);
     }
 
-    return 1;
+    // Conversions are started by TEMP_startConversion() and read later
+    ds18b20.setWaitForConversion(false);
+
+    return _found == 0;
 }
 
-float TEMP_read(void) {
+uint8_t TEMP_getProbeCount(void) {
+    return _probes.count ? _probes.count : 1;
+}
+
+void TEMP_printProbes(void) {
+    for (uint8_t _i = 0; _i < _probes.count; ++_i) {
+        Serial.print(MSG_PROBES_short);
+        Serial.print(',');
+        Serial.print(_i + 1);
+        Serial.print(',');
+        for (uint8_t _b = 0; _b < 8; ++_b) {
+            if (_probes.rom[_i][_b] < 0x10) {
+                Serial.print('0');
+            }
+            Serial.print(_probes.rom[_i][_b], HEX);
+        }
+        Serial.print(',');
+        Serial.println(_found & (1 << _i) ? 1 : 0);
+    }
+}
+
+bool TEMP_setConfig(const uint16_t period_s, const uint8_t resolution,
+                    const bool fill_empty) {
+    if (period_s == 0 || period_s > TEMP_PERIOD_MAX || resolution < 9 ||
+        resolution > 12) {
+        return true;
+    }
+    _config.tag = 'D';
+    _config.periodS = period_s;
+    _config.resolution = resolution;
+    _config.fillEmpty = fill_empty;
+    _config.crc =
+        LOG_crc16((const uint8_t*)&_config, offsetof(TempConfig, crc));
+    EEPROM.put(EEPROM_TEMPCFG_ADDR, _config);
+
+    // A conversion at the old resolution is not used, the next sample reads
+    _applyResolution();
+    _pending = false;
+    _readingValid = false;
+    return false;
+}
+
+void TEMP_printConfig(void) {
+    Serial.print(MSG_TEMP_CONFIG_short);
+    Serial.print(',');
+    Serial.print(_config.periodS);
+    Serial.print(',');
+    Serial.print(_config.resolution);
+    Serial.print(',');
+    Serial.println(_config.fillEmpty);
+}
+
+void TEMP_clearProbes(void) {
+    EEPROM.update(EEPROM_PROBES_ADDR, 0);  // The tag: enumerate at next boot
+}
+
+/**
+ * @brief Start a conversion on every probe at once (Skip ROM) for the sample
+ * at a given time
+ */
+void _convert(const uint32_t time) {
     ds18b20.requestTemperatures();
+    _pending = true;
+    _pendingFor = time;
+}
 
-    return ds18b20.getTempCByIndex(0);
-}
\ No newline at end of file
+void TEMP_startConversion(const uint32_t time, const uint32_t next_time) {
+    // Samples below a second apart: the next second, started by its first
+    // sample, so the conversion gets the rest of this one
+    const uint32_t _for = next_time > time ? next_time : time + 1;
+    if (_due(_for) && !(_pending && _pendingFor == _for)) {
+        _convert(_for);  // Only for a sample that reads
+    }
+}
+
+void TEMP_read(const uint32_t time, int16_t *temps) {
+    if (!_due(time)) {
+        for (uint8_t _i = 0; _i < TEMP_getProbeCount(); ++_i) {
+            temps[_i] = _config.fillEmpty ? LOG_TEMP_INVALID : _reading[_i];
+        }
+        return;
+    }
+
+    // Use the conversion started for this sample, or convert now
+    if (!_pending || _pendingFor != time) {
+        _convert(time);
+    }
+    _pending = false;
+
+    // Normally done already: the probes answer read slots with 1 once all
+    // of them are (and when they are missing)
+    const uint8_t _drop = 12 - _config.resolution;
+    const uint16_t _convMs = TEMP_CONVERSION_MS >> _drop;
+    uint32_t _start = millis();
+    while (!ds18b20.isConversionComplete() && millis() - _start < _convMs) {
+    }
+
+    for (uint8_t _i = 0; _i < TEMP_getProbeCount(); ++_i) {
+        // Raw value in 1/128 degrees, rounded to centi-degrees (x100/128)
+        int32_t _raw = _i < _probes.count ? ds18b20.getTemp(_probes.rom[_i])
+                                          : DEVICE_DISCONNECTED_RAW;
+        if (_raw > DEVICE_DISCONNECTED_RAW) {
+            _raw &= ~((8L << _drop) - 1);  // Bits below the resolution
+        }
+        if (_raw <= DEVICE_DISCONNECTED_RAW) {
+            temps[_i] = DEVICE_DISCONNECTED_C * 100;
+        } else if (_raw < 0) {
+            temps[_i] = -(int16_t)((-_raw * 25 + 16) >> 5);
+        } else {
+            temps[_i] = (_raw * 25 + 16) >> 5;
+        }
+        _reading[_i] = temps[_i];
+    }
+    _readingTime = time;
+    _readingValid = true;
+}
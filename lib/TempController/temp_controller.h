@@ -23,20 +23,137 @@
 #ifndef __TEMP_CONTROLLER_H__
 #define __TEMP_CONTROLLER_H__
 
+#include <EEPROM.h>
+#include <stdint.h>
+
+#include "eeprom_map.h"
+#include "log_format.h"
+
+// Conversion time of a 12-bit reading in milliseconds, halved for each bit
+// less of resolution
+#define TEMP_CONVERSION_MS 750
+
+// Default temperature acquisition period in seconds (1-3600)
+#ifndef TEMP_PERIOD_S
+#define TEMP_PERIOD_S 1
+#endif
+
+// Default resolution in bits (9-12)
+#ifndef TEMP_RESOLUTION
+#define TEMP_RESOLUTION 12
+#endif
+
+// Default value of the records between two readings: 0 carries the last
+// reading forward, 1 leaves the field empty (LOG_TEMP_INVALID)
+#ifndef TEMP_FILL_EMPTY
+#define TEMP_FILL_EMPTY 0
+#endif
+
+#define TEMP_PERIOD_MAX 3600
+
+/**
+ * @brief ROM codes of the probes persisted in EEPROM at EEPROM_PROBES_ADDR.
+ * The position of a probe is its temperature column.
+ */
+struct TempProbeCache {
+    char tag;                         ///< 'R' when the block has been written
+    uint8_t count;                    ///< Probes cached
+    uint8_t rom[LOG_TEMP_PROBES][8];  ///< ROM code of each probe
+    uint16_t crc;                     ///< CRC-16 of the previous fields
+};
+
 /**
- * @brief Initialize and setup temperature sensor (DS18B20)
+ * @brief Temperature acquisition settings persisted in EEPROM at
+ * EEPROM_TEMPCFG_ADDR
+ */
+struct TempConfig {
+    char tag;            ///< 'D' when the block has been written
+    uint16_t periodS;    ///< Seconds between readings (1-3600)
+    uint8_t resolution;  ///< Bits per reading (9-12)
+    uint8_t fillEmpty;   ///< Records between readings: 0 last value, 1 empty
+    uint16_t crc;        ///< CRC-16 of the previous fields
+};
+
+/**
+ * @brief Initialize and setup the temperature sensors (DS18B20). The bus is
+ * searched once: cached probes keep their column, probes not cached yet are
+ * appended (up to LOG_TEMP_PROBES) and the cache is written back if it
+ * changed. Cached probes that do not answer read -12700. The acquisition
+ * settings are loaded from EEPROM and the resolution set on every probe.
  *
- * @return 0 if success, error code otherwise
- * @todo Describir código de errores
+ * @return 0 if success, 1 if no probe answers
  */
 bool TEMP_init(void);
 
 /**
- * @brief Retrieves the temperature in Celsius from a DS18B20 sensor accessing
- * the temperature value at index 0
+ * @brief Number of temperature columns: the probes cached at boot
+ *
+ * @return Probes, 1 to LOG_TEMP_PROBES
+ */
+uint8_t TEMP_getProbeCount(void);
+
+/**
+ * @brief Print one `M121,column,ROM code,found` line per cached probe, the
+ * ROM code in hex and found 1 if the probe answered the boot search
+ */
+void TEMP_printProbes(void);
+
+/**
+ * @brief Set the temperature acquisition settings, apply the resolution to
+ * the probes and persist them
+ *
+ * @param[in] period_s      Seconds between readings (1-TEMP_PERIOD_MAX),
+ *                          readings are taken at multiples of it
+ * @param[in] resolution    Bits per reading (9-12), the conversion takes
+ *                          TEMP_CONVERSION_MS >> (12 - resolution)
+ * @param[in] fill_empty    Records between readings: false carries the last
+ *                          reading forward, true leaves them empty
+ *
+ * @return True if a setting is out of range
+ */
+bool TEMP_setConfig(const uint16_t period_s, const uint8_t resolution,
+                    const bool fill_empty);
+
+/**
+ * @brief Print the temperature acquisition settings as
+ * `M122,period,resolution,fill empty`
+ */
+void TEMP_printConfig(void);
+
+/**
+ * @brief Forget the cached ROM codes. The bus is enumerated again at the next
+ * boot, in search order.
+ */
+void TEMP_clearProbes(void);
+
+/**
+ * @brief Starts a temperature conversion on every probe at once (Skip ROM)
+ * and returns without waiting for it, if the next sample takes a reading.
+ * Call it at the end of a sample, so the conversion runs while the device
+ * sleeps and TEMP_read() finds it done at the next one.
+ *
+ * With samples below a second apart it starts at the first sample of the
+ * second before the reading, and the following samples leave it running.
+ *
+ * @param[in] time       POSIX time of the sample that starts it
+ * @param[in] next_time  POSIX second of the next sample
+ */
+void TEMP_startConversion(const uint32_t time, const uint32_t next_time);
+
+/**
+ * @brief Retrieves the temperature in Celsius of every cached probe, without
+ * floating point, reading each scratchpad by its ROM code (no bus search).
+ * A reading is taken by the first sample of each acquisition period: the
+ * conversion started for it by the previous sample is read; without one
+ * (first sample, missed samples, clock change) a conversion is started and
+ * waited for. Other samples get the last reading
+ * or LOG_TEMP_INVALID, as configured.
  *
- * @returns Temperature in Celsius as a float
+ * @param[in]  time     POSIX time of the sample
+ * @param[out] temps    Temperature of each probe in centi-degrees Celsius
+ *                      (-12700 if the probe does not answer),
+ *                      TEMP_getProbeCount() values
  */
-float TEMP_read(void);
+void TEMP_read(const uint32_t time, int16_t *temps);
 
 #endif  // !__TEMP_CONTROLLER_H__
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+ * @file    Arduino.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for the Arduino megaAVR core. Only the subset used by
+ * the firmware is provided: digital I/O, simulated time, interrupts, the Print
+ * and Stream classes and the USB Serial port. Time only advances through
+ * delay(), delayMicroseconds() and the simulation loop (see sim.h).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE  4
+#define FALLING 2
+#define RISING  3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define LED_BUILTIN 25
+
+#define NUM_DIGITAL_PINS 41
+
+#define digitalPinToInterrupt(p) (p)
+
+#define noInterrupts() cli()
+#define interrupts()   sei()
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+char *itoa(int value, char *str, int base);
+char *utoa(unsigned int value, char *str, int base);
+char *ltoa(long value, char *str, int base);
+char *ultoa(unsigned long value, char *str, int base);
+char *strupr(char *str);
+
+/** --------------------------------------------------------------------------
+ * Print / Stream
+ * -------------------------------------------------------------------------- */
+
+class __FlashStringHelper;
+#define F(string_literal) \
+    (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print {
+   public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) {
+        return str ? write((const uint8_t *)str, strlen(str)) : 0;
+    }
+    size_t write(const char *buffer, size_t size) {
+        return write((const uint8_t *)buffer, size);
+    }
+    virtual int availableForWrite() {
+        return 0;
+    }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *s);
+    size_t print(const char s[]);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println(const __FlashStringHelper *s);
+    size_t println(const char s[]);
+    size_t println(char c);
+    size_t println(unsigned char n, int base = DEC);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n, int digits = 2);
+    size_t println(void);
+
+   private:
+    size_t printNumber(unsigned long n, uint8_t base);
+    size_t printFloat(double number, uint8_t digits);
+};
+
+class Stream : public Print {
+   public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+/**
+ * @brief USB serial port. Output goes to stdout (unless muted through
+ * sim_serialMute()) and input is fed from sim_serialInject().
+ */
+class HardwareSerial : public Stream {
+   public:
+    void begin(unsigned long baud) {
+        (void)baud;
+    }
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int availableForWrite() override {
+        return 64;
+    }
+    void flush() override;
+    operator bool() {
+        return true;
+    }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+void setup(void);
+void loop(void);
+
+#endif  // !__ARDUINO_H__
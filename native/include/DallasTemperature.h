@@ -0,0 +1,101 @@
+/**
+ * @file    DallasTemperature.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for Miles Burton's DallasTemperature library, built on
+ * top of the simulated OneWire bus. Only the DS18B20 subset used by the
+ * firmware is provided; blocking requests advance simulated time by the
+ * conversion time of the configured resolution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_DALLASTEMPERATURE_H__
+#define __SIM_DALLASTEMPERATURE_H__
+
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_C   -127
+#define DEVICE_DISCONNECTED_RAW -7040
+
+#define DS18B20MODEL 0x28
+
+typedef uint8_t DeviceAddress[8];
+typedef uint8_t ScratchPad[9];
+
+class DallasTemperature {
+   public:
+    DallasTemperature(OneWire *wire) : _wire(wire) {}
+
+    void begin(void);
+    uint8_t getDeviceCount(void) {
+        return _devices;
+    }
+    uint8_t getDS18Count(void) {
+        return _devices;
+    }
+    bool getAddress(uint8_t *deviceAddress, uint8_t index);
+    bool validFamily(const uint8_t *deviceAddress) {
+        return deviceAddress[0] == DS18B20MODEL;
+    }
+    bool isConnected(const uint8_t *deviceAddress);
+    bool isConnected(const uint8_t *deviceAddress, uint8_t *scratchPad);
+    bool readScratchPad(const uint8_t *deviceAddress, uint8_t *scratchPad);
+
+    uint8_t getResolution(void) {
+        return _bitResolution;
+    }
+    void setResolution(uint8_t newResolution);
+    bool setResolution(const uint8_t *deviceAddress, uint8_t newResolution,
+                       bool skipGlobalBitResolutionCalculation = false);
+
+    void setWaitForConversion(bool flag) {
+        _waitForConversion = flag;
+    }
+    bool getWaitForConversion(void) {
+        return _waitForConversion;
+    }
+    void setCheckForConversion(bool flag) {
+        _checkForConversion = flag;
+    }
+
+    struct request_t {
+        bool result;
+        unsigned long timestamp;
+        operator bool() {
+            return result;
+        }
+    };
+
+    request_t requestTemperatures(void);
+    request_t requestTemperaturesByAddress(const uint8_t *deviceAddress);
+    request_t requestTemperaturesByIndex(uint8_t index);
+
+    int32_t getTemp(const uint8_t *deviceAddress);
+    float getTempC(const uint8_t *deviceAddress);
+    float getTempCByIndex(uint8_t index);
+
+    bool isConversionComplete(void);
+    static uint16_t millisToWaitForConversion(uint8_t bitResolution);
+
+   private:
+    OneWire *_wire;
+    uint8_t _devices = 0;
+    uint8_t _bitResolution = 9;
+    bool _waitForConversion = true;
+    bool _checkForConversion = true;
+};
+
+#endif  // !__SIM_DALLASTEMPERATURE_H__
@@ -0,0 +1,63 @@
+/**
+ * @file    EEPROM.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for the Arduino EEPROM library. The 256-byte
+ * ATmega4809 EEPROM is kept in RAM and erased to 0xFF at start-up, like a
+ * freshly programmed device (see sim_eepromLoad() to preload an image).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_EEPROM_H__
+#define __SIM_EEPROM_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#define E2END 0xFF
+
+extern uint8_t sim_eeprom[E2END + 1];
+
+struct EEPROMClass {
+    uint8_t read(int idx) {
+        return sim_eeprom[idx & E2END];
+    }
+    void write(int idx, uint8_t val) {
+        sim_eeprom[idx & E2END] = val;
+    }
+    void update(int idx, uint8_t val) {
+        write(idx, val);
+    }
+    uint16_t length() {
+        return E2END + 1;
+    }
+
+    template <typename T>
+    T &get(int idx, T &t) {
+        memcpy((uint8_t *)&t, &sim_eeprom[idx], sizeof(T));
+        return t;
+    }
+
+    template <typename T>
+    const T &put(int idx, const T &t) {
+        memcpy(&sim_eeprom[idx], (const uint8_t *)&t, sizeof(T));
+        return t;
+    }
+};
+
+static EEPROMClass EEPROM __attribute__((unused));
+
+#endif  // !__SIM_EEPROM_H__
@@ -0,0 +1,61 @@
+/**
+ * @file    OneWire.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for Paul Stoffregen's OneWire library. The bus is
+ * populated with simulated DS18B20 probes (see sim_tempSetProbes()) that
+ * answer ROM search, Skip/Match ROM, Convert T, Read Scratchpad and
+ * resolution writes. Conversion time is modelled from the configured
+ * resolution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_ONEWIRE_H__
+#define __SIM_ONEWIRE_H__
+
+#include <Arduino.h>
+
+class OneWire {
+   public:
+    OneWire() {}
+    OneWire(uint8_t pin) : _pin(pin) {}
+    void begin(uint8_t pin) {
+        _pin = pin;
+    }
+
+    uint8_t reset(void);
+    void select(const uint8_t rom[8]);
+    void skip(void);
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0);
+    uint8_t read(void);
+    void read_bytes(uint8_t *buf, uint16_t count);
+    void write_bit(uint8_t v);
+    uint8_t read_bit(void);
+    void depower(void) {}
+
+    void reset_search();
+    void target_search(uint8_t family_code);
+    bool search(uint8_t *newAddr, bool search_mode = true);
+
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+
+   private:
+    uint8_t _pin = 0;
+    uint8_t _searchIndex = 0;
+};
+
+#endif  // !__SIM_ONEWIRE_H__
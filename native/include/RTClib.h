@@ -0,0 +1,142 @@
+/**
+ * @file    RTClib.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for Adafruit's RTClib, limited to DateTime, TimeSpan
+ * and RTC_DS3231. The DS3231 keeps time from the simulation clock and drives
+ * the alarm/SQW pin through sim.cpp. Every register access is counted in
+ * sim_i2cTransactions so scheduling cost can be compared.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_RTCLIB_H__
+#define __SIM_RTCLIB_H__
+
+#include <Arduino.h>
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class TimeSpan;
+
+class DateTime {
+   public:
+    DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000);
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0,
+             uint8_t min = 0, uint8_t sec = 0);
+
+    uint16_t year() const {
+        return 2000U + yOff;
+    }
+    uint8_t month() const {
+        return m;
+    }
+    uint8_t day() const {
+        return d;
+    }
+    uint8_t hour() const {
+        return hh;
+    }
+    uint8_t minute() const {
+        return mm;
+    }
+    uint8_t second() const {
+        return ss;
+    }
+    uint8_t dayOfTheWeek() const;
+    uint32_t unixtime(void) const;
+    bool isValid() const;
+
+    char *toString(char *buffer) const;
+
+    DateTime operator+(const TimeSpan &span) const;
+    DateTime operator-(const TimeSpan &span) const;
+    bool operator<(const DateTime &right) const {
+        return unixtime() < right.unixtime();
+    }
+    bool operator==(const DateTime &right) const {
+        return unixtime() == right.unixtime();
+    }
+
+   protected:
+    uint8_t yOff;
+    uint8_t m;
+    uint8_t d;
+    uint8_t hh;
+    uint8_t mm;
+    uint8_t ss;
+};
+
+class TimeSpan {
+   public:
+    TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+        : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 +
+                   (int32_t)minutes * 60 + seconds) {}
+    int32_t totalseconds() const {
+        return _seconds;
+    }
+
+   protected:
+    int32_t _seconds;
+};
+
+enum Ds3231SqwPinMode {
+    DS3231_OFF = 0x1C,
+    DS3231_SquareWave1Hz = 0x00,
+    DS3231_SquareWave1kHz = 0x08,
+    DS3231_SquareWave4kHz = 0x10,
+    DS3231_SquareWave8kHz = 0x18
+};
+
+enum Ds3231Alarm1Mode {
+    DS3231_A1_PerSecond = 0x0F,
+    DS3231_A1_Second = 0x0E,
+    DS3231_A1_Minute = 0x0C,
+    DS3231_A1_Hour = 0x08,
+    DS3231_A1_Date = 0x00,
+    DS3231_A1_Day = 0x10
+};
+
+enum Ds3231Alarm2Mode {
+    DS3231_A2_PerMinute = 0x7,
+    DS3231_A2_Minute = 0x6,
+    DS3231_A2_Hour = 0x4,
+    DS3231_A2_Date = 0x0,
+    DS3231_A2_Day = 0x8
+};
+
+extern uint32_t sim_i2cTransactions;
+
+class RTC_DS3231 {
+   public:
+    bool begin(void *wireInstance = nullptr);
+    void adjust(const DateTime &dt);
+    bool lostPower(void);
+    DateTime now();
+    Ds3231SqwPinMode readSqwPinMode();
+    void writeSqwPinMode(Ds3231SqwPinMode mode);
+    bool setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode);
+    bool setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode);
+    void disableAlarm(uint8_t alarm_num);
+    void clearAlarm(uint8_t alarm_num);
+    bool alarmFired(uint8_t alarm_num);
+    void enable32K(void);
+    void disable32K(void);
+    bool isEnabled32K(void);
+    float getTemperature();
+};
+
+#endif  // !__SIM_RTCLIB_H__
@@ -0,0 +1,245 @@
+/**
+ * @file    SdFat.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for Greiman's SdFat (FAT16/FAT32 subset). Files live
+ * in a host directory (BHD_SIM_SDROOT, "sdcard" by default). Pre-allocated
+ * files are given a contiguous range of virtual sectors so raw sector writes
+ * through card() land in the right host file. Every card operation advances
+ * simulated time by a simple cost model and is counted in sim_sd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_SDFAT_H__
+#define __SIM_SDFAT_H__
+
+#include <fcntl.h>
+#include <stdio.h>
+
+#include <Arduino.h>
+
+#ifndef O_AT_END
+#define O_AT_END 0x4000000
+#endif
+
+typedef int oflag_t;
+
+#define DEDICATED_SPI 1
+#define SHARED_SPI    0
+
+#define SD_SCK_MHZ(mhz) (1000000UL * (mhz))
+#define SPI_FULL_SPEED  SD_SCK_MHZ(50)
+#define SPI_HALF_SPEED  SD_SCK_MHZ(F_CPU / 4000000)
+
+#define T_ACCESS 1
+#define T_CREATE 2
+#define T_WRITE  4
+
+#define SD_CARD_ERROR_NONE 0x00
+#define SD_CARD_ERROR_CMD25 0x0C
+#define SD_CARD_ERROR_WRITE_DATA 0x29
+#define SD_CARD_ERROR_WRITE_TIMEOUT 0x2A
+
+class SdSpiConfig {
+   public:
+    SdSpiConfig(uint8_t cs, uint8_t opt, uint32_t maxSpeed)
+        : csPin(cs), options(opt), maxSck(maxSpeed) {}
+    const uint8_t csPin;
+    const uint8_t options;
+    const uint32_t maxSck;
+};
+
+inline bool isSpi(const SdSpiConfig &) {
+    return true;
+}
+
+struct cid_t {
+    uint8_t data[16];
+};
+struct csd_t {
+    uint8_t data[16];
+};
+
+/// Operation counters and fault injection for the simulated card
+struct SimSdCounters {
+    uint32_t opens;
+    uint32_t closes;
+    uint32_t syncs;
+    uint32_t exists;
+    uint32_t fileWrites;
+    uint32_t sectorWrites;
+    uint32_t multiSectorWrites;
+    uint32_t bytesWritten;
+    uint32_t failNextWrites;  ///< Number of upcoming writes that will fail
+};
+extern SimSdCounters sim_sd;
+
+class SdCard {
+   public:
+    bool readCID(cid_t *cid);
+    bool readCSD(csd_t *csd);
+    bool readOCR(uint32_t *ocr);
+    bool readSector(uint32_t sector, uint8_t *dst);
+    bool readSectors(uint32_t sector, uint8_t *dst, size_t ns);
+    bool writeSector(uint32_t sector, const uint8_t *src);
+    bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns);
+    bool erase(uint32_t firstSector, uint32_t lastSector);
+    bool syncDevice() {
+        return true;
+    }
+    bool isBusy() {
+        return false;
+    }
+    uint32_t sectorCount();
+    uint8_t errorCode() const {
+        return _errorCode;
+    }
+    uint32_t errorData() const {
+        return _errorData;
+    }
+    void setError(uint8_t code, uint32_t data = 0) {
+        _errorCode = code;
+        _errorData = data;
+    }
+
+   private:
+    uint8_t _errorCode = 0;
+    uint32_t _errorData = 0;
+};
+
+class FatFile {
+   public:
+    FatFile() {}
+    ~FatFile();
+    FatFile(const FatFile &) = delete;
+    FatFile &operator=(const FatFile &) = delete;
+
+    bool open(const char *path, oflag_t oflag = O_RDONLY);
+    bool isOpen() const {
+        return _fp != nullptr;
+    }
+    bool close();
+    bool sync();
+
+    int read();
+    int read(void *buf, size_t count);
+    int available() {
+        return _pos < _size ? (int)(_size - _pos) : 0;
+    }
+    size_t write(const void *buf, size_t count);
+    size_t write(uint8_t b) {
+        return write(&b, 1);
+    }
+
+    bool seekSet(uint32_t pos);
+    bool seekEnd(int32_t offset = 0) {
+        return seekSet(_size + offset);
+    }
+    bool seekCur(int32_t offset) {
+        return seekSet(_pos + offset);
+    }
+    uint32_t curPosition() const {
+        return _pos;
+    }
+    uint32_t fileSize() const {
+        return _size;
+    }
+
+    bool truncate(uint32_t length);
+    bool truncate() {
+        return truncate(_pos);
+    }
+    bool preAllocate(uint32_t length);
+    bool contiguousRange(uint32_t *bgnSector, uint32_t *endSector);
+    bool isContiguous() const {
+        return _firstSector != 0;
+    }
+    uint32_t firstSector() const {
+        return _firstSector;
+    }
+
+    bool remove();
+    bool rename(const char *newPath);
+    size_t getName(char *name, size_t size);
+
+    bool timestamp(uint8_t flags, uint16_t year, uint8_t month, uint8_t day,
+                   uint8_t hour, uint8_t minute, uint8_t second);
+
+   private:
+    void _program();
+
+    FILE *_fp = nullptr;
+    uint32_t _cacheSector = 0;  // Dirty cached sector + 1 (0: clean)
+    char _path[192] = {0};
+    uint32_t _pos = 0;
+    uint32_t _size = 0;
+    uint32_t _firstSector = 0;
+    bool _append = false;
+};
+
+/// SdFile: a FatFile with Arduino Print support
+class SdFile : public FatFile, public Print {
+   public:
+    size_t write(uint8_t b) override {
+        return FatFile::write(&b, 1);
+    }
+    size_t write(const uint8_t *buf, size_t count) override {
+        return FatFile::write(buf, count);
+    }
+    size_t write(const char *str) {
+        return FatFile::write(str, strlen(str));
+    }
+    size_t write(const void *buf, size_t count) {
+        return FatFile::write(buf, count);
+    }
+    void flush() override {
+        FatFile::sync();
+    }
+    using Print::print;
+    using Print::println;
+};
+
+typedef SdFile File32;
+
+class SdFat {
+   public:
+    bool begin(const SdSpiConfig &config);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *oldPath, const char *newPath);
+    SdCard *card() {
+        return &_card;
+    }
+    uint8_t sdErrorCode() {
+        return _card.errorCode();
+    }
+    uint32_t sdErrorData() {
+        return _card.errorData();
+    }
+    uint32_t freeClusterCount();
+    uint8_t sectorsPerCluster() {
+        return 64;
+    }
+
+   private:
+    SdCard _card;
+};
+
+typedef SdFat SdFat32;
+
+void printSdErrorSymbol(Print *pr, uint8_t code);
+
+#endif  // !__SIM_SDFAT_H__
@@ -0,0 +1,34 @@
+/**
+ * @file    interrupt.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for <avr/interrupt.h>. ISR() defines a plain function
+ * that the simulated peripherals call directly; cli()/sei() toggle a global
+ * interrupt-enable flag checked before dispatching.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_AVR_INTERRUPT_H__
+#define __SIM_AVR_INTERRUPT_H__
+
+extern volatile bool sim_globalInterrupts;
+
+#define cli() (sim_globalInterrupts = false)
+#define sei() (sim_globalInterrupts = true)
+
+#define ISR(vector, ...) void vector(void)
+
+#endif  // !__SIM_AVR_INTERRUPT_H__
@@ -0,0 +1,293 @@
+/**
+ * @file    io.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for the ATmega4809 peripheral registers used by the
+ * firmware. Registers are plain memory except for a few strobes (ADC0.COMMAND
+ * and the write-one-to-clear ADC0.INTFLAGS) that drive the simulated ADC in
+ * sim.cpp, and RTC.CNT, which follows the simulated clock. Bit masks and group
+ * configurations mirror iom4809.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_AVR_IO_H__
+#define __SIM_AVR_IO_H__
+
+#include <stdint.h>
+
+typedef volatile uint8_t register8_t;
+typedef volatile uint16_t register16_t;
+
+// Flat I/O space for code that addresses registers by absolute address
+extern uint8_t sim_io[0x1000];
+#define _SFR_MEM8(addr) (*(volatile uint8_t *)(sim_io + (addr)))
+
+/** --------------------------------------------------------------------------
+ * ADC0
+ * -------------------------------------------------------------------------- */
+
+void sim_adcCommand(uint8_t value);
+void sim_adcClearFlags(uint8_t mask);
+
+/// Strobe register: writing STCONV starts a simulated conversion
+struct SimAdcCommand {
+    volatile uint8_t value;
+    SimAdcCommand &operator=(uint8_t v) {
+        value = v;
+        sim_adcCommand(v);
+        return *this;
+    }
+    operator uint8_t() const {
+        return value;
+    }
+};
+
+/// Write-one-to-clear interrupt flags
+struct SimAdcIntFlags {
+    volatile uint8_t value;
+    SimAdcIntFlags &operator=(uint8_t v) {
+        sim_adcClearFlags(v);
+        return *this;
+    }
+    operator uint8_t() const {
+        return value;
+    }
+};
+
+typedef struct ADC_struct {
+    register8_t CTRLA;
+    register8_t CTRLB;
+    register8_t CTRLC;
+    register8_t CTRLD;
+    register8_t CTRLE;
+    register8_t SAMPCTRL;
+    register8_t MUXPOS;
+    SimAdcCommand COMMAND;
+    register8_t EVCTRL;
+    register8_t INTCTRL;
+    SimAdcIntFlags INTFLAGS;
+    register8_t DBGCTRL;
+    register8_t TEMP;
+    register16_t RES;
+    register16_t WINLT;
+    register16_t WINHT;
+    register8_t CALIB;
+} ADC_t;
+
+extern ADC_t ADC0;
+
+#define ADC_ENABLE_bm  0x01
+#define ADC_FREERUN_bm 0x02
+#define ADC_RESSEL_bm  0x04
+#define ADC_RUNSTBY_bm 0x80
+
+#define ADC_SAMPNUM_gm       0x07
+#define ADC_SAMPNUM_ACC1_gc  (0x00 << 0)
+#define ADC_SAMPNUM_ACC2_gc  (0x01 << 0)
+#define ADC_SAMPNUM_ACC4_gc  (0x02 << 0)
+#define ADC_SAMPNUM_ACC8_gc  (0x03 << 0)
+#define ADC_SAMPNUM_ACC16_gc (0x04 << 0)
+#define ADC_SAMPNUM_ACC32_gc (0x05 << 0)
+#define ADC_SAMPNUM_ACC64_gc (0x06 << 0)
+
+#define ADC_PRESC_gm        0x07
+#define ADC_PRESC_DIV2_gc   (0x00 << 0)
+#define ADC_PRESC_DIV4_gc   (0x01 << 0)
+#define ADC_PRESC_DIV8_gc   (0x02 << 0)
+#define ADC_PRESC_DIV16_gc  (0x03 << 0)
+#define ADC_PRESC_DIV32_gc  (0x04 << 0)
+#define ADC_PRESC_DIV64_gc  (0x05 << 0)
+#define ADC_PRESC_DIV128_gc (0x06 << 0)
+#define ADC_PRESC_DIV256_gc (0x07 << 0)
+#define ADC_REFSEL_gm       0x30
+#define ADC_REFSEL_INTREF_gc (0x00 << 4)
+#define ADC_REFSEL_VDDREF_gc (0x01 << 4)
+#define ADC_REFSEL_VREFA_gc  (0x02 << 4)
+#define ADC_SAMPCAP_bm       0x40
+
+#define ADC_SAMPDLY_gm       0x0F
+#define ADC_ASDV_bm          0x10
+#define ADC_INITDLY_gm       0xE0
+#define ADC_INITDLY_DLY0_gc  (0x00 << 5)
+#define ADC_INITDLY_DLY16_gc (0x01 << 5)
+#define ADC_INITDLY_DLY32_gc (0x02 << 5)
+#define ADC_INITDLY_DLY64_gc (0x03 << 5)
+
+#define ADC_WINCM_gm         0x07
+#define ADC_WINCM_NONE_gc    (0x00 << 0)
+#define ADC_WINCM_BELOW_gc   (0x01 << 0)
+#define ADC_WINCM_ABOVE_gc   (0x02 << 0)
+#define ADC_WINCM_INSIDE_gc  (0x03 << 0)
+#define ADC_WINCM_OUTSIDE_gc (0x04 << 0)
+
+#define ADC_SAMPLEN_gm 0x1F
+
+#define ADC_MUXPOS_gm          0x1F
+#define ADC_MUXPOS_AIN0_gc     (0x00 << 0)
+#define ADC_MUXPOS_DACREF_gc   (0x1C << 0)
+#define ADC_MUXPOS_TEMPSENSE_gc (0x1E << 0)
+#define ADC_MUXPOS_GND_gc      (0x1F << 0)
+
+#define ADC_STCONV_bm 0x01
+
+#define ADC_RESRDY_bm 0x01
+#define ADC_WCMP_bm   0x02
+
+/** --------------------------------------------------------------------------
+ * VREF and the AC0 DAC reference (an ADC input only, see sim_adc.cpp)
+ * -------------------------------------------------------------------------- */
+
+typedef struct VREF_struct {
+    register8_t CTRLA;
+    register8_t CTRLB;
+} VREF_t;
+
+extern VREF_t VREF;
+
+#define VREF_AC0REFSEL_gm     0x07
+#define VREF_AC0REFSEL_0V55_gc (0x00 << 0)
+#define VREF_AC0REFSEL_1V1_gc  (0x01 << 0)
+#define VREF_AC0REFSEL_2V5_gc  (0x02 << 0)
+#define VREF_AC0REFSEL_4V34_gc (0x03 << 0)
+#define VREF_AC0REFSEL_1V5_gc  (0x04 << 0)
+
+#define VREF_AC0REFEN_bm  0x01
+#define VREF_ADC0REFEN_bm 0x02
+
+typedef struct AC_struct {
+    register8_t CTRLA;
+    register8_t reserved_1;
+    register8_t MUXCTRLA;
+    register8_t reserved_2;
+    register8_t DACREF;
+    register8_t reserved_3;
+    register8_t INTCTRL;
+    register8_t STATUS;
+} AC_t;
+
+extern AC_t AC0;
+
+/** --------------------------------------------------------------------------
+ * TCB (periodic interrupt mode only, see sim_tcb.cpp)
+ * -------------------------------------------------------------------------- */
+
+typedef struct TCB_struct {
+    register8_t CTRLA;
+    register8_t CTRLB;
+    register8_t EVCTRL;
+    register8_t INTCTRL;
+    register8_t INTFLAGS;
+    register8_t STATUS;
+    register8_t DBGCTRL;
+    register8_t TEMP;
+    register16_t CNT;
+    register16_t CCMP;
+} TCB_t;
+
+extern TCB_t TCB2;
+
+#define TCB_ENABLE_bm          0x01
+#define TCB_CLKSEL_gm          0x06
+#define TCB_CLKSEL_CLKDIV1_gc  (0x00 << 1)
+#define TCB_CLKSEL_CLKDIV2_gc  (0x01 << 1)
+#define TCB_CLKSEL_CLKTCA_gc   (0x02 << 1)
+#define TCB_CNTMODE_gm         0x07
+#define TCB_CNTMODE_INT_gc     (0x00 << 0)
+#define TCB_CAPT_bm            0x01
+
+/** --------------------------------------------------------------------------
+ * RTC (counter with overflow and compare, see sim_rtc_cnt.cpp)
+ * -------------------------------------------------------------------------- */
+
+uint16_t sim_rtcCntRead(void);
+void sim_rtcCntWrite(uint16_t value);
+void sim_rtcCntClearFlags(uint8_t mask);
+
+/// Counter that follows the simulated 32.768 kHz clock
+struct SimRtcCount {
+    SimRtcCount &operator=(uint16_t v) {
+        sim_rtcCntWrite(v);
+        return *this;
+    }
+    operator uint16_t() const {
+        return sim_rtcCntRead();
+    }
+};
+
+/// Write-one-to-clear interrupt flags
+struct SimRtcIntFlags {
+    volatile uint8_t value;
+    SimRtcIntFlags &operator=(uint8_t v) {
+        sim_rtcCntClearFlags(v);
+        return *this;
+    }
+    operator uint8_t() const {
+        return value;
+    }
+};
+
+typedef struct RTC_struct {
+    register8_t CTRLA;
+    register8_t STATUS;
+    register8_t INTCTRL;
+    SimRtcIntFlags INTFLAGS;
+    register8_t TEMP;
+    register8_t DBGCTRL;
+    register8_t reserved_1;
+    register8_t CLKSEL;
+    SimRtcCount CNT;
+    register16_t PER;
+    register16_t CMP;
+} RTC_t;
+
+extern RTC_t RTC;
+
+#define RTC_RTCEN_bm            0x01
+#define RTC_PRESCALER_gm        0x78
+#define RTC_PRESCALER_DIV1_gc   (0x00 << 3)
+#define RTC_RUNSTDBY_bm         0x80
+#define RTC_CTRLABUSY_bm        0x01
+#define RTC_CNTBUSY_bm          0x02
+#define RTC_PERBUSY_bm          0x04
+#define RTC_CMPBUSY_bm          0x08
+#define RTC_OVF_bm              0x01
+#define RTC_CMP_bm              0x02
+#define RTC_CLKSEL_gm           0x03
+#define RTC_CLKSEL_INT32K_gc    (0x00 << 0)
+#define RTC_CLKSEL_INT1K_gc     (0x01 << 0)
+#define RTC_CLKSEL_TOSC32K_gc   (0x02 << 0)
+#define RTC_CLKSEL_EXTCLK_gc    (0x03 << 0)
+
+/** --------------------------------------------------------------------------
+ * PORT
+ * -------------------------------------------------------------------------- */
+
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+#define PORT_ISC_gm                0x07
+#define PORT_ISC_INPUT_DISABLE_gc  (0x04 << 0)
+#define PORT_PULLUPEN_bm           0x08
+
+#define PORTD_DIRCLR _SFR_MEM8(0x0462)
+
+#endif  // !__SIM_AVR_IO_H__
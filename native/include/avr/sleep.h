@@ -0,0 +1,49 @@
+/**
+ * @file    sleep.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host stand-in for <avr/sleep.h>. sleep_cpu() jumps the simulated
+ * clock to the next hardware event, whose interrupt wakes the CPU up.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_AVR_SLEEP_H__
+#define __SIM_AVR_SLEEP_H__
+
+#include <stdint.h>
+
+// SLPCTRL.CTRLA sleep modes
+#define SLEEP_MODE_IDLE     (0x00 << 1)
+#define SLEEP_MODE_STANDBY  (0x01 << 1)
+#define SLEEP_MODE_PWR_DOWN (0x02 << 1)
+
+extern uint8_t sim_sleepCtrl;
+
+/// Sleep until the next interrupt if sleep is enabled
+void sim_sleepCpu(void);
+
+#define set_sleep_mode(mode) (sim_sleepCtrl = (sim_sleepCtrl & 0x01) | (mode))
+#define sleep_enable()        (sim_sleepCtrl |= 0x01)
+#define sleep_disable()       (sim_sleepCtrl &= ~0x01)
+#define sleep_cpu()           sim_sleepCpu()
+#define sleep_mode()     \
+    do {                 \
+        sleep_enable();  \
+        sleep_cpu();     \
+        sleep_disable(); \
+    } while (0)
+
+#endif  // !__SIM_AVR_SLEEP_H__
@@ -0,0 +1,125 @@
+/**
+ * @file    sim.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Control interface of the host simulation that stands in for the
+ * Nano Every hardware. It owns the simulated clock and the models behind the
+ * register/library stand-ins (hall sensors, DS3231, DS18B20 bus, SD card).
+ *
+ * Time never advances on its own: the firmware consumes it through delay(),
+ * peripheral cost models and sleep, and sim_idle() jumps straight to the next
+ * pending hardware event, so long deployments run in seconds.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdint.h>
+
+/** --------------------------------------------------------------------------
+ * Clock and events
+ * -------------------------------------------------------------------------- */
+
+/// Simulated time since power-on in microseconds
+uint64_t sim_micros(void);
+
+/// Consume CPU time (busy work): advances the clock and fires due events
+void sim_advance(uint64_t us);
+
+/// Sleep until the next hardware event (or `max_us`) and fire it
+void sim_idle(uint64_t max_us = 1000000ULL);
+
+/// Microseconds spent asleep in sim_idle() since power-on
+uint64_t sim_sleptMicros(void);
+
+/// Dispatch the interrupt attached to a pin on a matching edge
+void sim_pinDrive(uint8_t pin, uint8_t level);
+
+/// Pin output level as last written by the firmware
+uint8_t sim_pinLevel(uint8_t pin);
+
+/// Time of the last output level change on a pin
+uint64_t sim_pinChangedAt(uint8_t pin);
+
+/** --------------------------------------------------------------------------
+ * Hall sensors (ADC0)
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @brief Signal model: returns the voltage on analog input `ain` at time `us`
+ * as a fraction of AREF scaled to 0..65535 (before ADC noise/quantisation).
+ * The sensors are ratiometric, so a sagging AREF (sim_adcSetAref) scales
+ * their output with it and the readings stay the same.
+ */
+typedef uint16_t (*SimHallModel)(uint8_t ain, uint64_t us);
+void sim_hallSetModel(SimHallModel model);
+
+/// Pins powering the two sensor groups (sensor outputs float when low)
+void sim_hallSetPowerPins(uint8_t group0_pin, uint8_t group1_pin);
+
+/// ADC conversions started since power-on
+uint32_t sim_adcConversions(void);
+
+/// AREF rail voltage in millivolts seen by the simulated ADC (default 3300)
+void sim_adcSetAref(uint16_t mv);
+
+/** --------------------------------------------------------------------------
+ * DS3231 and DS18B20
+ * -------------------------------------------------------------------------- */
+
+/// Set the RTC date/time (seconds since 1970) and its oscillator-stop flag
+void sim_rtcSet(uint32_t unixtime, bool lost_power);
+
+/// Error of the ATmega4809 32.768 kHz oscillator clocking RTC.CNT, in parts
+/// per million (positive runs fast)
+void sim_osc32kSetError(int32_t ppm);
+
+/// Temperature model in centi-degrees Celsius for probe `index`
+typedef int16_t (*SimTempModel)(uint8_t index, uint64_t us);
+void sim_tempSetModel(SimTempModel model);
+
+/// Number of DS18B20 probes on the simulated 1-Wire bus (0 to 8)
+void sim_tempSetProbes(uint8_t count);
+
+/// Number of 1-Wire resets issued since power-on
+uint32_t sim_oneWireResets(void);
+
+/** --------------------------------------------------------------------------
+ * Serial and EEPROM
+ * -------------------------------------------------------------------------- */
+
+/// Queue text as if typed on the serial monitor
+void sim_serialInject(const char *text);
+
+/// Silence the USB serial echo on stdout
+void sim_serialMute(bool mute);
+
+/// Load/save the EEPROM image from/to a host file (missing file = erased)
+bool sim_eepromLoad(const char *path);
+bool sim_eepromSave(const char *path);
+
+/** --------------------------------------------------------------------------
+ * SD card
+ * -------------------------------------------------------------------------- */
+
+/// Host directory that stands for the card's root directory
+void sim_sdSetRoot(const char *path);
+
+/// Make card initialization fail, as with no card inserted
+void sim_sdSetPresent(bool present);
+
+#endif  // !__SIM_H__
@@ -0,0 +1,353 @@
+/**
+ * @file    arduino.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host implementation of the Arduino core subset: digital pins,
+ * timing, external interrupts, Print formatting and the USB Serial port.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <ctype.h>
+
+#include "sim_internal.h"
+
+// Serial line at 115200 baud, 10 bits per character
+#define SIM_SERIAL_US_PER_BYTE 87
+
+volatile bool sim_globalInterrupts = true;
+uint8_t sim_io[0x1000];
+
+static uint8_t _pinLevel[NUM_DIGITAL_PINS];
+static uint8_t _pinInput[NUM_DIGITAL_PINS];
+static void (*_pinHandler[NUM_DIGITAL_PINS])(void);
+static int _pinMode[NUM_DIGITAL_PINS];
+static uint64_t _pinChanged[NUM_DIGITAL_PINS];
+
+/** --------------------------------------------------------------------------
+ * Digital I/O and interrupts
+ * -------------------------------------------------------------------------- */
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < NUM_DIGITAL_PINS && mode == INPUT_PULLUP) {
+        _pinInput[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < NUM_DIGITAL_PINS) {
+        uint8_t _level = val ? HIGH : LOW;
+        if (_level != _pinLevel[pin]) _pinChanged[pin] = sim_micros();
+        _pinLevel[pin] = _level;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= NUM_DIGITAL_PINS) return LOW;
+    // Outputs read back their latch, inputs the level driven by a device
+    return _pinHandler[pin] || _pinInput[pin] ? _pinInput[pin]
+                                              : _pinLevel[pin];
+}
+
+int analogRead(uint8_t pin) {
+    (void)pin;
+    return 0;
+}
+
+uint8_t sim_pinLevel(uint8_t pin) {
+    return pin < NUM_DIGITAL_PINS ? _pinLevel[pin] : LOW;
+}
+
+uint64_t sim_pinChangedAt(uint8_t pin) {
+    return pin < NUM_DIGITAL_PINS ? _pinChanged[pin] : 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    if (pin < NUM_DIGITAL_PINS) {
+        _pinHandler[pin] = handler;
+        _pinMode[pin] = mode;
+    }
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < NUM_DIGITAL_PINS) {
+        _pinHandler[pin] = nullptr;
+    }
+}
+
+void sim_pinDrive(uint8_t pin, uint8_t level) {
+    if (pin >= NUM_DIGITAL_PINS) return;
+    uint8_t _old = _pinInput[pin];
+    _pinInput[pin] = level;
+    if (!_pinHandler[pin] || !sim_globalInterrupts || _old == level) return;
+
+    bool _edge = (_pinMode[pin] == CHANGE) ||
+                 (_pinMode[pin] == FALLING && level == LOW) ||
+                 (_pinMode[pin] == RISING && level == HIGH);
+    if (_edge) {
+        _pinHandler[pin]();
+    }
+}
+
+/** --------------------------------------------------------------------------
+ * Time
+ * -------------------------------------------------------------------------- */
+
+unsigned long millis(void) {
+    return (unsigned long)(sim_micros() / 1000ULL);
+}
+
+unsigned long micros(void) {
+    return (unsigned long)sim_micros();
+}
+
+void delay(unsigned long ms) {
+    sim_advance((uint64_t)ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim_advance(us);
+}
+
+/** --------------------------------------------------------------------------
+ * Sleep
+ * -------------------------------------------------------------------------- */
+
+uint8_t sim_sleepCtrl = 0;
+
+void sim_sleepCpu(void) {
+    if (!(sim_sleepCtrl & 0x01)) return;
+    // The core's millis() timer (TCB) wakes the CPU up every millisecond
+    sim_idle(1000);
+}
+
+/** --------------------------------------------------------------------------
+ * avr-libc string helpers
+ * -------------------------------------------------------------------------- */
+
+char *ultoa(unsigned long value, char *str, int base) {
+    char _tmp[33];
+    uint8_t _n = 0;
+    do {
+        uint8_t _d = value % base;
+        _tmp[_n++] = _d < 10 ? '0' + _d : 'a' + _d - 10;
+        value /= base;
+    } while (value);
+    for (uint8_t _i = 0; _i < _n; ++_i) {
+        str[_i] = _tmp[_n - 1 - _i];
+    }
+    str[_n] = '\0';
+    return str;
+}
+
+char *ltoa(long value, char *str, int base) {
+    if (value < 0 && base == 10) {
+        str[0] = '-';
+        ultoa((unsigned long)(-value), str + 1, base);
+        return str;
+    }
+    return ultoa((unsigned long)value, str, base);
+}
+
+char *itoa(int value, char *str, int base) {
+    return ltoa(value, str, base);
+}
+
+char *utoa(unsigned int value, char *str, int base) {
+    return ultoa(value, str, base);
+}
+
+char *strupr(char *str) {
+    for (char *_p = str; *_p; ++_p) {
+        *_p = toupper((unsigned char)*_p);
+    }
+    return str;
+}
+
+/** --------------------------------------------------------------------------
+ * Print
+ * -------------------------------------------------------------------------- */
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t _n = 0;
+    while (size--) {
+        if (write(*buffer++))
+            _n++;
+        else
+            break;
+    }
+    return _n;
+}
+
+size_t Print::print(const __FlashStringHelper *s) {
+    return write(reinterpret_cast<const char *>(s));
+}
+size_t Print::print(const char s[]) {
+    return write(s);
+}
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+size_t Print::print(unsigned char n, int base) {
+    return print((unsigned long)n, base);
+}
+size_t Print::print(int n, int base) {
+    return print((long)n, base);
+}
+size_t Print::print(unsigned int n, int base) {
+    return print((unsigned long)n, base);
+}
+size_t Print::print(long n, int base) {
+    if (base == 10 && n < 0) {
+        size_t _t = print('-');
+        return _t + printNumber((unsigned long)(-n), 10);
+    }
+    return printNumber((unsigned long)n, base);
+}
+size_t Print::print(unsigned long n, int base) {
+    return printNumber(n, base);
+}
+size_t Print::print(double n, int digits) {
+    return printFloat(n, digits);
+}
+
+size_t Print::println(void) {
+    return write("\r\n");
+}
+size_t Print::println(const __FlashStringHelper *s) {
+    return print(s) + println();
+}
+size_t Print::println(const char s[]) {
+    return print(s) + println();
+}
+size_t Print::println(char c) {
+    return print(c) + println();
+}
+size_t Print::println(unsigned char n, int base) {
+    return print(n, base) + println();
+}
+size_t Print::println(int n, int base) {
+    return print(n, base) + println();
+}
+size_t Print::println(unsigned int n, int base) {
+    return print(n, base) + println();
+}
+size_t Print::println(long n, int base) {
+    return print(n, base) + println();
+}
+size_t Print::println(unsigned long n, int base) {
+    return print(n, base) + println();
+}
+size_t Print::println(double n, int digits) {
+    return print(n, digits) + println();
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+    char _buf[33];
+    if (base < 2) base = 10;
+    ultoa(n, _buf, base);
+    for (char *_p = _buf; *_p; ++_p) *_p = toupper((unsigned char)*_p);
+    return write(_buf);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+    // Same algorithm as the Arduino core, including its rounding
+    if (isnan(number)) return print("nan");
+    if (isinf(number)) return print("inf");
+    if (number > 4294967040.0 || number < -4294967040.0) return print("ovf");
+
+    size_t _n = 0;
+    if (number < 0.0) {
+        _n += print('-');
+        number = -number;
+    }
+    double _rounding = 0.5;
+    for (uint8_t _i = 0; _i < digits; ++_i) _rounding /= 10.0;
+    number += _rounding;
+
+    unsigned long _int = (unsigned long)number;
+    double _rem = number - (double)_int;
+    _n += print(_int);
+    if (digits > 0) _n += print('.');
+    while (digits-- > 0) {
+        _rem *= 10.0;
+        unsigned int _d = (unsigned int)_rem;
+        _n += print(_d);
+        _rem -= _d;
+    }
+    return _n;
+}
+
+/** --------------------------------------------------------------------------
+ * Serial
+ * -------------------------------------------------------------------------- */
+
+HardwareSerial Serial;
+
+static char _rxBuffer[256];
+static uint16_t _rxHead = 0, _rxTail = 0;
+static uint64_t _txBusyUntil = 0;  // When the UART finishes shifting out
+static bool _txMute = false;
+
+void sim_serialInject(const char *text) {
+    while (*text) {
+        uint16_t _next = (_rxHead + 1) % sizeof(_rxBuffer);
+        if (_next == _rxTail) break;  // Buffer full, drop like the real UART
+        _rxBuffer[_rxHead] = *text++;
+        _rxHead = _next;
+    }
+}
+
+void sim_serialMute(bool mute) {
+    _txMute = mute;
+}
+
+int HardwareSerial::available() {
+    return (_rxHead - _rxTail + sizeof(_rxBuffer)) % sizeof(_rxBuffer);
+}
+
+int HardwareSerial::peek() {
+    return _rxHead == _rxTail ? -1 : (uint8_t)_rxBuffer[_rxTail];
+}
+
+int HardwareSerial::read() {
+    if (_rxHead == _rxTail) return -1;
+    uint8_t _c = _rxBuffer[_rxTail];
+    _rxTail = (_rxTail + 1) % sizeof(_rxBuffer);
+    return _c;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (!_txMute) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    uint64_t _now = sim_micros();
+    if (_txBusyUntil < _now) _txBusyUntil = _now;
+    _txBusyUntil += (uint64_t)size * SIM_SERIAL_US_PER_BYTE;
+    return size;
+}
+
+void HardwareSerial::flush() {
+    // Wait for the UART to shift out everything queued so far
+    uint64_t _now = sim_micros();
+    if (_txBusyUntil > _now) sim_advance(_txBusyUntil - _now);
+    if (!_txMute) fflush(stdout);
+}
@@ -0,0 +1,300 @@
+/**
+ * @file    sim.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Simulated clock, event dispatch and the host entry point. main()
+ * runs the unmodified firmware setup() and loop() against the stand-ins for a
+ * number of simulated seconds and prints a summary of where time went.
+ *
+ * Usage: bhd_sim [-s seconds] [-d YYYY-MM-DD HH:MM:SS] [-r sdroot]
+ *                [-e eeprom.bin] [-c command]... [-p probes] [-k ppm]
+ *                [-v]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <RTClib.h>
+#include <SdFat.h>
+#include <time.h>
+
+#include <chrono>
+
+#include "sim_internal.h"
+
+#define SIM_MAX_DEVICES 8
+
+// CPU time of a pass of loop() that finds nothing to do
+#define SIM_LOOP_PASS_US 10
+
+uint8_t sim_eeprom[E2END + 1];
+
+static uint64_t _now = 0;
+static uint64_t _slept = 0;
+static uint64_t _setupEnd = SIM_NEVER;  // End of the run while in setup()
+static const char *_eepromPath = nullptr;
+static const SimDevice *_devices[SIM_MAX_DEVICES];
+static uint8_t _deviceCount = 0;
+
+/** --------------------------------------------------------------------------
+ * Clock and events
+ * -------------------------------------------------------------------------- */
+
+void sim_registerDevice(const SimDevice *device) {
+    if (_deviceCount < SIM_MAX_DEVICES) {
+        _devices[_deviceCount++] = device;
+    }
+}
+
+uint64_t sim_micros(void) {
+    return _now;
+}
+
+/**
+ * @brief Earliest pending event among all devices
+ *
+ * @param[out] device   Device owning that event (nullptr if none)
+ */
+static uint64_t _nextEvent(const SimDevice **device) {
+    uint64_t _t = SIM_NEVER;
+    *device = nullptr;
+    for (uint8_t _i = 0; _i < _deviceCount; ++_i) {
+        uint64_t _n = _devices[_i]->next();
+        if (_n < _t) {
+            _t = _n;
+            *device = _devices[_i];
+        }
+    }
+    return _t;
+}
+
+/**
+ * @brief Move the clock to `target`, firing every event due on the way in
+ * chronological order
+ */
+static void _runUntil(uint64_t target) {
+    const SimDevice *_dev;
+    uint64_t _t;
+    while ((_t = _nextEvent(&_dev)) <= target) {
+        if (_t > _now) _now = _t;
+        _dev->fire(_now);
+    }
+    if (target > _now) _now = target;
+
+    // setup() waiting forever, e.g. for SETDT after an RTC power loss
+    if (_now >= _setupEnd) {
+        Serial.flush();
+        if (_eepromPath) sim_eepromSave(_eepromPath);
+        fprintf(stderr, "setup() did not finish within the run time\n");
+        exit(1);
+    }
+}
+
+void sim_advance(uint64_t us) {
+    _runUntil(_now + us);
+}
+
+void sim_idle(uint64_t max_us) {
+    const SimDevice *_dev;
+    uint64_t _t = _nextEvent(&_dev);
+    uint64_t _target = _now + max_us;
+    if (_t < _target) _target = _t > _now ? _t : _now;
+
+    _slept += _target - _now;
+    _runUntil(_target);
+}
+
+uint64_t sim_sleptMicros(void) {
+    return _slept;
+}
+
+/** --------------------------------------------------------------------------
+ * EEPROM image
+ * -------------------------------------------------------------------------- */
+
+bool sim_eepromLoad(const char *path) {
+    memset(sim_eeprom, 0xFF, sizeof(sim_eeprom));
+    FILE *_f = fopen(path, "rb");
+    if (!_f) return false;
+    size_t _n = fread(sim_eeprom, 1, sizeof(sim_eeprom), _f);
+    fclose(_f);
+    return _n == sizeof(sim_eeprom);
+}
+
+bool sim_eepromSave(const char *path) {
+    FILE *_f = fopen(path, "wb");
+    if (!_f) return false;
+    size_t _n = fwrite(sim_eeprom, 1, sizeof(sim_eeprom), _f);
+    fclose(_f);
+    return _n == sizeof(sim_eeprom);
+}
+
+/** --------------------------------------------------------------------------
+ * Entry point
+ * -------------------------------------------------------------------------- */
+
+static void _usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-s seconds] [-d 'YYYY-MM-DD HH:MM:SS'] [-r sdroot]\n"
+            "          [-e eeprom.bin] [-c command]... [-p probes] [-k ppm]\n"
+            "          [-v]\n"
+            "  -s  simulated run time in seconds (default 60)\n"
+            "  -d  RTC date/time at power-on (default: RTC lost power)\n"
+            "  -r  host directory used as SD card root (default ./sdcard)\n"
+            "  -e  EEPROM image, loaded at start and saved at exit\n"
+            "  -c  serial command sent after power-on, or '@T command' at second T\n"
+            "      ('@T !fail N' makes the next N card writes fail,\n"
+            "      '@T !aref MV' sets the AREF rail to MV millivolts)\n"
+            "  -p  number of DS18B20 probes on the bus (default 1)\n"
+            "  -k  error of the internal 32.768 kHz oscillator in ppm\n"
+            "  -v  echo the firmware's serial output\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    uint64_t _seconds = 60;
+    bool _verbose = false;
+    uint32_t _rtcTime = 0;
+    struct {
+        uint64_t at;
+        const char *cmd;
+    } _timed[16];
+    uint8_t _timedCount = 0;
+
+    memset(sim_eeprom, 0xFF, sizeof(sim_eeprom));
+
+    for (int _i = 1; _i < argc; ++_i) {
+        const char *_a = argv[_i];
+        const char *_v = (_i + 1 < argc) ? argv[_i + 1] : nullptr;
+        if (!strcmp(_a, "-v")) {
+            _verbose = true;
+            continue;
+        }
+        if (!_v || _a[0] != '-' || _a[2] != '\0') {
+            _usage(argv[0]);
+            return 2;
+        }
+        ++_i;
+        switch (_a[1]) {
+            case 's':
+                _seconds = strtoull(_v, nullptr, 10);
+                break;
+            case 'd': {
+                struct tm _tm = {};
+                if (!strptime(_v, "%Y-%m-%d %H:%M:%S", &_tm)) {
+                    _usage(argv[0]);
+                    return 2;
+                }
+                _rtcTime = DateTime(_tm.tm_year + 1900, _tm.tm_mon + 1,
+                                    _tm.tm_mday, _tm.tm_hour, _tm.tm_min,
+                                    _tm.tm_sec)
+                               .unixtime();
+                break;
+            }
+            case 'r':
+                sim_sdSetRoot(_v);
+                break;
+            case 'e':
+                _eepromPath = _v;
+                sim_eepromLoad(_v);
+                break;
+            case 'c':
+                if (_v[0] == '@' && _timedCount < 16) {  // "@T command"
+                    char *_rest;
+                    _timed[_timedCount].at = strtoull(_v + 1, &_rest, 10);
+                    _timed[_timedCount].cmd = _rest + (*_rest == ' ');
+                    ++_timedCount;
+                } else {
+                    sim_serialInject(_v);
+                    sim_serialInject("\n");
+                }
+                break;
+            case 'p':
+                sim_tempSetProbes((uint8_t)atoi(_v));
+                break;
+            case 'k':
+                sim_osc32kSetError(atol(_v));
+                break;
+            default:
+                _usage(argv[0]);
+                return 2;
+        }
+    }
+
+    sim_serialMute(!_verbose);
+    sim_rtcInit();
+    sim_adcInit();
+    sim_tcbInit();
+    sim_rtcCntInit();
+    if (_rtcTime) {
+        sim_rtcSet(_rtcTime, false);
+    }
+
+    auto _wall0 = std::chrono::steady_clock::now();
+
+    _setupEnd = _seconds * 1000000ULL;
+    setup();
+    _setupEnd = SIM_NEVER;
+    uint64_t _start = sim_micros(), _slept0 = sim_sleptMicros();
+    uint64_t _end = _start + _seconds * 1000000ULL;
+    while (sim_micros() < _end) {
+        // Timed commands arrive before the next pass, at most a millisecond
+        // late (the core's millis() tick wakes a sleeping firmware)
+        for (uint8_t _t = 0; _t < _timedCount; ++_t) {
+            uint64_t _at = _start + _timed[_t].at * 1000000ULL;
+            if (_timed[_t].cmd && _at <= sim_micros()) {
+                if (!strncmp(_timed[_t].cmd, "!fail ", 6)) {  // Card fault
+                    sim_sd.failNextWrites = atoi(_timed[_t].cmd + 6);
+                } else if (!strncmp(_timed[_t].cmd, "!aref ", 6)) {  // Sag
+                    sim_adcSetAref(atoi(_timed[_t].cmd + 6));
+                } else {
+                    sim_serialInject(_timed[_t].cmd);
+                    sim_serialInject("\n");
+                }
+                _timed[_t].cmd = nullptr;
+            }
+        }
+        // Only the firmware's own sleep counts as asleep: each pass of
+        // loop() costs at least SIM_LOOP_PASS_US awake, so a loop that
+        // polls instead of sleeping shows as awake time
+        loop();
+        sim_advance(SIM_LOOP_PASS_US);
+    }
+    Serial.flush();
+
+    auto _wall1 = std::chrono::steady_clock::now();
+    double _wall =
+        std::chrono::duration<double>(_wall1 - _wall0).count();
+    uint64_t _run = sim_micros() - _start;
+    uint64_t _awake = _run - (sim_sleptMicros() - _slept0);
+
+    if (_eepromPath) sim_eepromSave(_eepromPath);
+
+    fprintf(stderr,
+            "simulated %.1f s in %.3f s wall (%.0fx)\n"
+            "awake time     : %.3f s (%.2f %%)\n"
+            "adc conversions: %u\n"
+            "i2c transfers  : %u\n"
+            "1-wire resets  : %u\n"
+            "sd opens/syncs : %u / %u\n"
+            "sd sectors     : %u written, %u bytes through files\n",
+            _run / 1e6, _wall, _wall > 0 ? (_run / 1e6) / _wall : 0.0,
+            _awake / 1e6, _run ? 100.0 * _awake / _run : 0.0,
+            sim_adcConversions(), sim_i2cTransactions, sim_oneWireResets(),
+            sim_sd.opens, sim_sd.syncs, sim_sd.sectorWrites,
+            sim_sd.bytesWritten);
+    return 0;
+}
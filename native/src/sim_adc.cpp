@@ -0,0 +1,197 @@
+/**
+ * @file    sim_adc.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Simulated ADC0 and hall sensor front-end. A conversion samples the
+ * signal model for the selected input, adds ~0.7 LSB of noise per sample,
+ * accumulates SAMPNUM samples and raises RESRDY (and WCMP) after the time the
+ * real ADC would take with the current prescaler and sample length.
+ *
+ * With RESRDY interrupts disabled the conversion is charged as busy CPU time,
+ * which is what a polling loop costs. With them enabled it completes as a
+ * timed event that wakes the CPU and calls ADC0_RESRDY_vect.
+ *
+ * Sensor outputs settle exponentially after their group's sleep pin goes
+ * high and read near ground while asleep. They are ratiometric and follow
+ * AREF, so their readings do not change when AREF sags. The AC0 DAC reference
+ * (the 1.1 V reference scaled by AC0.DACREF, only while VREF.CTRLB AC0REFEN
+ * is set) does not, and reads higher.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#include "sim_internal.h"
+
+// Weak so that firmware without interrupt-driven conversions still links
+void ADC0_RESRDY_vect(void) __attribute__((weak));
+void ADC0_WCOMP_vect(void) __attribute__((weak));
+
+ADC_t ADC0;
+VREF_t VREF;
+AC_t AC0;
+
+// Sensor power pins (HALL_SLEEP_GROUP0/1) and settling time constants
+static uint8_t _groupPin[2] = {8, 7};
+static const uint16_t _settleTauUs[2] = {120, 90};
+
+static SimHallModel _model = nullptr;
+static uint32_t _conversions = 0;
+static uint64_t _doneAt = SIM_NEVER;
+static uint16_t _pendingRes = 0;
+static uint16_t _arefMv = 3300;
+static uint32_t _rng = 0x12345678;
+
+void sim_hallSetModel(SimHallModel model) {
+    _model = model;
+}
+
+void sim_hallSetPowerPins(uint8_t group0_pin, uint8_t group1_pin) {
+    _groupPin[0] = group0_pin;
+    _groupPin[1] = group1_pin;
+}
+
+uint32_t sim_adcConversions(void) {
+    return _conversions;
+}
+
+void sim_adcSetAref(uint16_t mv) {
+    _arefMv = mv;
+}
+
+/**
+ * @brief Default signal: each valve idles at a different gape with a slow
+ * drift and closes briefly every few minutes
+ */
+static uint16_t _defaultModel(uint8_t ain, uint64_t us) {
+    double _t = us / 1e6;
+    double _v = 0.30 + 0.06 * ain + 0.01 * sin(_t / (600.0 + 37.0 * ain));
+    if (fmod(_t + 41.0 * ain, 300.0) < 4.0) _v -= 0.08;  // Valve snap
+    return (uint16_t)(_v * 65535.0);
+}
+
+/// Cheap Gaussian-ish noise (sum of uniforms), in LSB
+static double _noise(void) {
+    double _s = 0;
+    for (uint8_t _i = 0; _i < 4; ++_i) {
+        _rng = _rng * 1664525u + 1013904223u;
+        _s += (_rng >> 8) / 16777216.0;
+    }
+    return (_s - 2.0) * 1.2;
+}
+
+/// Sensor group powering an analog input (AIN1-3: group 0, AIN0,4,5: group 1)
+static int8_t _groupOf(uint8_t ain) {
+    if (ain >= 1 && ain <= 3) return 0;
+    if (ain == 0 || ain == 4 || ain == 5) return 1;
+    return -1;
+}
+
+/// AC0 DAC reference in millivolts (0 while the reference is off)
+static double _dacrefMv(void) {
+    static const double _refMv[8] = {550, 1100, 2500, 4340, 1500, 0, 0, 0};
+    if (!(VREF.CTRLB & VREF_AC0REFEN_bm)) return 0.0;
+    return _refMv[VREF.CTRLA & VREF_AC0REFSEL_gm] * AC0.DACREF / 256.0;
+}
+
+/// Input voltage as a fraction of AREF
+static double _input(uint8_t mux, uint64_t us) {
+    if (mux == ADC_MUXPOS_GND_gc) return 0.0;
+    if (mux == ADC_MUXPOS_DACREF_gc) return _dacrefMv() / _arefMv;
+    int8_t _g = _groupOf(mux);
+    if (_g < 0) return 0.0;
+    if (!sim_pinLevel(_groupPin[_g])) return 0.002;  // Asleep
+
+    double _v = (_model ? _model : _defaultModel)(mux, us) / 65535.0;
+    double _on = (double)(us - sim_pinChangedAt(_groupPin[_g]));
+    return _v * (1.0 - exp(-_on / _settleTauUs[_g]));
+}
+
+/// Conversion time of one (accumulated) result in microseconds
+static uint64_t _conversionTime(void) {
+    uint8_t _samples = 1 << (ADC0.CTRLB & ADC_SAMPNUM_gm);
+    uint16_t _presc = 2 << (ADC0.CTRLC & ADC_PRESC_gm);
+    uint16_t _cycles = 13 + (ADC0.SAMPCTRL & ADC_SAMPLEN_gm);
+    return ((uint64_t)_samples * _cycles * _presc * 1000000ULL) / F_CPU + 1;
+}
+
+static void _complete(void) {
+    ADC0.RES = _pendingRes;
+    ADC0.INTFLAGS.value |= ADC_RESRDY_bm;
+
+    uint8_t _mode = ADC0.CTRLE & ADC_WINCM_gm;
+    uint16_t _r = _pendingRes;
+    bool _hit = (_mode == ADC_WINCM_BELOW_gc && _r < ADC0.WINLT) ||
+                (_mode == ADC_WINCM_ABOVE_gc && _r > ADC0.WINHT) ||
+                (_mode == ADC_WINCM_INSIDE_gc && _r >= ADC0.WINLT &&
+                 _r <= ADC0.WINHT) ||
+                (_mode == ADC_WINCM_OUTSIDE_gc &&
+                 (_r < ADC0.WINLT || _r > ADC0.WINHT));
+    if (_hit) ADC0.INTFLAGS.value |= ADC_WCMP_bm;
+
+    if (!sim_globalInterrupts) return;
+    if ((ADC0.INTCTRL & ADC_WCMP_bm) && _hit && ADC0_WCOMP_vect) {
+        ADC0_WCOMP_vect();
+    }
+    if ((ADC0.INTCTRL & ADC_RESRDY_bm) && ADC0_RESRDY_vect) {
+        ADC0_RESRDY_vect();
+    }
+}
+
+void sim_adcCommand(uint8_t value) {
+    if (!(value & ADC_STCONV_bm) || !(ADC0.CTRLA & ADC_ENABLE_bm)) return;
+    ++_conversions;
+
+    uint8_t _mux = ADC0.MUXPOS & ADC_MUXPOS_gm;
+    uint8_t _samples = 1 << (ADC0.CTRLB & ADC_SAMPNUM_gm);
+    double _full = (ADC0.CTRLA & ADC_RESSEL_bm) ? 255.0 : 1023.0;
+    uint64_t _dt = _conversionTime();
+
+    uint32_t _acc = 0;
+    for (uint8_t _i = 0; _i < _samples; ++_i) {
+        double _x = _input(_mux, sim_micros() + (_dt * _i) / _samples);
+        double _c = _x * _full + _noise();
+        _acc += _c < 0 ? 0 : (_c > _full ? (uint32_t)_full : (uint32_t)_c);
+    }
+    _pendingRes = (uint16_t)_acc;
+
+    if (ADC0.INTCTRL & (ADC_RESRDY_bm | ADC_WCMP_bm)) {
+        _doneAt = sim_micros() + _dt;  // Completes in the background
+    } else {
+        sim_advance(_dt);  // Caller is polling INTFLAGS
+        _complete();
+    }
+}
+
+void sim_adcClearFlags(uint8_t mask) {
+    ADC0.INTFLAGS.value &= ~mask;
+}
+
+static uint64_t _adcNext(void) {
+    return _doneAt;
+}
+
+static void _adcFire(uint64_t now) {
+    (void)now;
+    _doneAt = SIM_NEVER;
+    _complete();
+}
+
+static const SimDevice _adcDevice = {_adcNext, _adcFire};
+
+void sim_adcInit(void) {
+    sim_registerDevice(&_adcDevice);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file    sim_internal.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Glue shared by the simulated devices: timed event sources and the
+ * interrupt dispatcher.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_INTERNAL_H__
+#define __SIM_INTERNAL_H__
+
+#include <stdint.h>
+
+#include "sim.h"
+
+#define SIM_NEVER UINT64_MAX
+
+/**
+ * @brief A simulated device with timed events. `next` returns the absolute
+ * time of its next event (SIM_NEVER if none) and `fire` handles it.
+ */
+struct SimDevice {
+    uint64_t (*next)(void);
+    void (*fire)(uint64_t now);
+};
+
+void sim_registerDevice(const SimDevice *device);
+
+void sim_rtcInit(void);
+void sim_adcInit(void);
+void sim_tcbInit(void);
+void sim_rtcCntInit(void);
+
+#endif  // !__SIM_INTERNAL_H__
@@ -0,0 +1,423 @@
+/**
+ * @file    sim_onewire.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Simulated 1-Wire bus with DS18B20 probes, plus the
+ * DallasTemperature subset built on it. Bus timing follows the standard speed
+ * slots (~70 us per bit, ~1 ms per reset) so blocking reads cost what they do
+ * on the device. The temperature register only takes a new value when its
+ * conversion is over, as on the device.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <DallasTemperature.h>
+
+#include "sim_internal.h"
+
+#define SIM_OW_MAX_PROBES 8
+#define SIM_OW_US_PER_BIT 70
+#define SIM_OW_US_RESET   960
+
+/// 1-Wire transaction state after the last reset
+enum SimOwState { OW_IDLE, OW_ROM, OW_MATCH, OW_FUNCTION, OW_READ, OW_WRITE };
+
+struct SimProbe {
+    uint8_t rom[8];
+    uint8_t config;  // Resolution bits R1:R0 in bits 6:5
+    uint8_t th, tl;
+    uint64_t convertDoneAt;
+    int16_t raw;   // Temperature register, 1/16 degC
+    int16_t next;  // Result of the conversion in progress
+};
+
+static SimProbe _probes[SIM_OW_MAX_PROBES];
+static uint8_t _probeCount = 1;
+static bool _selected[SIM_OW_MAX_PROBES];
+static SimOwState _state = OW_IDLE;
+static uint8_t _matchBuf[8], _matchLen = 0;
+static uint8_t _readBuf[9], _readPos = 0, _readLen = 0;
+static uint8_t _writeBuf[3], _writeLen = 0;
+static uint32_t _resets = 0;
+static SimTempModel _tempModel = nullptr;
+static bool _probesBuilt = false;
+
+static int16_t _defaultTemp(uint8_t index, uint64_t us) {
+    double _t = us / 1e6;
+    return (int16_t)(1850 + 150 * sin(_t / 13751.0) - 40 * index);
+}
+
+static void _buildProbes(void) {
+    for (uint8_t _i = 0; _i < SIM_OW_MAX_PROBES; ++_i) {
+        SimProbe &_p = _probes[_i];
+        _p.rom[0] = DS18B20MODEL;
+        for (uint8_t _b = 1; _b < 7; ++_b) _p.rom[_b] = 0x10 * _i + _b;
+        _p.rom[7] = OneWire::crc8(_p.rom, 7);
+        _p.config = 0x7F;  // 12-bit power-on default
+        _p.th = 0x4B;
+        _p.tl = 0x46;
+        _p.convertDoneAt = 0;
+        _p.raw = 0x0550;  // 85 degC power-on value
+        _p.next = _p.raw;
+    }
+    _probesBuilt = true;
+}
+
+void sim_tempSetModel(SimTempModel model) {
+    _tempModel = model;
+}
+
+void sim_tempSetProbes(uint8_t count) {
+    _probeCount = count > SIM_OW_MAX_PROBES ? SIM_OW_MAX_PROBES : count;
+}
+
+uint32_t sim_oneWireResets(void) {
+    return _resets;
+}
+
+static uint16_t _convTimeMs(uint8_t config) {
+    return 750 >> (3 - ((config >> 5) & 0x03));
+}
+
+static void _slot(uint16_t bits) {
+    sim_advance((uint64_t)bits * SIM_OW_US_PER_BIT);
+}
+
+/// Temperature register once conversion is over, quantised to resolution
+static int16_t _sample(uint8_t index) {
+    SimProbe &_p = _probes[index];
+    int32_t _cC = (_tempModel ? _tempModel : _defaultTemp)(index, sim_micros());
+    int16_t _raw = (int16_t)((_cC * 16L) / 100L);
+    uint8_t _drop = 3 - ((_p.config >> 5) & 0x03);
+    return _raw & ~((1 << _drop) - 1);
+}
+
+static void _function(uint8_t cmd) {
+    switch (cmd) {
+        case 0x44:  // Convert T
+            for (uint8_t _i = 0; _i < _probeCount; ++_i) {
+                if (!_selected[_i]) continue;
+                _probes[_i].convertDoneAt =
+                    sim_micros() + _convTimeMs(_probes[_i].config) * 1000ULL;
+                _probes[_i].next = _sample(_i);
+            }
+            _state = OW_READ;  // Read slots now poll conversion status
+            _readLen = 0;
+            break;
+        case 0xBE:  // Read Scratchpad
+            memset(_readBuf, 0xFF, 9);  // Pulled-up bus if nobody matched
+            for (uint8_t _i = 0; _i < _probeCount; ++_i) {
+                if (!_selected[_i]) continue;
+                SimProbe &_p = _probes[_i];
+                if (sim_micros() >= _p.convertDoneAt) _p.raw = _p.next;
+                _readBuf[0] = _p.raw & 0xFF;
+                _readBuf[1] = (_p.raw >> 8) & 0xFF;
+                _readBuf[2] = _p.th;
+                _readBuf[3] = _p.tl;
+                _readBuf[4] = _p.config;
+                _readBuf[5] = 0xFF;
+                _readBuf[6] = 0x0C;
+                _readBuf[7] = 0x10;
+                _readBuf[8] = OneWire::crc8(_readBuf, 8);
+                break;
+            }
+            _readPos = 0;
+            _readLen = 9;
+            _state = OW_READ;
+            break;
+        case 0x4E:  // Write Scratchpad
+            _writeLen = 0;
+            _state = OW_WRITE;
+            break;
+        default:
+            _state = OW_IDLE;
+            break;
+    }
+}
+
+uint8_t OneWire::reset(void) {
+    if (!_probesBuilt) _buildProbes();
+    ++_resets;
+    sim_advance(SIM_OW_US_RESET);
+    _state = OW_ROM;
+    return _probeCount > 0;
+}
+
+void OneWire::skip(void) {
+    write(0xCC);
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+    write(0x55);
+    for (uint8_t _i = 0; _i < 8; ++_i) write(rom[_i]);
+}
+
+void OneWire::write(uint8_t v, uint8_t power) {
+    (void)power;
+    _slot(8);
+    switch (_state) {
+        case OW_ROM:
+            if (v == 0xCC) {
+                for (uint8_t _i = 0; _i < SIM_OW_MAX_PROBES; ++_i)
+                    _selected[_i] = _i < _probeCount;
+                _state = OW_FUNCTION;
+            } else if (v == 0x55) {
+                _matchLen = 0;
+                _state = OW_MATCH;
+            } else {
+                _state = OW_IDLE;
+            }
+            break;
+        case OW_MATCH:
+            _matchBuf[_matchLen++] = v;
+            if (_matchLen == 8) {
+                for (uint8_t _i = 0; _i < SIM_OW_MAX_PROBES; ++_i) {
+                    _selected[_i] = _i < _probeCount &&
+                                    !memcmp(_probes[_i].rom, _matchBuf, 8);
+                }
+                _state = OW_FUNCTION;
+            }
+            break;
+        case OW_FUNCTION:
+            _function(v);
+            break;
+        case OW_WRITE:
+            _writeBuf[_writeLen++] = v;
+            if (_writeLen == 3) {
+                for (uint8_t _i = 0; _i < _probeCount; ++_i) {
+                    if (!_selected[_i]) continue;
+                    _probes[_i].th = _writeBuf[0];
+                    _probes[_i].tl = _writeBuf[1];
+                    _probes[_i].config = (_writeBuf[2] & 0x60) | 0x1F;
+                }
+                _state = OW_IDLE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power) {
+    for (uint16_t _i = 0; _i < count; ++_i) write(buf[_i], power);
+}
+
+uint8_t OneWire::read_bit(void) {
+    _slot(1);
+    if (_state != OW_READ || _readLen) return 1;
+    // Status polling after Convert T: 0 while any selected probe is busy
+    for (uint8_t _i = 0; _i < _probeCount; ++_i) {
+        if (_selected[_i] && sim_micros() < _probes[_i].convertDoneAt)
+            return 0;
+    }
+    return 1;
+}
+
+uint8_t OneWire::read(void) {
+    if (_state == OW_READ && _readLen) {
+        _slot(8);
+        return _readPos < _readLen ? _readBuf[_readPos++] : 0xFF;
+    }
+    uint8_t _v = 0;
+    for (uint8_t _i = 0; _i < 8; ++_i) _v |= read_bit() << _i;
+    return _v;
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count) {
+    for (uint16_t _i = 0; _i < count; ++_i) buf[_i] = read();
+}
+
+void OneWire::write_bit(uint8_t v) {
+    (void)v;
+    _slot(1);
+}
+
+void OneWire::reset_search() {
+    _searchIndex = 0;
+}
+
+void OneWire::target_search(uint8_t family_code) {
+    (void)family_code;
+    _searchIndex = 0;
+}
+
+bool OneWire::search(uint8_t *newAddr, bool search_mode) {
+    (void)search_mode;
+    if (!_probesBuilt) _buildProbes();
+    ++_resets;
+    // A ROM search costs a reset plus 64 triplets of 3 slots
+    sim_advance(SIM_OW_US_RESET + 8 * SIM_OW_US_PER_BIT +
+                64 * 3 * SIM_OW_US_PER_BIT);
+    if (_searchIndex >= _probeCount) return false;
+    memcpy(newAddr, _probes[_searchIndex++].rom, 8);
+    return true;
+}
+
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len) {
+    uint8_t _crc = 0;
+    while (len--) {
+        uint8_t _in = *addr++;
+        for (uint8_t _i = 8; _i; _i--) {
+            uint8_t _mix = (_crc ^ _in) & 0x01;
+            _crc >>= 1;
+            if (_mix) _crc ^= 0x8C;
+            _in >>= 1;
+        }
+    }
+    return _crc;
+}
+
+/** --------------------------------------------------------------------------
+ * DallasTemperature
+ * -------------------------------------------------------------------------- */
+
+void DallasTemperature::begin(void) {
+    DeviceAddress _addr;
+    _devices = 0;
+    _wire->reset_search();
+    while (_wire->search(_addr)) {
+        if (OneWire::crc8(_addr, 7) != _addr[7]) continue;
+        ScratchPad _sp;
+        if (readScratchPad(_addr, _sp)) {
+            uint8_t _res = 9 + ((_sp[4] >> 5) & 0x03);
+            if (_res > _bitResolution) _bitResolution = _res;
+        }
+        ++_devices;
+    }
+}
+
+bool DallasTemperature::getAddress(uint8_t *deviceAddress, uint8_t index) {
+    uint8_t _depth = 0;
+    _wire->reset_search();
+    while (_depth <= index && _wire->search(deviceAddress)) {
+        if (_depth == index && OneWire::crc8(deviceAddress, 7) ==
+                                   deviceAddress[7]) {
+            return true;
+        }
+        ++_depth;
+    }
+    return false;
+}
+
+bool DallasTemperature::readScratchPad(const uint8_t *deviceAddress,
+                                       uint8_t *scratchPad) {
+    if (!_wire->reset()) return false;
+    _wire->select(deviceAddress);
+    _wire->write(0xBE);
+    for (uint8_t _i = 0; _i < 9; ++_i) scratchPad[_i] = _wire->read();
+    return _wire->reset() == 1;
+}
+
+bool DallasTemperature::isConnected(const uint8_t *deviceAddress) {
+    ScratchPad _sp;
+    return isConnected(deviceAddress, _sp);
+}
+
+bool DallasTemperature::isConnected(const uint8_t *deviceAddress,
+                                    uint8_t *scratchPad) {
+    bool _ok = readScratchPad(deviceAddress, scratchPad);
+    return _ok && OneWire::crc8(scratchPad, 8) == scratchPad[8];
+}
+
+void DallasTemperature::setResolution(uint8_t newResolution) {
+    _bitResolution = newResolution < 9 ? 9 : (newResolution > 12 ? 12 : newResolution);
+    DeviceAddress _addr;
+    for (uint8_t _i = 0; _i < _devices; ++_i) {
+        if (getAddress(_addr, _i)) setResolution(_addr, _bitResolution, true);
+    }
+}
+
+bool DallasTemperature::setResolution(const uint8_t *deviceAddress,
+                                      uint8_t newResolution,
+                                      bool skipGlobalBitResolutionCalculation) {
+    (void)skipGlobalBitResolutionCalculation;
+    ScratchPad _sp;
+    if (!isConnected(deviceAddress, _sp)) return false;
+    uint8_t _cfg = ((newResolution - 9) & 0x03) << 5 | 0x1F;
+    _wire->reset();
+    _wire->select(deviceAddress);
+    _wire->write(0x4E);
+    _wire->write(_sp[2]);
+    _wire->write(_sp[3]);
+    _wire->write(_cfg);
+    _wire->reset();
+    return true;
+}
+
+uint16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution) {
+    switch (bitResolution) {
+        case 9:
+            return 94;
+        case 10:
+            return 188;
+        case 11:
+            return 375;
+        default:
+            return 750;
+    }
+}
+
+bool DallasTemperature::isConversionComplete(void) {
+    return _wire->read_bit() == 1;
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperatures(void) {
+    request_t _req = {true, millis()};
+    _wire->reset();
+    _wire->skip();
+    _wire->write(0x44);
+    if (_waitForConversion) {
+        delay(millisToWaitForConversion(_bitResolution));
+    }
+    return _req;
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperaturesByAddress(
+    const uint8_t *deviceAddress) {
+    request_t _req = {true, millis()};
+    _wire->reset();
+    _wire->select(deviceAddress);
+    _wire->write(0x44);
+    if (_waitForConversion) {
+        delay(millisToWaitForConversion(_bitResolution));
+    }
+    return _req;
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperaturesByIndex(
+    uint8_t index) {
+    DeviceAddress _addr;
+    if (!getAddress(_addr, index)) return request_t{false, millis()};
+    return requestTemperaturesByAddress(_addr);
+}
+
+int32_t DallasTemperature::getTemp(const uint8_t *deviceAddress) {
+    ScratchPad _sp;
+    if (!isConnected(deviceAddress, _sp)) return DEVICE_DISCONNECTED_RAW;
+    // 1/128 degC units, like the library
+    return (((int16_t)_sp[1]) << 11) | (((int16_t)_sp[0]) << 3);
+}
+
+float DallasTemperature::getTempC(const uint8_t *deviceAddress) {
+    int32_t _raw = getTemp(deviceAddress);
+    if (_raw <= DEVICE_DISCONNECTED_RAW) return DEVICE_DISCONNECTED_C;
+    return (float)_raw * 0.0078125f;
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index) {
+    DeviceAddress _addr;
+    if (!getAddress(_addr, index)) return DEVICE_DISCONNECTED_C;
+    return getTempC(_addr);
+}
@@ -0,0 +1,303 @@
+/**
+ * @file    sim_rtc.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   RTClib DateTime/TimeSpan and a simulated DS3231 on the I2C bus. The
+ * INT/SQW output is wired to RTC_ALARM_PIN: in interrupt mode (INTCN=1) it is
+ * pulled low while an enabled alarm flag is set, otherwise it outputs the
+ * 1 Hz square wave with its falling edge on the seconds update.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <RTClib.h>
+
+#include "sim_internal.h"
+
+// DS3231 INT/SQW output is wired to D2 (RTC_ALARM_PIN)
+#define SIM_RTC_INT_PIN 2
+
+// Each register access on the 100 kHz I2C bus costs about this long
+#define SIM_I2C_US_PER_TRANSFER 250
+
+uint32_t sim_i2cTransactions = 0;
+
+/** --------------------------------------------------------------------------
+ * DateTime
+ * -------------------------------------------------------------------------- */
+
+static const uint8_t _daysInMonth[] = {31, 28, 31, 30, 31, 30,
+                                       31, 31, 30, 31, 30, 31};
+
+static uint16_t _date2days(uint16_t y, uint8_t m, uint8_t d) {
+    if (y >= 2000U) y -= 2000U;
+    uint16_t _days = d;
+    for (uint8_t _i = 1; _i < m; ++_i) _days += _daysInMonth[_i - 1];
+    if (m > 2 && y % 4 == 0) ++_days;
+    return _days + 365 * y + (y + 3) / 4 - 1;
+}
+
+DateTime::DateTime(uint32_t t) {
+    t -= SECONDS_FROM_1970_TO_2000;
+    ss = t % 60;
+    t /= 60;
+    mm = t % 60;
+    t /= 60;
+    hh = t % 24;
+    uint16_t _days = t / 24;
+    uint8_t _leap;
+    for (yOff = 0;; ++yOff) {
+        _leap = yOff % 4 == 0;
+        if (_days < 365U + _leap) break;
+        _days -= 365 + _leap;
+    }
+    for (m = 1; m < 12; ++m) {
+        uint8_t _dim = _daysInMonth[m - 1];
+        if (_leap && m == 2) ++_dim;
+        if (_days < _dim) break;
+        _days -= _dim;
+    }
+    d = _days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
+                   uint8_t min, uint8_t sec) {
+    if (year >= 2000U) year -= 2000U;
+    yOff = year;
+    m = month;
+    d = day;
+    hh = hour;
+    mm = min;
+    ss = sec;
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    uint16_t _day = _date2days(yOff, m, d);
+    return (_day + 6) % 7;  // Jan 1, 2000 is a Saturday
+}
+
+uint32_t DateTime::unixtime(void) const {
+    uint16_t _days = _date2days(yOff, m, d);
+    return ((uint32_t)_days * 24UL + hh) * 3600UL + mm * 60UL + ss +
+           SECONDS_FROM_1970_TO_2000;
+}
+
+bool DateTime::isValid() const {
+    if (yOff >= 100) return false;
+    DateTime _other(unixtime());
+    return yOff == _other.yOff && m == _other.m && d == _other.d &&
+           hh == _other.hh && mm == _other.mm && ss == _other.ss;
+}
+
+/// Only the "YYYY-MM-DD hh:mm:ss" layout used by the firmware is supported
+char *DateTime::toString(char *buffer) const {
+    char _tmp[32];
+    snprintf(_tmp, sizeof(_tmp), "%04u-%02u-%02u %02u:%02u:%02u", year(), m,
+             d, hh, mm, ss);
+    memcpy(buffer, _tmp, 19);
+    return buffer;
+}
+
+DateTime DateTime::operator+(const TimeSpan &span) const {
+    return DateTime(unixtime() + span.totalseconds());
+}
+
+DateTime DateTime::operator-(const TimeSpan &span) const {
+    return DateTime(unixtime() - span.totalseconds());
+}
+
+/** --------------------------------------------------------------------------
+ * DS3231
+ * -------------------------------------------------------------------------- */
+
+static struct {
+    uint64_t baseUs;     // Simulated time of the last adjust()
+    uint32_t baseTime;   // Unix time set at baseUs
+    bool osf;            // Oscillator stop flag
+    bool intcn;          // Interrupt control (true: alarms, false: SQW)
+    bool a1ie, a2ie;     // Alarm interrupt enables
+    bool a1f, a2f;       // Alarm flags
+    uint8_t a1mode;      // Ds3231Alarm1Mode mask
+    uint32_t a1time;     // Alarm 1 match value (unix time)
+    uint64_t sqwLowAt;   // Next SQW falling edge
+} _rtc = {0, SECONDS_FROM_1970_TO_2000, true, true, false, false,
+          false, false, 0, 0, SIM_NEVER};
+
+static void _i2c(uint8_t transfers) {
+    sim_i2cTransactions += transfers;
+    sim_advance((uint64_t)transfers * SIM_I2C_US_PER_TRANSFER);
+}
+
+static uint32_t _rtcNow(void) {
+    return _rtc.baseTime + (uint32_t)((sim_micros() - _rtc.baseUs) / 1000000ULL);
+}
+
+/// Start of the next RTC second
+static uint64_t _nextSecond(void) {
+    uint64_t _elapsed = sim_micros() - _rtc.baseUs;
+    return _rtc.baseUs + (_elapsed / 1000000ULL + 1) * 1000000ULL;
+}
+
+static void _updatePin(void) {
+    if (!_rtc.intcn) return;  // SQW edges are generated as events
+    bool _low = (_rtc.a1f && _rtc.a1ie) || (_rtc.a2f && _rtc.a2ie);
+    sim_pinDrive(SIM_RTC_INT_PIN, _low ? LOW : HIGH);
+}
+
+/// Whether alarm 1 matches at unix time `t` under the current mask
+static bool _a1Matches(uint32_t t) {
+    DateTime _n(t), _a(_rtc.a1time);
+    switch (_rtc.a1mode) {
+        case DS3231_A1_PerSecond:
+            return true;
+        case DS3231_A1_Second:
+            return _n.second() == _a.second();
+        case DS3231_A1_Minute:
+            return _n.second() == _a.second() && _n.minute() == _a.minute();
+        case DS3231_A1_Hour:
+            return _n.second() == _a.second() &&
+                   _n.minute() == _a.minute() && _n.hour() == _a.hour();
+        default:
+            return t == _rtc.a1time;
+    }
+}
+
+static uint64_t _rtcNext(void) {
+    uint64_t _t = _nextSecond();
+    if (!_rtc.intcn) return _t < _rtc.sqwLowAt ? _t : _rtc.sqwLowAt;
+    return _rtc.a1ie ? _t : SIM_NEVER;
+}
+
+static void _rtcFire(uint64_t now) {
+    if (!_rtc.intcn) {
+        // 1 Hz square wave: low for the first half of every second
+        uint64_t _phase = (now - _rtc.baseUs) % 1000000ULL;
+        sim_pinDrive(SIM_RTC_INT_PIN, _phase < 500000ULL ? LOW : HIGH);
+        _rtc.sqwLowAt = now + 500000ULL;
+        return;
+    }
+    if (_rtc.a1ie && _a1Matches(_rtcNow())) {
+        _rtc.a1f = true;
+        _updatePin();
+    }
+}
+
+static const SimDevice _rtcDevice = {_rtcNext, _rtcFire};
+
+void sim_rtcInit(void) {
+    sim_registerDevice(&_rtcDevice);
+    sim_pinDrive(SIM_RTC_INT_PIN, HIGH);  // Open drain with pull-up
+}
+
+void sim_rtcSet(uint32_t unixtime, bool lost_power) {
+    _rtc.baseUs = sim_micros();
+    _rtc.baseTime = unixtime;
+    _rtc.osf = lost_power;
+}
+
+bool RTC_DS3231::begin(void *wireInstance) {
+    (void)wireInstance;
+    _i2c(1);
+    return true;
+}
+
+void RTC_DS3231::adjust(const DateTime &dt) {
+    _i2c(3);
+    _rtc.baseUs = sim_micros();
+    _rtc.baseTime = dt.unixtime();
+    _rtc.osf = false;
+}
+
+bool RTC_DS3231::lostPower(void) {
+    _i2c(1);
+    return _rtc.osf;
+}
+
+DateTime RTC_DS3231::now() {
+    _i2c(1);
+    return DateTime(_rtcNow());
+}
+
+Ds3231SqwPinMode RTC_DS3231::readSqwPinMode() {
+    _i2c(1);
+    return _rtc.intcn ? DS3231_OFF : DS3231_SquareWave1Hz;
+}
+
+void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode) {
+    _i2c(2);
+    _rtc.intcn = (mode == DS3231_OFF);
+    if (_rtc.intcn) {
+        _rtc.sqwLowAt = SIM_NEVER;
+        _updatePin();
+    } else {
+        _rtc.sqwLowAt = _nextSecond();
+    }
+}
+
+bool RTC_DS3231::setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode) {
+    _i2c(1);
+    if (!_rtc.intcn) return false;
+    _i2c(2);
+    _rtc.a1time = dt.unixtime();
+    _rtc.a1mode = alarm_mode;
+    _rtc.a1ie = true;
+    _updatePin();
+    return true;
+}
+
+bool RTC_DS3231::setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode) {
+    (void)dt;
+    (void)alarm_mode;
+    _i2c(3);
+    _rtc.a2ie = true;
+    return _rtc.intcn;
+}
+
+void RTC_DS3231::disableAlarm(uint8_t alarm_num) {
+    _i2c(2);
+    if (alarm_num == 1) _rtc.a1ie = false;
+    if (alarm_num == 2) _rtc.a2ie = false;
+    _updatePin();
+}
+
+void RTC_DS3231::clearAlarm(uint8_t alarm_num) {
+    _i2c(2);
+    if (alarm_num == 1) _rtc.a1f = false;
+    if (alarm_num == 2) _rtc.a2f = false;
+    _updatePin();
+}
+
+bool RTC_DS3231::alarmFired(uint8_t alarm_num) {
+    _i2c(1);
+    return alarm_num == 1 ? _rtc.a1f : _rtc.a2f;
+}
+
+void RTC_DS3231::enable32K(void) {
+    _i2c(2);
+}
+
+void RTC_DS3231::disable32K(void) {
+    _i2c(2);
+}
+
+bool RTC_DS3231::isEnabled32K(void) {
+    _i2c(1);
+    return false;
+}
+
+float RTC_DS3231::getTemperature() {
+    _i2c(1);
+    return 20.0f;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file    sim_rtc_cnt.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Simulated ATmega4809 RTC counter (the PIT is not modelled). While
+ * enabled, CNT counts the 32.768 kHz clock, off by sim_osc32kSetError() parts
+ * per million, from 0 to PER and raises OVF on the wrap and CMP when it
+ * reaches CMP. RTC_CNT_vect is called for the enabled flags; a flag raised
+ * with interrupts off is delivered at the next event after they are back on.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "sim_internal.h"
+
+// Weak so that firmware without the internal timer still links
+void RTC_CNT_vect(void) __attribute__((weak));
+
+RTC_t RTC;
+
+static double _hz = 32768.0;
+static uint64_t _baseAt = SIM_NEVER;  // Time CNT was _baseCnt (never: off)
+static uint16_t _baseCnt = 0;
+static uint64_t _handled = 0;  // Ticks since _baseAt with events raised
+
+void sim_osc32kSetError(int32_t ppm) {
+    _hz = 32768.0 * (1.0 + ppm * 1e-6);
+}
+
+static bool _enabled(void) {
+    return RTC.CTRLA & RTC_RTCEN_bm;
+}
+
+/// Ticks counted since _baseAt
+static uint64_t _ticks(uint64_t now) {
+    if (_baseAt == SIM_NEVER || now < _baseAt) return 0;
+    // Tolerance so that _ticks(_tickAt(n)) is n despite rounding
+    return (uint64_t)((double)(now - _baseAt) * _hz / 1e6 + 1e-6);
+}
+
+/// Time the tick count reaches `ticks`
+static uint64_t _tickAt(uint64_t ticks) {
+    return _baseAt + (uint64_t)ceil((double)ticks * 1e6 / _hz);
+}
+
+/// Counter value after `ticks` ticks
+static uint16_t _value(uint64_t ticks) {
+    uint32_t _top = (uint32_t)RTC.PER + 1;
+    return (_baseCnt % _top + ticks) % _top;
+}
+
+/// First tick after `after` at which the counter becomes `value`
+static uint64_t _reach(uint64_t after, uint16_t value) {
+    uint32_t _top = (uint32_t)RTC.PER + 1;
+    uint16_t _from = _value(after);
+    uint32_t _d = ((uint32_t)value + _top - _from) % _top;
+    return after + (_d ? _d : _top);
+}
+
+uint16_t sim_rtcCntRead(void) {
+    if (!_enabled()) return _baseCnt;
+    return _value(_ticks(sim_micros()));
+}
+
+void sim_rtcCntWrite(uint16_t value) {
+    _baseCnt = value;
+    _baseAt = _enabled() ? sim_micros() : SIM_NEVER;
+    _handled = 0;
+}
+
+void sim_rtcCntClearFlags(uint8_t mask) {
+    RTC.INTFLAGS.value &= ~mask;
+}
+
+/// Enabled flags waiting for the interrupt
+static uint8_t _pending(void) {
+    return RTC.INTFLAGS.value & RTC.INTCTRL & (RTC_OVF_bm | RTC_CMP_bm);
+}
+
+static uint64_t _rtcNext(void) {
+    if (!_enabled()) {
+        if (_baseAt != SIM_NEVER) {  // Stopped: hold the count
+            _baseCnt = _value(_ticks(sim_micros()));
+            _baseAt = SIM_NEVER;
+        }
+        return SIM_NEVER;
+    }
+    if (_baseAt == SIM_NEVER) {  // Just started
+        _baseAt = sim_micros();
+        _handled = 0;
+    }
+    if (_pending() && sim_globalInterrupts && RTC_CNT_vect) {
+        return sim_micros();
+    }
+    uint64_t _next = SIM_NEVER;
+    if (RTC.INTCTRL & RTC_OVF_bm) {
+        _next = _tickAt(_reach(_handled, 0));
+    }
+    if (RTC.INTCTRL & RTC_CMP_bm) {
+        uint64_t _cmp = _tickAt(_reach(_handled, RTC.CMP));
+        if (_cmp < _next) _next = _cmp;
+    }
+    return _next;
+}
+
+static void _rtcFire(uint64_t now) {
+    uint64_t _t = _ticks(now);
+    if (_t > _handled) {
+        if (_reach(_handled, 0) <= _t) RTC.INTFLAGS.value |= RTC_OVF_bm;
+        if (_reach(_handled, RTC.CMP) <= _t) RTC.INTFLAGS.value |= RTC_CMP_bm;
+        _handled = _t;
+    }
+    if (_pending() && sim_globalInterrupts && RTC_CNT_vect) {
+        RTC_CNT_vect();
+    }
+}
+
+static const SimDevice _rtcDevice = {_rtcNext, _rtcFire};
+
+void sim_rtcCntInit(void) {
+    sim_registerDevice(&_rtcDevice);
+}
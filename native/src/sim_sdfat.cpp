@@ -0,0 +1,422 @@
+/**
+ * @file    sim_sdfat.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   SdFat stand-in backed by a host directory. The cost model is coarse
+ * but keeps the relative weights of a slow SPI card: a directory lookup per
+ * open/exists, a FAT and directory update per sync, and ~1 ms per 512-byte
+ * sector moved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <SdFat.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sim_internal.h"
+
+#define SIM_SD_US_LOOKUP 3000  // Directory scan (open, exists)
+#define SIM_SD_US_SYNC   4000  // Directory entry + FAT sector update
+#define SIM_SD_US_SECTOR 1100  // One 512-byte sector transfer and program
+#define SIM_SD_US_CMD    150   // Command overhead of a multi-sector write
+
+#define SIM_SD_MAX_EXTENTS 16
+
+SimSdCounters sim_sd;
+
+static char _root[128] = "sdcard";
+static bool _present = true;
+
+/// Virtual sector range of a pre-allocated host file
+struct SimExtent {
+    char path[192];
+    uint32_t first;
+    uint32_t count;
+};
+static SimExtent _extents[SIM_SD_MAX_EXTENTS];
+static uint32_t _nextSector = 0x2000;
+
+void sim_sdSetRoot(const char *path) {
+    strncpy(_root, path, sizeof(_root) - 1);
+}
+
+void sim_sdSetPresent(bool present) {
+    _present = present;
+}
+
+static void _hostPath(const char *path, char *out, size_t size) {
+    while (*path == '/') ++path;
+    snprintf(out, size, "%s/%s", _root, path);
+}
+
+/// Consume one injected failure, if any
+static bool _injectedFailure(SdCard *card) {
+    if (!sim_sd.failNextWrites) return false;
+    --sim_sd.failNextWrites;
+    card->setError(SD_CARD_ERROR_WRITE_TIMEOUT, 0);
+    return true;
+}
+
+static SdFat *_volume = nullptr;
+
+/** --------------------------------------------------------------------------
+ * SdFat / SdCard
+ * -------------------------------------------------------------------------- */
+
+bool SdFat::begin(const SdSpiConfig &config) {
+    (void)config;
+    _volume = this;
+    if (!_present) {
+        _card.setError(0x01, 0xFF);  // SD_CARD_ERROR_CMD0
+        return false;
+    }
+    mkdir(_root, 0755);
+    sim_advance(50000);
+    return true;
+}
+
+bool SdFat::exists(const char *path) {
+    ++sim_sd.exists;
+    sim_advance(SIM_SD_US_LOOKUP);
+    char _p[192];
+    _hostPath(path, _p, sizeof(_p));
+    return access(_p, F_OK) == 0;
+}
+
+bool SdFat::remove(const char *path) {
+    sim_advance(SIM_SD_US_LOOKUP + SIM_SD_US_SYNC);
+    char _p[192];
+    _hostPath(path, _p, sizeof(_p));
+    return ::remove(_p) == 0;
+}
+
+bool SdFat::rename(const char *oldPath, const char *newPath) {
+    sim_advance(2 * SIM_SD_US_LOOKUP + SIM_SD_US_SYNC);
+    char _a[192], _b[192];
+    _hostPath(oldPath, _a, sizeof(_a));
+    _hostPath(newPath, _b, sizeof(_b));
+    return ::rename(_a, _b) == 0;
+}
+
+uint32_t SdFat::freeClusterCount() {
+    return 100000;
+}
+
+bool SdCard::readCID(cid_t *cid) {
+    memset(cid, 0, sizeof(*cid));
+    return true;
+}
+
+bool SdCard::readCSD(csd_t *csd) {
+    memset(csd, 0, sizeof(*csd));
+    return true;
+}
+
+bool SdCard::readOCR(uint32_t *ocr) {
+    *ocr = 0xC0FF8000;
+    return true;
+}
+
+uint32_t SdCard::sectorCount() {
+    return 15523840;  // 8 GB
+}
+
+/// Map a virtual sector to a host file and byte offset
+static const SimExtent *_extentOf(uint32_t sector) {
+    for (uint8_t _i = 0; _i < SIM_SD_MAX_EXTENTS; ++_i) {
+        const SimExtent &_e = _extents[_i];
+        if (_e.count && sector >= _e.first && sector < _e.first + _e.count)
+            return &_e;
+    }
+    return nullptr;
+}
+
+bool SdCard::readSector(uint32_t sector, uint8_t *dst) {
+    return readSectors(sector, dst, 1);
+}
+
+bool SdCard::readSectors(uint32_t sector, uint8_t *dst, size_t ns) {
+    sim_advance(SIM_SD_US_CMD + ns * SIM_SD_US_SECTOR / 2);
+    for (size_t _i = 0; _i < ns; ++_i) {
+        uint8_t *_d = dst + 512 * _i;
+        memset(_d, 0, 512);
+        const SimExtent *_e = _extentOf(sector + _i);
+        if (!_e) continue;
+        FILE *_f = fopen(_e->path, "rb");
+        if (!_f) continue;
+        fseek(_f, (long)(sector + _i - _e->first) * 512, SEEK_SET);
+        size_t _n = fread(_d, 1, 512, _f);
+        (void)_n;
+        fclose(_f);
+    }
+    return true;
+}
+
+bool SdCard::writeSector(uint32_t sector, const uint8_t *src) {
+    return writeSectors(sector, src, 1);
+}
+
+bool SdCard::writeSectors(uint32_t sector, const uint8_t *src, size_t ns) {
+    sim_advance(SIM_SD_US_CMD + ns * SIM_SD_US_SECTOR);
+    if (_injectedFailure(this)) return false;
+    ++sim_sd.multiSectorWrites;
+    sim_sd.sectorWrites += ns;
+    for (size_t _i = 0; _i < ns; ++_i) {
+        const SimExtent *_e = _extentOf(sector + _i);
+        if (!_e) {
+            setError(SD_CARD_ERROR_WRITE_DATA, sector + _i);
+            return false;
+        }
+        FILE *_f = fopen(_e->path, "r+b");
+        if (!_f) return false;
+        fseek(_f, (long)(sector + _i - _e->first) * 512, SEEK_SET);
+        fwrite(src + 512 * _i, 1, 512, _f);
+        fclose(_f);
+    }
+    return true;
+}
+
+bool SdCard::erase(uint32_t firstSector, uint32_t lastSector) {
+    sim_advance(SIM_SD_US_SYNC);
+    static const uint8_t _zero[512] = {0};
+    for (uint32_t _s = firstSector; _s <= lastSector; ++_s) {
+        const SimExtent *_e = _extentOf(_s);
+        if (!_e) continue;
+        FILE *_f = fopen(_e->path, "r+b");
+        if (!_f) continue;
+        fseek(_f, (long)(_s - _e->first) * 512, SEEK_SET);
+        fwrite(_zero, 1, 512, _f);
+        fclose(_f);
+    }
+    return true;
+}
+
+void printSdErrorSymbol(Print *pr, uint8_t code) {
+    pr->print(F("SD_CARD_ERROR_"));
+    switch (code) {
+        case SD_CARD_ERROR_NONE:
+            pr->print(F("NONE"));
+            break;
+        case SD_CARD_ERROR_WRITE_DATA:
+            pr->print(F("WRITE_DATA"));
+            break;
+        case SD_CARD_ERROR_WRITE_TIMEOUT:
+            pr->print(F("WRITE_TIMEOUT"));
+            break;
+        default:
+            pr->print(F("UNKNOWN"));
+            break;
+    }
+}
+
+/** --------------------------------------------------------------------------
+ * FatFile
+ * -------------------------------------------------------------------------- */
+
+FatFile::~FatFile() {
+    if (_fp) fclose(_fp);
+}
+
+bool FatFile::open(const char *path, oflag_t oflag) {
+    if (_fp) return false;
+    ++sim_sd.opens;
+    sim_advance(SIM_SD_US_LOOKUP);
+
+    _hostPath(path, _path, sizeof(_path));
+    bool _exists = access(_path, F_OK) == 0;
+    if (!_exists && !(oflag & O_CREAT)) return false;
+    if (_exists && (oflag & O_CREAT) && (oflag & O_EXCL)) return false;
+
+    const char *_mode = "rb";
+    if ((oflag & O_ACCMODE) != O_RDONLY) {
+        _mode = (_exists && !(oflag & O_TRUNC)) ? "r+b" : "w+b";
+        if (!_exists) sim_advance(SIM_SD_US_SYNC);  // New directory entry
+    }
+    _fp = fopen(_path, _mode);
+    if (!_fp) return false;
+
+    fseek(_fp, 0, SEEK_END);
+    _size = (uint32_t)ftell(_fp);
+    _append = oflag & O_APPEND;
+    _pos = (oflag & O_AT_END) ? _size : 0;
+    _firstSector = 0;
+    for (uint8_t _i = 0; _i < SIM_SD_MAX_EXTENTS; ++_i) {
+        if (_extents[_i].count && !strcmp(_extents[_i].path, _path))
+            _firstSector = _extents[_i].first;
+    }
+    return true;
+}
+
+bool FatFile::close() {
+    if (!_fp) return false;
+    ++sim_sd.closes;
+    bool _ok = sync();
+    fclose(_fp);
+    _fp = nullptr;
+    return _ok;
+}
+
+bool FatFile::sync() {
+    if (!_fp) return false;
+    ++sim_sd.syncs;
+    _program();
+    sim_advance(SIM_SD_US_SYNC);
+    return fflush(_fp) == 0;
+}
+
+int FatFile::read() {
+    uint8_t _b;
+    return read(&_b, 1) == 1 ? _b : -1;
+}
+
+int FatFile::read(void *buf, size_t count) {
+    if (!_fp) return -1;
+    sim_advance((count + 511) / 512 * SIM_SD_US_SECTOR / 2);
+    fseek(_fp, _pos, SEEK_SET);
+    size_t _n = fread(buf, 1, count, _fp);
+    _pos += _n;
+    return (int)_n;
+}
+
+size_t FatFile::write(const void *buf, size_t count) {
+    if (!_fp) return 0;
+    ++sim_sd.fileWrites;
+    uint32_t _from = _append ? _size : _pos;
+    sim_advance(20 + count / 8);  // SPI-free copy into the sector cache
+    if (_volume && _injectedFailure(_volume->card())) return 0;
+
+    // Like SdFat's single sector cache: leaving a dirty sector programs it,
+    // whole aligned sectors bypass the cache
+    uint32_t _end = _from + count;
+    for (uint32_t _s = _from / 512; _s * 512 < _end; ++_s) {
+        bool _whole = _s * 512 >= _from && (_s + 1) * 512 <= _end;
+        if (_whole) {
+            _program();
+            sim_advance(SIM_SD_US_SECTOR);
+            ++sim_sd.sectorWrites;
+        } else if (_s + 1 != _cacheSector) {
+            _program();
+            _cacheSector = _s + 1;
+        }
+    }
+
+    fseek(_fp, _from, SEEK_SET);
+    size_t _n = fwrite(buf, 1, count, _fp);
+    _pos = _from + _n;
+    if (_pos > _size) _size = _pos;
+    sim_sd.bytesWritten += _n;
+    return _n;
+}
+
+void FatFile::_program() {
+    if (!_cacheSector) return;
+    _cacheSector = 0;
+    sim_advance(SIM_SD_US_SECTOR);
+    ++sim_sd.sectorWrites;
+}
+
+bool FatFile::seekSet(uint32_t pos) {
+    if (!_fp || pos > _size) return false;
+    _pos = pos;
+    return true;
+}
+
+bool FatFile::truncate(uint32_t length) {
+    if (!_fp || length > _size) return false;
+    sim_advance(SIM_SD_US_SYNC);
+    fflush(_fp);
+    if (ftruncate(fileno(_fp), length) != 0) return false;
+    _size = length;
+    if (_pos > _size) _pos = _size;
+    for (uint8_t _i = 0; _i < SIM_SD_MAX_EXTENTS; ++_i) {
+        SimExtent &_e = _extents[_i];
+        if (_e.count && !strcmp(_e.path, _path)) {
+            _e.count = (length + 511) / 512;
+        }
+    }
+    return true;
+}
+
+bool FatFile::preAllocate(uint32_t length) {
+    if (!_fp || _size || !length) return false;
+    for (uint8_t _i = 0; _i < SIM_SD_MAX_EXTENTS; ++_i) {
+        SimExtent &_e = _extents[_i];
+        if (_e.count) continue;
+        snprintf(_e.path, sizeof(_e.path), "%s", _path);
+        _e.first = _nextSector;
+        _e.count = (length + 511) / 512;
+        _nextSector += _e.count + 64;
+        _firstSector = _e.first;
+
+        // Allocating the chain writes one FAT sector per 128 clusters
+        sim_advance(SIM_SD_US_SYNC * (1 + _e.count / (64 * 128)));
+        fflush(_fp);
+        if (ftruncate(fileno(_fp), length) != 0) return false;
+        _size = length;
+        return true;
+    }
+    return false;
+}
+
+bool FatFile::contiguousRange(uint32_t *bgnSector, uint32_t *endSector) {
+    for (uint8_t _i = 0; _i < SIM_SD_MAX_EXTENTS; ++_i) {
+        const SimExtent &_e = _extents[_i];
+        if (_e.count && !strcmp(_e.path, _path)) {
+            if (bgnSector) *bgnSector = _e.first;
+            if (endSector) *endSector = _e.first + _e.count - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FatFile::remove() {
+    if (!_fp) return false;
+    fclose(_fp);
+    _fp = nullptr;
+    sim_advance(SIM_SD_US_SYNC);
+    return ::remove(_path) == 0;
+}
+
+bool FatFile::rename(const char *newPath) {
+    char _p[192];
+    _hostPath(newPath, _p, sizeof(_p));
+    if (::rename(_path, _p) != 0) return false;
+    snprintf(_path, sizeof(_path), "%s", _p);
+    return true;
+}
+
+size_t FatFile::getName(char *name, size_t size) {
+    const char *_base = strrchr(_path, '/');
+    _base = _base ? _base + 1 : _path;
+    strncpy(name, _base, size);
+    name[size - 1] = '\0';
+    return strlen(name);
+}
+
+bool FatFile::timestamp(uint8_t flags, uint16_t year, uint8_t month,
+                        uint8_t day, uint8_t hour, uint8_t minute,
+                        uint8_t second) {
+    (void)flags;
+    (void)year;
+    (void)month;
+    (void)day;
+    (void)hour;
+    (void)minute;
+    (void)second;
+    return _fp != nullptr;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file    sim_tcb.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Simulated TCB2 in periodic interrupt mode. While enabled with the
+ * CAPT interrupt on, it raises CAPT every CCMP + 1 ticks of the selected clock
+ * (CLK_PER, CLK_PER/2 or the TCA0 clock, CLK_PER/64 in the Arduino core) and
+ * calls TCB2_INT_vect.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#include "sim_internal.h"
+
+// Weak so that firmware without the burst timer still links
+void TCB2_INT_vect(void) __attribute__((weak));
+
+TCB_t TCB2;
+
+static uint64_t _nextAt = SIM_NEVER;
+
+/// Timer period in microseconds (at least 1)
+static uint64_t _period(void) {
+    uint8_t _clk = TCB2.CTRLA & TCB_CLKSEL_gm;
+    uint32_t _div = _clk == TCB_CLKSEL_CLKTCA_gc    ? 64
+                    : _clk == TCB_CLKSEL_CLKDIV2_gc ? 2
+                                                    : 1;
+    uint64_t _us = ((uint64_t)(TCB2.CCMP + 1) * _div * 1000000ULL) / F_CPU;
+    return _us ? _us : 1;
+}
+
+static bool _running(void) {
+    return (TCB2.CTRLA & TCB_ENABLE_bm) && (TCB2.INTCTRL & TCB_CAPT_bm);
+}
+
+static uint64_t _tcbNext(void) {
+    if (!_running()) {
+        _nextAt = SIM_NEVER;
+    } else if (_nextAt == SIM_NEVER) {  // Just started
+        _nextAt = sim_micros() + _period();
+    }
+    return _nextAt;
+}
+
+static void _tcbFire(uint64_t now) {
+    _nextAt = now + _period();
+    TCB2.INTFLAGS |= TCB_CAPT_bm;
+    if (sim_globalInterrupts && TCB2_INT_vect) {
+        TCB2_INT_vect();
+    }
+}
+
+static const SimDevice _tcbDevice = {_tcbNext, _tcbFire};
+
+void sim_tcbInit(void) {
+    sim_registerDevice(&_tcbDevice);
+}
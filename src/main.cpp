@@ -25,6 +25,7 @@
  */
 
 #include <Arduino.h>
+#include <avr/sleep.h>
 
 #include "pin_definitions.h"
 #include "error_codes.h"
@@ -41,19 +42,53 @@
 
 DateTime now;  // Variable to hold current time
 
-// Interrupt flag from RTC alarm
+// Interrupt flag from the RTC alarm or square wave and micros() when it fired
 volatile bool alarmFlag = false;
+volatile uint32_t alarmMicros = 0;
 
-// Sensors measures
-uint16_t hall_measures[6] = {0};
-float temp_measure = 0;
+// Sensors measures (POSIX time, hall values, centi-degrees)
+LogRecord record;
 
-// Human-readable time stamp for log file
-char timestamp[] = "YYYY-MM-DD hh:mm:ss";
+// POSIX and human-readable time text, updated field by field every sample
+LogTimeText timeText;
 
-// Interrupt handler for RTC alarm
+// Text of the record for the Serial port
+char line[LOG_TEXT_MAX_SIZE];
+
+// Header of the last burst capture
+LogEventHeader event;
+
+// Gapes of the calibrated hall channels
+LogGape gape;
+
+// Interrupt handler for RTC alarm or square wave edge
 void onAlarm(void) {
+    if (RTC_onInterrupt()) {  // Not only timing the internal timer
+        alarmMicros = micros();
+    }
+    alarmFlag = true;
+}
+
+// Interrupt handler for a sample period of the internal timer
+void onTimer(void) {
     alarmFlag = true;
+    alarmMicros = micros();
+}
+
+// Sleep in idle mode until an interrupt (RTC pin, internal timer, serial
+// reception or the core's millis() tick) unless a sample or a command is
+// already waiting. Interrupts are enabled by the instruction before sleep,
+// so a wake-up can not be missed between the check and it.
+void sleepUntilEvent(void) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if (!alarmFlag && !Serial.available()) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
 }
 
 // Initialize GPIO pins
@@ -127,6 +162,14 @@ void setup() {
         }
     }
 
+    // Continue the log file interrupted by a reset or a power loss
+    bool logResumed = !SDCard_recover(sn);
+    if (logResumed) {
+        Serial.print(MSG_LOG_RESUMED_short);
+        Serial.print(',');
+        Serial.println(MSG_LOG_RESUMED_str);
+    }
+
     // Start external RTC
     uint8_t r = RTC_initExternal();
     if (r == 10) {
@@ -192,12 +235,30 @@ void setup() {
     // Initialize ADC and sleep GPIO for hall sensors
     ADC_init();
     HALL_initIO(HALL_SLEEP_GROUP0, HALL_SLEEP_GROUP1);
+    HALL_initChannels();
+    HALL_initSettling();
+    HALL_initPower();
+    HALL_initBurst();
+    HALL_initCalibration();
 
     now = RTC_getNow();  // get the updated time
-
-    // Initialize logfile name
-    SDCard_initFileName(now.year(), now.month(), now.day(), now.hour(),
-                        now.minute(), now.second(), sn);
+    RTC_initSchedule();
+
+    // Acquisition details for the binary log file header
+    uint8_t _order[6];
+    LogADCConfig _adc;
+    LogCalibration _cal;
+    HALL_getChannelOrder(_order);
+    HALL_getADCConfig(&_adc);
+    HALL_getCalibration(&_cal);
+    SDCard_setLogInfo(RTC_getPeriodMs(), _order, _adc, _cal,
+                      HALL_getChannelMask(), TEMP_getProbeCount());
+
+    // Initialize logfile name (unless the previous one was resumed)
+    if (!logResumed) {
+        SDCard_initFileName(now.year(), now.month(), now.day(), now.hour(),
+                            now.minute(), now.second(), sn);
+    }
 
     // oldDay = now.day();
 
@@ -209,19 +270,20 @@ void setup() {
      * End of setup and configuration section
      * ------------------------------------------------------- */
 
-    // schedule an alarm 10 seconds in the future
-    if (!RTC_1secondAlarm()) {
+    // Program the RTC wake-ups: the square wave once, the first alarm or the
+    // internal timer
+    if (!RTC_startSchedule(onTimer)) {
 #ifdef DEBUG
-        Serial.println("Error, alarm wasn't set!");
+        Serial.println("Error, schedule wasn't set!");
 #endif
         /// @todo Handle error and not continue
     } else {
 #ifdef DEBUG
-        Serial.println("Alarm will happen in 1 seconds!");
+        Serial.println("Samples will start at the next RTC edge!");
 #endif
     }
 
-    // The alarm will trigger an interrupt
+    // The alarm or square wave will trigger an interrupt
     pinMode(RTC_ALARM_PIN, INPUT);
     attachInterrupt(digitalPinToInterrupt(2), onAlarm, FALLING);
 
@@ -231,48 +293,78 @@ void setup() {
 }
 
 void loop() {
+    // Count the RTC edges and timer periods: the time comes from the
+    // software clock (or the RTC in alarm mode), and a sample is due once
+    // per sample period
+    bool _due = false;
     if (alarmFlag) {        // If alarm was triggered
         alarmFlag = false;  // Clear the flag
+        _due = RTC_tick(&record.time, &record.timeMs);
+    }
 
+    if (_due) {
         // Show that sensor read and process is running
         digitalWrite(GREEN_LED, LED_ON_STATE);
 
-        // Update now
-        now = RTC_getNow();
-
-        // Print current time to Serial
-        Serial.print(now.unixtime(), DEC);
-        Serial.print(F(","));  // POSIX time value
-
-        // Read all six hall sensors
-        HALL_read(HALL_SLEEP_GROUP0, HALL_SLEEP_GROUP1, hall_measures);
+        LOG_timeTextUpdate(&timeText, record.time);
 
-        // Read temperature sensor
-        temp_measure = TEMP_read();
+        // Read all six hall sensors (corrected for the AREF supply)
+        HALL_read(HALL_SLEEP_GROUP0, HALL_SLEEP_GROUP1, record.hall);
+        record.supplyCenti = HALL_getSupply();
+        HALL_toGape(record.hall, &gape);
 
-        // Create timestamp for logfile
-        printTimeToBuffer(now, timestamp);
-        // Write values to SD
-        SDCard_writeFile(now.unixtime(), timestamp, hall_measures,
-                         temp_measure);
+        // Read the temperature probes: the conversion started by the
+        // previous sample
+        TEMP_read(record.time, record.tempCenti);
 
-        // Print hall sensor values and temperature to Serial
-        for (uint8_t i = 0; i < 6; ++i) {
-            Serial.print(hall_measures[i]);
+        // Write values to SD (interval statistics are taken there), report a
+        // failure with the card error code
+        if (SDCard_writeFile(record, timeText, gape)) {
+            const LogCardHealth &_health = SDCard_getHealth();
+            Serial.print(ERROR_SDCARD_WRITEFAIL_short);
             Serial.print(',');
+            Serial.print(ERROR_SDCARD_WRITEFAIL_str);
+            Serial.print(',');
+            Serial.print(_health.errorCode);
+            Serial.print(',');
+            Serial.println(_health.errorData);
         }
-        Serial.print(temp_measure, 2);
 
-        // End of logging line
-        Serial.println();
-        Serial.flush();
+        // Save a completed burst capture and re-arm its trigger
+        const LogHallSample *_samples =
+            HALL_getEvent(&event, record.time,
+                          alarmMicros - record.timeMs * 1000UL);
+        if (_samples) {
+            SDCard_writeEvent(event, _samples);
+            HALL_releaseEvent();
+        }
 
-        // Next 1s alarm
-        RTC_1secondAlarm();
+        // Print the record to Serial: POSIX time, enabled hall values,
+        // temperatures, supply and gapes. With interval statistics only the
+        // decimated samples and the summary of a closed window are printed
+        SDCard_printSummary();
+        if (SDCard_rawDue(record.time, record.timeMs)) {
+            const uint8_t _mask = HALL_getChannelMask() | LOG_SUPPLY_bm |
+                                  (RTC_getPeriodMs() % 1000 ? LOG_MILLIS_bm
+                                                            : 0);
+            Serial.write(line, LOG_formatRecord(line, &record, &timeText,
+                                                false, _mask, &gape,
+                                                TEMP_getProbeCount()));
+        }
+        Serial.flush();
 
         // Turn-off green LED to show that the process is done
         digitalWrite(GREEN_LED, LED_OFF_STATE);
+
+        // Create the next log file ahead of a rollover, outside the sample
+        SDCard_prepareNextFile();
+
+        // Convert the temperature of the next sample while sleeping
+        TEMP_startConversion(record.time, RTC_getNextTime());
     }
 
     CMD_readCommand();
+
+    // Sleep until the next wake-up (the temperature converts meanwhile)
+    sleepUntilEvent();
 }
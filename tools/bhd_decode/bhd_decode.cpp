@@ -0,0 +1,441 @@
+/**
+ * @file    bhd_decode.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host tool that validates and converts device log files (.bhd packed
+ * or delta records, and .csv) to CSV or to a compact columnar file (.bhc).
+ * Burst captures go to a `<name>_events.csv` file and interval summaries to a
+ * `<name>_stats.csv` file next to the output.
+ *
+ * Files are memory-mapped and split into chunks that decode independently;
+ * the chunks of all the input files are spread over a pool of threads.
+ *
+ * Usage: bhd_decode [-f csv|col|none] [-o DIR] [-j THREADS] FILE|DIR...
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_reader.h"
+#include "log_writer.h"
+
+/**
+ * @brief Output format
+ */
+enum OutputFormat { OUTPUT_CSV, OUTPUT_COLUMNAR, OUTPUT_NONE };
+
+/**
+ * @brief An input file and the decoding results of its chunks
+ */
+struct Job {
+    LogFile file;
+    std::string out;  ///< Output path, empty if there is nothing to write
+    std::vector<std::vector<LogRecord>> chunks;
+    std::vector<std::vector<ReaderEvent>> events;
+    std::vector<std::vector<LogSummary>> summaries;
+    std::vector<ReaderIssues> issues;
+    std::atomic<size_t> pending{0};
+};
+
+static OutputFormat _format = OUTPUT_CSV;
+static std::string _outDir;
+static std::mutex _printLock;
+
+static std::atomic<uint64_t> _totalRecords{0};
+static std::atomic<uint32_t> _failedFiles{0};
+
+static void _usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-f csv|col|none] [-o DIR] [-j THREADS] FILE|DIR...\n"
+            "  -f  output format: csv (default), col (columnar .bhc) or none\n"
+            "      (validate only)\n"
+            "  -o  output directory, created if missing (default: next to\n"
+            "      each input file)\n"
+            "  -j  worker threads (default: all cores)\n"
+            "Directories are scanned for .bhd and .csv files.\n",
+            name);
+}
+
+static bool _endsWith(const std::string &s, const char *suffix) {
+    size_t _n = strlen(suffix);
+    return s.size() >= _n && strcasecmp(s.c_str() + s.size() - _n, suffix) == 0;
+}
+
+/**
+ * @brief Add a file, or the log files of a directory, to the input list.
+ * Decoder outputs found in a directory are skipped: event and statistics
+ * files, and CSV files next to a `.bhd` file of the same name.
+ */
+static void _collect(const std::string &path, std::vector<std::string> *out) {
+    struct stat _st;
+    if (stat(path.c_str(), &_st) == 0 && S_ISDIR(_st.st_mode)) {
+        DIR *_dir = opendir(path.c_str());
+        if (!_dir) {
+            return;
+        }
+        std::vector<std::string> _csv;
+        std::set<std::string> _bhd;  // Names without the extension
+        while (struct dirent *_e = readdir(_dir)) {
+            std::string _name = _e->d_name;
+            if (_endsWith(_name, ".bhd")) {
+                _bhd.insert(_name.substr(0, _name.size() - 4));
+            } else if (_endsWith(_name, ".csv") &&
+                       !_endsWith(_name, "_events.csv") &&
+                       !_endsWith(_name, "_stats.csv")) {
+                _csv.push_back(_name);
+            }
+        }
+        closedir(_dir);
+        std::vector<std::string> _names;
+        for (const std::string &_b : _bhd) {
+            _names.push_back(path + "/" + _b + ".bhd");
+        }
+        for (const std::string &_c : _csv) {
+            if (!_bhd.count(_c.substr(0, _c.size() - 4))) {
+                _names.push_back(path + "/" + _c);
+            }
+        }
+        std::sort(_names.begin(), _names.end());
+        out->insert(out->end(), _names.begin(), _names.end());
+    } else {
+        out->push_back(path);
+    }
+}
+
+/**
+ * @brief Create a directory and its missing parents (as `mkdir -p`)
+ *
+ * @return True if `path` is a directory afterwards
+ */
+static bool _makeDir(const std::string &path) {
+    struct stat _st;
+    if (stat(path.c_str(), &_st) == 0) {
+        if (!S_ISDIR(_st.st_mode)) {
+            errno = ENOTDIR;
+            return false;
+        }
+        return true;
+    }
+    size_t _slash = path.find_last_of('/');
+    if (_slash != std::string::npos && _slash > 0 &&
+        !_makeDir(path.substr(0, _slash))) {
+        return false;
+    }
+    return mkdir(path.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+/**
+ * @brief Output path for an input file, empty if there is nothing to write
+ */
+static std::string _outputPath(const LogFile &file) {
+    if (_format == OUTPUT_NONE ||
+        (_format == OUTPUT_CSV && file.format == LOG_FORMAT_CSV &&
+         _outDir.empty())) {
+        return "";  // Already CSV, do not overwrite the input
+    }
+    std::string _base = file.path;
+    size_t _slash = _base.find_last_of('/');
+    if (!_outDir.empty()) {
+        _base = _outDir + "/" + _base.substr(_slash + 1);
+        _slash = _base.find_last_of('/');
+    }
+    size_t _dot = _base.find_last_of('.');
+    if (_dot != std::string::npos &&
+        (_slash == std::string::npos || _dot > _slash)) {
+        _base.erase(_dot);
+    }
+    return _base + (_format == OUTPUT_CSV ? ".csv" : ".bhc");
+}
+
+/**
+ * @brief Absolute path of a file that may not exist yet (its directory must),
+ * to compare output and input paths
+ */
+static std::string _canonical(const std::string &path) {
+    size_t _slash = path.find_last_of('/');
+    std::string _dir =
+        _slash == std::string::npos ? "." : path.substr(0, _slash);
+    std::string _name = path.substr(_slash + 1);  // npos + 1 is 0
+    char *_real = realpath(_dir.empty() ? "/" : _dir.c_str(), nullptr);
+    if (!_real) {
+        return path;
+    }
+    std::string _abs = _real;
+    free(_real);
+    return (_abs == "/" ? "" : _abs) + "/" + _name;
+}
+
+/**
+ * @brief Check that no two files write the same output and that no output
+ * overwrites an input (outputs are written while other inputs are mapped)
+ *
+ * @return False after printing the first conflict
+ */
+static bool _checkOutputs(const std::vector<std::unique_ptr<Job>> &jobs) {
+    std::set<std::string> _inputs, _outputs;
+    for (const auto &_job : jobs) {
+        _inputs.insert(_canonical(_job->file.path));
+    }
+    for (const auto &_job : jobs) {
+        if (_job->out.empty()) {
+            continue;
+        }
+        std::string _stem = _job->out.substr(0, _job->out.find_last_of('.'));
+        for (const std::string &_o :
+             {_job->out, _stem + "_events.csv", _stem + "_stats.csv"}) {
+            std::string _c = _canonical(_o);
+            if (_inputs.count(_c) || !_outputs.insert(_c).second) {
+                fprintf(stderr, "%s: output %s %s\n",
+                        _job->file.path.c_str(), _o.c_str(),
+                        _inputs.count(_c) ? "is also an input"
+                                          : "is written by another input");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Merge the chunks of a decoded file, check it and write the output
+ */
+static void _finish(Job *job) {
+    std::vector<LogRecord> _records;
+    size_t _n = 0;
+    for (const auto &_c : job->chunks) {
+        _n += _c.size();
+    }
+    _records.reserve(_n);
+    ReaderIssues _issues;
+    for (size_t _i = 0; _i < job->chunks.size(); ++_i) {
+        _records.insert(_records.end(), job->chunks[_i].begin(),
+                        job->chunks[_i].end());
+        std::vector<LogRecord>().swap(job->chunks[_i]);
+        _issues.add(job->issues[_i]);
+    }
+    READER_checkTime(job->file, _records, &_issues);
+    std::vector<ReaderEvent> _events;
+    for (auto &_c : job->events) {
+        _events.insert(_events.end(), _c.begin(), _c.end());
+        std::vector<ReaderEvent>().swap(_c);
+    }
+    std::vector<LogSummary> _summaries;
+    for (auto &_c : job->summaries) {
+        _summaries.insert(_summaries.end(), _c.begin(), _c.end());
+        std::vector<LogSummary>().swap(_c);
+    }
+
+    const std::string &_out = job->out;
+    bool _written = true;
+    if (!_out.empty()) {
+        _written = _format == OUTPUT_CSV
+                       ? WRITER_csv(_out, job->file, _records)
+                       : WRITER_columnar(_out, job->file, _records);
+        if (!_events.empty()) {
+            _written &= WRITER_events(
+                _out.substr(0, _out.find_last_of('.')) + "_events.csv",
+                _events);
+        }
+        if (!_summaries.empty()) {
+            _written &= WRITER_summaries(
+                _out.substr(0, _out.find_last_of('.')) + "_stats.csv",
+                job->file, _summaries);
+        }
+    }
+
+    _totalRecords += _records.size();
+    if (_issues.errors() || !_written) {
+        ++_failedFiles;
+    }
+
+    std::lock_guard<std::mutex> _lock(_printLock);
+    printf("%s: %zu records", job->file.path.c_str(), _records.size());
+    if (job->file.hasHeader) {
+        printf(", SN%03u, fw %u.%u.%u", job->file.header.serialNumber,
+               job->file.header.fwVersion[0], job->file.header.fwVersion[1],
+               job->file.header.fwVersion[2]);
+    }
+    if (!_events.empty()) {
+        printf(", %zu events", _events.size());
+    }
+    if (!_summaries.empty()) {
+        printf(", %zu summaries", _summaries.size());
+    }
+    printf(", %u bad blocks, %u unwritten blocks, %u truncated,"
+           " %u bad keyframes, %u time regressions, %u gaps",
+           _issues.badBlocks, _issues.unwritten, _issues.truncated,
+           _issues.badKeyframes, _issues.timeRegressions, _issues.gaps);
+    if (_issues.hasHealth) {  // Last card health record of the file
+        const LogCardOpStats &_w = _issues.health.op[LOG_CARD_WRITE];
+        const LogCardOpStats &_s = _issues.health.op[LOG_CARD_SYNC];
+        printf(", card: max write %u us, max sync %u us, %u retries,"
+               " %u errors",
+               (unsigned)_w.maxUs, (unsigned)_s.maxUs,
+               (unsigned)(_w.retries + _s.retries),
+               (unsigned)(_w.errors + _s.errors +
+                          _issues.health.op[LOG_CARD_OPEN].errors));
+        if (_issues.health.errorCode) {
+            printf(" (last 0x%02X,0x%X)", _issues.health.errorCode,
+                   (unsigned)_issues.health.errorData);
+        }
+    }
+    printf("%s\n", _written ? "" : ", WRITE FAILED");
+}
+
+int main(int argc, char **argv) {
+    unsigned _threads = std::thread::hardware_concurrency();
+    std::vector<std::string> _paths;
+
+    for (int _i = 1; _i < argc; ++_i) {
+        const char *_a = argv[_i];
+        if (_a[0] == '-' && _a[1] && !_a[2]) {
+            if (_i + 1 >= argc) {
+                _usage(argv[0]);
+                return 2;
+            }
+            const char *_v = argv[++_i];
+            switch (_a[1]) {
+                case 'f':
+                    if (!strcmp(_v, "csv")) {
+                        _format = OUTPUT_CSV;
+                    } else if (!strcmp(_v, "col")) {
+                        _format = OUTPUT_COLUMNAR;
+                    } else if (!strcmp(_v, "none")) {
+                        _format = OUTPUT_NONE;
+                    } else {
+                        _usage(argv[0]);
+                        return 2;
+                    }
+                    break;
+                case 'o':
+                    _outDir = _v;
+                    break;
+                case 'j': {
+                    char *_end;
+                    long _n = strtol(_v, &_end, 10);
+                    if (*_end || _end == _v || _n <= 0 || _n > 1024) {
+                        fprintf(stderr, "-j: invalid thread count: %s\n", _v);
+                        return 2;
+                    }
+                    _threads = _n;
+                    break;
+                }
+                default:
+                    _usage(argv[0]);
+                    return 2;
+            }
+        } else {
+            _collect(_a, &_paths);
+        }
+    }
+    if (_paths.empty()) {
+        _usage(argv[0]);
+        return 2;
+    }
+    if (_threads == 0) {  // Core count unknown
+        _threads = 1;
+    }
+    if (!_outDir.empty() && _format != OUTPUT_NONE && !_makeDir(_outDir)) {
+        fprintf(stderr, "%s: cannot create output directory: %s\n",
+                _outDir.c_str(), strerror(errno));
+        return 2;
+    }
+
+    auto _t0 = std::chrono::steady_clock::now();
+
+    // Map every file and list its chunks as independent tasks
+    std::vector<std::unique_ptr<Job>> _jobs;
+    std::vector<std::pair<Job *, size_t>> _tasks;
+    uint64_t _bytes = 0;
+    for (const std::string &_path : _paths) {
+        std::unique_ptr<Job> _job(new Job);
+        std::string _error;
+        if (!READER_open(_path, &_job->file, &_error)) {
+            fprintf(stderr, "%s: %s\n", _path.c_str(), _error.c_str());
+            ++_failedFiles;
+            continue;
+        }
+        size_t _chunks = _job->file.bounds.size() - 1;
+        _job->chunks.resize(_chunks);
+        _job->events.resize(_chunks);
+        _job->summaries.resize(_chunks);
+        _job->issues.resize(_chunks);
+        _job->pending = _chunks;
+        _job->out = _outputPath(_job->file);
+        _bytes += _job->file.size;
+        for (size_t _c = 0; _c < _chunks; ++_c) {
+            _tasks.emplace_back(_job.get(), _c);
+        }
+        _jobs.push_back(std::move(_job));
+    }
+    if (!_checkOutputs(_jobs)) {
+        return 2;
+    }
+    for (const auto &_job : _jobs) {
+        if (_job->pending == 0) {  // Header only
+            _finish(_job.get());
+        }
+    }
+
+    // Workers take tasks in order; the one that decodes the last chunk of a
+    // file merges and writes it
+    std::atomic<size_t> _next{0};
+    auto _worker = [&]() {
+        for (size_t _t; (_t = _next++) < _tasks.size();) {
+            Job *_job = _tasks[_t].first;
+            size_t _c = _tasks[_t].second;
+            READER_decodeChunk(_job->file, _c, &_job->chunks[_c],
+                               &_job->events[_c], &_job->summaries[_c],
+                               &_job->issues[_c]);
+            if (--_job->pending == 0) {
+                _finish(_job);
+            }
+        }
+    };
+    std::vector<std::thread> _pool;
+    for (unsigned _i = 1; _i < _threads; ++_i) {
+        _pool.emplace_back(_worker);
+    }
+    _worker();
+    for (auto &_th : _pool) {
+        _th.join();
+    }
+
+    double _s = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - _t0)
+                    .count();
+    fprintf(stderr,
+            "%zu files, %llu records, %.1f MB in %.2f s (%u threads), "
+            "%u with errors\n",
+            _paths.size(), (unsigned long long)_totalRecords.load(),
+            _bytes / 1e6, _s, _threads, _failedFiles.load());
+    return _failedFiles ? 1 : 0;
+}
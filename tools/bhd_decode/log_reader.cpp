@@ -0,0 +1,643 @@
+/**
+ * @file    log_reader.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "log_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Largest 12-bit hall value
+#define READER_HALL_MAX 0x0FFF
+
+void ReaderIssues::add(const ReaderIssues &o) {
+    if (o.hasValid) {
+        badBlocks += unwritten + o.badBlocks;
+        unwritten = o.unwritten;
+        hasValid = true;
+    } else {
+        badBlocks += o.badBlocks;
+        unwritten += o.unwritten;
+    }
+    if (o.hasHealth) {
+        hasHealth = true;
+        health = o.health;
+    }
+    truncated += o.truncated;
+    badKeyframes += o.badKeyframes;
+    timeRegressions += o.timeRegressions;
+    gaps += o.gaps;
+}
+
+uint32_t ReaderIssues::errors(void) const {
+    return badBlocks + truncated + badKeyframes + timeRegressions;
+}
+
+LogFile::~LogFile() {
+    if (data && size) {
+        munmap((void *)data, size);
+    }
+}
+
+/**
+ * @brief Split [begin, end) into chunks of about READER_CHUNK_BYTES, each a
+ * multiple of `unit` bytes
+ */
+static void _splitFixed(LogFile *file, const size_t begin, const size_t end,
+                        const size_t unit) {
+    size_t _step = READER_CHUNK_BYTES - READER_CHUNK_BYTES % unit;
+    for (size_t _p = begin; _p < end; _p += _step) {
+        file->bounds.push_back(_p);
+    }
+    file->bounds.push_back(end);
+}
+
+/**
+ * @brief Split [begin, end) into chunks of about READER_CHUNK_BYTES that end
+ * right after a newline, keeping the `#S` sample lines with their event
+ */
+static void _splitLines(LogFile *file, const size_t begin, const size_t end) {
+    size_t _p = begin;
+    file->bounds.push_back(_p);
+    while (end - _p > READER_CHUNK_BYTES) {
+        const void *_nl = memchr(file->data + _p + READER_CHUNK_BYTES, '\n',
+                                 end - _p - READER_CHUNK_BYTES);
+        if (!_nl) {
+            break;
+        }
+        _p = (const uint8_t *)_nl - file->data + 1;
+        while (end - _p >= 2 && file->data[_p] == '#' &&
+               file->data[_p + 1] == 'S') {
+            _nl = memchr(file->data + _p, '\n', end - _p);
+            _p = _nl ? (const uint8_t *)_nl - file->data + 1 : end;
+        }
+        if (_p == end) {
+            break;
+        }
+        file->bounds.push_back(_p);
+    }
+    if (file->bounds.back() != end) {
+        file->bounds.push_back(end);
+    }
+}
+
+/**
+ * @brief Parse an unsigned decimal number
+ */
+static const char *_parseUint(const char *p, const char *end, uint32_t *v) {
+    uint32_t _v = 0;
+    const char *_s = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        _v = _v * 10 + (*p++ - '0');
+    }
+    *v = _v;
+    return p == _s ? nullptr : p;
+}
+
+/**
+ * @brief Parse a temperature with up to two decimals into centi-degrees
+ */
+static int16_t _parseTemp(const char *p, const char *end) {
+    bool _neg = p < end && *p == '-';
+    p += _neg;
+    uint32_t _int, _frac = 0, _digits = 0;
+    if (!(p = _parseUint(p, end, &_int))) {
+        return LOG_TEMP_INVALID;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9' && _digits < 2) {
+            _frac = _frac * 10 + (*p++ - '0');
+            ++_digits;
+        }
+    }
+    while (_digits++ < 2) {
+        _frac *= 10;
+    }
+    int32_t _c = (int32_t)(_int * 100 + _frac);
+    return (int16_t)(_neg ? -_c : _c);
+}
+
+/**
+ * @brief Parse `n` comma-separated unsigned numbers, each preceded by a comma
+ *
+ * @return True if all of them were found
+ */
+static bool _parseList(const char *p, const char *end, uint32_t *values,
+                       const uint8_t n) {
+    for (uint8_t _i = 0; _i < n; ++_i) {
+        if (p >= end || *p != ',') {
+            return false;
+        }
+        p = _parseUint(p + 1, end, &values[_i]);
+        if (!p) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Read the gape calibration from the `#C,channel,raw1,gape1,...` lines
+ * that follow the header line of a CSV file
+ *
+ * @param[in] begin     Offset of the first line after the header line
+ */
+static void _parseCalibration(LogFile *file, size_t begin) {
+    const char *_p = (const char *)file->data + begin;
+    const char *_end = (const char *)file->data + file->size;
+    while (_end - _p >= 2 && _p[0] == '#' && _p[1] == 'C') {
+        const char *_eol = (const char *)memchr(_p, '\n', _end - _p);
+        if (!_eol) {
+            _eol = _end;
+        }
+        uint32_t _v[1 + 2 * LOG_CAL_POINTS];
+        if (_parseList(_p + 2, _eol, _v, 1 + 2 * LOG_CAL_POINTS) &&
+            _v[0] >= 1 && _v[0] <= LOG_HALL_CHANNELS) {
+            uint8_t _c = _v[0] - 1;
+            for (uint8_t _i = 0; _i < LOG_CAL_POINTS; ++_i) {
+                file->cal.points[_c][_i].raw = _v[1 + 2 * _i];
+                file->cal.points[_c][_i].gapeUm = _v[2 + 2 * _i];
+            }
+            if (LOG_calValid(file->cal.points[_c])) {
+                file->cal.channels |= 1 << _c;
+            }
+        }
+        _p = _eol + 1;
+    }
+}
+
+/**
+ * @brief Read the logged hall channels from the `hallN` columns of the header
+ * line of a CSV file, the probes from the `TempN.C` ones and the supply from
+ * a `Supply.V` one
+ *
+ * @param[in] end       Offset of the header line end
+ */
+static void _parseColumns(LogFile *file, size_t end) {
+    const char *_p = (const char *)file->data;
+    const char *_end = _p + end;
+    uint8_t _mask = 0, _probes = 0;
+    while ((_p = (const char *)memchr(_p, ',', _end - _p)) != nullptr) {
+        ++_p;
+        if (_end - _p >= 5 && memcmp(_p, "hall", 4) == 0 && _p[4] >= '1' &&
+            _p[4] <= '0' + LOG_HALL_CHANNELS) {
+            _mask |= 1 << (_p[4] - '1');
+        } else if (_end - _p >= 8 && memcmp(_p, "Supply.V", 8) == 0) {
+            _mask |= LOG_SUPPLY_bm;
+        } else if (_end - _p >= 5 && memcmp(_p, "Temp", 4) == 0 &&
+                   _p[4] >= '1' && _p[4] <= '0' + LOG_TEMP_PROBES) {
+            ++_probes;
+        }
+    }
+    if (!(_mask & LOG_HALL_MASK_ALL)) {
+        _mask |= LOG_HALL_MASK_ALL;
+    }
+    file->hallMask = _mask;
+    file->tempProbes = _probes ? _probes : 1;
+}
+
+/**
+ * @brief Set LOG_MILLIS_bm when the first record line of a CSV file has a
+ * POSIX time with milliseconds ("1700000000.250")
+ *
+ * @param[in] begin     Offset of the first line after the header line
+ */
+static void _parseMillis(LogFile *file, size_t begin) {
+    const char *_p = (const char *)file->data + begin;
+    const char *_end = (const char *)file->data + file->size;
+    while (_p < _end && *_p == '#') {  // Calibration lines
+        const char *_eol = (const char *)memchr(_p, '\n', _end - _p);
+        _p = _eol ? _eol + 1 : _end;
+    }
+    while (_p < _end && *_p >= '0' && *_p <= '9') {
+        ++_p;
+    }
+    if (_p < _end && *_p == '.') {
+        file->hallMask |= LOG_MILLIS_bm;
+    }
+}
+
+bool READER_open(const std::string &path, LogFile *file, std::string *error) {
+    file->path = path;
+
+    int _fd = open(path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        *error = strerror(errno);
+        return false;
+    }
+    struct stat _st;
+    if (fstat(_fd, &_st) < 0) {
+        *error = strerror(errno);
+        close(_fd);
+        return false;
+    }
+    file->size = _st.st_size;
+    if (file->size) {
+        void *_map = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (_map == MAP_FAILED) {
+            *error = strerror(errno);
+            close(_fd);
+            return false;
+        }
+        madvise(_map, file->size, MADV_SEQUENTIAL);
+        file->data = (const uint8_t *)_map;
+    }
+    close(_fd);
+
+    if (file->size >= LOG_HEADER_SIZE &&
+        memcmp(file->data, LOG_MAGIC, 4) == 0) {
+        if (!LOG_readHeader(file->data, &file->header)) {
+            *error = "bad header CRC";
+            return false;
+        }
+        if (file->header.version != LOG_FORMAT_VERSION) {
+            *error = "unsupported format version";
+            return false;
+        }
+        file->hasHeader = true;
+        file->fileId = LOG_fileId(file->data);
+        file->format = file->header.recordFormat;
+        if (file->format != LOG_FORMAT_PACKED &&
+            file->format != LOG_FORMAT_DELTA) {
+            *error = "unsupported record format";
+            return false;
+        }
+        file->cal = file->header.cal;
+        file->hallMask = file->header.hallMask;
+        file->tempProbes = file->header.tempProbes;
+        _splitFixed(file, file->header.headerSize, file->size, LOG_BLOCK_SIZE);
+        return true;
+    }
+
+    if (file->size >= 6 && memcmp(file->data, "POSIXt", 6) == 0) {
+        file->format = LOG_FORMAT_CSV;
+        const void *_nl = memchr(file->data, '\n', file->size);
+        size_t _begin = _nl ? (const uint8_t *)_nl - file->data + 1
+                            : file->size;
+        _parseColumns(file, _begin);
+        _parseMillis(file, _begin);
+        _parseCalibration(file, _begin);
+        _splitLines(file, _begin, file->size);
+        return true;
+    }
+
+    *error = "not a log file";
+    return false;
+}
+
+/**
+ * @brief Decode the blocks of [p, end). Blocks that fail the CRC, file id or
+ * sequence check are counted as unwritten until a valid block follows them.
+ */
+static void _decodeBlocks(const LogFile &file, const uint8_t *p,
+                          const uint8_t *end, std::vector<LogRecord> *records,
+                          std::vector<ReaderEvent> *events,
+                          std::vector<LogSummary> *summaries,
+                          ReaderIssues *issues) {
+    uint8_t _last[LOG_BLOCK_SIZE];
+    ReaderEvent _e;
+    for (; p < end; p += LOG_BLOCK_SIZE) {
+        const uint8_t *_block = p;
+        if (end - p < LOG_BLOCK_SIZE) {  // Last sector of a FAT-grown file
+            memset(_last, 0, sizeof(_last));
+            memcpy(_last, p, end - p);
+            _block = _last;
+        }
+
+        LogBlockState _state;
+        if (!LOG_blockCheck(_block, file.fileId,
+                            (p - file.data) / LOG_BLOCK_SIZE) ||
+            !LOG_blockBegin(&_state, _block, file.hallMask,
+                            file.tempProbes)) {
+            ++issues->unwritten;  // Damaged if a valid block follows
+            continue;
+        }
+        issues->badBlocks += issues->unwritten;
+        issues->unwritten = 0;
+        issues->hasValid = true;
+        if (LOG_readHealth(_block, &issues->health)) {  // No records
+            issues->hasHealth = true;
+            continue;
+        }
+        if (LOG_readEvent(_block, &_e.header, _e.hall)) {  // No records
+            events->push_back(_e);
+            continue;
+        }
+
+        LogRecord _r;
+        LogSummary _s;
+        uint8_t _kind;
+        size_t _start = records->size(), _sumStart = summaries->size();
+        while ((_kind = LOG_blockNextEntry(&_state, _block, &_r, &_s))) {
+            if (_kind == LOG_ENTRY_SUMMARY) {
+                summaries->push_back(_s);
+                continue;
+            }
+            bool _ok = true;
+            for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+                _ok &= _r.hall[_i] <= READER_HALL_MAX;
+            }
+            if (!_ok) {  // Out-of-range values: drop the block
+                if (records->size() == _start) {
+                    ++issues->badKeyframes;
+                } else {
+                    ++issues->badBlocks;
+                }
+                records->resize(_start);
+                summaries->resize(_sumStart);
+                _state.count = 0;
+                break;
+            }
+            records->push_back(_r);
+        }
+        if (_state.count != 0) {
+            ++issues->truncated;
+        }
+    }
+}
+
+/**
+ * @brief Parse a burst capture line: `#E` starts an event, `#S` adds a sample
+ * to it. Events that miss samples are dropped as truncated.
+ *
+ * @param[in,out] filled    Samples of the last event so far
+ */
+static void _parseEventLine(const char *line, const char *eol,
+                            std::vector<ReaderEvent> *events, uint8_t *filled,
+                            ReaderIssues *issues) {
+    uint32_t _v[7];
+    if (eol - line >= 2 && line[1] == 'E') {
+        if (!events->empty() && *filled < events->back().header.count) {
+            events->pop_back();
+            ++issues->truncated;
+        }
+        if (!_parseList(line + 2, eol, _v, 7) || _v[3] == 0 ||
+            _v[3] > LOG_EVENT_SAMPLES) {
+            ++issues->truncated;
+            return;
+        }
+        ReaderEvent _e;
+        _e.header.time = _v[0];
+        _e.header.timeMs = _v[1];
+        _e.header.periodUs = _v[2];
+        _e.header.count = _v[3];
+        _e.header.pre = _v[4];
+        _e.header.channels = _v[5];
+        _e.header.threshold = _v[6];
+        events->push_back(_e);
+        *filled = 0;
+    } else if (eol - line >= 2 && line[1] == 'S' && !events->empty() &&
+               *filled < events->back().header.count) {
+        if (!_parseList(line + 2, eol, _v, LOG_HALL_CHANNELS)) {
+            return;  // Counted when the event ends short
+        }
+        for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+            events->back().hall[*filled][_c] = _v[_c];
+        }
+        ++*filled;
+    }
+}
+
+/**
+ * @brief Parse a comma and the unsigned number that follows it
+ */
+static const char *_parseNext(const char *p, const char *end, uint32_t *v) {
+    return p < end && *p == ',' ? _parseUint(p + 1, end, v) : nullptr;
+}
+
+/**
+ * @brief Parse a comma and the value printed with two decimals from 1/16
+ * units that follows it
+ */
+static const char *_parseNextQ4(const char *p, const char *end, uint32_t *v) {
+    uint32_t _int, _frac;
+    if (!(p = _parseNext(p, end, &_int)) || end - p < 3 || *p != '.' ||
+        _parseUint(p + 1, p + 3, &_frac) != p + 3) {
+        return nullptr;
+    }
+    *v = (_int << LOG_STATS_FRAC) + (_frac * 16 + 50) / 100;
+    return p + 3;
+}
+
+/**
+ * @brief Parse a `#M119` interval summary line with the values of the
+ * channels in a mask
+ *
+ * @param[in] p     Line after the `#M119` tag
+ *
+ * @return True if the line is complete
+ */
+static bool _parseSummaryLine(const char *p, const char *end,
+                              const uint8_t mask, LogSummary *summary) {
+    uint32_t _v[4];
+    memset(summary, 0, sizeof(LogSummary));
+    if (!(p = _parseNext(p, end, &_v[0])) ||
+        !(p = _parseNext(p, end, &_v[1]))) {
+        return false;
+    }
+    summary->time = _v[0];
+    summary->count = _v[1];
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (!(mask & (1 << _i))) {
+            continue;
+        }
+        if (!(p = _parseNext(p, end, &_v[0])) ||
+            !(p = _parseNext(p, end, &_v[1])) ||
+            !(p = _parseNextQ4(p, end, &_v[2])) ||
+            !(p = _parseNextQ4(p, end, &_v[3]))) {
+            return false;
+        }
+        summary->min[_i] = _v[0];
+        summary->max[_i] = _v[1];
+        summary->mean[_i] = _v[2];
+        summary->var[_i] = _v[3];
+    }
+    // Temperatures, empty without a valid one
+    int16_t *_temps[3] = {&summary->tempMin, &summary->tempMax,
+                          &summary->tempMean};
+    for (uint8_t _n = 0; _n < 3; ++_n) {
+        if (p >= end || *p != ',') {
+            return false;
+        }
+        const char *_next = (const char *)memchr(p + 1, ',', end - p - 1);
+        if (!_next) {
+            _next = end;
+        }
+        *_temps[_n] = _parseTemp(p + 1, _next);
+        p = _next;
+    }
+    return true;
+}
+
+/**
+ * @brief Decode the CSV lines of [p, end), with the hall values of the
+ * channels in a mask and a number of temperatures
+ */
+static void _decodeCSV(const char *p, const char *end, const uint8_t mask,
+                       const uint8_t probes,
+                       std::vector<LogRecord> *records,
+                       std::vector<ReaderEvent> *events,
+                       std::vector<LogSummary> *summaries,
+                       ReaderIssues *issues) {
+    uint8_t _filled = 0;
+    while (p < end) {
+        const char *_eol = (const char *)memchr(p, '\n', end - p);
+        if (!_eol) {
+            _eol = end;
+        }
+        const char *_line = p;
+        p = _eol + 1;
+        if (_eol > _line && _eol[-1] == '\r') {
+            --_eol;
+        }
+        if (_eol == _line) {
+            continue;
+        }
+        if (_eol - _line >= 5 &&
+            memcmp(_line, "#M119", 5) == 0) {
+            LogSummary _s;
+            if (_parseSummaryLine(_line + 5, _eol, mask, &_s)) {
+                summaries->push_back(_s);
+            } else {
+                ++issues->truncated;
+            }
+            continue;
+        }
+        if (*_line == '#') {  // Card health or burst capture line
+            _parseEventLine(_line, _eol, events, &_filled, issues);
+            continue;
+        }
+        if ((uint8_t)*_line == 0xFF || memchr(_line, '\0', _eol - _line)) {
+            ++issues->unwritten;  // Pre-allocated tail of a reset file
+            continue;
+        }
+
+        LogRecord _r;
+        uint32_t _v;
+        const char *_q = _parseUint(_line, _eol, &_r.time);
+        _r.timeMs = 0;
+        if (_q && _q < _eol && *_q == '.') {  // Sub-second times
+            _q = _parseUint(_q + 1, _eol, &_v);
+            _r.timeMs = _v;
+        }
+        // Skip the human-readable date and time
+        _q = _q && _q < _eol ? (const char *)memchr(_q + 1, ',', _eol - _q - 1)
+                             : nullptr;
+        uint8_t _i = 0;
+        for (; _q && _i < LOG_HALL_CHANNELS; ++_i) {
+            if (!(mask & (1 << _i))) {
+                _r.hall[_i] = 0;
+                continue;
+            }
+            _q = _parseUint(_q + 1, _eol, &_v);
+            if (!_q || _q >= _eol || *_q != ',') {
+                _q = nullptr;
+                break;
+            }
+            _r.hall[_i] = _v;
+        }
+        if (!_q) {
+            ++issues->truncated;
+            continue;
+        }
+        for (_i = 0; _i < LOG_TEMP_PROBES; ++_i) {
+            _r.tempCenti[_i] = LOG_TEMP_INVALID;
+        }
+        _r.tempCenti[0] = _parseTemp(_q + 1, _eol);
+        for (_i = 1; _q && _i < probes; ++_i) {
+            _q = (const char *)memchr(_q + 1, ',', _eol - _q - 1);
+            if (_q) {
+                _r.tempCenti[_i] = _parseTemp(_q + 1, _eol);
+            }
+        }
+        if (!_q) {
+            ++issues->truncated;
+            continue;
+        }
+        _r.supplyCenti = 0;
+        if (mask & LOG_SUPPLY_bm) {  // Supply column after the temperatures
+            _q = (const char *)memchr(_q + 1, ',', _eol - _q - 1);
+            int16_t _v = _q ? _parseTemp(_q + 1, _eol) : LOG_TEMP_INVALID;
+            _r.supplyCenti = _v > 0 ? _v : 0;
+        }
+        records->push_back(_r);
+    }
+    if (!events->empty() && _filled < events->back().header.count) {
+        events->pop_back();
+        ++issues->truncated;
+    }
+}
+
+void READER_decodeChunk(const LogFile &file, const size_t chunk,
+                        std::vector<LogRecord> *records,
+                        std::vector<ReaderEvent> *events,
+                        std::vector<LogSummary> *summaries,
+                        ReaderIssues *issues) {
+    const uint8_t *_p = file.data + file.bounds[chunk];
+    const uint8_t *_end = file.data + file.bounds[chunk + 1];
+
+    switch (file.format) {
+        case LOG_FORMAT_PACKED:
+        case LOG_FORMAT_DELTA:
+            records->reserve((_end - _p) / LOG_BLOCK_SIZE *
+                             LOG_PACKED_PER_BLOCK);
+            _decodeBlocks(file, _p, _end, records, events, summaries, issues);
+            break;
+
+        default:
+            _decodeCSV((const char *)_p, (const char *)_end, file.hallMask,
+                       file.tempProbes, records, events, summaries, issues);
+            break;
+    }
+}
+
+void READER_checkTime(const LogFile &file,
+                      const std::vector<LogRecord> &records,
+                      ReaderIssues *issues) {
+    // Periods in milliseconds, as sub-second records carry them
+    uint64_t _period = file.hasHeader && file.header.samplePeriodMs
+                           ? file.header.samplePeriodMs
+                           : 1000;
+    // Change-driven files write a record at least every heartbeat
+    if (file.hasHeader && file.header.filter.heartbeatS * 1000ULL > _period) {
+        _period = file.header.filter.heartbeatS * 1000ULL;
+    }
+    // Files with interval statistics only keep the decimated samples, if any
+    bool _gaps = true;
+    if (file.hasHeader && file.header.stats.windowS) {
+        _gaps = file.header.stats.rawEvery != 0;
+        if (file.header.stats.rawEvery * 1000ULL > _period) {
+            _period = file.header.stats.rawEvery * 1000ULL;
+        }
+    }
+    for (size_t _i = 1; _i < records.size(); ++_i) {
+        const LogRecord &_a = records[_i - 1], &_b = records[_i];
+        uint64_t _prev = _a.time * 1000ULL + _a.timeMs;
+        uint64_t _t = _b.time * 1000ULL + _b.timeMs;
+        if (_t < _prev) {
+            ++issues->timeRegressions;
+        } else if (_gaps && _t - _prev > 2 * _period) {
+            ++issues->gaps;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+/**
+ * @file    log_reader.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Memory-mapped reader for device log files (.bhd packed or delta
+ * blocks, and .csv). A file is split into chunks that decode independently, so the
+ * chunks of one or many files can be spread over all cores.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOG_READER_H__
+#define __LOG_READER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "log_calib.h"
+#include "log_format.h"
+
+// Bytes of input per chunk
+#define READER_CHUNK_BYTES (1u << 20)
+
+/**
+ * @brief Validation counters of a chunk or a whole file
+ */
+struct ReaderIssues {
+    uint32_t badBlocks = 0;       ///< Damaged blocks before the last valid one
+    uint32_t unwritten = 0;       ///< Blocks after the last valid one
+    uint32_t truncated = 0;       ///< Blocks or lines that end early
+    uint32_t badKeyframes = 0;    ///< Keyframes with out-of-range values
+    uint32_t timeRegressions = 0; ///< Records older than the previous one
+    uint32_t gaps = 0;            ///< Steps longer than two sample periods
+    bool hasValid = false;        ///< At least one valid block
+    bool hasHealth = false;       ///< A card health block was found
+    LogCardHealth health{};       ///< Last card health block
+
+    /// Append the counters of the next chunk: its leading invalid blocks are
+    /// damaged if it has a valid block, otherwise they extend the tail
+    void add(const ReaderIssues &o);
+    uint32_t errors(void) const;
+};
+
+/**
+ * @brief A burst capture: event block, or `#E` and `#S` lines in CSV files
+ */
+struct ReaderEvent {
+    LogEventHeader header{};
+    LogHallSample hall[LOG_EVENT_SAMPLES];  ///< header.count samples
+};
+
+/**
+ * @brief A memory-mapped log file and its chunks
+ */
+struct LogFile {
+    std::string path;
+    uint8_t format = LOG_FORMAT_CSV;  ///< LogRecordFormat
+    bool hasHeader = false;           ///< Binary header found and valid
+    LogFileHeader header{};
+    uint16_t fileId = 0;              ///< Id stored in every block
+    /// Gape calibration: from the header, or the `#C` lines of CSV files
+    LogCalibration cal{};
+    /// Hall channels logged: from the header, or the `hallN` columns of CSV
+    /// files
+    uint8_t hallMask = LOG_HALL_MASK_ALL;
+    /// Temperatures per record: from the header, or the `TempN.C` columns of
+    /// CSV files
+    uint8_t tempProbes = 1;
+
+    const uint8_t *data = nullptr;    ///< Mapped file
+    size_t size = 0;
+    /// Chunk boundaries, byte offsets: chunk i is [bounds[i], bounds[i + 1])
+    std::vector<size_t> bounds;
+
+    ~LogFile();
+};
+
+/**
+ * @brief Map a file, detect its format and split it into chunks
+ *
+ * @param[in]  path     File to open
+ * @param[out] file     Mapped file
+ * @param[out] error    Reason of the failure
+ *
+ * @return True on success
+ */
+bool READER_open(const std::string &path, LogFile *file, std::string *error);
+
+/**
+ * @brief Decode one chunk of a file
+ *
+ * @param[in]  file         Mapped file
+ * @param[in]  chunk        Chunk index
+ * @param[out] records      Decoded records, appended
+ * @param[out] events       Decoded burst captures, appended
+ * @param[out] summaries    Decoded interval summaries, appended
+ * @param[out] issues       Validation counters of the chunk
+ */
+void READER_decodeChunk(const LogFile &file, const size_t chunk,
+                        std::vector<LogRecord> *records,
+                        std::vector<ReaderEvent> *events,
+                        std::vector<LogSummary> *summaries,
+                        ReaderIssues *issues);
+
+/**
+ * @brief Check the time continuity of the records of a whole file
+ *
+ * @param[in]  file         Decoded file (for the sample period, the
+ *                          change-driven logging heartbeat and the decimation
+ *                          of files with interval statistics)
+ * @param[in]  records      All records of the file, in order
+ * @param[out] issues       Time regressions and gaps are added here
+ */
+void READER_checkTime(const LogFile &file,
+                      const std::vector<LogRecord> &records,
+                      ReaderIssues *issues);
+
+#endif  // !__LOG_READER_H__
@@ -0,0 +1,430 @@
+/**
+ * @file    log_writer.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "log_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Bytes of formatted CSV kept in memory before writing them out
+#define WRITER_BUFFER_BYTES (1u << 20)
+
+/**
+ * @brief Format "YYYY-MM-DD hh:mm:ss" for a POSIX time (UTC, 19 chars)
+ */
+static void _formatDateTime(uint32_t t, char *out) {
+    // Civil date from days since 1970-01-01 (H. Hinnant's algorithm)
+    int32_t _z = t / 86400 + 719468;
+    uint32_t _sec = t % 86400;
+    int32_t _era = _z / 146097;
+    uint32_t _doe = _z - _era * 146097;
+    uint32_t _yoe = (_doe - _doe / 1460 + _doe / 36524 - _doe / 146096) / 365;
+    uint32_t _doy = _doe - (365 * _yoe + _yoe / 4 - _yoe / 100);
+    uint32_t _mp = (5 * _doy + 2) / 153;
+    uint32_t _d = _doy - (153 * _mp + 2) / 5 + 1;
+    uint32_t _m = _mp < 10 ? _mp + 3 : _mp - 9;
+    uint32_t _y = _yoe + _era * 400 + (_m <= 2);
+
+    uint32_t _v[6] = {_y, _m, _d, _sec / 3600, _sec / 60 % 60, _sec % 60};
+    static const char _sep[6] = {'-', '-', ' ', ':', ':', 0};
+    char *_p = out;
+    for (uint8_t _i = 0; _i < 6; ++_i) {
+        if (_i == 0) {
+            *_p++ = '0' + _v[0] / 1000 % 10;
+            *_p++ = '0' + _v[0] / 100 % 10;
+        }
+        *_p++ = '0' + _v[_i] / 10 % 10;
+        *_p++ = '0' + _v[_i] % 10;
+        if (_sep[_i]) {
+            *_p++ = _sep[_i];
+        }
+    }
+}
+
+/**
+ * @brief Append an unsigned decimal number
+ */
+static char *_putUint(char *p, uint32_t v) {
+    char _tmp[10];
+    uint8_t _n = 0;
+    do {
+        _tmp[_n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (_n) {
+        *p++ = _tmp[--_n];
+    }
+    return p;
+}
+
+/**
+ * @brief Build the conversion tables of the calibrated channels
+ */
+static void _calTables(const LogCalibration &cal, LogCalTable *tables) {
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (cal.channels & (1 << _c)) {
+            tables[_c] = LOG_calTable(cal.points[_c]);
+        }
+    }
+}
+
+bool WRITER_csv(const std::string &path, const LogFile &file,
+                const std::vector<LogRecord> &records) {
+    FILE *_out = fopen(path.c_str(), "wb");
+    if (!_out) {
+        return false;
+    }
+
+    const LogCalibration &_cal = file.cal;
+    const uint8_t _mask = file.hallMask;
+    const bool _gapes = (_cal.channels & _mask) != 0;
+    LogCalTable _tables[LOG_HALL_CHANNELS];
+    _calTables(_cal, _tables);
+
+    // Columns of the logged channels only, as on the device
+    std::vector<char> _buf(WRITER_BUFFER_BYTES + 256);
+    char *_p = _buf.data();
+    _p += sprintf(_p, "POSIXt,DateTime");
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (_mask & (1 << _c)) {
+            _p += sprintf(_p, ",hall%u", _c + 1);
+        }
+    }
+    if (file.tempProbes == 1) {
+        _p += sprintf(_p, ",Temp.C");
+    } else {  // One column per probe
+        for (uint8_t _i = 0; _i < file.tempProbes; ++_i) {
+            _p += sprintf(_p, ",Temp%u.C", _i + 1);
+        }
+    }
+    if (_mask & LOG_SUPPLY_bm) {
+        _p += sprintf(_p, ",Supply.V");
+    }
+    for (uint8_t _c = 0; _gapes && _c < LOG_HALL_CHANNELS; ++_c) {
+        if (_mask & (1 << _c)) {
+            _p += sprintf(_p, ",gape%u", _c + 1);
+        }
+    }
+    _p += sprintf(_p, "\r\n");
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (_cal.channels & (1 << _c)) {
+            _p += sprintf(_p, "#C,%u", _c + 1);
+            for (uint8_t _i = 0; _i < LOG_CAL_POINTS; ++_i) {
+                _p += sprintf(_p, ",%u,%u", _cal.points[_c][_i].raw,
+                              _cal.points[_c][_i].gapeUm);
+            }
+            _p += sprintf(_p, "\r\n");
+        }
+    }
+
+    // The date only changes once a day, keep the last one formatted
+    uint32_t _day = UINT32_MAX;
+    char _dt[20];
+    bool _ok = true;
+    for (const LogRecord &_r : records) {
+        if (_r.time / 86400 != _day) {
+            _day = _r.time / 86400;
+            _formatDateTime(_r.time, _dt);
+        } else {
+            uint32_t _s = _r.time % 86400;
+            uint32_t _hms[3] = {_s / 3600, _s / 60 % 60, _s % 60};
+            for (uint8_t _i = 0; _i < 3; ++_i) {
+                _dt[11 + 3 * _i] = '0' + _hms[_i] / 10;
+                _dt[12 + 3 * _i] = '0' + _hms[_i] % 10;
+            }
+        }
+
+        // Sub-second times carry the milliseconds in both columns
+        char _ms[4] = {'.', char('0' + _r.timeMs / 100),
+                       char('0' + _r.timeMs / 10 % 10),
+                       char('0' + _r.timeMs % 10)};
+        _p = _putUint(_p, _r.time);
+        if (_mask & LOG_MILLIS_bm) {
+            memcpy(_p, _ms, 4);
+            _p += 4;
+        }
+        *_p++ = ',';
+        memcpy(_p, _dt, 19);
+        _p += 19;
+        if (_mask & LOG_MILLIS_bm) {
+            memcpy(_p, _ms, 4);
+            _p += 4;
+        }
+        for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+            if (_mask & (1 << _i)) {
+                *_p++ = ',';
+                _p = _putUint(_p, _r.hall[_i]);
+            }
+        }
+        for (uint8_t _i = 0; _i < file.tempProbes; ++_i) {
+            *_p++ = ',';
+            if (_r.tempCenti[_i] == LOG_TEMP_INVALID) {
+                continue;
+            }
+            int32_t _c = _r.tempCenti[_i];
+            if (_c < 0) {
+                *_p++ = '-';
+                _c = -_c;
+            }
+            _p = _putUint(_p, _c / 100);
+            *_p++ = '.';
+            *_p++ = '0' + _c % 100 / 10;
+            *_p++ = '0' + _c % 10;
+        }
+        if (_mask & LOG_SUPPLY_bm) {
+            *_p++ = ',';
+            if (_r.supplyCenti) {
+                _p = _putUint(_p, _r.supplyCenti / 100);
+                *_p++ = '.';
+                *_p++ = '0' + _r.supplyCenti % 100 / 10;
+                *_p++ = '0' + _r.supplyCenti % 10;
+            }
+        }
+        for (uint8_t _c = 0; _gapes && _c < LOG_HALL_CHANNELS; ++_c) {
+            if (!(_mask & (1 << _c))) {
+                continue;
+            }
+            *_p++ = ',';
+            if (_cal.channels & (1 << _c)) {
+                uint16_t _um = LOG_calApply(_tables[_c], _r.hall[_c]);
+                _p = _putUint(_p, _um / 1000);
+                *_p++ = '.';
+                *_p++ = '0' + _um / 100 % 10;
+                *_p++ = '0' + _um / 10 % 10;
+                *_p++ = '0' + _um % 10;
+            }
+        }
+        *_p++ = '\r';
+        *_p++ = '\n';
+
+        if (_p - _buf.data() >= (ptrdiff_t)WRITER_BUFFER_BYTES) {
+            _ok &= fwrite(_buf.data(), 1, _p - _buf.data(), _out) ==
+                   (size_t)(_p - _buf.data());
+            _p = _buf.data();
+        }
+    }
+    _ok &= fwrite(_buf.data(), 1, _p - _buf.data(), _out) ==
+           (size_t)(_p - _buf.data());
+    return (fclose(_out) == 0) && _ok;
+}
+
+bool WRITER_events(const std::string &path,
+                   const std::vector<ReaderEvent> &events) {
+    FILE *_out = fopen(path.c_str(), "wb");
+    if (!_out) {
+        return false;
+    }
+
+    bool _ok = fprintf(_out, "event,POSIXt,sample,hall1,hall2,hall3,hall4,"
+                             "hall5,hall6\r\n") > 0;
+    for (size_t _e = 0; _e < events.size() && _ok; ++_e) {
+        const LogEventHeader &_h = events[_e].header;
+        int64_t _trigger = (int64_t)_h.time * 1000 + _h.timeMs;
+        for (uint8_t _i = 0; _i < _h.count; ++_i) {
+            int32_t _n = (int32_t)_i - _h.pre;
+            int64_t _ms = _trigger + (int64_t)_n * _h.periodUs / 1000;
+            const uint16_t *_v = events[_e].hall[_i];
+            _ok &= fprintf(_out, "%zu,%lld.%03u,%d,%u,%u,%u,%u,%u,%u\r\n",
+                           _e + 1, (long long)(_ms / 1000),
+                           (unsigned)(_ms % 1000), _n, _v[0], _v[1], _v[2],
+                           _v[3], _v[4], _v[5]) > 0;
+        }
+    }
+    return (fclose(_out) == 0) && _ok;
+}
+
+/**
+ * @brief Print a temperature in centi-degrees with two decimals, nothing for
+ * LOG_TEMP_INVALID
+ */
+static int _printTemp(FILE *out, const int16_t temp_centi) {
+    if (temp_centi == LOG_TEMP_INVALID) {
+        return 0;
+    }
+    int32_t _v = temp_centi < 0 ? -(int32_t)temp_centi : temp_centi;
+    return fprintf(out, "%s%d.%02d", temp_centi < 0 ? "-" : "",
+                   (int)(_v / 100), (int)(_v % 100));
+}
+
+bool WRITER_summaries(const std::string &path, const LogFile &file,
+                      const std::vector<LogSummary> &summaries) {
+    FILE *_out = fopen(path.c_str(), "wb");
+    if (!_out) {
+        return false;
+    }
+
+    bool _ok = fprintf(_out, "POSIXt,DateTime,samples") > 0;
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        if (file.hallMask & (1 << _i)) {
+            _ok &= fprintf(_out,
+                           ",hall%u_min,hall%u_max,hall%u_mean,hall%u_var",
+                           _i + 1, _i + 1, _i + 1, _i + 1) > 0;
+        }
+    }
+    _ok &= fprintf(_out, ",Temp.C_min,Temp.C_max,Temp.C_mean\r\n") > 0;
+
+    const double _q = 1.0 / (1 << LOG_STATS_FRAC);
+    for (const LogSummary &_s : summaries) {
+        char _dt[20] = {0};
+        _formatDateTime(_s.time, _dt);
+        _ok &= fprintf(_out, "%u,%s,%u", (unsigned)_s.time, _dt,
+                       (unsigned)_s.count) > 0;
+        for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+            if (file.hallMask & (1 << _i)) {
+                _ok &= fprintf(_out, ",%u,%u,%.4f,%.4f", (unsigned)_s.min[_i],
+                               (unsigned)_s.max[_i], _s.mean[_i] * _q,
+                               _s.var[_i] * _q) > 0;
+            }
+        }
+        const int16_t _temps[3] = {_s.tempMin, _s.tempMax, _s.tempMean};
+        for (uint8_t _n = 0; _n < 3; ++_n) {
+            _ok &= fputc(',', _out) != EOF && _printTemp(_out, _temps[_n]) >= 0;
+        }
+        _ok &= fprintf(_out, "\r\n") > 0;
+        if (!_ok) {
+            break;
+        }
+    }
+    return (fclose(_out) == 0) && _ok;
+}
+
+/**
+ * @brief Column table entry of a columnar file
+ */
+struct __attribute__((packed)) ColumnEntry {
+    char name[8];
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t offset;
+};
+
+bool WRITER_columnar(const std::string &path, const LogFile &file,
+                     const std::vector<LogRecord> &records) {
+    static const char *_names[9] = {"time",  "hall1", "hall2",  "hall3",
+                                    "hall4", "hall5", "hall6",  "temp_c",
+                                    "supply_v"};
+    static const uint8_t _types[9] = {0, 1, 1, 1, 1, 1, 1, 2, 1};
+    static const uint8_t _sizes[3] = {4, 2, 2};
+
+    FILE *_out = fopen(path.c_str(), "wb");
+    if (!_out) {
+        return false;
+    }
+
+    // Time (and its milliseconds, if logged), the logged hall channels, the
+    // temperature of each probe and the supply (if logged), then one gape
+    // column per logged and calibrated channel. Probes after the first are
+    // sources from _probeSrc on, the milliseconds source _msSrc.
+    static const uint8_t _probeSrc = 9 + LOG_HALL_CHANNELS;
+    static const uint8_t _msSrc = _probeSrc + LOG_TEMP_PROBES - 1;
+    LogCalTable _tables[LOG_HALL_CHANNELS];
+    _calTables(file.cal, _tables);
+    uint8_t _source[_msSrc + 1];
+    uint8_t _n = 0;
+    for (uint8_t _s = 0; _s < 9; ++_s) {
+        if (_s == 0 || _s == 7 ||
+            (_s == 8 ? file.hallMask & LOG_SUPPLY_bm
+                     : file.hallMask & (1 << (_s - 1)))) {
+            _source[_n++] = _s;
+        }
+        if (_s == 0 && (file.hallMask & LOG_MILLIS_bm)) {
+            _source[_n++] = _msSrc;
+        }
+        for (uint8_t _k = 1; _s == 7 && _k < file.tempProbes; ++_k) {
+            _source[_n++] = _probeSrc + _k - 1;
+        }
+    }
+    for (uint8_t _c = 0; _c < LOG_HALL_CHANNELS; ++_c) {
+        if (file.cal.channels & file.hallMask & (1 << _c)) {
+            _source[_n++] = 9 + _c;
+        }
+    }
+
+    uint32_t _rows = records.size();
+    uint8_t _head[16] = {'B', 'H', 'D', 'C', 1, _n};
+    uint16_t _sn = file.hasHeader ? file.header.serialNumber : 0;
+    uint32_t _period = file.hasHeader ? file.header.samplePeriodMs : 1000;
+    memcpy(&_head[6], &_sn, 2);
+    memcpy(&_head[8], &_rows, 4);
+    memcpy(&_head[12], &_period, 4);
+
+    ColumnEntry _cols[_msSrc + 1];
+    uint32_t _offset = sizeof(_head) + _n * sizeof(ColumnEntry);
+    for (uint8_t _c = 0; _c < _n; ++_c) {
+        memset(&_cols[_c], 0, sizeof(ColumnEntry));
+        if (_source[_c] == _msSrc) {
+            memcpy(_cols[_c].name, "time_ms", 7);
+            _cols[_c].type = 1;
+        } else if (file.tempProbes > 1 &&
+            (_source[_c] == 7 || _source[_c] >= _probeSrc)) {
+            memcpy(_cols[_c].name, "temp1_c", 7);
+            _cols[_c].name[4] += _source[_c] == 7 ? 0
+                                                  : _source[_c] - _probeSrc + 1;
+            _cols[_c].type = 2;
+        } else if (_source[_c] < 9) {
+            strncpy(_cols[_c].name, _names[_source[_c]],
+                    sizeof(_cols[_c].name));
+            _cols[_c].type = _types[_source[_c]];
+        } else {
+            snprintf(_cols[_c].name, sizeof(_cols[_c].name), "gape%u",
+                     _source[_c] - 8);
+            _cols[_c].type = 1;
+        }
+        _offset = (_offset + 7) & ~7u;
+        _cols[_c].offset = _offset;
+        _offset += _rows * _sizes[_cols[_c].type];
+    }
+
+    bool _ok = fwrite(_head, 1, sizeof(_head), _out) == sizeof(_head);
+    _ok &= fwrite(_cols, sizeof(ColumnEntry), _n, _out) == _n;
+
+    std::vector<uint8_t> _col;
+    size_t _pos = sizeof(_head) + _n * sizeof(ColumnEntry);
+    for (uint8_t _c = 0; _c < _n && _ok; ++_c) {
+        static const uint8_t _zero[8] = {0};
+        _ok &= fwrite(_zero, 1, _cols[_c].offset - _pos, _out) ==
+               _cols[_c].offset - _pos;
+
+        uint8_t _size = _sizes[_cols[_c].type];
+        uint8_t _s = _source[_c];
+        _col.resize((size_t)_rows * _size);
+        for (uint32_t _i = 0; _i < _rows; ++_i) {
+            const LogRecord &_r = records[_i];
+            if (_s == 0) {
+                memcpy(&_col[_i * 4], &_r.time, 4);
+            } else if (_s == _msSrc) {
+                memcpy(&_col[_i * 2], &_r.timeMs, 2);
+            } else if (_s == 7) {
+                memcpy(&_col[_i * 2], &_r.tempCenti[0], 2);
+            } else if (_s >= _probeSrc) {
+                memcpy(&_col[_i * 2], &_r.tempCenti[_s - _probeSrc + 1], 2);
+            } else if (_s == 8) {
+                memcpy(&_col[_i * 2], &_r.supplyCenti, 2);
+            } else if (_s < 7) {
+                memcpy(&_col[_i * 2], &_r.hall[_s - 1], 2);
+            } else {
+                uint16_t _um = LOG_calApply(_tables[_s - 9], _r.hall[_s - 9]);
+                memcpy(&_col[_i * 2], &_um, 2);
+            }
+        }
+        _ok &= fwrite(_col.data(), 1, _col.size(), _out) == _col.size();
+        _pos = _cols[_c].offset + _col.size();
+    }
+    return (fclose(_out) == 0) && _ok;
+}
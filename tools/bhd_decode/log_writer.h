@@ -0,0 +1,100 @@
+/**
+ * @file    log_writer.h
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Output formats of the host decoder: CSV with the same layout as
+ * the device, and a compact columnar file (.bhc) with one little-endian array
+ * per column:
+ *
+ * | Offset | Size    | Field                                            |
+ * | ------ | ------- | ------------------------------------------------ |
+ * | 0      | 4       | `BHDC`                                           |
+ * | 4      | 1       | Version (1)                                      |
+ * | 5      | 1       | Number of columns (8)                            |
+ * | 6      | 2       | Serial number                                    |
+ * | 8      | 4       | Number of rows                                   |
+ * | 12     | 4       | Sample period in ms                              |
+ * | 16     | 16 x N  | Columns: name[8], type, 3 reserved, data offset   |
+ *
+ * Column types: 0 uint32, 1 uint16, 2 int16. Arrays are 8-byte aligned.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOG_WRITER_H__
+#define __LOG_WRITER_H__
+
+#include <string>
+#include <vector>
+
+#include "log_reader.h"
+
+/**
+ * @brief Write records as CSV, with the device header line and the logged hall
+ * channels only. With a gape calibration, the gapes in millimetres follow the
+ * temperature and the calibration follows the header line as on the device.
+ *
+ * @param[in] path      Output file
+ * @param[in] file      Source file (hall channels and gape calibration)
+ * @param[in] records   Records to write
+ *
+ * @return True on success
+ */
+bool WRITER_csv(const std::string &path, const LogFile &file,
+                const std::vector<LogRecord> &records);
+
+/**
+ * @brief Write burst captures as CSV, one line per sample with the event
+ * number, the sample time (POSIX seconds with milliseconds) and its index
+ * relative to the trigger
+ *
+ * @param[in] path      Output file
+ * @param[in] events    Events to write
+ *
+ * @return True on success
+ */
+bool WRITER_events(const std::string &path,
+                   const std::vector<ReaderEvent> &events);
+
+/**
+ * @brief Write interval summaries as CSV, one line per window with its start,
+ * the samples and the min, max, mean and variance of each logged hall channel
+ * and of the temperature
+ *
+ * @param[in] path      Output file
+ * @param[in] file      Source file (hall channels)
+ * @param[in] summaries Summaries to write
+ *
+ * @return True on success
+ */
+bool WRITER_summaries(const std::string &path, const LogFile &file,
+                      const std::vector<LogSummary> &summaries);
+
+/**
+ * @brief Write records as a columnar file, with a `time_ms` column for files
+ * with sub-second times, a `hallN` column for each logged channel and a
+ * `gapeN` column in micrometres for each logged and calibrated channel
+ *
+ * @param[in] path      Output file
+ * @param[in] file      Source file (serial number, sample period, hall
+ *                      channels and gape calibration)
+ * @param[in] records   Records to write
+ *
+ * @return True on success
+ */
+bool WRITER_columnar(const std::string &path, const LogFile &file,
+                     const std::vector<LogRecord> &records);
+
+#endif  // !__LOG_WRITER_H__
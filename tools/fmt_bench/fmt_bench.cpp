@@ -0,0 +1,357 @@
+/**
+ * @file    fmt_bench.cpp
+ * @author  Agustín Capovilla
+ * @date    2025-10
+ *
+ * @brief   Host benchmark of the CSV record formatting: the previous
+ * Print-based path (DateTime::toString() on a copied template, Print number and
+ * float conversion, one virtual write per field) against the fixed-point
+ * formatter of log_text.h, over two days of 1 Hz records. Both paths write
+ * into a 512-byte sector buffer like the firmware and their output is compared
+ * byte by byte (the temperature to its last digit, see main()).
+ *
+ * The Arduino and RTClib code is reproduced here so it runs on the host; floats
+ * are single precision as on AVR. Host cycles are not AVR cycles (no hardware
+ * divider or FPU there, so the gap is wider on the device), but they rank the
+ * two paths and show where the time goes.
+ *
+ * Usage: fmt_bench [RECORDS]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static inline uint64_t _ticks(void) {
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t _ticks(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+#include "log_text.h"
+
+// Repetitions of each path, the fastest one is reported
+#define BENCH_RUNS 5
+
+// DS18B20 raw value of a failed reading (DallasTemperature)
+#define DEVICE_DISCONNECTED_RAW -7040
+
+/**
+ * @brief Input of one record: the fields of the RTC DateTime, the hall values
+ * and the raw DS18B20 reading (1/128 degrees)
+ */
+struct BenchInput {
+    uint32_t time;
+    uint8_t yOff, m, d, hh, mm, ss;
+    uint16_t hall[LOG_HALL_CHANNELS];
+    int32_t tempRaw;
+};
+
+/*******************************************************
+ * Sector buffer sink (SectorBuffer in sd_manager.cpp)
+ *******************************************************/
+class Sink {
+   public:
+    virtual ~Sink() {}
+    virtual size_t write(uint8_t c) {
+        return write(&c, 1);
+    }
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        while (size) {
+            size_t _chunk = sizeof(data) - len;
+            if (_chunk > size) {
+                _chunk = size;
+            }
+            memcpy(&data[len], buffer, _chunk);
+            buffer += _chunk;
+            size -= _chunk;
+            len += _chunk;
+            if (len == sizeof(data)) {  // Sector full, written to the card
+                checksum += data[0] + data[sizeof(data) - 1];
+                len = 0;
+            }
+        }
+        return size;
+    }
+    uint8_t data[512];
+    size_t len = 0;
+    uint32_t checksum = 0;
+};
+
+/*******************************************************
+ * Previous path: Arduino Print and RTClib DateTime
+ *******************************************************/
+class Print : public Sink {
+   public:
+    size_t print(const char *s) {
+        return write((const uint8_t *)s, strlen(s));
+    }
+    size_t printChars(const char *s) {  // print(F("..."))
+        size_t _n = 0;
+        while (*s) {
+            _n += write((uint8_t)*s++);
+        }
+        return _n;
+    }
+    size_t print(unsigned long n) {
+        char _buf[8 * sizeof(long) + 1];
+        char *_str = &_buf[sizeof(_buf) - 1];
+        *_str = '\0';
+        do {
+            char _c = n % 10;
+            n /= 10;
+            *--_str = _c + '0';
+        } while (n);
+        return print(_str);
+    }
+    size_t print(float number, uint8_t digits) {
+        size_t _n = 0;
+        if (isnan(number)) {
+            return print("nan");
+        }
+        if (number < 0.0f) {
+            _n += write('-');
+            number = -number;
+        }
+        float _rounding = 0.5f;
+        for (uint8_t _i = 0; _i < digits; ++_i) {
+            _rounding /= 10.0f;
+        }
+        number += _rounding;
+        unsigned long _int = (unsigned long)number;
+        float _rem = number - (float)_int;
+        _n += print(_int);
+        if (digits > 0) {
+            _n += write('.');
+        }
+        while (digits-- > 0) {
+            _rem *= 10.0f;
+            unsigned int _d = (unsigned int)_rem;
+            _n += print((unsigned long)_d);
+            _rem -= _d;
+        }
+        return _n;
+    }
+    size_t println(void) {
+        return write((const uint8_t *)"\r\n", 2);
+    }
+};
+
+/**
+ * @brief DateTime::toString() of RTClib 2.1.1 for the tokens of the log
+ * timestamp (the template is scanned with strlen() on every character)
+ */
+static char *_toString(const BenchInput &dt, char *buffer) {
+    for (size_t _i = 0; _i < strlen(buffer) - 1; ++_i) {
+        if (buffer[_i] == 'h' && buffer[_i + 1] == 'h') {
+            buffer[_i] = '0' + dt.hh / 10;
+            buffer[_i + 1] = '0' + dt.hh % 10;
+        }
+        if (buffer[_i] == 'm' && buffer[_i + 1] == 'm') {
+            buffer[_i] = '0' + dt.mm / 10;
+            buffer[_i + 1] = '0' + dt.mm % 10;
+        }
+        if (buffer[_i] == 's' && buffer[_i + 1] == 's') {
+            buffer[_i] = '0' + dt.ss / 10;
+            buffer[_i + 1] = '0' + dt.ss % 10;
+        }
+        if (buffer[_i] == 'D' && buffer[_i + 1] == 'D') {
+            buffer[_i] = '0' + dt.d / 10;
+            buffer[_i + 1] = '0' + dt.d % 10;
+        }
+        if (buffer[_i] == 'M' && buffer[_i + 1] == 'M') {
+            buffer[_i] = '0' + dt.m / 10;
+            buffer[_i + 1] = '0' + dt.m % 10;
+        }
+        if (buffer[_i] == 'Y' && buffer[_i + 1] == 'Y' &&
+            buffer[_i + 2] == 'Y' && buffer[_i + 3] == 'Y') {
+            buffer[_i] = '2';
+            buffer[_i + 1] = '0';
+            buffer[_i + 2] = '0' + (dt.yOff / 10) % 10;
+            buffer[_i + 3] = '0' + dt.yOff % 10;
+        }
+    }
+    return buffer;
+}
+
+/**
+ * @brief Previous record path: printTimeToBuffer(), getTempC() and _writeCSV()
+ */
+static void _writePrint(Print &out, const BenchInput &in) {
+    char _timestamp[] = "YYYY-MM-DD hh:mm:ss";
+    strcpy(_timestamp, "YYYY-MM-DD hh:mm:ss");
+    _toString(in, _timestamp);
+
+    float _tempC = in.tempRaw <= DEVICE_DISCONNECTED_RAW
+                       ? -127.0f
+                       : (float)in.tempRaw * 0.0078125f;
+
+    out.print((unsigned long)in.time);
+    out.printChars(",");
+    out.print(_timestamp);
+    out.printChars(",");
+    for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+        out.print((unsigned long)in.hall[_i]);
+        out.printChars(",");
+    }
+    out.print(_tempC, 2);
+    out.println();
+}
+
+/*******************************************************
+ * New path: fixed-point formatter
+ *******************************************************/
+/**
+ * @brief New record path: TEMP_read() conversion, LOG_timeTextUpdate() and
+ * _writeCSV()
+ */
+static void _writeFixed(Sink &out, LogTimeText &text, const BenchInput &in) {
+    LogRecord _record;
+    _record.time = in.time;
+    memcpy(_record.hall, in.hall, sizeof(_record.hall));
+    if (in.tempRaw <= DEVICE_DISCONNECTED_RAW) {
+        _record.tempCenti[0] = -12700;
+    } else if (in.tempRaw < 0) {
+        _record.tempCenti[0] = -(int16_t)((-in.tempRaw * 25 + 16) >> 5);
+    } else {
+        _record.tempCenti[0] = (in.tempRaw * 25 + 16) >> 5;
+    }
+
+    LOG_timeTextUpdate(&text, in.time);
+    char _line[LOG_TEXT_MAX_SIZE];
+    uint8_t _n = LOG_formatRecord(_line, &_record, &text, true,
+                                  LOG_HALL_MASK_ALL, nullptr);
+    out.write((const uint8_t *)_line, _n);
+}
+
+/*******************************************************
+ * Benchmark
+ *******************************************************/
+static void _makeInput(std::vector<BenchInput> &input) {
+    uint32_t _t = 1759276800UL;  // 2025-10-01 00:00:00
+    uint32_t _seed = 1;
+    for (size_t _k = 0; _k < input.size(); ++_k, ++_t) {
+        BenchInput &_in = input[_k];
+        _in.time = _t;
+
+        // Civil date (RTC registers)
+        uint32_t _days = _t / 86400, _sec = _t % 86400;
+        int32_t _z = _days + 719468, _era = _z / 146097;
+        uint32_t _doe = _z - _era * 146097;
+        uint32_t _yoe = (_doe - _doe / 1460 + _doe / 36524 - _doe / 146096) /
+                        365;
+        uint32_t _doy = _doe - (365 * _yoe + _yoe / 4 - _yoe / 100);
+        uint32_t _mp = (5 * _doy + 2) / 153;
+        _in.d = _doy - (153 * _mp + 2) / 5 + 1;
+        _in.m = _mp < 10 ? _mp + 3 : _mp - 9;
+        _in.yOff = _yoe + _era * 400 + (_in.m <= 2) - 2000;
+        _in.hh = _sec / 3600;
+        _in.mm = _sec / 60 % 60;
+        _in.ss = _sec % 60;
+
+        for (uint8_t _i = 0; _i < LOG_HALL_CHANNELS; ++_i) {
+            _seed = _seed * 1103515245u + 12345u;
+            _in.hall[_i] = 1500 + _i * 300 + (_seed >> 16) % 64;
+        }
+        // Slow swing through negative values, with a few failed readings
+        _in.tempRaw = (int32_t)(3000.0 * sin(_k / 2000.0)) & ~7;
+        if (_k % 10007 == 10006) {
+            _in.tempRaw = DEVICE_DISCONNECTED_RAW;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t _records = argc > 1 ? strtoul(argv[1], NULL, 10) : 2 * 86400;
+    if (_records == 0) {
+        fprintf(stderr, "usage: %s [RECORDS]\n", argv[0]);
+        return 2;
+    }
+    std::vector<BenchInput> _input(_records);
+    _makeInput(_input);
+
+    // Both paths must render the same bytes, except for the last temperature
+    // digit: Print adds 0.005 in float and truncates, so some halves round
+    // down, while centi-degrees round half away from zero like the binary
+    // formats
+    size_t _mismatches = 0, _rounding = 0;
+    LogTimeText _text;
+    LOG_timeTextReset(&_text);
+    for (const BenchInput &_in : _input) {
+        Print _a;
+        Sink _b;
+        _writePrint(_a, _in);
+        _writeFixed(_b, _text, _in);
+        if (_a.len == _b.len && memcmp(_a.data, _b.data, _a.len) == 0) {
+            continue;
+        }
+        const char *_ta = (const char *)memrchr(_a.data, ',', _a.len);
+        const char *_tb = (const char *)memrchr(_b.data, ',', _b.len);
+        size_t _na = _ta - (const char *)_a.data;
+        if (_ta && _tb && _na == (size_t)(_tb - (const char *)_b.data) &&
+            memcmp(_a.data, _b.data, _na) == 0 &&
+            fabs(atof(_ta + 1) - atof(_tb + 1)) < 0.015) {
+            ++_rounding;
+        } else if (_mismatches++ < 5) {
+            fprintf(stderr, "mismatch: %.*s     vs %.*s", (int)_a.len, _a.data,
+                    (int)_b.len, _b.data);
+        }
+    }
+
+    uint64_t _best[2] = {UINT64_MAX, UINT64_MAX};
+    uint32_t _sum = 0;
+    for (uint8_t _run = 0; _run < BENCH_RUNS; ++_run) {
+        Print _a;
+        uint64_t _t0 = _ticks();
+        for (const BenchInput &_in : _input) {
+            _writePrint(_a, _in);
+        }
+        uint64_t _t1 = _ticks();
+        Sink _b;
+        LOG_timeTextReset(&_text);
+        for (const BenchInput &_in : _input) {
+            _writeFixed(_b, _text, _in);
+        }
+        uint64_t _t2 = _ticks();
+        _best[0] = _t1 - _t0 < _best[0] ? _t1 - _t0 : _best[0];
+        _best[1] = _t2 - _t1 < _best[1] ? _t2 - _t1 : _best[1];
+        _sum += _a.checksum + _b.checksum;
+    }
+
+    double _before = (double)_best[0] / _records;
+    double _after = (double)_best[1] / _records;
+    printf("records            : %zu (checksum %u)\n", _records,
+           (unsigned)_sum);
+    printf("Print + toString   : %8.1f %s/record\n", _before, BENCH_UNIT);
+    printf("fixed-point        : %8.1f %s/record\n", _after, BENCH_UNIT);
+    printf("speed-up           : %8.2fx\n", _before / _after);
+    printf("temperature halves : %zu rounded up instead of down\n", _rounding);
+    printf("output mismatches  : %zu\n", _mismatches);
+    return _mismatches != 0;
+}